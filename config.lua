@@ -18,6 +18,7 @@ audio =
     use_effects = 1;
     listener_is_player = 0;
     stream_buffer_size = 128;
+    sample_cache_size = 16384;                  -- KB of decoded sound samples, 0 - no limit
 }
 
 render =
@@ -33,6 +34,18 @@ render =
     fog_color = {r = 255, g = 255, b = 255};
 }
 
+physics =
+{
+    step_rate = 60;                             -- Fixed simulation steps per second, independent from frame rate.
+    max_substeps = 4;                           -- Steps limit per frame, longer frames are slowed down.
+}
+
+script =
+{
+    gc_step_budget = 0;                         -- Microseconds of Lua GC work per frame, 0 - Lua collects by itself.
+    profile = 0;                                -- Collect scripts callbacks timings, see "script_profile" command.
+}
+
 controls =
 {
     mouse_sensitivity_x = 0.25;                 -- to inverse mouse axis use negative values
@@ -65,7 +65,7 @@ end
 function doTasks()
     local i = 0;
     while(engine_tasks[i] ~= nil) do
-        local t = engine_tasks[i]();
+        local t = callTask(engine_tasks[i]);   -- profiled per task function
         if(t == false or t == nil) then     -- remove task, if it returns nil or false.
             local j = i;
             while(engine_tasks[j] ~= nil) do
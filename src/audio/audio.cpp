@@ -64,8 +64,51 @@ typedef struct audio_effect_s
 
     ALuint      sample_index;       // First (or only) sample (buffer) index.
     ALuint      sample_count;       // Sample amount to randomly select from.
+
+    ALuint      priority;           // Base voice priority, see TR_AUDIO_PRIORITY_*.
 }audio_effect_t, *audio_effect_p;
 
+// Voice priorities. Busy scene steals voice with the lowest priority first,
+// audibility only orders voices inside one priority level.
+
+#define TR_AUDIO_PRIORITY_LOW       (0)     // Static sound sources (ambience), random chance effects.
+#define TR_AUDIO_PRIORITY_NORMAL    (1)     // Entities.
+#define TR_AUDIO_PRIORITY_HIGH      (2)     // Player, far-reaching effects.
+#define TR_AUDIO_PRIORITY_GLOBAL    (3)     // Menu, secrets and other global sounds.
+
+#define TR_AUDIO_PRIORITY_FAR_RANGE (16.0 * 1024.0) // Effects heard that far are loud events (explosions, alarms).
+
+// Looped effects that can't get a source (out of range or outvoted) are kept as
+// virtual voices and get a source back when they become important enough.
+
+#define TR_AUDIO_MAX_VIRTUAL_VOICES 64
+
+typedef struct audio_voice_s
+{
+    int32_t     effect_ID;
+    int32_t     emitter_ID;
+    uint32_t    emitter_type;
+    uint32_t    priority;
+}audio_voice_t, *audio_voice_p;
+
+// Level sample: raw data reference, decoded into AL buffer on first use.
+
+#define TR_AUDIO_SAMPLE_UNLOADED    (0)
+#define TR_AUDIO_SAMPLE_LOADED      (1)
+#define TR_AUDIO_SAMPLE_BROKEN      (2)
+
+typedef struct audio_sample_s
+{
+    uint32_t    offset;             // Offset of WAV data in level samples block.
+    uint32_t    size;               // Size of WAV data.
+    uint32_t    uncomp_size;        // Amount of PCM to keep (TR4/5), 0 - whole sample.
+    uint32_t    al_size;            // Bytes occupied in AL buffer.
+    uint32_t    last_used;          // Audio frame of last use, for LRU eviction.
+    uint16_t    state;
+    ALuint      buffer;
+    char       *file_name;          // Overridden sample file, replaces raw data.
+}audio_sample_t, *audio_sample_p;
+
 // Audio emitter (aka SoundSource) structure.
 
 typedef struct audio_emitter_s
@@ -95,6 +138,8 @@ public:
     void Update();  // Update source parameters.
 
     void SetBuffer(ALint buffer);           // Assign buffer to source.
+    bool ReleaseBuffer(ALuint buffer);      // Unbind AL buffer if it is not played.
+    void Deactivate();                      // Clear active flag and return source to free list.
     void SetLooping(ALboolean is_looping);  // Set looping flag.
     void SetPitch(ALfloat pitch_value);     // Set pitch shift.
     void SetGain(ALfloat gain_value);       // Set gain (volume).
@@ -107,12 +152,15 @@ public:
     uint32_t    effect_index;   // Effect index. Used to associate effect with entity for R/W flags.
     uint32_t    sample_index;   // OpenAL sample (buffer) index. May be the same for different sources.
     uint32_t    sample_count;   // How many buffers to use, beginning with sample_index.
+    uint32_t    priority;       // Voice priority, see TR_AUDIO_PRIORITY_*.
 
     friend int Audio_IsEffectPlaying(int effect_ID, int entity_type, int entity_ID);
+    friend int Audio_GetFreeSource();
 
 private:
     bool        active;         // Source gets autostopped and destroyed on next frame, if it's not set.
     bool        is_water;       // Marker to define if sample is in underwater state or not.
+    bool        in_free_list;   // Source index is pushed to free list (maybe stale, if it was reused by rewind).
     ALuint      source_index;   // Source index. Should be unique for each source.
 
     void LinkEmitter();                             // Link source to parent emitter.
@@ -128,8 +176,11 @@ public:
    ~StreamTrackBuffer();
 
     bool Load(int track_index);
+    uint8_t *GetData(uint32_t offset, size_t *bytes);       // PCM at byte offset, bytes is clamped to what is available.
+    void Suspend();                                         // Drop decoder state of a track that is not playing.
 
 private:
+    bool Open_Ogg();
     bool Load_Ogg(const char *path);                        // Ogg file loading routine.
     bool Load_Wad(const char *path, uint32_t track);        // Wad file loading routine.
     bool Load_Wav(const char *path);                        // Wav file loading routine.
@@ -144,6 +195,14 @@ public:
     int             channels;
     int             sample_bitsize;
     int             rate;
+
+private:
+    // OGG tracks are not decoded at once: buffer holds one buffer_part chunk,
+    // decoder keeps position and seeks if stream asks for other offset.
+    char           *ogg_path;
+    stb_vorbis     *ogg;
+    char           *ogg_alloc;
+    uint32_t        ogg_offset;          // Byte offset of the next decoded chunk.
 };
 
 
@@ -155,8 +214,20 @@ bool Audio_FillALBuffer(ALuint buf_number, Uint8* buffer_data, Uint32 buffer_siz
 int  Audio_LoadALbufferFromWAV_Mem(ALuint buf_number, uint8_t *sample_pointer, uint32_t sample_size, uint32_t uncomp_sample_size = 0);
 int  Audio_LoadALbufferFromWAV_File(ALuint buf_number, const char *fname);
 void Audio_LoadOverridedSamples();
+ALuint Audio_GetSampleBuffer(uint32_t sample_index);    // Decodes sample if it is not cached.
+void Audio_TrimSamples();                               // Evicts least recently used samples over budget.
 
 int  Audio_GetFreeSource();
+int  Audio_StealSource(float score);                // Stop the least important voice, if it is less important than score.
+float Audio_GetAudibility(int entity_type, int entity_ID, float range, float gain);
+uint32_t Audio_GetEffectPriority(audio_effect_p effect);
+uint32_t Audio_GetVoicePriority(audio_effect_p effect, int entity_type, int entity_ID);
+audio_effect_p Audio_GetEffect(int effect_ID);
+int  Audio_StartVoice(int source_number, int effect_ID, int entity_type, int entity_ID, uint32_t priority);
+int  Audio_AddVirtualVoice(int effect_ID, int entity_type, int entity_ID, uint32_t priority);
+int  Audio_RemoveVirtualVoices(int effect_ID, int entity_type, int entity_ID);
+int  Audio_FindVirtualVoice(int effect_ID, int entity_type, int entity_ID);
+void Audio_UpdateVirtualVoices();
 int  Audio_GetFreeStream();                         // Get free (stopped) stream.
 int  Audio_TrackAlreadyPlayed(uint32_t track_index, int8_t mask = 0);     // Check if track played with given activation mask.
 void Audio_UpdateStreams(float time);               // Update all streams.
@@ -178,19 +249,104 @@ StreamTrackBuffer::StreamTrackBuffer() :
     stream_type(TR_AUDIO_STREAM_TYPE_ONESHOT),
     channels(0),
     sample_bitsize(0),
-    rate(0)
+    rate(0),
+    ogg_path(NULL),
+    ogg(NULL),
+    ogg_alloc(NULL),
+    ogg_offset(0)
 {
 }
 
 
 StreamTrackBuffer::~StreamTrackBuffer()
 {
+    Suspend();
     if(buffer)
     {
         buffer_size = 0;
         free(buffer);
         buffer = NULL;
     }
+    if(ogg_path)
+    {
+        free(ogg_path);
+        ogg_path = NULL;
+    }
+}
+
+
+uint8_t *StreamTrackBuffer::GetData(uint32_t offset, size_t *bytes)
+{
+    if(offset >= buffer_size)
+    {
+        *bytes = 0;
+        return NULL;
+    }
+
+    if(*bytes > buffer_size - offset)
+    {
+        *bytes = buffer_size - offset;
+    }
+
+    if(!ogg_path)
+    {
+        return buffer + offset;
+    }
+
+    if(!ogg && !Open_Ogg())
+    {
+        *bytes = 0;
+        return NULL;
+    }
+
+    if(offset != ogg_offset)
+    {
+        int frame_size = channels * sizeof(short);
+        if(!stb_vorbis_seek(ogg, offset / frame_size))
+        {
+            *bytes = 0;
+            return NULL;
+        }
+        ogg_offset = offset - offset % frame_size;
+    }
+
+    if(*bytes > buffer_part)
+    {
+        *bytes = buffer_part;
+    }
+
+    int shorts = *bytes / sizeof(short);
+    shorts -= shorts % channels;
+    int readed = stb_vorbis_get_samples_short_interleaved(ogg, channels, (short*)buffer, shorts);
+    *bytes = readed * channels * sizeof(short);
+    ogg_offset += *bytes;
+    if(*bytes == 0)
+    {
+        buffer_size = ogg_offset;           // stream length from last page was too optimistic.
+        return NULL;
+    }
+
+    return buffer;
+}
+
+
+void StreamTrackBuffer::Suspend()
+{
+    if(ogg)
+    {
+        stb_vorbis_close(ogg);
+        ogg = NULL;
+    }
+    if(ogg_alloc)
+    {
+        free(ogg_alloc);
+        ogg_alloc = NULL;
+    }
+    if(ogg_path && buffer)
+    {
+        free(buffer);
+        buffer = NULL;
+    }
 }
 
 
@@ -223,56 +379,67 @@ bool StreamTrackBuffer::Load(int track_index)
         }
     }
 
-    return (this->buffer != NULL);
+    return (this->buffer != NULL) || (this->ogg_path != NULL);
 }
 
-///@TODO: fix vorbis streaming! ov_bitrate may differ in differ section
-bool StreamTrackBuffer::Load_Ogg(const char *path)
+bool StreamTrackBuffer::Open_Ogg()
 {
+    const int alloc_size = 256 * 1024;
     int err = 0;
     stb_vorbis_alloc alloc;
-    alloc.alloc_buffer_length_in_bytes = 256 * 1024;
-    alloc.alloc_buffer = (char*)Sys_GetTempMem(alloc.alloc_buffer_length_in_bytes);
-    stb_vorbis *ov = stb_vorbis_open_filename(path, &err, &alloc);
+    alloc.alloc_buffer_length_in_bytes = alloc_size;
+    alloc.alloc_buffer = ogg_alloc = (char*)malloc(alloc_size);
+    ogg = stb_vorbis_open_filename(ogg_path, &err, &alloc);
+    ogg_offset = 0;
 
-    if(!ov)
+    if(!ogg)
     {
-        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: Couldn't open file: %s.", path);
-        Sys_ReturnTempMem(alloc.alloc_buffer_length_in_bytes);
+        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: Couldn't open file: %s, error = %d.", ogg_path, err);
+        Suspend();
         return false;
     }
 
-    stb_vorbis_info info = stb_vorbis_get_info(ov);
+    if(!buffer && buffer_part)
+    {
+        buffer = (uint8_t*)malloc(buffer_part);
+    }
+
+    return true;
+}
+
+
+bool StreamTrackBuffer::Load_Ogg(const char *path)
+{
+    ogg_path = strdup(path);
+    if(!Open_Ogg())
+    {
+        free(ogg_path);
+        ogg_path = NULL;
+        return false;
+    }
+
+    stb_vorbis_info info = stb_vorbis_get_info(ogg);
     channels = info.channels;
     sample_bitsize = 16;
-    buffer_part = 96 * info.max_frame_size;
     rate = info.sample_rate;
+    buffer_size = stb_vorbis_stream_length_in_samples(ogg) * channels * sizeof(short);
 
-    {
-        const size_t temp_buf_size = 64 * 1024 * 1024;
-        size_t buffer_left = temp_buf_size / 2;
-        short *temp_buff = (short*)malloc(temp_buf_size);
-        size_t readed = 0;
-        buffer_size = 0;
-        while(0 != (readed = stb_vorbis_get_frame_short_interleaved(ov, channels, temp_buff + buffer_size, buffer_left)))
-        {
-            buffer_size += readed * channels;
-            buffer_left -= readed * channels;
-        }
-        buffer_size *= 2;
-        stb_vorbis_close(ov);
-        Sys_ReturnTempMem(alloc.alloc_buffer_length_in_bytes);
+    // ~0.4 s of 44.1 kHz stereo per AL buffer; decoded only when queued.
+    buffer_part = 32 * 1024 * channels;
+    buffer = (uint8_t*)malloc(buffer_part);
 
-        if(buffer_size > 0)
-        {
-            buffer = (uint8_t*)malloc(buffer_size);
-            memcpy(buffer, temp_buff, buffer_size);
-            Con_Notify("file \"%s\" loaded with rate=%d, bitrate=%.1f", path, rate, ((float)info.sample_rate / 1000.0f));
-        }
-        free(temp_buff);
+    if((channels < 1) || (channels > 2) || (buffer_size == 0))
+    {
+        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: unsupported file: %s.", path);
+        Suspend();
+        free(ogg_path);
+        ogg_path = NULL;
+        return false;
     }
 
-    return buffer_size > 0;
+    Con_Notify("file \"%s\" opened for streaming with rate=%d, length=%.1f s", path, rate,
+               (float)(buffer_size / (channels * sizeof(short))) / (float)rate);
+    return true;
 }
 
 
@@ -418,10 +585,18 @@ struct audio_world_data_s
     uint32_t                        audio_effects_count;    // Amount of available effects in level.
     struct audio_effect_s          *audio_effects;          // Effects and their parameters.
 
-    uint32_t                        audio_buffers_count;    // Amount of samples.
-    ALuint                         *audio_buffers;          // Samples.
+    uint32_t                        audio_samples_count;    // Amount of samples.
+    struct audio_sample_s          *audio_samples;          // Samples.
+    uint32_t                        samples_data_size;
+    uint8_t                        *samples_data;           // Raw level samples block, decoded lazily.
+    uint32_t                        samples_cache_size;     // Bytes of decoded samples in AL buffers.
+    uint32_t                        frame;                  // Audio update counter.
     uint32_t                        audio_sources_count;    // Amount of runtime channels.
     AudioSource                    *audio_sources;          // Channels.
+    uint32_t                        free_sources_count;
+    uint16_t                       *free_sources;           // Stack of inactive channel indexes.
+    uint32_t                        virtual_voices_count;
+    struct audio_voice_s            virtual_voices[TR_AUDIO_MAX_VIRTUAL_VOICES];
 
     bool                            damp_active;            // Global flag for damping BGM tracks.
     uint32_t                        stream_tracks_count;    // Amount of stream track channels.
@@ -446,7 +621,9 @@ AudioSource::AudioSource()
     effect_index = 0;
     sample_index = 0;
     sample_count = 0;
+    priority     = TR_AUDIO_PRIORITY_NORMAL;
     is_water     = false;
+    in_free_list = false;
     alGenSources(1, &source_index);
 
     if(alIsSource(source_index))
@@ -534,7 +711,18 @@ void AudioSource::Stop()
     if(alIsSource(source_index))
     {
         alSourceStop(source_index);
-        active = false;
+        Deactivate();
+    }
+}
+
+
+void AudioSource::Deactivate()
+{
+    active = false;
+    if(!in_free_list && audio_world_data.free_sources)
+    {
+        in_free_list = true;
+        audio_world_data.free_sources[audio_world_data.free_sources_count++] = this - audio_world_data.audio_sources;
     }
 }
 
@@ -549,7 +737,7 @@ void AudioSource::Update()
     // Disable and bypass source, if it is stopped.
     if(state == AL_STOPPED)
     {
-        active = false;
+        Deactivate();
         return;
     }
 
@@ -570,7 +758,7 @@ void AudioSource::Update()
     alGetSourcef(source_index, AL_MAX_DISTANCE, &range);
 
     // Check if source is in listener's range, and if so, update position,
-    // else stop and disable it.
+    // else stop and disable it. Looped entity sounds are kept as virtual voices.
     if(Audio_IsInRange(emitter_type, emitter_ID, range, gain))
     {
         LinkEmitter();
@@ -583,6 +771,11 @@ void AudioSource::Update()
     }
     else
     {
+        audio_effect_p effect = Audio_GetEffect(effect_index);
+        if(effect && (effect->loop == TR_AUDIO_LOOP_LOOPED) && (emitter_type == TR_AUDIO_EMITTER_ENTITY))
+        {
+            Audio_AddVirtualVoice(effect_index, emitter_type, emitter_ID, priority);
+        }
         Stop();
     }
 }
@@ -590,7 +783,7 @@ void AudioSource::Update()
 
 void AudioSource::SetBuffer(ALint buffer)
 {
-    ALint buffer_index = audio_world_data.audio_buffers[buffer];
+    ALuint buffer_index = Audio_GetSampleBuffer(buffer);
 
     if(alIsSource(source_index) && alIsBuffer(buffer_index))
     {
@@ -717,7 +910,10 @@ void Audio_CoreInit()
 
 void Audio_CoreDeinit()
 {
-    StreamTrack_Clear(&audio_world_data.external_stream);
+    if(audio_world_data.external_stream.internal)   // not inited without audio device
+    {
+        StreamTrack_Clear(&audio_world_data.external_stream);
+    }
 
     if(al_context)  // T4Larson <t4larson@gmail.com>: fixed
     {
@@ -785,6 +981,15 @@ int Audio_StreamPlay(uint32_t track_index, const uint8_t mask)
         Audio_StopStreams(stb->stream_type);
     }
 
+    // Only playing tracks keep their decoders open.
+    for(uint32_t i = 0; i < audio_world_data.stream_buffers_count; ++i)
+    {
+        if(audio_world_data.stream_buffers[i] && (i != track_index) && !Audio_IsTrackPlaying(i))
+        {
+            audio_world_data.stream_buffers[i]->Suspend();
+        }
+    }
+
     // Entry found, now process to actual track loading.
     target_stream = Audio_GetFreeStream();            // At first, we need to get free stream.
     if(target_stream == -1)
@@ -801,11 +1006,8 @@ int Audio_StreamPlay(uint32_t track_index, const uint8_t mask)
     while(StreamTrack_IsNeedUpdateBuffer(s) && (s->buffer_offset < stb->buffer_size))
     {
         size_t bytes = stb->buffer_part;
-        if(bytes > stb->buffer_size - s->buffer_offset)
-        {
-            bytes = stb->buffer_size - s->buffer_offset;
-        }
-        if(StreamTrack_UpdateBuffer(s, stb->buffer + s->buffer_offset, bytes, stb->sample_bitsize, stb->channels, stb->rate) <= 0)
+        uint8_t *data = stb->GetData(s->buffer_offset, &bytes);
+        if(!data || (StreamTrack_UpdateBuffer(s, data, bytes, stb->sample_bitsize, stb->channels, stb->rate) <= 0))
         {
             break;
         }
@@ -840,17 +1042,14 @@ void Audio_UpdateStreams(float time)
             while(stb && StreamTrack_IsNeedUpdateBuffer(s) && (s->buffer_offset < stb->buffer_size))
             {
                 size_t bytes = stb->buffer_part;
-                if(bytes + s->buffer_offset > stb->buffer_size)
-                {
-                    bytes = stb->buffer_size - s->buffer_offset;
-                }
-                if(StreamTrack_UpdateBuffer(s, stb->buffer + s->buffer_offset, bytes, stb->sample_bitsize, stb->channels, stb->rate) <= 0)
+                uint8_t *data = stb->GetData(s->buffer_offset, &bytes);
+                if(!data || (StreamTrack_UpdateBuffer(s, data, bytes, stb->sample_bitsize, stb->channels, stb->rate) <= 0))
                 {
                     break;
                 }
             }
 
-            if((s->buffer_offset >= stb->buffer_size) && (s->type == TR_AUDIO_STREAM_TYPE_BACKGROUND))
+            if(stb && (s->buffer_offset >= stb->buffer_size) && (s->type == TR_AUDIO_STREAM_TYPE_BACKGROUND))
             {
                 s->buffer_offset = 0;
             }
@@ -1002,7 +1201,7 @@ int  Audio_ResumeStreams(int stream_type)
 
 
 // ======== Audio source global methods ========
-int  Audio_IsInRange(int entity_type, int entity_ID, float range, float gain)
+float Audio_GetAudibility(int entity_type, int entity_ID, float range, float gain)
 {
     ALfloat  vec[3] = {0.0, 0.0, 0.0}, dist;
     entity_p ent;
@@ -1013,7 +1212,7 @@ int  Audio_IsInRange(int entity_type, int entity_ID, float range, float gain)
             ent = World_GetEntityByID(entity_ID);
             if(!ent)
             {
-                return 0;
+                return 0.0f;
             }
             vec3_copy(vec, ent->transform.M4x4 + 12);
             break;
@@ -1021,16 +1220,16 @@ int  Audio_IsInRange(int entity_type, int entity_ID, float range, float gain)
         case TR_AUDIO_EMITTER_SOUNDSOURCE:
             if((uint32_t)entity_ID + 1 > audio_world_data.audio_emitters_count)
             {
-                return 0;
+                return 0.0f;
             }
             vec3_copy(vec, audio_world_data.audio_emitters[entity_ID].position);
             break;
 
         case TR_AUDIO_EMITTER_GLOBAL:
-            return 1;
+            return (gain > 0.0f) ? (gain) : (1.0f);
 
         default:
-            return 0;
+            return 0.0f;
     }
 
     dist = vec3_dist_sq(listener_position, vec);
@@ -1040,7 +1239,19 @@ int  Audio_IsInRange(int entity_type, int entity_ID, float range, float gain)
 
     dist /= (gain + 1.25);
 
-    return dist < range * range;
+    if(dist >= range * range)
+    {
+        return 0.0f;
+    }
+
+    // Linear falloff, as AL_LINEAR_DISTANCE_CLAMPED model does.
+    return (gain > 0.0f ? gain : 0.01f) * (1.0f - sqrtf(dist) / range) + 0.001f;
+}
+
+
+int  Audio_IsInRange(int entity_type, int entity_ID, float range, float gain)
+{
+    return Audio_GetAudibility(entity_type, entity_ID, range, gain) > 0.0f;
 }
 
 
@@ -1062,6 +1273,8 @@ void Audio_UpdateSources()
     {
         audio_world_data.audio_sources[i].Update();
     }
+
+    Audio_UpdateVirtualVoices();
 }
 
 
@@ -1083,6 +1296,7 @@ void Audio_StopAllSources()
     {
         audio_world_data.audio_sources[i].Stop();
     }
+    audio_world_data.virtual_voices_count = 0;
 }
 
 
@@ -1098,11 +1312,130 @@ void Audio_ResumeAllSources()
 }
 
 
-int Audio_GetFreeSource()   ///@FIXME: add condition (compare max_dist with new source dist)
+int Audio_GetFreeSource()
 {
+    while(audio_world_data.free_sources_count > 0)
+    {
+        uint16_t i = audio_world_data.free_sources[--audio_world_data.free_sources_count];
+        AudioSource *source = audio_world_data.audio_sources + i;
+        source->in_free_list = false;
+        if(!source->IsActive())
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+int Audio_StealSource(float score)
+{
+    int victim = -1;
+    float victim_score = score;
+
     for(uint32_t i = 0; i < audio_world_data.audio_sources_count; i++)
     {
-        if(audio_world_data.audio_sources[i].IsActive() == false)
+        AudioSource *source = audio_world_data.audio_sources + i;
+        audio_effect_p effect = Audio_GetEffect(source->effect_index);
+        if(source->IsActive() && effect)
+        {
+            float s = source->priority + Audio_GetAudibility(source->emitter_type, source->emitter_ID, effect->range, effect->gain);
+            if(s < victim_score)
+            {
+                victim = i;
+                victim_score = s;
+            }
+        }
+    }
+
+    if(victim >= 0)
+    {
+        AudioSource *source = audio_world_data.audio_sources + victim;
+        audio_effect_p effect = Audio_GetEffect(source->effect_index);
+        if((effect->loop == TR_AUDIO_LOOP_LOOPED) && (source->emitter_type != TR_AUDIO_EMITTER_SOUNDSOURCE))
+        {
+            Audio_AddVirtualVoice(source->effect_index, source->emitter_type, source->emitter_ID, source->priority);
+        }
+        source->Stop();
+        if(source->IsActive())
+        {
+            return -1;
+        }
+        return Audio_GetFreeSource();
+    }
+
+    return -1;
+}
+
+
+audio_effect_p Audio_GetEffect(int effect_ID)
+{
+    if((effect_ID >= 0) && ((uint32_t)effect_ID < audio_world_data.audio_map_count))
+    {
+        int real_ID = (int)audio_world_data.audio_map[effect_ID];
+        if((real_ID >= 0) && ((uint32_t)real_ID < audio_world_data.audio_effects_count))
+        {
+            return audio_world_data.audio_effects + real_ID;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Base effect priority from its sound details: random chance effects are
+// background fillers, which are not missed, far-reaching ones are important events.
+
+uint32_t Audio_GetEffectPriority(audio_effect_p effect)
+{
+    if((effect->loop != TR_AUDIO_LOOP_LOOPED) && (effect->chance > 0) && (effect->chance < 0x7FFE))  // see chance test in Audio_Send
+    {
+        return TR_AUDIO_PRIORITY_LOW;
+    }
+
+    if(effect->range >= TR_AUDIO_PRIORITY_FAR_RANGE)
+    {
+        return TR_AUDIO_PRIORITY_HIGH;
+    }
+
+    return TR_AUDIO_PRIORITY_NORMAL;
+}
+
+
+uint32_t Audio_GetVoicePriority(audio_effect_p effect, int entity_type, int entity_ID)
+{
+    uint32_t priority = effect->priority;
+
+    switch(entity_type)
+    {
+        case TR_AUDIO_EMITTER_GLOBAL:
+            return TR_AUDIO_PRIORITY_GLOBAL;
+
+        case TR_AUDIO_EMITTER_SOUNDSOURCE:
+            return (priority > TR_AUDIO_PRIORITY_LOW) ? (priority - 1) : (TR_AUDIO_PRIORITY_LOW);
+
+        case TR_AUDIO_EMITTER_ENTITY:
+            {
+                entity_p player = World_GetPlayer();
+                if(player && (player->id == (uint32_t)entity_ID) && (priority < TR_AUDIO_PRIORITY_HIGH))
+                {
+                    priority = TR_AUDIO_PRIORITY_HIGH;
+                }
+            }
+            break;
+    }
+
+    return priority;
+}
+
+
+int Audio_FindVirtualVoice(int effect_ID, int entity_type, int entity_ID)
+{
+    audio_voice_p v = audio_world_data.virtual_voices;
+    for(uint32_t i = 0; i < audio_world_data.virtual_voices_count; ++i, ++v)
+    {
+        if((v->effect_ID == effect_ID) && (v->emitter_type == (uint32_t)entity_type) && (v->emitter_ID == entity_ID))
         {
             return i;
         }
@@ -1112,6 +1445,77 @@ int Audio_GetFreeSource()   ///@FIXME: add condition (compare max_dist with new
 }
 
 
+int Audio_AddVirtualVoice(int effect_ID, int entity_type, int entity_ID, uint32_t priority)
+{
+    if(Audio_FindVirtualVoice(effect_ID, entity_type, entity_ID) >= 0)
+    {
+        return 1;
+    }
+
+    if(audio_world_data.virtual_voices_count < TR_AUDIO_MAX_VIRTUAL_VOICES)
+    {
+        audio_voice_p v = audio_world_data.virtual_voices + audio_world_data.virtual_voices_count++;
+        v->effect_ID = effect_ID;
+        v->emitter_type = entity_type;
+        v->emitter_ID = entity_ID;
+        v->priority = priority;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int Audio_RemoveVirtualVoices(int effect_ID, int entity_type, int entity_ID)
+{
+    int ret = 0;
+    int i;
+    while((i = Audio_FindVirtualVoice(effect_ID, entity_type, entity_ID)) >= 0)
+    {
+        audio_world_data.virtual_voices[i] = audio_world_data.virtual_voices[--audio_world_data.virtual_voices_count];
+        ret++;
+    }
+
+    return ret;
+}
+
+
+/*
+ * Virtual voices are resumed from the start of sample: they are looped, so
+ * the offset is inaudible. Voices of removed entities are dropped.
+ */
+void Audio_UpdateVirtualVoices()
+{
+    for(uint32_t i = audio_world_data.virtual_voices_count; i-- > 0;)
+    {
+        audio_voice_p v = audio_world_data.virtual_voices + i;
+        audio_effect_p effect = Audio_GetEffect(v->effect_ID);
+        if(!effect || ((v->emitter_type == TR_AUDIO_EMITTER_ENTITY) && !World_GetEntityByID(v->emitter_ID)))
+        {
+            *v = audio_world_data.virtual_voices[--audio_world_data.virtual_voices_count];
+            continue;
+        }
+
+        float audibility = Audio_GetAudibility(v->emitter_type, v->emitter_ID, effect->range, effect->gain);
+        if(audibility > 0.0f)
+        {
+            int source_number = Audio_GetFreeSource();
+            if(source_number < 0)
+            {
+                source_number = Audio_StealSource(v->priority + audibility);
+            }
+            if(source_number >= 0)
+            {
+                audio_voice_t voice = *v;
+                // Stealing may have added voice to the end, so remove by search.
+                Audio_RemoveVirtualVoices(voice.effect_ID, voice.emitter_type, voice.emitter_ID);
+                Audio_StartVoice(source_number, voice.effect_ID, voice.emitter_type, voice.emitter_ID, voice.priority);
+            }
+        }
+    }
+}
+
+
 int Audio_IsEffectPlaying(int effect_ID, int entity_type, int entity_ID)
 {
     for(uint32_t i = 0; i < audio_world_data.audio_sources_count; i++)
@@ -1138,12 +1542,12 @@ int Audio_Send(int effect_ID, int entity_type, int entity_ID)
 {
     int32_t         source_number;
     uint16_t        random_value;
-    ALfloat         random_float;
+    uint32_t        priority;
+    float           audibility;
     audio_effect_p  effect = NULL;
-    AudioSource    *source = NULL;
 
     // If there are no audio buffers or effect index is wrong, don't process.
-    if((audio_world_data.audio_buffers_count < 1) || (effect_ID < 0))
+    if((audio_world_data.audio_samples_count < 1) || (effect_ID < 0))
     {
         return TR_AUDIO_SEND_IGNORED;
     }
@@ -1180,16 +1584,31 @@ int Audio_Send(int effect_ID, int entity_type, int entity_ID)
         }
     }
 
-    // Pre-step 3: Calculate if effect's hearing sphere intersect listener's hearing sphere.
+    // Pre-step 3: looped effect, which is already tracked as virtual voice,
+    // will get its source back in Audio_UpdateVirtualVoices.
+
+    if((effect->loop == TR_AUDIO_LOOP_LOOPED) && (Audio_FindVirtualVoice(effect_ID, entity_type, entity_ID) >= 0))
+    {
+        return TR_AUDIO_SEND_IGNORED;
+    }
+
+    // Pre-step 4: Calculate if effect's hearing sphere intersect listener's hearing sphere.
     // If it's not, bypass audio send (cause we don't want it to occupy channel, if it's not
-    // heard).
+    // heard). Looped entity sounds are remembered as virtual voices. Sound sources are
+    // resent every frame, so they don't need it.
 
-    if(Audio_IsInRange(entity_type, entity_ID, effect->range, effect->gain ) == false)
+    priority = Audio_GetVoicePriority(effect, entity_type, entity_ID);
+    audibility = Audio_GetAudibility(entity_type, entity_ID, effect->range, effect->gain);
+    if(audibility <= 0.0f)
     {
+        if((effect->loop == TR_AUDIO_LOOP_LOOPED) && (entity_type == TR_AUDIO_EMITTER_ENTITY))
+        {
+            Audio_AddVirtualVoice(effect_ID, entity_type, entity_ID, priority);
+        }
         return TR_AUDIO_SEND_IGNORED;
     }
 
-    // Pre-step 4: check if R (Rewind) flag is set for this effect, if so,
+    // Pre-step 5: check if R (Rewind) flag is set for this effect, if so,
     // find any effect with similar ID playing for this entity, and stop it.
     // Otherwise, if W (Wait) or L (Looped) flag is set, and same effect is
     // playing for current entity, don't send it and exit function.
@@ -1210,87 +1629,128 @@ int Audio_Send(int effect_ID, int entity_type, int entity_ID)
     else
     {
         source_number = Audio_GetFreeSource();  // Get free source.
+        if(source_number == -1)
+        {
+            source_number = Audio_StealSource(priority + audibility);
+        }
     }
 
     if(source_number != -1)  // Everything is OK, we're sending audio to channel.
     {
-        int buffer_index;
+        return Audio_StartVoice(source_number, effect_ID, entity_type, entity_ID, priority);
+    }
+    else if((effect->loop == TR_AUDIO_LOOP_LOOPED) && (entity_type != TR_AUDIO_EMITTER_SOUNDSOURCE))
+    {
+        Audio_AddVirtualVoice(effect_ID, entity_type, entity_ID, priority);
+    }
 
-        // Step 1. Assign buffer to source.
+    return TR_AUDIO_SEND_NOCHANNEL;
+}
 
-        if(effect->sample_count > 1)
-        {
-            // Select random buffer, if effect info contains more than 1 assigned samples.
-            random_value = rand() % (effect->sample_count);
-            buffer_index = random_value + effect->sample_index;
-        }
-        else
-        {
-            // Just assign buffer to source, if there is only one assigned sample.
-            buffer_index = effect->sample_index;
-        }
 
-        source = &audio_world_data.audio_sources[source_number];
+int Audio_StartVoice(int source_number, int effect_ID, int entity_type, int entity_ID, uint32_t priority)
+{
+    uint16_t        random_value;
+    ALfloat         random_float;
+    audio_effect_p  effect = Audio_GetEffect(effect_ID);
+    AudioSource    *source = &audio_world_data.audio_sources[source_number];
+    int             buffer_index;
 
-        source->SetBuffer(buffer_index);
+    if(!effect)
+    {
+        return TR_AUDIO_SEND_NOSAMPLE;
+    }
 
-        // Step 2. Check looped flag, and if so, set source type to looped.
+    // Step 1. Assign buffer to source.
 
-        if(effect->loop == TR_AUDIO_LOOP_LOOPED)
-        {
-            source->SetLooping(AL_TRUE);
-        }
-        else
-        {
-            source->SetLooping(AL_FALSE);
-        }
+    if(effect->sample_count > 1)
+    {
+        // Select random buffer, if effect info contains more than 1 assigned samples.
+        random_value = rand() % (effect->sample_count);
+        buffer_index = random_value + effect->sample_index;
+    }
+    else
+    {
+        // Just assign buffer to source, if there is only one assigned sample.
+        buffer_index = effect->sample_index;
+    }
 
-        // Step 3. Apply internal sound parameters.
+    source->SetBuffer(buffer_index);
 
-        source->emitter_ID   = entity_ID;
-        source->emitter_type = entity_type;
-        source->effect_index = effect_ID;
+    // Step 2. Check looped flag, and if so, set source type to looped.
 
-        // Step 4. Apply sound effect properties.
+    if(effect->loop == TR_AUDIO_LOOP_LOOPED)
+    {
+        source->SetLooping(AL_TRUE);
+    }
+    else
+    {
+        source->SetLooping(AL_FALSE);
+    }
 
-        if(effect->rand_pitch)  // Vary pitch, if flag is set.
-        {
-            random_float = rand() % effect->rand_pitch_var;
-            random_float = effect->pitch + ((random_float - 25.0) / 200.0);
-            source->SetPitch(random_float);
-        }
-        else
-        {
-            source->SetPitch(effect->pitch);
-        }
+    // Step 3. Apply internal sound parameters.
 
-        if(effect->rand_gain)   // Vary gain, if flag is set.
-        {
-            random_float = rand() % effect->rand_gain_var;
-            random_float = effect->gain + (random_float - 25.0) / 200.0;
-            source->SetGain(random_float);
-        }
-        else
-        {
-            source->SetGain(effect->gain);
-        }
+    source->emitter_ID   = entity_ID;
+    source->emitter_type = entity_type;
+    source->effect_index = effect_ID;
+    source->priority     = priority;
 
-        source->SetRange(effect->range);    // Set audible range.
+    // Step 4. Apply sound effect properties.
 
-        source->Play();                     // Everything is OK, play sound now!
+    if(effect->rand_pitch)  // Vary pitch, if flag is set.
+    {
+        random_float = rand() % effect->rand_pitch_var;
+        random_float = effect->pitch + ((random_float - 25.0) / 200.0);
+        source->SetPitch(random_float);
+    }
+    else
+    {
+        source->SetPitch(effect->pitch);
+    }
 
-        return TR_AUDIO_SEND_PROCESSED;
+    if(effect->rand_gain)   // Vary gain, if flag is set.
+    {
+        random_float = rand() % effect->rand_gain_var;
+        random_float = effect->gain + (random_float - 25.0) / 200.0;
+        source->SetGain(random_float);
     }
     else
     {
-        return TR_AUDIO_SEND_NOCHANNEL;
+        source->SetGain(effect->gain);
+    }
+
+    source->SetRange(effect->range);    // Set audible range.
+
+    source->Play();                     // Everything is OK, play sound now!
+
+    return TR_AUDIO_SEND_PROCESSED;
+}
+
+
+bool AudioSource::ReleaseBuffer(ALuint buffer)
+{
+    if(alIsSource(source_index))
+    {
+        ALint current = 0;
+        alGetSourcei(source_index, AL_BUFFER, &current);
+        if((ALuint)current == buffer)
+        {
+            if(active)
+            {
+                return false;
+            }
+            alSourcei(source_index, AL_BUFFER, 0);
+        }
     }
+
+    return true;
 }
 
 
 int Audio_Kill(int effect_ID, int entity_type, int entity_ID)
 {
     int playing_sound = Audio_IsEffectPlaying(effect_ID, entity_type, entity_ID);
+    int virtual_voices = Audio_RemoveVirtualVoices(effect_ID, entity_type, entity_ID);
 
     if(playing_sound != -1)
     {
@@ -1298,7 +1758,7 @@ int Audio_Kill(int effect_ID, int entity_type, int entity_ID)
         return TR_AUDIO_SEND_PROCESSED;
     }
 
-    return TR_AUDIO_SEND_IGNORED;
+    return (virtual_voices > 0) ? (TR_AUDIO_SEND_PROCESSED) : (TR_AUDIO_SEND_IGNORED);
 }
 
 
@@ -1322,9 +1782,12 @@ void Audio_LoadOverridedSamples()
                     for(int j = 0; j < sample_count; j++, buffer_counter++)
                     {
                         snprintf(sample_name, sizeof(sample_name), sample_name_mask, (sample_index + j));
-                        if(Sys_FileFound(sample_name, 0))
+                        if((buffer_counter < audio_world_data.audio_samples_count) && Sys_FileFound(sample_name, 0))
                         {
-                            Audio_LoadALbufferFromWAV_File(audio_world_data.audio_buffers[buffer_counter], sample_name);
+                            audio_sample_p sample = audio_world_data.audio_samples + buffer_counter;
+                            free(sample->file_name);
+                            sample->file_name = strdup(sample_name);
+                            sample->state = TR_AUDIO_SAMPLE_UNLOADED;
                         }
                     }
                 }
@@ -1342,13 +1805,21 @@ void Audio_InitGlobals()
 {
     audio_settings.music_volume = 0.7;
     audio_settings.sound_volume = 0.8;
+    audio_settings.sample_cache_size = 0;
     audio_settings.use_effects  = true;
     audio_settings.listener_is_player = false;
 
     audio_world_data.audio_sources = NULL;
     audio_world_data.audio_sources_count = 0;
-    audio_world_data.audio_buffers = NULL;
-    audio_world_data.audio_buffers_count = 0;
+    audio_world_data.free_sources = NULL;
+    audio_world_data.free_sources_count = 0;
+    audio_world_data.virtual_voices_count = 0;
+    audio_world_data.audio_samples = NULL;
+    audio_world_data.audio_samples_count = 0;
+    audio_world_data.samples_data = NULL;
+    audio_world_data.samples_data_size = 0;
+    audio_world_data.samples_cache_size = 0;
+    audio_world_data.frame = 0;
     audio_world_data.audio_effects = NULL;
     audio_world_data.audio_effects_count = 0;
 
@@ -1371,6 +1842,13 @@ void Audio_Init(uint32_t num_Sources)
     num_Sources -= TR_AUDIO_STREAM_NUMSOURCES;          // Subtract sources reserved for music.
     audio_world_data.audio_sources_count = num_Sources;
     audio_world_data.audio_sources = new AudioSource[num_Sources];
+    audio_world_data.free_sources = (uint16_t*)malloc(num_Sources * sizeof(uint16_t));
+    audio_world_data.free_sources_count = 0;
+    audio_world_data.virtual_voices_count = 0;
+    for(uint32_t i = num_Sources; i-- > 0;)
+    {
+        audio_world_data.audio_sources[i].Deactivate();
+    }
 
     // Generate stream tracks array.
     audio_world_data.stream_tracks_count = TR_AUDIO_STREAM_NUMSOURCES - 1;
@@ -1416,11 +1894,10 @@ void Audio_GenSamples(class VT_Level *tr)
         Audio_CacheTrack(Script_GetSecretTrackNumber(engine_lua));
     }
 
-    // Generate new buffer array.
-    audio_world_data.audio_buffers_count = tr->samples_count;
-    audio_world_data.audio_buffers = (ALuint*)malloc(audio_world_data.audio_buffers_count * sizeof(ALuint));
-    memset(audio_world_data.audio_buffers, 0, sizeof(ALuint) * audio_world_data.audio_buffers_count);
-    alGenBuffers(audio_world_data.audio_buffers_count, audio_world_data.audio_buffers);
+    // Generate new sample array. AL buffers are created on first use.
+    audio_world_data.audio_samples_count = tr->samples_count;
+    audio_world_data.audio_samples = (audio_sample_p)calloc(audio_world_data.audio_samples_count, sizeof(audio_sample_t));
+    audio_world_data.samples_cache_size = 0;
 
     // Generate stream track map array.
     // We use scripted amount of tracks to define map bounds.
@@ -1444,7 +1921,8 @@ void Audio_GenSamples(class VT_Level *tr)
     audio_world_data.audio_map = tr->soundmap;
     tr->soundmap = NULL;                   /// without it VT destructor free(tr->soundmap)
 
-    // Cycle through raw samples block and parse them to OpenAL buffers.
+    // Cycle through raw samples block and find sample bounds in it.
+    // Block itself is kept until level unload, samples are decoded in Audio_GetSampleBuffer.
 
     // Different TR versions have different ways of storing samples.
     // TR1:     sample block size, sample block, num samples, sample offsets.
@@ -1462,14 +1940,15 @@ void Audio_GenSamples(class VT_Level *tr)
             case TR_I_UB:
                 audio_world_data.audio_map_count = TR_AUDIO_MAP_SIZE_TR1;
 
-                for(i = 0; i < audio_world_data.audio_buffers_count-1; i++)
+                // Sample offsets are not sorted, so let RIFF header limit sample size.
+                for(i = 0; i < audio_world_data.audio_samples_count; i++)
                 {
-                    pointer = tr->samples_data + tr->sample_indices[i];
-                    uint32_t size = tr->sample_indices[i + 1] - tr->sample_indices[i];
-                    Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, size);
+                    if(tr->sample_indices[i] < tr->samples_data_size)
+                    {
+                        audio_world_data.audio_samples[i].offset = tr->sample_indices[i];
+                        audio_world_data.audio_samples[i].size = tr->samples_data_size - tr->sample_indices[i];
+                    }
                 }
-                i = audio_world_data.audio_buffers_count-1;
-                Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, (tr->samples_count - tr->sample_indices[i]));
                 break;
 
             case TR_II:
@@ -1492,10 +1971,10 @@ void Audio_GenSamples(class VT_Level *tr)
                         }
                         else
                         {
-                            uncomp_size = ind2 - ind1;
-                            Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], tr->samples_data + ind1, uncomp_size);
+                            audio_world_data.audio_samples[i].offset = ind1;
+                            audio_world_data.audio_samples[i].size = ind2 - ind1;
                             i++;
-                            if(i > audio_world_data.audio_buffers_count - 1)
+                            if(i > audio_world_data.audio_samples_count - 1)
                             {
                                 break;
                             }
@@ -1504,11 +1983,10 @@ void Audio_GenSamples(class VT_Level *tr)
                     }
                     ind2++;
                 }
-                uncomp_size = tr->samples_data_size - ind1;
-                pointer = tr->samples_data + ind1;
-                if(i < audio_world_data.audio_buffers_count)
+                if(i < audio_world_data.audio_samples_count)
                 {
-                    Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, uncomp_size);
+                    audio_world_data.audio_samples[i].offset = ind1;
+                    audio_world_data.audio_samples[i].size = tr->samples_data_size - ind1;
                 }
                 break;
 
@@ -1526,8 +2004,9 @@ void Audio_GenSamples(class VT_Level *tr)
                     comp_size   = *((uint32_t*)pointer);
                     pointer += 4;
 
-                    // Load WAV sample into OpenAL buffer.
-                    Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, comp_size, uncomp_size);
+                    audio_world_data.audio_samples[i].offset = pointer - tr->samples_data;
+                    audio_world_data.audio_samples[i].size = comp_size;
+                    audio_world_data.audio_samples[i].uncomp_size = uncomp_size;
 
                     // Now we can safely move pointer through current sample data.
                     pointer += comp_size;
@@ -1542,7 +2021,8 @@ void Audio_GenSamples(class VT_Level *tr)
                 return;
         }
 
-        free(tr->samples_data);
+        audio_world_data.samples_data = tr->samples_data;
+        audio_world_data.samples_data_size = tr->samples_data_size;
         tr->samples_data = NULL;
         tr->samples_data_size = 0;
     }
@@ -1650,6 +2130,13 @@ void Audio_GenSamples(class VT_Level *tr)
             break;
     }
 
+    // Priorities depend on the final loop mode and range, so they go after the fixes.
+
+    for(i = 0; i < audio_world_data.audio_effects_count; i++)
+    {
+        audio_world_data.audio_effects[i].priority = Audio_GetEffectPriority(audio_world_data.audio_effects + i);
+    }
+
     // Cycle through sound emitters and
     // parse them to native OpenTomb sound emitters structure.
 
@@ -1677,6 +2164,14 @@ int Audio_DeInit()
         audio_world_data.audio_sources = NULL;
     }
 
+    if(audio_world_data.free_sources)
+    {
+        audio_world_data.free_sources_count = 0;
+        free(audio_world_data.free_sources);
+        audio_world_data.free_sources = NULL;
+    }
+    audio_world_data.virtual_voices_count = 0;
+
     if(audio_world_data.audio_emitters)
     {
         audio_world_data.audio_emitters_count = 0;
@@ -1704,12 +2199,28 @@ int Audio_DeInit()
 
     ///@CRITICAL: You must to delete all sources before buffers deleting!!!
 
-    if(audio_world_data.audio_buffers)
+    if(audio_world_data.audio_samples)
     {
-        alDeleteBuffers(audio_world_data.audio_buffers_count, audio_world_data.audio_buffers);
-        audio_world_data.audio_buffers_count = 0;
-        free(audio_world_data.audio_buffers);
-        audio_world_data.audio_buffers = NULL;
+        for(uint32_t i = 0; i < audio_world_data.audio_samples_count; i++)
+        {
+            audio_sample_p sample = audio_world_data.audio_samples + i;
+            if(sample->state == TR_AUDIO_SAMPLE_LOADED)
+            {
+                alDeleteBuffers(1, &sample->buffer);
+            }
+            free(sample->file_name);
+        }
+        audio_world_data.audio_samples_count = 0;
+        audio_world_data.samples_cache_size = 0;
+        free(audio_world_data.audio_samples);
+        audio_world_data.audio_samples = NULL;
+    }
+
+    if(audio_world_data.samples_data)
+    {
+        audio_world_data.samples_data_size = 0;
+        free(audio_world_data.samples_data);
+        audio_world_data.samples_data = NULL;
     }
 
     if(audio_world_data.audio_effects)
@@ -1784,6 +2295,90 @@ int  Audio_LogALError(int error_marker)
 }*/
 
 
+ALuint Audio_GetSampleBuffer(uint32_t sample_index)
+{
+    if(sample_index >= audio_world_data.audio_samples_count)
+    {
+        return 0;
+    }
+
+    audio_sample_p sample = audio_world_data.audio_samples + sample_index;
+    sample->last_used = audio_world_data.frame;
+
+    if(sample->state == TR_AUDIO_SAMPLE_UNLOADED)
+    {
+        int result = -1;
+        alGenBuffers(1, &sample->buffer);
+        if(sample->file_name)
+        {
+            result = Audio_LoadALbufferFromWAV_File(sample->buffer, sample->file_name);
+        }
+        else if(sample->size && (sample->offset < audio_world_data.samples_data_size) &&
+                (sample->size <= audio_world_data.samples_data_size - sample->offset))
+        {
+            result = Audio_LoadALbufferFromWAV_Mem(sample->buffer, audio_world_data.samples_data + sample->offset, sample->size, sample->uncomp_size);
+        }
+
+        if(result != 0)
+        {
+            alDeleteBuffers(1, &sample->buffer);
+            sample->buffer = 0;
+            sample->state = TR_AUDIO_SAMPLE_BROKEN;         // Don't try to decode it each time.
+            return 0;
+        }
+
+        ALint al_size = 0;
+        alGetBufferi(sample->buffer, AL_SIZE, &al_size);
+        sample->al_size = al_size;
+        sample->state = TR_AUDIO_SAMPLE_LOADED;
+        audio_world_data.samples_cache_size += sample->al_size;
+        Audio_TrimSamples();
+    }
+
+    return sample->buffer;
+}
+
+
+void Audio_TrimSamples()
+{
+    uint32_t budget = audio_settings.sample_cache_size * 1024;
+
+    while(budget && (audio_world_data.samples_cache_size > budget))
+    {
+        audio_sample_p victim = NULL;
+        audio_sample_p sample = audio_world_data.audio_samples;
+        for(uint32_t i = 0; i < audio_world_data.audio_samples_count; ++i, ++sample)
+        {
+            // Samples of current frame may be about to play, keep them.
+            if((sample->state == TR_AUDIO_SAMPLE_LOADED) && (sample->last_used != audio_world_data.frame) &&
+               (!victim || (sample->last_used < victim->last_used)))
+            {
+                bool released = true;
+                for(uint32_t j = 0; released && (j < audio_world_data.audio_sources_count); j++)
+                {
+                    released = audio_world_data.audio_sources[j].ReleaseBuffer(sample->buffer);
+                }
+                if(released)
+                {
+                    victim = sample;
+                }
+            }
+        }
+
+        if(!victim)
+        {
+            break;
+        }
+
+        alDeleteBuffers(1, &victim->buffer);
+        victim->buffer = 0;
+        victim->state = TR_AUDIO_SAMPLE_UNLOADED;
+        audio_world_data.samples_cache_size -= victim->al_size;
+        victim->al_size = 0;
+    }
+}
+
+
 int Audio_LoadALbufferFromWAV_Mem(ALuint buf_number, uint8_t *sample_pointer, uint32_t sample_size, uint32_t uncomp_sample_size)
 {
     SDL_AudioSpec wav_spec;
@@ -1977,6 +2572,7 @@ void Audio_UpdateListenerByEntity(struct entity_s *ent)
 
 void Audio_Update(float time)
 {
+    audio_world_data.frame++;
     Audio_UpdateSources();
     Audio_UpdateStreams(time);
     Audio_UpdateListenerByCamera(&engine_camera, time);
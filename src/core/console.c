@@ -143,8 +143,11 @@ void Con_Destroy()
     con_base.edit_buff = NULL;
     con_base.edit_size = 0;
 
-    qglDeleteBuffersARB(1, &backgroundBuffer);
-    qglDeleteBuffersARB(1, &cursorBuffer);
+    if(!screen_info.headless)
+    {
+        qglDeleteBuffersARB(1, &backgroundBuffer);
+        qglDeleteBuffersARB(1, &cursorBuffer);
+    }
     backgroundBuffer = 0;
     cursorBuffer = 0;
     
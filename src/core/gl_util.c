@@ -271,6 +271,8 @@ PFNGLISVERTEXARRAYPROC                  qglIsVertexArray = NULL;
 
 PFNGLGENERATEMIPMAPEXTPROC              qglGenerateMipmap = NULL;
 
+PFNGLDRAWELEMENTSINSTANCEDARBPROC       qglDrawElementsInstancedARB = NULL;
+
 static char *engine_gl_ext_str = NULL;
 static GLuint whiteTexture = 0;
 
@@ -580,6 +582,11 @@ void InitGLExtFuncs()
     {
         Sys_Error("Shaders not supported");
     }
+
+    if(IsGLExtensionSupported("GL_ARB_draw_instanced"))
+    {
+        qglDrawElementsInstancedARB = (PFNGLDRAWELEMENTSINSTANCEDARBPROC)SDL_GL_GetProcAddress("glDrawElementsInstancedARB");
+    }
 }
 
 /**
@@ -428,6 +428,9 @@ extern PFNGLISVERTEXARRAYPROC qglIsVertexArray;
 
 extern PFNGLGENERATEMIPMAPPROC qglGenerateMipmap;
 
+/*draw instanced ARB, NULL if not supported*/
+extern PFNGLDRAWELEMENTSINSTANCEDARBPROC qglDrawElementsInstancedARB;
+
 void InitGLExtFuncs();
 int IsGLExtensionSupported(const char *ext);
 
@@ -0,0 +1,154 @@
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+#include <pthread.h>
+
+#include "jobs.h"
+
+
+static struct jobs_pool_s
+{
+    uint32_t                workers_count;
+    pthread_t               workers[JOBS_MAX_WORKERS];
+    pthread_mutex_t         mutex;
+    pthread_cond_t          start_cond;
+    pthread_cond_t          done_cond;
+
+    job_func_t              func;
+    void                   *data;
+    uint32_t                count;
+    uint32_t                next;                                               // next index to take
+    uint32_t                done;
+    uint32_t                generation;                                         // increased on every ParallelFor
+    int                     stop;
+} jobs_pool = {0};
+
+
+/*
+ * Takes indexes until there are no more; must be called with locked mutex.
+ */
+static void Jobs_ProcessItems(job_progress_func_t progress)
+{
+    while(jobs_pool.next < jobs_pool.count)
+    {
+        uint32_t index = jobs_pool.next++;
+        pthread_mutex_unlock(&jobs_pool.mutex);
+        jobs_pool.func(jobs_pool.data, index);
+        pthread_mutex_lock(&jobs_pool.mutex);
+
+        if(++jobs_pool.done == jobs_pool.count)
+        {
+            pthread_cond_signal(&jobs_pool.done_cond);
+        }
+        if(progress)
+        {
+            uint32_t done = jobs_pool.done;
+            pthread_mutex_unlock(&jobs_pool.mutex);
+            progress(done, jobs_pool.count);
+            pthread_mutex_lock(&jobs_pool.mutex);
+        }
+    }
+}
+
+
+static void *Jobs_WorkerThread(void *arg)
+{
+    uint32_t generation = 0;
+
+    pthread_mutex_lock(&jobs_pool.mutex);
+    while(!jobs_pool.stop)
+    {
+        if(generation == jobs_pool.generation)
+        {
+            pthread_cond_wait(&jobs_pool.start_cond, &jobs_pool.mutex);
+            continue;
+        }
+        generation = jobs_pool.generation;
+        Jobs_ProcessItems(NULL);
+    }
+    pthread_mutex_unlock(&jobs_pool.mutex);
+
+    return NULL;
+}
+
+
+void Jobs_Init()
+{
+    int cpu_count = SDL_GetCPUCount();
+
+    pthread_mutex_init(&jobs_pool.mutex, NULL);
+    pthread_cond_init(&jobs_pool.start_cond, NULL);
+    pthread_cond_init(&jobs_pool.done_cond, NULL);
+    jobs_pool.stop = 0;
+    jobs_pool.generation = 0;
+    jobs_pool.workers_count = 0;
+
+    // The calling thread works too, so one core is left for it.
+    for(int i = 1; (i < cpu_count) && (jobs_pool.workers_count < JOBS_MAX_WORKERS); i++)
+    {
+        if(0 != pthread_create(jobs_pool.workers + jobs_pool.workers_count, NULL, Jobs_WorkerThread, NULL))
+        {
+            break;
+        }
+        jobs_pool.workers_count++;
+    }
+}
+
+
+void Jobs_Destroy()
+{
+    pthread_mutex_lock(&jobs_pool.mutex);
+    jobs_pool.stop = 1;
+    pthread_cond_broadcast(&jobs_pool.start_cond);
+    pthread_mutex_unlock(&jobs_pool.mutex);
+
+    for(uint32_t i = 0; i < jobs_pool.workers_count; i++)
+    {
+        pthread_join(jobs_pool.workers[i], NULL);
+    }
+    jobs_pool.workers_count = 0;
+
+    pthread_cond_destroy(&jobs_pool.done_cond);
+    pthread_cond_destroy(&jobs_pool.start_cond);
+    pthread_mutex_destroy(&jobs_pool.mutex);
+}
+
+
+uint32_t Jobs_GetWorkersCount()
+{
+    return jobs_pool.workers_count;
+}
+
+
+void Jobs_ParallelFor(job_func_t func, void *data, uint32_t count, job_progress_func_t progress)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&jobs_pool.mutex);
+    jobs_pool.func = func;
+    jobs_pool.data = data;
+    jobs_pool.count = count;
+    jobs_pool.next = 0;
+    jobs_pool.done = 0;
+    jobs_pool.generation++;
+    pthread_cond_broadcast(&jobs_pool.start_cond);
+
+    Jobs_ProcessItems(progress);
+    while(jobs_pool.done < jobs_pool.count)
+    {
+        pthread_cond_wait(&jobs_pool.done_cond, &jobs_pool.mutex);
+    }
+    jobs_pool.func = NULL;
+    jobs_pool.data = NULL;
+    pthread_mutex_unlock(&jobs_pool.mutex);
+
+    if(progress)
+    {
+        progress(count, count);
+    }
+}
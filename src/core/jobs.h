@@ -0,0 +1,32 @@
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define JOBS_MAX_WORKERS        (16)
+
+typedef void (*job_func_t)(void *data, uint32_t index);
+typedef void (*job_progress_func_t)(uint32_t done, uint32_t count);
+
+void Jobs_Init();
+void Jobs_Destroy();
+uint32_t Jobs_GetWorkersCount();
+
+/*
+ * Calls func(data, i) for every i in [0, count) on the worker threads and on
+ * the calling one, returns when all calls are done. Calls order is undefined,
+ * so func must touch only the data of its index. progress may be NULL, it is
+ * called from the calling thread only, so it may draw.
+ */
+void Jobs_ParallelFor(job_func_t func, void *data, uint32_t count, job_progress_func_t progress);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -24,6 +24,7 @@ obb_p OBB_Create()
         Polygon_Resize(ret->polygons + i, 4);
     }
     ret->transform = NULL;
+    ret->cull_plane = 0;
 
     return ret;
 }
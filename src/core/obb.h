@@ -33,6 +33,7 @@ typedef struct obb_s
     float                base_centre[3];
     float                centre[3];
     float                extent[3];
+    uint16_t             cull_plane;                     // last frustum plane that culled the box, tested first
 } obb_t, *obb_p;
 
 obb_p OBB_Create();
@@ -26,6 +26,7 @@ typedef struct screen_info_s
     uint32_t    debug_view_state : 8;
     uint32_t    fullscreen : 1;
     uint32_t    crosshair : 1;
+    uint32_t    headless : 1;                                                   // no window, GL context and audio device
 } screen_info_t, *screen_info_p;
 
 extern screen_info_t screen_info;
@@ -2,6 +2,9 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 #include "vmath.h"
 
 
@@ -838,6 +841,26 @@ int Mat4_inv(float mat[16], float inv[16])
  */
 void Mat4_Mat4_mul(float result[16], const float src1[16], const float src2[16])
 {
+#if defined(__SSE__)
+    // column by column, with the same summation order as the scalar version
+    __m128 c0 = _mm_loadu_ps(src1 + 0);
+    __m128 c1 = _mm_loadu_ps(src1 + 4);
+    __m128 c2 = _mm_loadu_ps(src1 + 8);
+    __m128 c3 = _mm_loadu_ps(src1 + 12);
+    __m128 r[4];
+
+    for(int i = 0; i < 4; i++)
+    {
+        r[i] = _mm_mul_ps(c0, _mm_set1_ps(src2[i * 4 + 0]));
+        r[i] = _mm_add_ps(r[i], _mm_mul_ps(c1, _mm_set1_ps(src2[i * 4 + 1])));
+        r[i] = _mm_add_ps(r[i], _mm_mul_ps(c2, _mm_set1_ps(src2[i * 4 + 2])));
+        r[i] = _mm_add_ps(r[i], _mm_mul_ps(c3, _mm_set1_ps(src2[i * 4 + 3])));
+    }
+    _mm_storeu_ps(result + 0, r[0]);
+    _mm_storeu_ps(result + 4, r[1]);
+    _mm_storeu_ps(result + 8, r[2]);
+    _mm_storeu_ps(result + 12, r[3]);
+#else
     // Store in temporary matrix so we don't overwrite anything if src1,2 alias result
     float t_res[16];
 
@@ -862,6 +885,7 @@ void Mat4_Mat4_mul(float result[16], const float src1[16], const float src2[16])
     t_res[3 * 4 + 3] = src1[0 * 4 + 3] * src2[3 * 4 + 0] + src1[1 * 4 + 3] * src2[3 * 4 + 1] + src1[2 * 4 + 3] * src2[3 * 4 + 2] + src1[3 * 4 + 3] * src2[3 * 4 + 3];
 
     memcpy(result, t_res, sizeof(t_res));
+#endif
 }
 
 
@@ -21,8 +21,10 @@ extern "C" {
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/gl_text.h"
+#include "core/jobs.h"
 #include "render/camera.h"
 #include "render/render.h"
+#include "render/frustum.h"
 #include "script/script.h"
 #include "physics/physics.h"
 #include "fmv/tiny_codec.h"
@@ -37,6 +39,7 @@ extern "C" {
 #include "skeletal_model.h"
 #include "entity.h"
 #include "gameflow.h"
+#include "save_game.h"
 #include "room.h"
 #include "world.h"
 #include "resource.h"
@@ -62,6 +65,13 @@ static volatile int             engine_done   = 0;
 static int                      engine_set_zero_time = 0;
 float time_scale = 1.0f;
 
+static char                    *headless_level  = NULL;
+static int32_t                  headless_frames = 0;
+static float                    headless_dt     = 1.0f / 60.0f;
+static char                    *headless_video  = NULL;
+static int                      headless_render_stats = 0;
+static int                      headless_cull_bench = 0;
+
 engine_container_p      last_cont = NULL;
 static float            ray_test_point[3] = {0.0f, 0.0f, 0.0f};
 static ss_bone_frame_t  test_model = {0};
@@ -100,6 +110,7 @@ void Engine_InitSDLSubsystems();
 void Engine_InitDefaultGlobals();
 
 void Engine_Display(float time);
+void Engine_HeadlessLoop();
 void Engine_PollSDLEvents();
 void Engine_Resize(int nominalW, int nominalH, int pixelsW, int pixelsH);
 
@@ -158,12 +169,70 @@ void Engine_Start(int argc, char **argv)
             }
             ++i;
         }
+        else if(0 == strncmp(argv[i], "-headless", 9))
+        {
+            screen_info.headless = 1;
+        }
+        else if(0 == strncmp(argv[i], "-level", 6))
+        {
+            if(i + 1 < argc)
+            {
+                headless_level = argv[i + 1];
+            }
+            ++i;
+        }
+        else if(0 == strncmp(argv[i], "-frames", 7))
+        {
+            if(i + 1 < argc)
+            {
+                headless_frames = atoi(argv[i + 1]);
+            }
+            ++i;
+        }
+        else if(0 == strncmp(argv[i], "-video", 6))
+        {
+            if(i + 1 < argc)
+            {
+                headless_video = argv[i + 1];
+            }
+            ++i;
+        }
+        else if(0 == strncmp(argv[i], "-render_stats", 13))
+        {
+            headless_render_stats = 1;
+        }
+        else if(0 == strncmp(argv[i], "-cull_bench", 11))
+        {
+            headless_cull_bench = 1;
+        }
+        else if(0 == strncmp(argv[i], "-dt", 3))
+        {
+            if(i + 1 < argc)
+            {
+                // accepts both "0.016" and "1/60" forms.
+                const char *div = strchr(argv[i + 1], '/');
+                float dt = atof(argv[i + 1]);
+                if(div && (atof(div + 1) > 0.0f))
+                {
+                    dt /= atof(div + 1);
+                }
+                headless_dt = (dt > 0.0f) ? (dt) : (headless_dt);
+            }
+            ++i;
+        }
         else
         {
             puts("usage:");
             puts("-config \"path_to_config_file\"");
             puts("-autoexec \"path_to_autoexec_file\"");
             puts("-base_path \"path_to_base_folder_location (contains data, resource, save and script folders)\"");
+            puts("-headless - run simulation only, without window, OpenGL and audio device");
+            puts("-level \"path_to_level_file\" - level to load after autoexec (relative to base_path)");
+            puts("-frames N - number of frames to simulate in headless mode (0 - until exit)");
+            puts("-dt T - fixed headless frame time in seconds, \"0.016\" or \"1/60\" (default 1/60)");
+            puts("-video \"path_to_rpl_file\" - decode video as fast as possible in headless mode and report codec throughput");
+            puts("-render_stats - build render lists and render queue (no GL) each headless frame, report their average size and check queue sort");
+            puts("-cull_bench - check and time boxes frustum culling on random boxes in headless mode (-frames N - rounds), fails on mismatch");
             exit(0);
         }
     }
@@ -173,6 +242,16 @@ void Engine_Start(int argc, char **argv)
 
     Engine_LoadConfig(config_name ? config_name : "config.lua");
 
+    if(screen_info.headless)
+    {
+        // No window, GL context or audio device: fonts, shaders and load
+        // screens are skipped, AL calls are no-ops without current context.
+        Gui_Init();
+        World_Prepare();
+        luaL_dofile(engine_lua, autoexec_name ? autoexec_name : "autoexec.lua");
+        return;
+    }
+
     // Init generic SDL interfaces.
     Engine_InitSDLSubsystems();
     Engine_InitSDLVideo();
@@ -205,6 +284,7 @@ void Engine_Start(int argc, char **argv)
 
 void Engine_Shutdown(int val)
 {
+    Save_WaitWrite();
     renderer.ResetWorld(NULL, 0, NULL, 0);
     SSBoneFrame_Clear(&test_model);
     World_Clear();
@@ -218,6 +298,7 @@ void Engine_Shutdown(int val)
     }
 
     Physics_Destroy();
+    Jobs_Destroy();
     Gui_Destroy();
     Con_Destroy();
     GLText_Destroy();
@@ -225,10 +306,16 @@ void Engine_Shutdown(int val)
     Sys_Destroy();
 
     /* no more renderings */
-    SDL_GL_DeleteContext(sdl_gl_context);
-    sdl_gl_context = 0;
-    SDL_DestroyWindow(sdl_window);
-    sdl_window = NULL;
+    if(sdl_gl_context)
+    {
+        SDL_GL_DeleteContext(sdl_gl_context);
+        sdl_gl_context = 0;
+    }
+    if(sdl_window)
+    {
+        SDL_DestroyWindow(sdl_window);
+        sdl_window = NULL;
+    }
 
     if(sdl_joystick)
     {
@@ -286,6 +373,7 @@ void Engine_Init_Pre()
     stream_codec_init(&engine_video);
 
     Sys_Init();
+    Jobs_Init();
     glf_init();
     GLText_Init();
     Con_Init();
@@ -502,6 +590,8 @@ void Engine_LoadConfig(const char *filename)
             Script_ParseScreen(lua, &screen_info);
             Script_ParseRender(lua, &renderer.settings);
             Script_ParseAudio(lua, &audio_settings);
+            Script_ParsePhysics(lua, &physics_settings);
+            Script_ParseScript(lua, &script_settings);
             Script_ParseConsole(lua);
             Script_ParseControls(lua, &control_mapper);
             lua_close(lua);
@@ -778,6 +868,12 @@ void Engine_JoyRumble(float power, int time)
 
 void Engine_MainLoop()
 {
+    if(screen_info.headless)
+    {
+        Engine_HeadlessLoop();
+        return;
+    }
+
     float time = 0.0f;
     float newtime = 0.0f;
     float oldtime = Sys_FloatTime();
@@ -843,6 +939,8 @@ void Engine_MainLoop()
             {
                 Game_Frame(time);
                 Gameflow_ProcessCommands();
+                Script_GCStep(engine_lua);
+                Save_CheckWrite();
             }
             Audio_Update(time);
             Engine_Display(time);
@@ -864,12 +962,12 @@ void Engine_MainLoop()
             stream_codec_audio_unlock(&engine_video);
             StreamTrack_Play(s);
 
-            stream_codec_video_lock(&engine_video);
-            if(engine_video.codec.video.rgba)
+            uint8_t *frame = stream_codec_video_acquire(&engine_video);
+            if(frame)
             {
-                Gui_SetScreenTexture(engine_video.codec.video.rgba, engine_video.codec.video.width, engine_video.codec.video.height, 32);
+                Gui_SetScreenTexture(frame, engine_video.codec.video.width, engine_video.codec.video.height, 32);
+                stream_codec_video_release(&engine_video);
             }
-            stream_codec_video_unlock(&engine_video);
             Gui_DrawLoadScreen(-1);
 
             if(control_states.gui_inventory)
@@ -881,6 +979,199 @@ void Engine_MainLoop()
 }
 
 
+/*
+ * Decodes whole video with codec only (no stream thread, no pacing),
+ * measures video decoding with colour conversion.
+ */
+static void Engine_HeadlessVideo(const char *name)
+{
+    struct tiny_codec_s codec;
+    int32_t frames = 0;
+
+    codec_init(&codec, SDL_RWFromFile(name, "rb"));
+    if(!codec.input || (0 != codec_open_rpl(&codec)) || !codec.video.decode)
+    {
+        printf("headless: can not open video \"%s\"\n", name);
+        if(codec.input)
+        {
+            codec_clear(&codec);
+            SDL_RWclose(codec.input);
+        }
+        return;
+    }
+
+    float start_time = Sys_FloatTime();
+    while(!engine_done && ((headless_frames <= 0) || (frames < headless_frames)) &&
+          (codec.packet(&codec, &codec.video.pkt) >= 0))
+    {
+        codec.video.decode(&codec, &codec.video.pkt);
+        ++frames;
+    }
+    float real_time = Sys_FloatTime() - start_time;
+
+    printf("headless: video %dx%d, %d frames decoded in %.3f s, %.1f frames/s\n",
+           codec.video.width, codec.video.height, frames, real_time,
+           (real_time > 0.0f) ? ((float)frames / real_time) : (0.0f));
+    codec_clear(&codec);
+    SDL_RWclose(codec.input);
+}
+
+
+struct headless_render_stats_s
+{
+    uint64_t    rooms;
+    uint64_t    pvs_rooms;
+    uint64_t    statics;
+    uint64_t    static_calls;
+    uint64_t    queue_items;
+    uint64_t    queue_switches[2];                                              // traversal, sorted order
+    uint64_t    queue_textures[2];
+    uint64_t    queue_buffers[2];
+    uint64_t    transparent_batches;
+    uint64_t    transparent_rebuilt;
+};
+
+/*
+ * Builds the frame render lists as Engine_Display does, but draws nothing
+ * (see renderer Gen* functions), and sums up their sizes.
+ */
+static void Engine_HeadlessRenderFrame(struct headless_render_stats_s *stats)
+{
+    render_queue_stats_t traversal_stats, sorted_stats;
+
+    Cam_Apply(&engine_camera);
+    Cam_RecalcClipPlanes(&engine_camera);
+    renderer.GenWorldList(&engine_camera);
+    stats->static_calls += renderer.GenStaticInstanceList();
+    stats->statics += renderer.GetStaticInstancesCount();
+    stats->rooms += renderer.GetRenderListCount();
+    stats->pvs_rooms += renderer.GetPVSRoomsCount();
+    renderer.GenRenderQueue();
+    renderer.GetRenderQueueStats(&traversal_stats, &sorted_stats);
+    stats->queue_items += sorted_stats.items;
+    stats->queue_switches[0] += traversal_stats.shader_switches;
+    stats->queue_switches[1] += sorted_stats.shader_switches;
+    stats->queue_textures[0] += traversal_stats.texture_binds;
+    stats->queue_textures[1] += sorted_stats.texture_binds;
+    stats->queue_buffers[0] += traversal_stats.buffer_binds;
+    stats->queue_buffers[1] += sorted_stats.buffer_binds;
+    stats->transparent_batches += renderer.GenTransparencyList();
+    stats->transparent_rebuilt += renderer.dynamicBSP->GetInputPolygonsCount();
+}
+
+/*
+ * Render queue radix sort against std::stable_sort on random keys.
+ */
+static void Engine_HeadlessRenderQueueCheck()
+{
+    const uint32_t rounds = 64;
+    uint32_t mismatches = RenderQueue_CheckSort(rounds);
+
+    printf("headless: render queue sort check: %u queues, %u misplaced items\n", rounds, mismatches);
+    if(mismatches)
+    {
+        printf("headless: render queue sort check failed\n");
+        Engine_Shutdown(EXIT_FAILURE);
+    }
+}
+
+
+static void Engine_HeadlessRenderReport(const struct headless_render_stats_s *stats, int32_t frames)
+{
+    printf("headless: render list per frame: %.1f rooms, %.1f static instances in %.1f instanced draw calls\n",
+           (float)stats->rooms / frames, (float)stats->statics / frames, (float)stats->static_calls / frames);
+    printf("headless: camera room PVS per frame: %.1f rooms\n", (float)stats->pvs_rooms / frames);
+    printf("headless: render queue per frame: %.1f items, traversal -> sorted: %.1f -> %.1f shader switches, %.1f -> %.1f texture binds, %.1f -> %.1f buffer binds\n",
+           (float)stats->queue_items / frames, (float)stats->queue_switches[0] / frames, (float)stats->queue_switches[1] / frames,
+           (float)stats->queue_textures[0] / frames, (float)stats->queue_textures[1] / frames,
+           (float)stats->queue_buffers[0] / frames, (float)stats->queue_buffers[1] / frames);
+    printf("headless: transparency per frame: %.1f sorted BSP batches, %.1f polygons inserted in dynamic tree\n",
+           (float)stats->transparent_batches / frames, (float)stats->transparent_rebuilt / frames);
+}
+
+
+/*
+ * Culling tests must agree and never reject a box with a visible point,
+ * else exits with failure.
+ */
+static void Engine_HeadlessCullBench()
+{
+    const uint32_t boxes_count = 4096;
+    uint32_t rounds = (headless_frames > 0) ? (headless_frames) : (256);
+    cull_bench_t bench;
+
+    Frustum_CullBench(&bench, rounds, boxes_count);
+    printf("headless: cull bench %u boxes, %u visible, %u mismatches, %u borderline, %u false rejects\n",
+           bench.boxes, bench.visible, bench.mismatches, bench.borderline, bench.false_rejects);
+    printf("headless: old faces test passed %u boxes, %u of them rejected by planes test\n",
+           bench.old_passed, bench.old_passed_rejected);
+    printf("headless: ns per box: old %.1f, single %.1f, batch scalar %.1f, batch %s %.1f\n",
+           1.0e9f * bench.old_time / bench.boxes, 1.0e9f * bench.single_time / bench.boxes,
+           1.0e9f * bench.scalar_time / bench.boxes, bench.simd, 1.0e9f * bench.simd_time / bench.boxes);
+    if(bench.mismatches || bench.false_rejects)
+    {
+        printf("headless: cull bench failed\n");
+        Engine_Shutdown(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ * Fixed time step simulation without display, input and audio update;
+ * runs as fast as CPU allows and reports simulation throughput.
+ */
+void Engine_HeadlessLoop()
+{
+    if(headless_video)
+    {
+        Engine_HeadlessVideo(headless_video);
+        return;
+    }
+
+    if(headless_cull_bench)
+    {
+        Engine_HeadlessCullBench();
+        return;
+    }
+
+    if(headless_level && !Engine_LoadMap(headless_level))
+    {
+        printf("headless: can not load level \"%s\"\n", headless_level);
+        Engine_Shutdown(EXIT_FAILURE);
+    }
+
+    int32_t frames = 0;
+    struct headless_render_stats_s render_stats = {0};
+    float start_time = Sys_FloatTime();
+    engine_set_zero_time = 0;
+    engine_frame_time = headless_dt;
+
+    while(!engine_done && ((headless_frames <= 0) || (frames < headless_frames)))
+    {
+        Sys_ResetTempMem();
+        engine_frame_time = headless_dt;
+        Game_Frame(headless_dt);
+        Gameflow_ProcessCommands();
+        Script_GCStep(engine_lua);
+        if(headless_render_stats)
+        {
+            Engine_HeadlessRenderFrame(&render_stats);
+        }
+        ++frames;
+    }
+
+    float real_time = Sys_FloatTime() - start_time;
+    screen_info.fps = (real_time > 0.0f) ? ((float)frames / real_time) : (0.0f);
+    printf("headless: %d frames, dt = %.6f s, simulated %.2f s in %.3f s, %.1f frames/s\n",
+           frames, headless_dt, (float)frames * headless_dt, real_time, screen_info.fps);
+    if(headless_render_stats && (frames > 0))
+    {
+        Engine_HeadlessRenderReport(&render_stats, frames);
+        Engine_HeadlessRenderQueueCheck();
+    }
+}
+
+
 void TestModelApplyKey(int key)
 {
     switch(key)
@@ -1308,6 +1599,14 @@ void ShowDebugInfo()
                 GLText_OutTextXY(30.0f, y += dy, "input polygons = %07d", renderer.dynamicBSP->GetInputPolygonsCount());
                 GLText_OutTextXY(30.0f, y += dy, "added polygons = %07d", renderer.dynamicBSP->GetAddedPolygonsCount());
             }
+            {
+                render_queue_stats_t traversal_stats, stats;
+                renderer.GetRenderQueueStats(&traversal_stats, &stats);
+                GLText_OutTextXY(30.0f, y += dy, "render queue: items = %d, draws = %d", stats.items, stats.draws);
+                GLText_OutTextXY(30.0f, y += dy, "shader switches = %d (%d unsorted), texture binds = %d (%d), buffer binds = %d (%d)",
+                                 stats.shader_switches, traversal_stats.shader_switches, stats.texture_binds, traversal_stats.texture_binds,
+                                 stats.buffer_binds, traversal_stats.buffer_binds);
+            }
             break;
 
         case debug_view_state_e::model_view:
@@ -1566,6 +1865,7 @@ extern "C" int Engine_ExecCmd(char *ch)
             Con_AddLine("loadMap(\"file_name\") - load level \"file_name\"\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("setgamef(game, level) - load level (ie: setgamef(2, 1) for TR2 level 1)\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("save, load - save and load game state in \"file_name\"\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("save_lua - export game state as lua script \"file_name\", load reads it too\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("exit - close program\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("cls - clean console\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("show_fps - switch show fps flag\0", FONTSTYLE_CONSOLE_NOTIFY);
@@ -1578,6 +1878,8 @@ extern "C" int Engine_ExecCmd(char *ch)
             Con_AddLine("r_wireframe, r_portals, r_frustums, r_room_boxes, r_boxes, r_normals, r_skip_room, r_flyby, r_cinematics, r_triggers, r_ai_boxes, r_cameras - render modes, r_path - show character path\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("playsound(id) - play specified sound\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("stopsound(id) - stop specified sound\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("script_profile [on, off, reset, dump \"file_name\"] - lua callbacks timings\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("script_gc_budget - lua GC step per frame in us, 0 - automatic GC\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("Watch out for case sensitive commands!\0", FONTSTYLE_CONSOLE_WARNING);
         }
         else if(!strcmp(token, "goto"))
@@ -1597,6 +1899,15 @@ extern "C" int Engine_ExecCmd(char *ch)
             }
             return 1;
         }
+        else if(!strcmp(token, "save_lua"))
+        {
+            ch = SC_ParseToken(ch, token, sizeof(token));
+            if(NULL != ch)
+            {
+                Game_Save(token, SAVE_FORMAT_LUA);
+            }
+            return 1;
+        }
         else if(!strcmp(token, "load"))
         {
             ch = SC_ParseToken(ch, token, sizeof(token));
@@ -1611,6 +1922,44 @@ extern "C" int Engine_ExecCmd(char *ch)
             Engine_Shutdown(0);
             return 1;
         }
+        else if(!strcmp(token, "script_profile"))
+        {
+            ch = SC_ParseToken(ch, token, sizeof(token));
+            if(NULL == ch)
+            {
+                Script_ProfilePrint();
+            }
+            else if(!strcmp(token, "on") || !strcmp(token, "off"))
+            {
+                script_settings.profile = (token[1] == 'n');
+                Script_ProfileReset();
+            }
+            else if(!strcmp(token, "reset"))
+            {
+                Script_ProfileReset();
+            }
+            else if(!strcmp(token, "dump"))
+            {
+                ch = SC_ParseToken(ch, token, sizeof(token));
+                const char *file_name = (NULL != ch) ? (token) : ("script_profile.txt");
+                if(!Script_ProfileDump(file_name))
+                {
+                    Con_Warning("can not write \"%s\"", file_name);
+                }
+            }
+            return 1;
+        }
+        else if(!strcmp(token, "script_gc_budget"))
+        {
+            ch = SC_ParseToken(ch, token, sizeof(token));
+            if(NULL == ch)
+            {
+                Con_Notify("script_gc_budget = %dus", (int)script_settings.gc_step_budget);
+                return 1;
+            }
+            script_settings.gc_step_budget = (atoi(token) > 0) ? (atoi(token)) : (0);
+            return 1;
+        }
         else if(!strcmp(token, "cls"))
         {
             Con_Clean();
@@ -248,6 +248,72 @@ void Entity_MoveToRoom(entity_p entity, struct room_s *new_room)
 }
 
 
+/*
+ * Places entity in the room (NULL - keeps current one), updates its sector
+ * and sets the movement state; shared by scripts and saved games loading.
+ */
+void Entity_SetRoomMove(entity_p ent, struct room_s *room, uint16_t move_type, uint16_t dir_flag)
+{
+    if(room)
+    {
+        Entity_MoveToRoom(ent, room);
+    }
+    Entity_UpdateRoomPos(ent);
+    ent->move_type = move_type;
+    ent->dir_flag = dir_flag;
+}
+
+
+void Entity_SetStateFlags(entity_p ent, uint16_t state_flags)
+{
+    ent->state_flags = state_flags;
+    if(ent->state_flags & ENTITY_STATE_COLLIDABLE)
+    {
+        Entity_EnableCollision(ent);
+    }
+    else
+    {
+        Entity_DisableCollision(ent);
+    }
+}
+
+
+/*
+ * Sets first size components of activation offset (dx, dy, dz, r), the
+ * activation point is created with default values if entity has not it.
+ */
+void Entity_SetActivationOffset(entity_p ent, const float *offset, int size)
+{
+    if(!ent->activation_point)
+    {
+        Entity_InitActivationPoint(ent);
+    }
+    for(int i = 0; (i < size) && (i < 4); i++)
+    {
+        ent->activation_point->offset[i] = offset[i];
+    }
+}
+
+
+/*
+ * Replaces base animations model by the one with the same meshes count,
+ * returns 0 if model does not fit.
+ */
+int Entity_SetBaseAnimModel(entity_p ent, struct skeletal_model_s *model)
+{
+    if(model && ent->bf->animations.model && (ent->bf->animations.model->mesh_count == model->mesh_count))
+    {
+        ent->bf->animations.model = model;
+        ent->bf->animations.prev_animation = 0;
+        ent->bf->animations.prev_frame = 0;
+        ent->bf->animations.current_animation = 0;
+        ent->bf->animations.current_frame = 0;
+        return 1;
+    }
+    return 0;
+}
+
+
 void Entity_UpdateTransform(entity_p entity)
 {
     float *ang = entity->transform.angles;
@@ -1152,6 +1218,18 @@ void Entity_MoveToSink(entity_p entity, struct static_camera_sink_s *sink)
 
 
 void Entity_Frame(entity_p entity, float time)
+{
+    if(Entity_ProcessAnimations(entity, time))
+    {
+        SSBoneFrame_Update(entity->bf, time);
+    }
+}
+
+/**
+ * Advances entity animations, but does not rebuild the pose;
+ * returns 1 if bf must be updated by SSBoneFrame_Update(Batch).
+ */
+int  Entity_ProcessAnimations(entity_p entity, float time)
 {
     if(entity && !(entity->type_flags & ENTITY_TYPE_DYNAMIC) && (entity->state_flags & ENTITY_STATE_ACTIVE)  && (entity->state_flags & ENTITY_STATE_ENABLED))
     {
@@ -1214,8 +1292,10 @@ void Entity_Frame(entity_p entity, float time)
             ss_anim = ss_anim->next;
         }
 
-        SSBoneFrame_Update(entity->bf, time);
+        return 1;
     }
+
+    return 0;
 }
 
 /**
@@ -179,8 +179,13 @@ void Entity_EnableCollision(entity_p ent);
 void Entity_DisableCollision(entity_p ent);
 void Entity_UpdateRoomPos(entity_p ent);
 void Entity_MoveToRoom(entity_p entity, struct room_s *new_room);
+void Entity_SetRoomMove(entity_p ent, struct room_s *room, uint16_t move_type, uint16_t dir_flag);
+void Entity_SetStateFlags(entity_p ent, uint16_t state_flags);
+void Entity_SetActivationOffset(entity_p ent, const float *offset, int size);
+int  Entity_SetBaseAnimModel(entity_p ent, struct skeletal_model_s *model);
 
 void Entity_Frame(entity_p entity, float time);  // process frame + trying to change state
+int  Entity_ProcessAnimations(entity_p entity, float time);  // the same, but without pose update
 
 void Entity_RebuildBV(entity_p ent);
 void Entity_UpdateTransform(entity_p entity);
@@ -373,18 +373,8 @@ static int escape124_decode_frame(struct tiny_codec_s *avctx, struct AVPacket *a
 
     if(avctx->video.rgba)
     {
-        uint8_t *rgba = avctx->video.rgba;
-        for(i = 0; i < avctx->video.height; ++i)
-        {
-            uint16_t *px = (uint16_t*)s->buff1 + i * new_stride;
-            for(int j = 0; j < avctx->video.width; ++j, ++px)
-            {
-                *rgba++ = ((*px) & 0x7C00) >> (10 - 3);
-                *rgba++ = ((*px) & 0x03E0) >> (5 - 3);
-                *rgba++ = ((*px) & 0x001F) << 3 ;
-                *rgba++ = 0xFF;
-            }
-        }
+        codec_rgb555_to_rgba(avctx->video.rgba, (uint16_t*)s->buff1, avctx->video.width, avctx->video.height, new_stride);
+        avctx->video.rgba_updates++;
     }
     FFSWAP(uint8_t*, s->buff1, s->buff2);
 
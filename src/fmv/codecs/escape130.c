@@ -288,23 +288,31 @@ static int escape130_decode_frame(struct tiny_codec_s *avctx, struct AVPacket *a
 
         for(i = 0; i < avctx->video.height; ++i)
         {
-            for(int j = 0; j < avctx->video.width; ++j)
+            for(int j = 0; j < avctx->video.width; j += 2)
             {
+                // chroma is shared by pixels pair, so weight it once
                 uint8_t cb = new_cb[j / 2] & 31;
                 uint8_t cr = new_cr[j / 2] & 31;
-                y = (s->new_y[new_y_stride * i + j] << 2);
                 u = chroma_vals[cb];
                 v = chroma_vals[cr];
-                r = y + 1.13983f * (v - 128);
-                g = y - 0.39465f * (u - 128) - 0.58060f * (v - 128);
-                b = y + 2.03211f * (u - 128);
-                r = (r < 0) ? (0) : (r);
-                g = (g < 0) ? (0) : (g);
-                b = (b < 0) ? (0) : (b);
-                *rgba++ = (r <= 0xFF) ? (r) : 0xFF;
-                *rgba++ = (g <= 0xFF) ? (g) : 0xFF;
-                *rgba++ = (b <= 0xFF) ? (b) : 0xFF;
-                *rgba++ = 0xFF;
+                float vr = 1.13983f * (v - 128);
+                float ug = 0.39465f * (u - 128);
+                float vg = 0.58060f * (v - 128);
+                float ub = 2.03211f * (u - 128);
+                for(int k = j; (k < j + 2) && (k < avctx->video.width); ++k)
+                {
+                    y = (s->new_y[new_y_stride * i + k] << 2);
+                    r = y + vr;
+                    g = y - ug - vg;
+                    b = y + ub;
+                    r = (r < 0) ? (0) : (r);
+                    g = (g < 0) ? (0) : (g);
+                    b = (b < 0) ? (0) : (b);
+                    *rgba++ = (r <= 0xFF) ? (r) : 0xFF;
+                    *rgba++ = (g <= 0xFF) ? (g) : 0xFF;
+                    *rgba++ = (b <= 0xFF) ? (b) : 0xFF;
+                    *rgba++ = 0xFF;
+                }
             }
             if(i & 1)
             {
@@ -312,6 +320,7 @@ static int escape130_decode_frame(struct tiny_codec_s *avctx, struct AVPacket *a
                 new_cr += new_cr_stride;
             }
         }
+        avctx->video.rgba_updates++;
     }
     //ff_dlog(avctx, "Frame data: provided %d bytes, used %d bytes\n",
     //        buf_size, get_bits_count(&gb) >> 3);
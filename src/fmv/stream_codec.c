@@ -17,14 +17,70 @@
 #include "tiny_codec.h"
 #include "stream_codec.h"
 
+static void stream_codec_free_frames(stream_codec_p s)
+{
+    for(int i = 0; i < STREAM_CODEC_VIDEO_FRAMES; ++i)
+    {
+        free(s->video_frames[i]);
+        s->video_frames[i] = NULL;
+    }
+    s->video_write = 0;
+    s->video_read = 0;
+}
+
+
+/*
+ * Frame number that must be on screen now, counted from the stream start.
+ */
+static uint64_t stream_codec_due_frame(stream_codec_p s)
+{
+    struct timespec now;
+    uint64_t ns;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    if((now.tv_sec < s->time_start.tv_sec) ||
+       ((now.tv_sec == s->time_start.tv_sec) && (now.tv_nsec < s->time_start.tv_nsec)))
+    {
+        return 0;
+    }
+    ns = (uint64_t)(now.tv_sec - s->time_start.tv_sec) * 1000000000 + now.tv_nsec - s->time_start.tv_nsec;
+    return ns / 1000 * s->codec.fps_num / (s->codec.fps_denum * 1000000);
+}
+
+
+/*
+ * Absolute time of the frame start, used as wakeup time for the decoder.
+ */
+static void stream_codec_frame_time(stream_codec_p s, uint64_t frame, struct timespec *t)
+{
+    uint64_t ns = (frame * s->codec.fps_denum) % s->codec.fps_num;
+    ns = ns * 1000000000 / s->codec.fps_num;
+    t->tv_sec = s->time_start.tv_sec + frame * s->codec.fps_denum / s->codec.fps_num;
+    t->tv_nsec = s->time_start.tv_nsec + ns;
+    if(t->tv_nsec >= 1000000000)
+    {
+        t->tv_nsec -= 1000000000;
+        t->tv_sec++;
+    }
+}
+
+
 void stream_codec_init(stream_codec_p s)
 {
     s->state = VIDEO_STATE_STOPPED;
     s->stop = 0;
     s->update_audio = 1;
     s->is_thread_run = 0;
+    s->video_write = 0;
+    s->video_read = 0;
+    s->frames_skipped = 0;
+    s->frames_dropped = 0;
+    for(int i = 0; i < STREAM_CODEC_VIDEO_FRAMES; ++i)
+    {
+        s->video_frames[i] = NULL;
+        s->video_frame_index[i] = 0;
+    }
     pthread_mutex_init(&s->timer_mutex, NULL);
-    pthread_mutex_init(&s->video_buffer_mutex, NULL);
     pthread_mutex_init(&s->audio_buffer_mutex, NULL);
     codec_init(&s->codec, NULL);
 }
@@ -38,9 +94,9 @@ void stream_codec_clear(stream_codec_p s)
         pthread_join(s->thread, NULL);
         s->is_thread_run = 0;
     }
+    stream_codec_free_frames(s);
 
     pthread_mutex_destroy(&s->timer_mutex);
-    pthread_mutex_destroy(&s->video_buffer_mutex);
     pthread_mutex_destroy(&s->audio_buffer_mutex);
 }
 
@@ -53,6 +109,7 @@ int stream_codec_check_end(stream_codec_p s)
         {
             pthread_join(s->thread, NULL);
             s->is_thread_run = 0;
+            stream_codec_free_frames(s);
             return 1;
         }
         return 0;
@@ -68,6 +125,7 @@ void stream_codec_stop(stream_codec_p s, int wait)
     {
         pthread_join(s->thread, NULL);
         s->is_thread_run = 0;
+        stream_codec_free_frames(s);
     }
 }
 
@@ -78,26 +136,14 @@ static void *stream_codec_thread_func(void *data)
     if(s)
     {
         uint64_t frame = 0;
-        uint64_t ns = 0;
-        struct timespec time_start = { 0 };
+        uint32_t skipped_in_row = 0;
         struct timespec vid_time;
         int can_continue = 1;
 
-        clock_gettime(CLOCK_REALTIME, &time_start);
-
         while(!s->stop && can_continue)
         {
-            frame++;
-            can_continue = 0;
-            ns = (frame * s->codec.fps_denum) % s->codec.fps_num;
-            ns = ns * 1000000000 / s->codec.fps_num;
-            vid_time.tv_sec = time_start.tv_sec + frame * s->codec.fps_denum / s->codec.fps_num;
-            vid_time.tv_nsec = time_start.tv_nsec + ns;
-            if(vid_time.tv_nsec >= 1000000000)
-            {
-                vid_time.tv_nsec -= 1000000000;
-                vid_time.tv_sec++;
-            }
+            uint32_t write = s->video_write;
+            uint32_t read = __atomic_load_n(&s->video_read, __ATOMIC_ACQUIRE);
 
             if(s->update_audio && s->codec.audio.decode && (s->codec.packet(&s->codec, &s->codec.audio.pkt) >= 0))
             {
@@ -107,25 +153,62 @@ static void *stream_codec_thread_func(void *data)
                 pthread_mutex_unlock(&s->audio_buffer_mutex);
             }
 
-            if(s->codec.video.decode && (s->codec.packet(&s->codec, &s->codec.video.pkt) >= 0))
+            if(write - read < STREAM_CODEC_VIDEO_FRAMES)
+            {
+                /* frame is already behind the clock: decode it to keep the
+                 * codec state, but skip colour conversion; some frames must
+                 * still reach the screen, so do not skip too many in row */
+                uint32_t slot = write % STREAM_CODEC_VIDEO_FRAMES;
+                int late = (frame + 1 < stream_codec_due_frame(s)) && (skipped_in_row < STREAM_CODEC_VIDEO_FRAMES - 1);
+                uint32_t updates = s->codec.video.rgba_updates;
+
+                can_continue = 0;
+                s->codec.video.rgba = (late) ? (NULL) : (s->video_frames[slot]);
+                if(s->codec.video.decode && (s->codec.packet(&s->codec, &s->codec.video.pkt) >= 0))
+                {
+                    s->codec.video.decode(&s->codec, &s->codec.video.pkt);
+                    if(s->codec.video.rgba_updates != updates)
+                    {
+                        s->video_frame_index[slot] = frame;
+                        __atomic_store_n(&s->video_write, write + 1, __ATOMIC_RELEASE);
+                        skipped_in_row = 0;
+                    }
+                    else if(late)
+                    {
+                        s->frames_skipped++;
+                        skipped_in_row++;
+                    }
+                    frame++;
+                    can_continue++;
+                }
+                s->state = VIDEO_STATE_RUNNING;
+            }
+            else
             {
-                pthread_mutex_lock(&s->video_buffer_mutex);
-                s->codec.video.decode(&s->codec, &s->codec.video.pkt);
-                pthread_mutex_unlock(&s->video_buffer_mutex);
-                can_continue++;
+                // ring is full: sleep until the oldest queued frame is shown
+                uint64_t wake_frame = stream_codec_due_frame(s) + 1;
+                if(wake_frame <= s->video_frame_index[read % STREAM_CODEC_VIDEO_FRAMES])
+                {
+                    wake_frame = s->video_frame_index[read % STREAM_CODEC_VIDEO_FRAMES] + 1;
+                }
+                stream_codec_frame_time(s, wake_frame, &vid_time);
+                pthread_mutex_timedlock(&s->timer_mutex, &vid_time);
             }
+        }
 
-            s->state = VIDEO_STATE_RUNNING;
+        // let renderer show queued frames
+        while(!s->stop && (__atomic_load_n(&s->video_read, __ATOMIC_ACQUIRE) != s->video_write))
+        {
+            stream_codec_frame_time(s, stream_codec_due_frame(s) + 1, &vid_time);
             pthread_mutex_timedlock(&s->timer_mutex, &vid_time);
         }
         s->state = VIDEO_STATE_QEUED;
 
-        pthread_mutex_lock(&s->video_buffer_mutex);
         pthread_mutex_lock(&s->audio_buffer_mutex);
+        s->codec.video.rgba = NULL;         // ring frames are owned by stream
         codec_clear(&s->codec);
         pthread_mutex_unlock(&s->audio_buffer_mutex);
-        pthread_mutex_unlock(&s->video_buffer_mutex);
-        
+
         SDL_RWclose(s->codec.input);
         s->codec.input = NULL;
     }
@@ -135,15 +218,41 @@ static void *stream_codec_thread_func(void *data)
 }
 
 
-void stream_codec_video_lock(stream_codec_p s)
+/*
+ * Returns the newest frame that is due to be shown, older queued frames are
+ * dropped; NULL if there is nothing new. Frame must be returned with
+ * stream_codec_video_release() before the next acquire.
+ */
+uint8_t *stream_codec_video_acquire(stream_codec_p s)
 {
-    pthread_mutex_lock(&s->video_buffer_mutex);
+    uint32_t read = s->video_read;
+    uint32_t write = __atomic_load_n(&s->video_write, __ATOMIC_ACQUIRE);
+    uint64_t due;
+
+    if(read == write)
+    {
+        return NULL;
+    }
+
+    due = stream_codec_due_frame(s);
+    while((write - read > 1) && (s->video_frame_index[(read + 1) % STREAM_CODEC_VIDEO_FRAMES] <= due))
+    {
+        read++;
+        s->frames_dropped++;
+    }
+    __atomic_store_n(&s->video_read, read, __ATOMIC_RELEASE);
+
+    if(s->video_frame_index[read % STREAM_CODEC_VIDEO_FRAMES] > due)
+    {
+        return NULL;
+    }
+    return s->video_frames[read % STREAM_CODEC_VIDEO_FRAMES];
 }
 
 
-void stream_codec_video_unlock(stream_codec_p s)
+void stream_codec_video_release(stream_codec_p s)
 {
-    pthread_mutex_unlock(&s->video_buffer_mutex);
+    __atomic_store_n(&s->video_read, s->video_read + 1, __ATOMIC_RELEASE);
 }
 
 
@@ -163,8 +272,24 @@ int stream_codec_play(stream_codec_p s)
 {
     if((s->state == VIDEO_STATE_STOPPED) && s->codec.input)
     {
+        uint32_t frame_size = 4 * s->codec.video.width * s->codec.video.height;
+
+        /* decoder writes straight into ring slots, so container's
+         * single frame buffer is not needed */
+        free(s->codec.video.rgba);
+        s->codec.video.rgba = NULL;
+        stream_codec_free_frames(s);
+        for(int i = 0; i < STREAM_CODEC_VIDEO_FRAMES; ++i)
+        {
+            s->video_frames[i] = (uint8_t*)malloc(frame_size);
+            s->video_frame_index[i] = 0;
+        }
+        s->frames_skipped = 0;
+        s->frames_dropped = 0;
+
         s->state = VIDEO_STATE_QEUED;
         s->stop = 0;
+        clock_gettime(CLOCK_REALTIME, &s->time_start);
 
         s->is_thread_run = (0 == pthread_create(&s->thread, NULL, stream_codec_thread_func, s));
         return (s->is_thread_run == 0);
@@ -27,6 +27,8 @@ extern "C" {
 #define VIDEO_STATE_QEUED       (1)
 #define VIDEO_STATE_RUNNING     (2)
 
+#define STREAM_CODEC_VIDEO_FRAMES   (4)     // decode-ahead ring size
+
 
 typedef struct stream_codec_s
 {
@@ -34,8 +36,17 @@ typedef struct stream_codec_s
     int                      is_thread_run;
     pthread_t                thread;
     pthread_mutex_t          timer_mutex;
-    pthread_mutex_t          video_buffer_mutex;
     pthread_mutex_t          audio_buffer_mutex;
+    struct timespec          time_start;
+    /* single producer / single consumer frames ring: decoder thread owns
+     * video_write, renderer owns video_read; slot is free while video_read
+     * did not pass it. */
+    uint8_t                 *video_frames[STREAM_CODEC_VIDEO_FRAMES];
+    uint64_t                 video_frame_index[STREAM_CODEC_VIDEO_FRAMES];
+    uint32_t                 video_write;
+    uint32_t                 video_read;
+    uint32_t                 frames_skipped;    // not converted by decoder (it was late)
+    uint32_t                 frames_dropped;    // converted, but never shown
     volatile int             stop;
     volatile int             update_audio;
     volatile int             state;
@@ -47,8 +58,8 @@ void stream_codec_clear(stream_codec_p s);
 void stream_codec_stop(stream_codec_p s, int wait);
 int  stream_codec_check_end(stream_codec_p s);
 
-void stream_codec_video_lock(stream_codec_p s);
-void stream_codec_video_unlock(stream_codec_p s);
+uint8_t *stream_codec_video_acquire(stream_codec_p s);
+void stream_codec_video_release(stream_codec_p s);
 void stream_codec_audio_lock(stream_codec_p s);
 void stream_codec_audio_unlock(stream_codec_p s);
 
@@ -7,6 +7,11 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <SDL2/SDL.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "tiny_codec.h"
 
@@ -81,6 +86,7 @@ void codec_init(struct tiny_codec_s *s, SDL_RWops *rw)
     av_init_packet(&s->video.pkt);
     s->video.pkt.is_video = 1;
     s->video.rgba = NULL;
+    s->video.rgba_updates = 0;
     s->video.entry = NULL;
     s->video.entry_size = 0;
     s->video.entry_current = 0;
@@ -191,4 +197,52 @@ uint32_t codec_resize_audio_buffer(struct tiny_codec_s *s, uint32_t sample_size,
     }
 
     return ret;
-}
\ No newline at end of file
+}
+
+/*
+ * RGB555 (bit 15 unused) to RGBA8888, 8 pixels per step with SIMD;
+ * src_stride is in pixels.
+ */
+void codec_rgb555_to_rgba(uint8_t *rgba, const uint16_t *src, uint32_t width, uint32_t height, uint32_t src_stride)
+{
+    for(uint32_t i = 0; i < height; ++i, src += src_stride)
+    {
+        const uint16_t *px = src;
+        uint32_t j = 0;
+#if defined(__SSE2__)
+        const __m128i mask_r = _mm_set1_epi16(0x7C00);
+        const __m128i mask_g = _mm_set1_epi16(0x03E0);
+        const __m128i mask_b = _mm_set1_epi16(0x001F);
+        const __m128i alpha  = _mm_set1_epi16((short)0xFF00);
+        for(; j + 8 <= width; j += 8, px += 8, rgba += 32)
+        {
+            __m128i p  = _mm_loadu_si128((const __m128i*)px);
+            __m128i r  = _mm_srli_epi16(_mm_and_si128(p, mask_r), 10 - 3);
+            __m128i g  = _mm_slli_epi16(_mm_and_si128(p, mask_g), 8 - (5 - 3));
+            __m128i b  = _mm_slli_epi16(_mm_and_si128(p, mask_b), 3);
+            __m128i rg = _mm_or_si128(r, g);
+            __m128i ba = _mm_or_si128(b, alpha);
+            _mm_storeu_si128((__m128i*)rgba, _mm_unpacklo_epi16(rg, ba));
+            _mm_storeu_si128((__m128i*)(rgba + 16), _mm_unpackhi_epi16(rg, ba));
+        }
+#elif defined(__ARM_NEON)
+        for(; j + 8 <= width; j += 8, px += 8, rgba += 32)
+        {
+            uint16x8_t p = vld1q_u16(px);
+            uint8x8x4_t out;
+            out.val[0] = vmovn_u16(vshrq_n_u16(vandq_u16(p, vdupq_n_u16(0x7C00)), 10 - 3));
+            out.val[1] = vmovn_u16(vshrq_n_u16(vandq_u16(p, vdupq_n_u16(0x03E0)), 5 - 3));
+            out.val[2] = vmovn_u16(vshlq_n_u16(vandq_u16(p, vdupq_n_u16(0x001F)), 3));
+            out.val[3] = vdup_n_u8(0xFF);
+            vst4_u8(rgba, out);
+        }
+#endif
+        for(; j < width; ++j, ++px)
+        {
+            *rgba++ = ((*px) & 0x7C00) >> (10 - 3);
+            *rgba++ = ((*px) & 0x03E0) >> (5 - 3);
+            *rgba++ = ((*px) & 0x001F) << 3;
+            *rgba++ = 0xFF;
+        }
+    }
+}
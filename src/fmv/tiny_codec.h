@@ -73,6 +73,7 @@ typedef struct tiny_codec_s
         uint16_t        width;
         uint16_t        height;
         uint8_t        *rgba;
+        uint32_t        rgba_updates;           ///< increased by decoder each time it writes rgba
         void           *priv_data;
         void          (*free_data)(void *data);
         int32_t       (*decode)(struct tiny_codec_s *s, struct AVPacket *pkt);
@@ -121,6 +122,7 @@ void codec_init(struct tiny_codec_s *s, SDL_RWops *rw);
 void codec_clear(struct tiny_codec_s *s);
 void codec_simplify_fps(struct tiny_codec_s *s);
 uint32_t codec_resize_audio_buffer(struct tiny_codec_s *s, uint32_t sample_size, uint32_t samples);
+void codec_rgb555_to_rgba(uint8_t *rgba, const uint16_t *src, uint32_t width, uint32_t height, uint32_t src_stride);
 
 int codec_open_rpl(struct tiny_codec_s *s);
                     
@@ -13,6 +13,7 @@ extern "C" {
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/obb.h"
+#include "core/jobs.h"
 #include "render/camera.h"
 #include "render/frustum.h"
 #include "render/render.h"
@@ -31,10 +32,41 @@ extern "C" {
 #include "character_controller.h"
 #include "gameflow.h"
 #include "inventory.h"
+#include "save_game.h"
 
 extern lua_State *engine_lua;
 
-int Save_Entity(entity_p ent, void *data);
+#define GAME_POSE_JOB_MAX_ENTITIES  (16)
+
+typedef struct game_pose_s
+{
+    uint32_t                    room_id;
+    uint32_t                    order;
+    struct ss_bone_frame_s     *bf;
+}game_pose_t, *game_pose_p;
+
+typedef struct game_pose_job_s
+{
+    uint32_t                    first;
+    uint32_t                    count;
+}game_pose_job_t, *game_pose_job_p;
+
+/*
+ * entities updated in this frame; logic runs serially, then poses are
+ * evaluated on the jobs pool in per room groups, then rigid bodies and
+ * rooms are synced serially in the entities order.
+ */
+static struct
+{
+    uint32_t                    size;
+    uint32_t                    entities_count;
+    uint32_t                    poses_count;
+    uint32_t                    jobs_count;
+    struct entity_s           **entities;
+    struct game_pose_s         *poses;
+    struct ss_bone_frame_s    **bone_frames;                                    // poses sorted by rooms
+    struct game_pose_job_s     *jobs;
+} game_update_list = {0, 0, 0, 0, NULL, NULL, NULL, NULL};
 
 int lua_mlook(lua_State * lua)
 {
@@ -118,287 +150,73 @@ void Game_RegisterLuaFunctions(struct lua_State *lua)
 }
 
 
-/**
- * Load game state
+/*
+ * local names are placed in "save/" dir
  */
-int Game_Load(const char* name)
+static void Game_GetSavePath(const char *name, char *save_path, size_t save_path_size)
 {
-    FILE *f;
-    char *ch, local;
+    const char *ch;
+    size_t save_path_base_len = save_path_size - 1;
 
-    local = 1;
-    for(ch = (char*)name; *ch; ch++)
+    for(ch = name; *ch && (*ch != '\\') && (*ch != '/'); ch++);
+    save_path[0] = 0;
+    if(*ch == 0)
     {
-        if((*ch == '\\') || (*ch == '/'))
-        {
-            local = 0;
-            break;
-        }
-    }
-
-    if(local)
-    {
-        char save_path[1024];
-        size_t save_path_base_len = sizeof(save_path) - 1;
         strncpy(save_path, Engine_GetBasePath(), save_path_base_len);
         save_path[save_path_base_len] = 0;
         strncat(save_path, "save/", save_path_base_len - strlen(save_path));
-        strncat(save_path, name, save_path_base_len - strlen(save_path));
-        if(!Sys_FileFound(save_path, 0))
-        {
-            Sys_extWarn("Can not read file \"%s\"", save_path);
-            return 0;
-        }
-        Script_LuaClearTasks();
-        luaL_dofile(engine_lua, save_path);
-    }
-    else
-    {
-        f = fopen(name, "rb");
-        if(f == NULL)
-        {
-            Sys_extWarn("Can not read file \"%s\"", name);
-            return 0;
-        }
-        fclose(f);
-        Script_LuaClearTasks();
-        luaL_dofile(engine_lua, name);
     }
-
-    return 1;
+    strncat(save_path, name, save_path_base_len - strlen(save_path));
 }
 
 /**
- * Entity save function, based on engine lua scripts;
+ * Checks the save file, waits for the one being written
  */
-int Save_Entity(entity_p ent, void *data)
+int Game_SaveFound(const char *name)
 {
-    if(ent)
-    {
-        FILE **f = (FILE**)data;
-        if(ent->type_flags & ENTITY_TYPE_SPAWNED)
-        {
-            uint32_t room_id = (ent->self->room) ? (ent->self->room->id) : (0xFFFFFFFF);
-            fprintf(*f, "\nspawnEntity(%d, 0x%X, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %d);", ent->bf->animations.model->id, room_id,
-                    ent->transform.M4x4[12 + 0], ent->transform.M4x4[12 + 1], ent->transform.M4x4[12 + 2],
-                    ent->transform.angles[0], ent->transform.angles[1], ent->transform.angles[2], ent->id);
-        }
-        else
-        {
-            fprintf(*f, "\nsetEntityPos(%d, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f);", ent->id,
-                    ent->transform.M4x4[12 + 0], ent->transform.M4x4[12 + 1], ent->transform.M4x4[12 + 2],
-                    ent->transform.angles[0], ent->transform.angles[1], ent->transform.angles[2]);
-        }
-
-        if(ent->self->room)
-        {
-            fprintf(*f, "\nsetEntityRoomMove(%d, %d, %d, %d);", ent->id, ent->self->room->id, ent->move_type, ent->dir_flag);
-        }
-        else
-        {
-            fprintf(*f, "\nsetEntityRoomMove(%d, nil, %d, %d);", ent->id, ent->move_type, ent->dir_flag);
-        }
-
-        if(ent->bf->animations.model && ent->character)
-        {
-            fprintf(*f, "\nsetEntityBaseAnimModel(%d, %d);", ent->id, ent->bf->animations.model->id);
-        }
-
-        if(ent->activation_point)
-        {
-            activation_point_p ap = ent->activation_point;
-            fprintf(*f, "\nsetEntityActivationOffset(%d, %.4f, %.4f, %.4f, %.4f);", ent->id, ap->offset[0], ap->offset[1], ap->offset[2], ap->offset[3]);
-            fprintf(*f, "\nsetEntityActivationDirection(%d, %.4f, %.4f, %.4f, %.4f);", ent->id, ap->direction[0], ap->direction[1], ap->direction[2], ap->direction[3]);
-        }
-
-        for(uint16_t i = 0; i < ent->bf->bone_tag_count; ++i)
-        {
-            ss_bone_tag_p b_tag = ent->bf->bone_tags + i;
-            if(b_tag->is_hidden)
-            {
-                fprintf(*f, "\nsetEntityBoneVisibility(%d, %d, false);", ent->id, i);
-            }
-            if(ent->character)
-            {
-                if(b_tag->is_targeted)
-                {
-                    fprintf(*f, "\nentitySSAnimSetTarget(%d, %d, %.2f, %.2f, %.2f, %.6f, %.6f, %.6f);", ent->id, i,
-                        b_tag->mod.target[0], b_tag->mod.target[1], b_tag->mod.target[2],
-                        b_tag->mod.direction[0], b_tag->mod.direction[1], b_tag->mod.direction[2]);
-                }
-                if(b_tag->is_axis_modded)
-                {
-                    fprintf(*f, "\nentitySSAnimSetAxisMod(%d, %d, %.6f, %.6f, %.6f);", ent->id, i,
-                        b_tag->mod.axis_mod[0], b_tag->mod.axis_mod[1], b_tag->mod.axis_mod[2]);
-                }
-                fprintf(*f, "\nentitySSAnimSetTargetingLimit(%d, %d, %.6f, %.6f, %.6f, %.6f);", ent->id, i,
-                    b_tag->mod.limit[0], b_tag->mod.limit[1], b_tag->mod.limit[2], b_tag->mod.limit[3]);
-                fprintf(*f, "\nentitySSAnimSetCurrentRotation(%d, %d, %.6f, %.6f, %.6f, %.6f);", ent->id, i,
-                    b_tag->mod.current[0], b_tag->mod.current[1], b_tag->mod.current[2], b_tag->mod.current[3]);
-            }
-        }
-
-        char save_buff[32768] = {0};
-        if(Script_GetEntitySaveData(engine_lua, ent->id, save_buff, sizeof(save_buff)) > 0)
-        {
-            fprintf(*f, "\n%s", save_buff);
-        }
-
-        ss_animation_p ss_anim = &ent->bf->animations;
-        for(; ss_anim->next; ss_anim = ss_anim->next);
-
-        for(; ss_anim; ss_anim = ss_anim->prev)
-        {
-            if(ss_anim->type != ANIM_TYPE_BASE)
-            {
-                if(ss_anim->model)
-                {
-                    fprintf(*f, "\nentitySSAnimEnsureExists(%d, %d, %d);", ent->id, ss_anim->type, ss_anim->model->id);
-                }
-                else
-                {
-                    fprintf(*f, "\nentitySSAnimEnsureExists(%d, %d, nil);", ent->id, ss_anim->type);
-                }
-            }
-        }
-
-        fprintf(*f, "\nremoveAllItems(%d);", ent->id);
-        for(inventory_node_p i = ent->inventory; i; i = i->next)
-        {
-            fprintf(*f, "\naddItem(%d, %d, %d);", ent->id, i->id, i->count);
-        }
-
-        if(ent->character)
-        {
-            fprintf(*f, "\nsetCharacterClimbPoint(%d, %.2f, %.2f, %.2f);", ent->id,
-                    ent->character->climb.point[0], ent->character->climb.point[1], ent->character->climb.point[2]);
-            if(ent->character->target_id != ENTITY_ID_NONE)
-            {
-                fprintf(*f, "\nsetCharacterTarget(%d, %d);", ent->id, ent->character->target_id);
-            }
-            else
-            {
-                fprintf(*f, "\nsetCharacterTarget(%d);", ent->id);
-            }
-
-            fprintf(*f, "\nsetCharacterWeaponModel(%d, %d, %d, %d);", ent->id, ent->character->weapon_id, ent->character->state.weapon_ready ? 2 : 0, ent->character->weapon_id_req);
-            for(int i = 0; i < PARAM_LASTINDEX; i++)
-            {
-                fprintf(*f, "\nsetCharacterParam(%d, %d, %.2f, %.2f);", ent->id, i, ent->character->parameters.param[i], ent->character->parameters.maximum[i]);
-            }
-        }
-
-        fprintf(*f, "\nsetEntityLinearSpeed(%d, %.2f);", ent->id, ent->linear_speed);
-        fprintf(*f, "\nsetEntitySpeed(%d, %.2f, %.2f, %.2f);", ent->id, ent->speed[0], ent->speed[1], ent->speed[2]);
-
-        fprintf(*f, "\nsetEntityFlags(%d, 0x%.4X, 0x%.4X, 0x%.8X);", ent->id, ent->state_flags, ent->type_flags, ent->callback_flags);
-        fprintf(*f, "\nsetEntityCollisionFlags(%d, %d, %d, %d);", ent->id, ent->self->collision_group, ent->self->collision_shape, ent->self->collision_mask);
-        fprintf(*f, "\nsetEntityTriggerLayout(%d, 0x%.2X);", ent->id, ent->trigger_layout);
-        fprintf(*f, "\nsetEntityTimer(%d, %.3f);", ent->id, ent->timer);
-
-        for(ss_anim = &ent->bf->animations; ss_anim; ss_anim = ss_anim->next)
-        {
-            if(ss_anim->model)
-            {
-                fprintf(*f, "\nsetEntityAnim(%d, %d, %d, %d, %d, %d);", ent->id, ss_anim->type, ss_anim->current_animation, ss_anim->current_frame, ss_anim->prev_animation, ss_anim->prev_frame);
-                fprintf(*f, "\nsetEntityAnimStateHeavy(%d, %d, %d);", ent->id, ss_anim->type, ss_anim->next_state_heavy);
-                fprintf(*f, "\nsetEntityAnimState(%d, %d, %d);", ent->id, ss_anim->type, ss_anim->next_state);
-                fprintf(*f, "\nentitySSAnimSetExtFlags(%d, %d, %d, %d);", ent->id, ss_anim->type, ss_anim->enabled, ss_anim->anim_ext_flags);
-                fprintf(*f, "\nentitySSAnimSetEnable(%d, %d, %d);", ent->id, ss_anim->type, ss_anim->enabled);
-            }
-        }
+    char save_path[1024];
 
-        if(ent->no_fix_all)
-        {
-            fprintf(*f, "\nnoFixEntityCollision(%d, true);", ent->id);
-        }
-        if(ent->no_move)
-        {
-            fprintf(*f, "\nnoEntityMove(%d, true);", ent->id);
-        }
-    }
-
-    return 0;
+    Game_GetSavePath(name, save_path, sizeof(save_path));
+    Save_WaitWrite();
+    return Sys_FileFound(save_path, 0);
 }
 
 /**
- * Save current game state
+ * Load game state
  */
-int Game_Save(const char* name)
+int Game_Load(const char* name)
 {
-    FILE *f;
-    char local;
-
-    local = 1;
-    for(const char *ch = name; *ch; ch++)
-    {
-        if((*ch == '\\') || (*ch == '/'))
-        {
-            local = 0;
-            break;
-        }
-    }
-
-    if(local)
-    {
-        char save_path[1024];
-        size_t save_path_base_len = sizeof(save_path) - 1;
-        strncpy(save_path, Engine_GetBasePath(), save_path_base_len);
-        save_path[save_path_base_len] = 0;
-        strncat(save_path, "save/", save_path_base_len - strlen(save_path));
-        strncat(save_path, name, save_path_base_len - strlen(save_path));
-        f = fopen(save_path, "wb");
-    }
-    else
-    {
-        f = fopen(name, "wb");
-    }
+    char save_path[1024];
 
-    if(!f)
+    Game_GetSavePath(name, save_path, sizeof(save_path));
+    Save_WaitWrite();                                                           // it may be just saved file
+    if(!Sys_FileFound(save_path, 0))
     {
-        Sys_extWarn("Can not create file \"%s\"", name);
+        Sys_extWarn("Can not read file \"%s\"", save_path);
         return 0;
     }
 
-    fprintf(f, "loadMap(\"%s\", %d, %d);\n", Gameflow_GetCurrentLevelPathLocal(), Gameflow_GetCurrentGameID(), Gameflow_GetCurrentLevelID());
-        
-    // Save flipmap and flipped room states.
-    uint8_t *flip_map;
-    uint8_t *flip_state;
-    uint32_t flip_count;
-    World_GetFlipInfo(&flip_map, &flip_state, &flip_count);
-    for(uint32_t i = 0; i < flip_count; i++)
+    if(Save_IsSnapshotFile(save_path))
     {
-        fprintf(f, "setFlipMap(%d, 0x%02X, 0);\n", i, flip_map[i]);
-        fprintf(f, "setFlipState(%d, %d);\n", i, flip_state[i]);
-    }
-    if(World_GetVersion() < TR_IV)
-    {
-        fprintf(f, "setGlobalFlipState(%d);\n", (int)World_GetGlobalFlipState());
+        return Save_LoadSnapshot(save_path);
     }
 
-    int id = 0;
-    room_p r = World_GetRoomByID(id);
-    while(r)
-    {
-        if(r->alternate_room_next || r->alternate_room_prev)
-        {
-            fprintf(f, "setRoomActiveContent(%d, %d);\n", id, r->content->original_room_id);
-        }
-        r = World_GetRoomByID(++id);
-    }
+    Script_LuaClearTasks();
+    luaL_dofile(engine_lua, save_path);
 
-    char save_buffer[32768] = {0};
-    if(Script_GetFlipEffectsSaveData(engine_lua, save_buffer, sizeof(save_buffer)) > 0)
-    {
-        fprintf(f, "\n%s\n", save_buffer);
-    }
-
-    World_IterateAllEntities(&Save_Entity, &f);
+    return 1;
+}
 
-    fclose(f);
+/**
+ * Save current game state; snapshot is taken here, file is written
+ * in background. Lua format is kept for export and hand editing.
+ */
+int Game_Save(const char* name, int format)
+{
+    char save_path[1024];
 
-    return 1;
+    Game_GetSavePath(name, save_path, sizeof(save_path));
+    return Save_WriteSnapshotAsync(Save_CaptureSnapshot(), save_path, format);
 }
 
 
@@ -569,15 +387,98 @@ int Game_UpdateEntity(entity_p ent, void *data)
             Entity_ProcessSector(ent);
             Script_LoopEntity(engine_lua, ent);
         }
-        Entity_Frame(ent, engine_frame_time);
-        Entity_UpdateRigidBody(ent, ent->character != NULL);
-        Entity_UpdateRoomPos(ent);
+        if(game_update_list.entities_count >= game_update_list.size)
+        {
+            game_update_list.size += 64;
+            game_update_list.entities = (entity_p*)realloc(game_update_list.entities, game_update_list.size * sizeof(entity_p));
+            game_update_list.poses = (game_pose_p)realloc(game_update_list.poses, game_update_list.size * sizeof(game_pose_t));
+            game_update_list.bone_frames = (ss_bone_frame_p*)realloc(game_update_list.bone_frames, game_update_list.size * sizeof(ss_bone_frame_p));
+            game_update_list.jobs = (game_pose_job_p)realloc(game_update_list.jobs, game_update_list.size * sizeof(game_pose_job_t));
+        }
+        game_update_list.entities[game_update_list.entities_count++] = ent;
+        if(Entity_ProcessAnimations(ent, engine_frame_time))
+        {
+            game_pose_p pose = game_update_list.poses + game_update_list.poses_count++;
+            pose->room_id = (ent->self->room) ? (ent->self->room->id) : (0xFFFFFFFF);
+            pose->order = game_update_list.poses_count;
+            pose->bf = ent->bf;
+        }
     }
 
     return 0;
 }
 
 
+static int Game_ComparePoses(const void *p1, const void *p2)
+{
+    game_pose_p pose1 = (game_pose_p)p1;
+    game_pose_p pose2 = (game_pose_p)p2;
+    if(pose1->room_id != pose2->room_id)
+    {
+        return (pose1->room_id < pose2->room_id) ? (-1) : (1);
+    }
+    return (pose1->order < pose2->order) ? (-1) : ((pose1->order > pose2->order) ? (1) : (0));
+}
+
+
+static void Game_PoseJob(void *data, uint32_t index)
+{
+    game_pose_job_p job = game_update_list.jobs + index;
+    SSBoneFrame_UpdateBatch(game_update_list.bone_frames + job->first, job->count, engine_frame_time);
+}
+
+
+/*
+ * Splits animated entities into jobs by rooms: neighbour entities share
+ * models and are mostly updated together; big rooms are split too.
+ */
+static void Game_UpdatePoses()
+{
+    game_pose_job_p job = NULL;
+
+    qsort(game_update_list.poses, game_update_list.poses_count, sizeof(game_pose_t), Game_ComparePoses);
+    game_update_list.jobs_count = 0;
+    for(uint32_t i = 0; i < game_update_list.poses_count; i++)
+    {
+        game_pose_p pose = game_update_list.poses + i;
+        game_update_list.bone_frames[i] = pose->bf;
+        if(!job || (job->count >= GAME_POSE_JOB_MAX_ENTITIES) || (pose->room_id != pose[-1].room_id))
+        {
+            job = game_update_list.jobs + game_update_list.jobs_count++;
+            job->first = i;
+            job->count = 0;
+        }
+        job->count++;
+    }
+
+    if(game_update_list.jobs_count > 1)
+    {
+        Jobs_ParallelFor(Game_PoseJob, NULL, game_update_list.jobs_count, NULL);
+    }
+    else if(game_update_list.jobs_count == 1)
+    {
+        Game_PoseJob(NULL, 0);
+    }
+}
+
+
+void Game_UpdateEntities()
+{
+    game_update_list.entities_count = 0;
+    game_update_list.poses_count = 0;
+    World_IterateAllEntities(Game_UpdateEntity, NULL);
+
+    Game_UpdatePoses();
+
+    for(uint32_t i = 0; i < game_update_list.entities_count; i++)
+    {
+        entity_p ent = game_update_list.entities[i];
+        Entity_UpdateRigidBody(ent, ent->character != NULL);
+        Entity_UpdateRoomPos(ent);
+    }
+}
+
+
 void Game_Frame(float time)
 {
     entity_p player = World_GetPlayer();
@@ -727,7 +628,7 @@ void Game_Frame(float time)
         }
     }
 
-    World_IterateAllEntities(Game_UpdateEntity, NULL);
+    Game_UpdateEntities();
 
     Physics_StepSimulation(time);
 
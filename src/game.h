@@ -15,8 +15,9 @@ struct entity_s;
 
 void Game_InitGlobals();
 void Game_RegisterLuaFunctions(struct lua_State *lua);
+int Game_SaveFound(const char *name);
 int Game_Load(const char* name);
-int Game_Save(const char* name);
+int Game_Save(const char* name, int format = 0);                               // SAVE_FORMAT_*, binary by default
 
 void Game_Frame(float time);
 
@@ -44,12 +44,15 @@ void Gui_Init()
     Gui_InitBars();
     Gui_InitNotifier();
 
-    qglGenBuffersARB(1, &crosshairBuffer);
-    qglGenBuffersARB(1, &backgroundBuffer);
-    qglGenBuffersARB(1, &rectBuffer);
-    qglGenTextures(1, &load_screen_tex);
-    Gui_FillCrosshairBuffer();
-    Gui_FillBackgroundBuffer();
+    if(!screen_info.headless)
+    {
+        qglGenBuffersARB(1, &crosshairBuffer);
+        qglGenBuffersARB(1, &backgroundBuffer);
+        qglGenBuffersARB(1, &rectBuffer);
+        qglGenTextures(1, &load_screen_tex);
+        Gui_FillCrosshairBuffer();
+        Gui_FillBackgroundBuffer();
+    }
 
     main_inventory_manager = new gui_InventoryManager();
 }
@@ -182,10 +185,13 @@ void Gui_Destroy()
         main_inventory_manager = NULL;
     }
 
-    qglDeleteTextures(1, &load_screen_tex);
-    qglDeleteBuffersARB(1, &crosshairBuffer);
-    qglDeleteBuffersARB(1, &backgroundBuffer);
-    qglDeleteBuffersARB(1, &rectBuffer);
+    if(!screen_info.headless)
+    {
+        qglDeleteTextures(1, &load_screen_tex);
+        qglDeleteBuffersARB(1, &crosshairBuffer);
+        qglDeleteBuffersARB(1, &backgroundBuffer);
+        qglDeleteBuffersARB(1, &rectBuffer);
+    }
 }
 
 
@@ -371,6 +377,11 @@ void Gui_DrawBars()
 
 void Gui_DrawLoadScreen(int value)
 {
+    if(screen_info.headless)
+    {
+        return;
+    }
+
     qglClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     qglPushAttrib(GL_ENABLE_BIT | GL_PIXEL_MODE_BIT | GL_COLOR_BUFFER_BIT);
@@ -449,6 +460,11 @@ bool Gui_SetScreenTexture(void *data, int w, int h, int bpp)
 
 bool Gui_LoadScreenAssignPic(const char* pic_name)
 {
+    if(screen_info.headless)
+    {
+        return false;
+    }
+
     size_t pic_len = strlen(pic_name);
     size_t base_len = strlen(Engine_GetBasePath());
     size_t buf_len = pic_len + base_len + 5;
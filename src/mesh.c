@@ -1,36 +1,45 @@
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/gl_util.h"
+#include "core/system.h"
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "mesh.h"
 
 
-void BaseMesh_GenVBO(struct base_mesh_s *mesh);
-void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct polygon_s *p);
-void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index, struct polygon_s *p);
+struct vertex_hash_s;
+
+void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct vertex_hash_s *hash, mesh_face_p face, struct polygon_s *p);
+void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index, mesh_face_p face, struct polygon_s *p);
 
 void BaseMesh_Clear(base_mesh_p mesh)
 {
-    if(qglIsBufferARB(mesh->vbo_vertex_array))
+    if(mesh->vbo_vertex_array && qglIsBufferARB(mesh->vbo_vertex_array))
     {
         qglDeleteBuffersARB(1, &mesh->vbo_vertex_array);
         mesh->vbo_vertex_array = 0;
     }
 
-    if(qglIsBufferARB(mesh->vbo_animated_vertex_array))
+    if(mesh->vbo_animated_vertex_array && qglIsBufferARB(mesh->vbo_animated_vertex_array))
     {
         qglDeleteBuffersARB(1, &mesh->vbo_animated_vertex_array);
         mesh->vbo_animated_vertex_array = 0;
     }
     
-    if(qglIsBufferARB(mesh->vbo_animated_texcoord_array))
+    if(mesh->vbo_animated_texcoord_array && qglIsBufferARB(mesh->vbo_animated_texcoord_array))
     {
         qglDeleteBuffersARB(1, &mesh->vbo_animated_texcoord_array);
         mesh->vbo_animated_texcoord_array = 0;
     }
 
+    if(mesh->vbo_index_array && qglIsBufferARB(mesh->vbo_index_array))
+    {
+        qglDeleteBuffersARB(1, &mesh->vbo_index_array);
+        mesh->vbo_index_array = 0;
+    }
+
     mesh->transparency_polygons = NULL;
     mesh->animated_polygons = NULL;
     
@@ -144,12 +153,87 @@ void BaseMesh_FindBB(base_mesh_p mesh)
 }
 
 
-void BaseMesh_GenVBO(struct base_mesh_s *mesh)
+static GLubyte BaseMesh_PackColor(float c)
+{
+    c = c * 255.0f + 0.5f;
+    return (c <= 0.0f) ? (0) : ((c >= 255.0f) ? (255) : ((GLubyte)c));
+}
+
+
+void BaseMesh_PackVertices(gpu_vertex_p dst, struct vertex_s *src, uint32_t count, float color_scale)
+{
+    float inv_scale = 1.0f / color_scale;
+    for(uint32_t i = 0; i < count; i++, dst++, src++)
+    {
+        float n = vec3_abs(src->normal);
+        n = (n > 0.0f) ? (127.0f / n) : (0.0f);
+        vec3_copy(dst->position, src->position);
+        dst->normal[0] = (GLbyte)(src->normal[0] * n);
+        dst->normal[1] = (GLbyte)(src->normal[1] * n);
+        dst->normal[2] = (GLbyte)(src->normal[2] * n);
+        dst->normal[3] = 0;
+        dst->color[0] = BaseMesh_PackColor(src->color[0] * inv_scale);
+        dst->color[1] = BaseMesh_PackColor(src->color[1] * inv_scale);
+        dst->color[2] = BaseMesh_PackColor(src->color[2] * inv_scale);
+        dst->color[3] = BaseMesh_PackColor(src->color[3] * inv_scale);
+        dst->tex_coord[0] = src->tex_coord[0];
+        dst->tex_coord[1] = src->tex_coord[1];
+    }
+}
+
+
+/*
+ * All faces (static and animated) share one index buffer, so draws do not
+ * send elements from client memory; face keeps offset of its range.
+ */
+static void BaseMesh_GenIndexBuffer(struct base_mesh_s *mesh)
 {
+    GLuint offset = 0;
+
+    for(uint32_t i = 0; i < mesh->faces_count; i++)
+    {
+        mesh->faces[i].elements_offset = offset;
+        offset += mesh->faces[i].elements_count * sizeof(GLuint);
+    }
+    for(uint32_t i = 0; i < mesh->animated_faces_count; i++)
+    {
+        mesh->animated_faces[i].elements_offset = offset;
+        offset += mesh->animated_faces[i].elements_count * sizeof(GLuint);
+    }
+
+    if(offset > 0)
+    {
+        qglGenBuffersARB(1, &mesh->vbo_index_array);
+        qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_index_array);
+        qglBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, offset, NULL, GL_STATIC_DRAW_ARB);
+        for(uint32_t i = 0; i < mesh->faces_count; i++)
+        {
+            qglBufferSubDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->faces[i].elements_offset,
+                                mesh->faces[i].elements_count * sizeof(GLuint), mesh->faces[i].elements);
+        }
+        for(uint32_t i = 0; i < mesh->animated_faces_count; i++)
+        {
+            qglBufferSubDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->animated_faces[i].elements_offset,
+                                mesh->animated_faces[i].elements_count * sizeof(GLuint), mesh->animated_faces[i].elements);
+        }
+    }
+}
+
+
+void BaseMesh_GenVBO(struct base_mesh_s *mesh, float color_scale)
+{
+    gpu_vertex_p packed;
+
     mesh->vbo_vertex_array = 0;
     mesh->vbo_animated_vertex_array = 0;
     mesh->vbo_animated_texcoord_array = 0;
-    
+    mesh->vbo_index_array = 0;
+
+    if(screen_info.headless)
+    {
+        return;
+    }
+
     /// now, begin VBO filling!
     qglGenBuffersARB(1, &mesh->vbo_vertex_array);
     if(mesh->vbo_vertex_array == 0)
@@ -157,16 +241,22 @@ void BaseMesh_GenVBO(struct base_mesh_s *mesh)
         abort();
     }
 
+    packed = (gpu_vertex_p)malloc(mesh->vertex_count * sizeof(gpu_vertex_t));
+    BaseMesh_PackVertices(packed, mesh->vertices, mesh->vertex_count, color_scale);
     qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
-    qglBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh->vertex_count * sizeof(vertex_t), mesh->vertices, GL_STATIC_DRAW_ARB);
+    qglBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh->vertex_count * sizeof(gpu_vertex_t), packed, GL_STATIC_DRAW_ARB);
+    free(packed);
 
     // Now for animated polygons, if any
     if(mesh->animated_polygons)
     {
         // And upload.
+        packed = (gpu_vertex_p)malloc(mesh->animated_vertex_count * sizeof(gpu_vertex_t));
+        BaseMesh_PackVertices(packed, mesh->animated_vertices, mesh->animated_vertex_count, color_scale);
         qglGenBuffersARB(1, &mesh->vbo_animated_vertex_array);
         qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_vertex_array);
-        qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(vertex_t), mesh->animated_vertices, GL_STATIC_DRAW);
+        qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(gpu_vertex_t), packed, GL_STATIC_DRAW);
+        free(packed);
         free(mesh->animated_vertices);
         mesh->animated_vertices = NULL;
         // Prepare empty buffer for tex coords
@@ -174,6 +264,7 @@ void BaseMesh_GenVBO(struct base_mesh_s *mesh)
         qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_texcoord_array);
         qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(GLfloat [2]), 0, GL_STREAM_DRAW);
     }
+    BaseMesh_GenIndexBuffer(mesh);
     qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
     qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
 }
@@ -182,33 +273,67 @@ void BaseMesh_GenVBO(struct base_mesh_s *mesh)
 /*
  * FACES FUNCTIONS
  */
-uint32_t BaseMesh_AddVertex(base_mesh_p mesh, struct vertex_s *vertex)
+typedef struct vertex_hash_s
+{
+    uint32_t               *table;                                              // vertex index + 1, 0 - empty cell
+    uint32_t                mask;                                               // table size - 1, size is power of 2
+}vertex_hash_t, *vertex_hash_p;
+
+
+static uint32_t BaseMesh_VertexHash(struct vertex_s *vertex)
+{
+    float key[9];
+    uint32_t word, hash = 2166136261u;
+
+    // + 0.0f makes -0.0f == 0.0f, as they are equal in vertices comparison.
+    key[0] = vertex->position[0] + 0.0f;
+    key[1] = vertex->position[1] + 0.0f;
+    key[2] = vertex->position[2] + 0.0f;
+    key[3] = vertex->tex_coord[0] + 0.0f;
+    key[4] = vertex->tex_coord[1] + 0.0f;
+    key[5] = vertex->color[0] + 0.0f;
+    key[6] = vertex->color[1] + 0.0f;
+    key[7] = vertex->color[2] + 0.0f;
+    key[8] = vertex->color[3] + 0.0f;
+    for(int i = 0; i < 9; i++)
+    {
+        memcpy(&word, key + i, sizeof(word));
+        hash = (hash ^ word) * 16777619u;
+    }
+
+    return hash ^ (hash >> 16);
+}
+
+
+/*
+ * Adds vertex to mesh->vertices if there is no equal one; vertices array must
+ * be already allocated with space for the new vertex.
+ */
+static uint32_t BaseMesh_AddVertex(base_mesh_p mesh, vertex_hash_p hash, struct vertex_s *vertex)
 {
-    vertex_p v = mesh->vertices;
-    uint32_t vertex_index = 0;
+    uint32_t cell = BaseMesh_VertexHash(vertex) & hash->mask;
+    vertex_p v;
 
-    for(vertex_index = 0; vertex_index < mesh->vertex_count; vertex_index++, v++)
+    for(; hash->table[cell]; cell = (cell + 1) & hash->mask)
     {
+        v = mesh->vertices + hash->table[cell] - 1;
         if(v->position[0] == vertex->position[0] && v->position[1] == vertex->position[1] && v->position[2] == vertex->position[2] &&
            v->tex_coord[0] == vertex->tex_coord[0] && v->tex_coord[1] == vertex->tex_coord[1] &&
            v->color[0] == vertex->color[0] && v->color[1] == vertex->color[1] && v->color[2] == vertex->color[2] && v->color[3] == vertex->color[3])
         {
-            return vertex_index;
+            return hash->table[cell] - 1;
         }
     }
 
-    vertex_index = mesh->vertex_count;
-    mesh->vertex_count++;
-    mesh->vertices = (vertex_p)realloc(mesh->vertices, mesh->vertex_count * sizeof(vertex_t));
-
-    v = mesh->vertices + vertex_index;
+    v = mesh->vertices + mesh->vertex_count;
     vec3_copy(v->position, vertex->position);
     vec3_copy(v->normal, vertex->normal);
     vec4_copy(v->color, vertex->color);
     v->tex_coord[0] = vertex->tex_coord[0];
     v->tex_coord[1] = vertex->tex_coord[1];
+    hash->table[cell] = ++mesh->vertex_count;
 
-    return vertex_index;
+    return mesh->vertex_count - 1;
 }
 
 
@@ -227,47 +352,83 @@ uint32_t BaseMesh_FindVertexIndex(base_mesh_p mesh, float v[3])
 }
 
 
-void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct polygon_s *p)
+static uint32_t BaseMesh_PolygonElementsCount(struct polygon_s *p)
 {
-    mesh_face_p current_face = NULL;
-    uint32_t add_elements_count = (p->vertex_count - 2) * 3;
-    GLuint *current_index;
-    
-    if (p->double_side)
+    uint32_t ret = (p->vertex_count - 2) * 3;
+    return (p->double_side) ? (2 * ret) : (ret);
+}
+
+
+/*
+ * Faces are atlas pages, so there are few of them, and neighbour polygons
+ * mostly share the page: last found face is checked first.
+ */
+static mesh_face_p BaseMesh_FindFace(mesh_face_p faces, uint32_t faces_count, uint32_t *last_face, GLuint texture_index)
+{
+    if((*last_face < faces_count) && (faces[*last_face].texture_index == texture_index))
     {
-        add_elements_count *= 2;
+        return faces + *last_face;
     }
-    
-    for(uint32_t i = 0; i < mesh->faces_count; i++)
+
+    for(uint32_t i = 0; i < faces_count; i++)
     {
-        if(mesh->faces[i].texture_index == p->texture_index)
+        if(faces[i].texture_index == texture_index)
         {
-            current_face = mesh->faces + i;
-            break;
+            *last_face = i;
+            return faces + i;
         }
     }
-    
-    if(current_face == NULL)
+
+    return NULL;
+}
+
+
+/*
+ * Counts polygon elements in the face with polygon's texture; new faces are
+ * appended to the array, it must have space for them.
+ */
+static void BaseMesh_CountFaceElements(mesh_face_p faces, uint32_t *faces_count, uint32_t *last_face, struct polygon_s *p)
+{
+    mesh_face_p face = BaseMesh_FindFace(faces, *faces_count, last_face, p->texture_index);
+    if(face == NULL)
     {
-        mesh->faces = (mesh_face_p)realloc(mesh->faces, (mesh->faces_count + 1) * sizeof(mesh_face_t));
-        current_face = mesh->faces + mesh->faces_count;
-        mesh->faces_count++;
-        current_face->elements = NULL;
-        current_face->elements_count = 0;
-        current_face->texture_index = p->texture_index;
+        *last_face = *faces_count;
+        face = faces + (*faces_count)++;
+        face->texture_index = p->texture_index;
+        face->elements_count = 0;
+        face->elements = NULL;
+        face->elements_offset = 0;
     }
-    
-    current_face->elements = (GLuint *)realloc(current_face->elements, (current_face->elements_count + add_elements_count) * sizeof(GLuint));
-    current_index = current_face->elements + current_face->elements_count;
-    current_face->elements_count += add_elements_count;
+    face->elements_count += BaseMesh_PolygonElementsCount(p);
+}
+
+
+/*
+ * Allocates elements of all counted faces; elements_count is reset, it is
+ * used as fill position while polygons are added.
+ */
+static void BaseMesh_AllocFacesElements(mesh_face_p faces, uint32_t faces_count)
+{
+    for(uint32_t i = 0; i < faces_count; i++)
+    {
+        faces[i].elements = (GLuint*)malloc(faces[i].elements_count * sizeof(GLuint));
+        faces[i].elements_count = 0;
+    }
+}
+
+
+void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, vertex_hash_p hash, mesh_face_p face, struct polygon_s *p)
+{
+    GLuint *current_index = face->elements + face->elements_count;
+    face->elements_count += BaseMesh_PolygonElementsCount(p);
 
     // Render the face as a triangle array
-    uint32_t startElement = BaseMesh_AddVertex(mesh, p->vertices);
-    uint32_t previousElement = BaseMesh_AddVertex(mesh, p->vertices + 1);
+    uint32_t startElement = BaseMesh_AddVertex(mesh, hash, p->vertices);
+    uint32_t previousElement = BaseMesh_AddVertex(mesh, hash, p->vertices + 1);
 
     for(uint16_t j = 2; j < p->vertex_count; j++)
     {
-        uint32_t thisElement = BaseMesh_AddVertex(mesh, p->vertices + j);
+        uint32_t thisElement = BaseMesh_AddVertex(mesh, hash, p->vertices + j);
 
         *current_index++ = startElement;
         *current_index++ = previousElement;
@@ -285,39 +446,10 @@ void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct polygon_s *p)
 }
 
 
-void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index, struct polygon_s *p)
+void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index, mesh_face_p face, struct polygon_s *p)
 {
-    mesh_face_p current_face = NULL;
-    uint32_t add_elements_count = (p->vertex_count - 2) * 3;
-    GLuint *current_index;
-    
-    if (p->double_side)
-    {
-        add_elements_count *= 2;
-    }
-    
-    for(uint32_t i = 0; i < mesh->animated_faces_count; i++)
-    {
-        if(mesh->animated_faces[i].texture_index == p->texture_index)
-        {
-            current_face = mesh->animated_faces + i;
-            break;
-        }
-    }
-    
-    if(current_face == NULL)
-    {
-        mesh->animated_faces = (mesh_face_p)realloc(mesh->animated_faces, (mesh->animated_faces_count + 1) * sizeof(mesh_face_t));
-        current_face = mesh->animated_faces + mesh->animated_faces_count;
-        mesh->animated_faces_count++;
-        current_face->elements = NULL;
-        current_face->elements_count = 0;
-        current_face->texture_index = p->texture_index;
-    }
-    
-    current_face->elements = (GLuint *)realloc(current_face->elements, (current_face->elements_count + add_elements_count) * sizeof(GLuint));
-    current_index = current_face->elements + current_face->elements_count;
-    current_face->elements_count += add_elements_count;
+    GLuint *current_index = face->elements + face->elements_count;
+    face->elements_count += BaseMesh_PolygonElementsCount(p);
 
     // Render the face as a triangle array
     uint32_t startElement = *vertex_index;
@@ -353,7 +485,10 @@ void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index
 void BaseMesh_GenFaces(base_mesh_p mesh)
 {
     polygon_p p = mesh->polygons;
-    
+    uint32_t max_vertex_count = 0;
+    uint32_t last_face = 0;
+    uint32_t faces_count = 0;
+
     mesh->faces_count = 0;
     mesh->faces = NULL;
     mesh->animated_faces_count = 0;
@@ -364,12 +499,18 @@ void BaseMesh_GenFaces(base_mesh_p mesh)
     
     mesh->animated_polygons = NULL;
     mesh->transparency_polygons = NULL;
-    
+
+    /*
+     * First pass: sort polygons and count vertices, faces and elements,
+     * so every array is allocated only once.
+     */
+    mesh->faces = (mesh_face_p)malloc((mesh->polygons_count + 1) * sizeof(mesh_face_t));
     for(uint32_t i = 0; i < mesh->polygons_count; i++, p++)
     {
         if((p->transparency < 2) && (p->anim_id == 0) && !Polygon_IsBroken(p))
         {
-            BaseMesh_AddPolygonToFaces(mesh, p);
+            BaseMesh_CountFaceElements(mesh->faces, &faces_count, &last_face, p);
+            max_vertex_count += p->vertex_count;
         }
         else if(p->transparency >= 2)
         {
@@ -382,21 +523,67 @@ void BaseMesh_GenFaces(base_mesh_p mesh)
             mesh->animated_polygons = p;
         }
     }
+
+    if(faces_count > 0)
+    {
+        vertex_hash_t hash;
+        uint32_t table_size = 16;
+
+        mesh->faces = (mesh_face_p)realloc(mesh->faces, faces_count * sizeof(mesh_face_t));
+        BaseMesh_AllocFacesElements(mesh->faces, faces_count);
+        mesh->faces_count = faces_count;
+
+        while(table_size < 2 * max_vertex_count)
+        {
+            table_size *= 2;
+        }
+        hash.mask = table_size - 1;
+        hash.table = (uint32_t*)calloc(table_size, sizeof(uint32_t));
+        free(mesh->vertices);                                                   // vertices are rebuilt from polygons
+        mesh->vertices = (vertex_p)malloc(max_vertex_count * sizeof(vertex_t));
+        mesh->vertex_count = 0;
+
+        last_face = 0;
+        p = mesh->polygons;
+        for(uint32_t i = 0; i < mesh->polygons_count; i++, p++)
+        {
+            if((p->transparency < 2) && (p->anim_id == 0) && !Polygon_IsBroken(p))
+            {
+                mesh_face_p face = BaseMesh_FindFace(mesh->faces, mesh->faces_count, &last_face, p->texture_index);
+                BaseMesh_AddPolygonToFaces(mesh, &hash, face, p);
+            }
+        }
+
+        free(hash.table);
+        mesh->vertices = (vertex_p)realloc(mesh->vertices, mesh->vertex_count * sizeof(vertex_t));
+    }
+    else
+    {
+        free(mesh->faces);
+        mesh->faces = NULL;
+    }
     
     if(mesh->animated_polygons)
     {
+        last_face = 0;
+        faces_count = 0;
+        mesh->animated_faces = (mesh_face_p)malloc(mesh->polygons_count * sizeof(mesh_face_t));
         for (polygon_p p = mesh->animated_polygons; p != 0; p = p->next)
         {
+            BaseMesh_CountFaceElements(mesh->animated_faces, &faces_count, &last_face, p);
             mesh->animated_vertex_count += p->vertex_count;
         }
+        mesh->animated_faces = (mesh_face_p)realloc(mesh->animated_faces, faces_count * sizeof(mesh_face_t));
+        BaseMesh_AllocFacesElements(mesh->animated_faces, faces_count);
+        mesh->animated_faces_count = faces_count;
 
         mesh->animated_vertices = (vertex_p)malloc(mesh->animated_vertex_count * sizeof(vertex_t));
         uint32_t vertex_index = 0;
+        last_face = 0;
         for (polygon_p p = mesh->animated_polygons; p != 0; p = p->next)
         {
-            BaseMesh_AddAnimatedPolygonToFaces(mesh, &vertex_index, p);
+            mesh_face_p face = BaseMesh_FindFace(mesh->animated_faces, mesh->animated_faces_count, &last_face, p->texture_index);
+            BaseMesh_AddAnimatedPolygonToFaces(mesh, &vertex_index, face, p);
         }
     }
-    
-    BaseMesh_GenVBO(mesh);
 }
@@ -13,14 +13,32 @@ extern "C" {
 #include <SDL2/SDL_opengl.h>
 #include <stdint.h>
 
+#define MESH_COLOR_SCALE_DEFAULT    (1.0f)
+#define MESH_COLOR_SCALE_ROOM       (2.0f)  // room vertex colors are overbright
+
 struct polygon_s;
 struct vertex_s;
 
+/*
+ * Packed vertex for VBO only, 28 bytes instead of 56 of the float vertex_s,
+ * which stays for CPU side (collision, BSP, debug lines). Normal is signed
+ * normalized byte, color is unsigned normalized byte divided by color scale
+ * (shader multiplies it back).
+ */
+typedef struct gpu_vertex_s
+{
+    GLfloat                 position[3];
+    GLbyte                  normal[4];
+    GLubyte                 color[4];
+    GLfloat                 tex_coord[2];
+}gpu_vertex_t, *gpu_vertex_p;
+
 typedef struct mesh_face_s
 {
     GLuint                  texture_index;
     GLuint                  elements_count;
     GLuint                 *elements;    
+    GLuint                  elements_offset;                                    // in bytes, in mesh's index buffer
 }mesh_face_t, *mesh_face_p;
 
 /*
@@ -54,6 +72,7 @@ typedef struct base_mesh_s
     GLuint                  vbo_vertex_array;
     GLuint                  vbo_animated_vertex_array;
     GLuint                  vbo_animated_texcoord_array;
+    GLuint                  vbo_index_array;                                    // elements of all faces
 }base_mesh_t, *base_mesh_p;
 
 
@@ -108,9 +127,10 @@ typedef struct light_s
 void BaseMesh_Clear(base_mesh_p mesh);
 void BaseMesh_FindBB(base_mesh_p mesh);
 
-uint32_t BaseMesh_AddVertex(base_mesh_p mesh, struct vertex_s *vertex);
 uint32_t BaseMesh_FindVertexIndex(base_mesh_p mesh, float v[3]);
-void     BaseMesh_GenFaces(base_mesh_p mesh);
+void     BaseMesh_GenFaces(base_mesh_p mesh);                                   // no GL calls, may be used from worker threads
+void     BaseMesh_PackVertices(gpu_vertex_p dst, struct vertex_s *src, uint32_t count, float color_scale);
+void     BaseMesh_GenVBO(base_mesh_p mesh, float color_scale);                  // main thread only
 
 
 #ifdef	__cplusplus
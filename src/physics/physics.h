@@ -49,6 +49,14 @@ typedef struct ghost_shape_s
 }ghost_shape_t, *ghost_shape_p;
 
 
+typedef struct physics_settings_s
+{
+    float       step_rate;                                                      // fixed simulation steps per second
+    uint16_t    max_substeps;                                                   // steps limit per frame, the rest of long frame is dropped
+}physics_settings_t, *physics_settings_p;
+
+extern struct physics_settings_s physics_settings;
+
 struct physics_data_s;
 struct physics_object_s;
 
@@ -73,6 +81,7 @@ int  Physics_SphereTest(struct collision_result_s *result, float from[3], float
 int  Physics_IsBodyesInited(struct physics_data_s *physics);
 int  Physics_IsGhostsInited(struct physics_data_s *physics);
 int  Physics_GetBodiesCount(struct physics_data_s *physics);
+// for dynamic bodies returns transform interpolated between fixed simulation steps
 void Physics_GetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
 void Physics_SetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
 void Physics_GetGhostWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
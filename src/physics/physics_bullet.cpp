@@ -322,6 +322,8 @@ btBroadphaseInterface                   *bt_engine_overlappingPairCache = NULL;
 btSequentialImpulseConstraintSolver     *bt_engine_solver = NULL;
 btDiscreteDynamicsWorld                 *bt_engine_dynamicsWorld = NULL;
 
+physics_settings_t                       physics_settings = {60.0f, 4};
+
 CBulletDebugDrawer                       bt_debug_drawer;
 
 /* bullet collision model calculation */
@@ -391,8 +393,17 @@ void Physics_Destroy()
 
 void Physics_StepSimulation(float time)
 {
-    time = (time < 0.1f) ? (time) : (0.0f);
-    bt_engine_dynamicsWorld->stepSimulation(time, 0);
+    if((physics_settings.step_rate > 0.0f) && (physics_settings.max_substeps > 0))
+    {
+        // Bullet accumulates frame time and makes fixed steps, motion states
+        // of dynamic bodies get transforms interpolated between the last two steps.
+        bt_engine_dynamicsWorld->stepSimulation(time, physics_settings.max_substeps, 1.0f / physics_settings.step_rate);
+    }
+    else
+    {
+        time = (time < 0.1f) ? (time) : (0.0f);
+        bt_engine_dynamicsWorld->stepSimulation(time, 0);
+    }
 }
 
 void Physics_DebugDrawWorld()
@@ -674,18 +685,35 @@ int  Physics_GetBodiesCount(struct physics_data_s *physics)
 
 void Physics_GetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index)
 {
-    if(physics->bt_body[index])
+    btRigidBody *body = physics->bt_body[index];
+    if(body)
     {
-        physics->bt_body[index]->getWorldTransform().getOpenGLMatrix(tr);
+        if(body->getMotionState() && !body->isStaticOrKinematicObject())
+        {
+            btTransform interpolated;
+            body->getMotionState()->getWorldTransform(interpolated);
+            interpolated.getOpenGLMatrix(tr);
+        }
+        else
+        {
+            body->getWorldTransform().getOpenGLMatrix(tr);
+        }
     }
 }
 
 
 void Physics_SetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index)
 {
-    if(physics->bt_body[index])
+    btRigidBody *body = physics->bt_body[index];
+    if(body)
     {
-        physics->bt_body[index]->getWorldTransform().setFromOpenGLMatrix(tr);
+        // teleport: reset interpolation too, else body blends from old place.
+        body->getWorldTransform().setFromOpenGLMatrix(tr);
+        body->setInterpolationWorldTransform(body->getWorldTransform());
+        if(body->getMotionState())
+        {
+            body->getMotionState()->setWorldTransform(body->getWorldTransform());
+        }
     }
 }
 
@@ -2050,7 +2078,9 @@ int Hair_GetElementsCount(struct hair_s *hair)
 
 void Hair_GetElementInfo(struct hair_s *hair, int element, struct base_mesh_s **mesh, float tr[16])
 {
-    hair->elements[element].body->getWorldTransform().getOpenGLMatrix(tr);
+    btTransform interpolated;
+    hair->elements[element].body->getMotionState()->getWorldTransform(interpolated);
+    interpolated.getOpenGLMatrix(tr);
     *mesh = hair->elements[element].mesh;
 }
 
@@ -183,8 +183,9 @@ number_canonical_object_textures(0),
 canonical_object_textures(NULL),
 textures_indexes(NULL)
 {
-    GLint max_texture_edge_length = 0;
-    qglGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_edge_length);
+    GLint max_texture_edge_length = 4096;
+    if (qglGetIntegerv != NULL) // there is no GL context in headless mode
+        qglGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_edge_length);
     if (max_texture_edge_length > 4096)
         max_texture_edge_length = 4096; // That is already 64 MB and covers up to 256 pages.
     result_page_width = max_texture_edge_length;
@@ -493,6 +494,11 @@ unsigned long bordered_texture_atlas::getNumAtlasPages() const
     return number_result_pages;
 }
 
+void bordered_texture_atlas::assignTextureNames(GLuint *textureNames)
+{
+    textures_indexes = textureNames;
+}
+
 void bordered_texture_atlas::createTextures(GLuint *textureNames)
 {
     GLubyte *data = (GLubyte *) malloc(4 * result_page_width * result_page_width);
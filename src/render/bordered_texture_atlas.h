@@ -182,6 +182,12 @@ public:
      */
     void createTextures(GLuint *textureNames);
 
+    /*!
+     * Assigns texture names without any upload (used when there is no GL
+     * context). textureNames must have the same length as for createTextures.
+     */
+    void assignTextureNames(GLuint *textureNames);
+
 };
 
 #endif /* BORDERED_TEXTURE_ATLAS_H */
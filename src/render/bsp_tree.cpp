@@ -52,6 +52,14 @@ void CDynamicBSP::AddBSPPolygon(struct bsp_node_s *leaf, struct polygon_s *p)
     bp->texture_index  = p->texture_index;
     bp->transparency   = p->transparency;
     bp->vertex_count   = p->vertex_count;
+    bp->anim_id        = p->anim_id;
+    bp->frame_offset   = p->frame_offset;
+    bp->anim_next      = NULL;
+    if((p->anim_id > 0) && (m_anim_seq == NULL))
+    {
+        bp->anim_next = m_anim_polygons;
+        m_anim_polygons = bp;
+    }
 
     bp->indexes        = (GLuint*)(m_tree_buffer + m_tree_allocated);
     m_tree_allocated  += p->vertex_count * sizeof(GLint);
@@ -191,6 +199,7 @@ CDynamicBSP::CDynamicBSP(uint32_t size)
 
     m_input_polygons = 0;
     m_added_polygons = 0;
+    m_anim_polygons = NULL;
 
     m_vbo = 0;
     m_anim_seq = NULL;
@@ -269,7 +278,7 @@ void CDynamicBSP::AddNewPolygonList(struct polygon_s *p, float transform[16], st
 
         if(visible)
         {
-            if(p->anim_id > 0)
+            if((p->anim_id > 0) && m_anim_seq)
             {
                 anim_seq_p seq = m_anim_seq + p->anim_id - 1;
                 uint16_t frame = (seq->current_frame + p->frame_offset) % seq->frames_count;
@@ -307,7 +316,7 @@ void CDynamicBSP::AddNewPolygonList(struct polygon_s *p, float transform[16], st
 
 void CDynamicBSP::Reset(struct anim_seq_s *seq)
 {
-    if(m_vbo == 0)
+    if((m_vbo == 0) && qglGenBuffersARB)                                       // no GL in headless mode
     {
         qglGenBuffersARB(1, &m_vbo);
     }
@@ -361,5 +370,48 @@ void CDynamicBSP::Reset(struct anim_seq_s *seq)
     m_realloc_state = 0;
     m_input_polygons = 0;
     m_added_polygons = 0;
+    m_anim_polygons = NULL;
     m_root = this->CreateBSPNode();
 }
+
+
+void CDynamicBSP::UploadVertices(GLenum usage)
+{
+    if(m_vbo != 0)
+    {
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_vbo);
+        qglBufferDataARB(GL_ARRAY_BUFFER_ARB, m_vertex_allocated * sizeof(vertex_t), m_vertex_buffer, usage);
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    }
+}
+
+/*
+ * Vertices of a BSP polygon are consecutive, so every animated polygon is
+ * updated by one sub data call; texture transform is affine, so it is valid
+ * for split polygons too. VBO must be bound.
+ */
+void CDynamicBSP::UpdateAnimTextures(struct anim_seq_s *seq)
+{
+    vertex_t buf[32];
+
+    for(bsp_polygon_p bp = m_anim_polygons; bp; bp = bp->anim_next)
+    {
+        anim_seq_p s = seq + bp->anim_id - 1;
+        uint16_t frame = (s->current_frame + bp->frame_offset) % s->frames_count;
+        tex_frame_p tf = s->frames + frame;
+
+        bp->texture_index = tf->texture_index;
+        for(uint16_t first = 0; first < bp->vertex_count; first += 32)
+        {
+            vertex_p v = m_vertex_buffer + bp->indexes[first];
+            uint16_t count = bp->vertex_count - first;
+            count = (count < 32) ? (count) : (32);
+            memcpy(buf, v, count * sizeof(vertex_t));
+            for(uint16_t i = 0; i < count; i++)
+            {
+                ApplyAnimTextureTransformation(buf[i].tex_coord, v[i].tex_coord, tf);
+            }
+            qglBufferSubDataARB(GL_ARRAY_BUFFER_ARB, bp->indexes[first] * sizeof(vertex_t), count * sizeof(vertex_t), buf);
+        }
+    }
+}
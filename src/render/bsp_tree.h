@@ -16,8 +16,11 @@ typedef struct bsp_polygon_s
     GLuint                 *indexes;                                            // vertices indexes
     uint16_t                texture_index;                                      // texture index
     uint16_t                transparency;                                       // transparency information
+    uint16_t                anim_id;                                            // anim texture ID (0 - not animated)
+    uint16_t                frame_offset;                                       // anim texture frame offset
     
     struct bsp_polygon_s   *next;                                               // polygon list (for BSP using)
+    struct bsp_polygon_s   *anim_next;                                          // animated polygons list (static trees only)
 } bsp_polygon_t, *bsp_polygon_p;
 
 
@@ -53,6 +56,8 @@ class CDynamicBSP
     uint32_t             m_input_polygons;
     uint32_t             m_added_polygons;
     
+    struct bsp_polygon_s *m_anim_polygons;
+    
     struct bsp_node_s     *CreateBSPNode();
     struct polygon_s      *CreatePolygon(uint16_t vertex_count);
     void AddBSPPolygon(struct bsp_node_s *leaf, struct polygon_s *p);
@@ -66,7 +71,16 @@ public:
    ~CDynamicBSP();
    
     void AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f);
+    // seq == NULL makes a static tree: animated polygons keep base texture
+    // coordinates and are refreshed by UpdateAnimTextures() before drawing.
     void Reset(struct anim_seq_s *seq);
+    void UploadVertices(GLenum usage);
+    void UpdateAnimTextures(struct anim_seq_s *seq);
+    
+    bool NeedRealloc()
+    {
+        return m_realloc_state != 0;
+    }
     
     struct vertex_s *GetVertexArray()
     {
@@ -2,6 +2,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "../core/system.h"
 #include "../core/vmath.h"
@@ -462,6 +467,19 @@ bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool
     return false;
 }
 
+/*
+ * Box vs. frustum clip planes test: the box is out if it is fully behind any
+ * side plane; r is the box projection radius on the plane normal. Test is
+ * conservative: near the frustum edges some invisible boxes are passed.
+ * hint - plane that rejected this box last time, it is tested first
+ * (boxes and camera move slowly, so it usually rejects the box again).
+ */
+static inline bool Frustum_IsBoxOutOfPlane(const float n[4], const float centre[3], float r)
+{
+    return vec3_plane_dist(n, centre) + r < 0.0f;
+}
+
+
 /**
  *
  * @param bbmin - aabb corner (x_min, y_min, z_min)
@@ -471,176 +489,284 @@ bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool
  */
 bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *frustum)
 {
-    bool inside = true;
-    polygon_t poly;
-    vertex_t vert[4];
+    float centre[3], extent[3];
+    float *n = frustum->planes;
+
+    vec3_add(centre, bbmin, bbmax);
+    vec3_mul_scalar(centre, centre, 0.5f);
+    vec3_sub(extent, bbmax, bbmin);
+    vec3_mul_scalar(extent, extent, 0.5f);
+    for(uint16_t i = 0; i < frustum->vertex_count; i++, n += 4)
+    {
+        float r = extent[0] * ABS(n[0]) + extent[1] * ABS(n[1]) + extent[2] * ABS(n[2]);
+        if(Frustum_IsBoxOutOfPlane(n, centre, r))
+        {
+            return false;
+        }
+    }
 
-    poly.vertices = vert;
-    poly.vertex_count = 4;
+    return true;
+}
 
-    /* X_AXIS */
 
-    poly.plane[1] = 0.0;
-    poly.plane[2] = 0.0;
-    if(frustum->cam_pos[0] < bbmin[0])
-    {
-        poly.plane[0] = -1.0;
-        poly.plane[3] = bbmin[0];
-        vert[0].position[0] = bbmin[0];
-        vert[0].position[1] = bbmax[1];
-        vert[0].position[2] = bbmax[2];
+bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
+{
+    const float *ax = (obb->transform) ? (obb->transform + 0) : (NULL);
+    const float *ay = (obb->transform) ? (obb->transform + 4) : (NULL);
+    const float *az = (obb->transform) ? (obb->transform + 8) : (NULL);
+    uint16_t hint = (obb->cull_plane < frustum->vertex_count) ? (obb->cull_plane) : (0);
 
-        vert[1].position[0] = bbmin[0];
-        vert[1].position[1] = bbmin[1];
-        vert[1].position[2] = bbmax[2];
+    for(uint16_t i = 0; i < frustum->vertex_count; i++)
+    {
+        uint16_t plane = (i == 0) ? (hint) : ((i <= hint) ? (i - 1) : (i));
+        float *n = frustum->planes + 4 * plane;
+        float r;
+        if(ax)
+        {
+            r = obb->extent[0] * ABS(vec3_dot(n, ax)) +
+                obb->extent[1] * ABS(vec3_dot(n, ay)) +
+                obb->extent[2] * ABS(vec3_dot(n, az));
+        }
+        else
+        {
+            r = obb->extent[0] * ABS(n[0]) + obb->extent[1] * ABS(n[1]) + obb->extent[2] * ABS(n[2]);
+        }
 
-        vert[2].position[0] = bbmin[0];
-        vert[2].position[1] = bbmin[1];
-        vert[2].position[2] = bbmin[2];
+        if(Frustum_IsBoxOutOfPlane(n, obb->centre, r))
+        {
+            obb->cull_plane = plane;
+            return false;
+        }
+    }
 
-        vert[3].position[0] = bbmin[0];
-        vert[3].position[1] = bbmax[1];
-        vert[3].position[2] = bbmin[2];
+    return true;
+}
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum)
+{
+    for(; frustum; frustum = frustum->next)
+    {
+        if(Frustum_IsOBBVisible(obb, frustum))
         {
             return true;
         }
-        inside = false;
     }
-    else if(frustum->cam_pos[0] > bbmax[0])
-    {
-        poly.plane[0] = 1.0;
-        poly.plane[3] =-bbmax[0];
-        vert[0].position[0] = bbmax[0];
-        vert[0].position[1] = bbmax[1];
-        vert[0].position[2] = bbmax[2];
-
-        vert[1].position[0] = bbmax[0];
-        vert[1].position[1] = bbmin[1];
-        vert[1].position[2] = bbmax[2];
-
-        vert[2].position[0] = bbmax[0];
-        vert[2].position[1] = bbmin[1];
-        vert[2].position[2] = bbmin[2];
 
-        vert[3].position[0] = bbmax[0];
-        vert[3].position[1] = bbmax[1];
-        vert[3].position[2] = bbmin[2];
+    return false;
+}
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+/*
+ * SoA BOXES
+ */
+void Frustum_BoxesInit(cull_boxes_p boxes, uint32_t count)
+{
+    boxes->count = count;
+    boxes->data = NULL;
+    if(count > 0)
+    {
+        boxes->data = (float*)malloc(6 * count * sizeof(float));
+        for(int k = 0; k < 3; k++)
         {
-            return true;
+            boxes->centre[k] = boxes->data + k * count;
+            boxes->extent[k] = boxes->data + (3 + k) * count;
         }
-        inside = false;
     }
+}
 
-    /* Y AXIS */
 
-    poly.plane[0] = 0.0;
-    poly.plane[2] = 0.0;
-    if(frustum->cam_pos[1] < bbmin[1])
+void Frustum_BoxesClear(cull_boxes_p boxes)
+{
+    if(boxes->data)
     {
-        poly.plane[1] = -1.0;
-        poly.plane[3] = bbmin[1];
-        vert[0].position[0] = bbmax[0];
-        vert[0].position[1] = bbmin[1];
-        vert[0].position[2] = bbmax[2];
+        free(boxes->data);
+        boxes->data = NULL;
+    }
+    boxes->count = 0;
+}
 
-        vert[1].position[0] = bbmin[0];
-        vert[1].position[1] = bbmin[1];
-        vert[1].position[2] = bbmax[2];
+/*
+ * Stores world axis aligned box that bounds the OBB.
+ */
+void Frustum_BoxesSetOBB(cull_boxes_p boxes, uint32_t index, struct obb_s *obb)
+{
+    for(int k = 0; k < 3; k++)
+    {
+        boxes->centre[k][index] = obb->centre[k];
+        if(obb->transform)
+        {
+            boxes->extent[k][index] = obb->extent[0] * ABS(obb->transform[0 + k]) +
+                                      obb->extent[1] * ABS(obb->transform[4 + k]) +
+                                      obb->extent[2] * ABS(obb->transform[8 + k]);
+        }
+        else
+        {
+            boxes->extent[k][index] = obb->extent[k];
+        }
+    }
+}
 
-        vert[2].position[0] = bbmin[0];
-        vert[2].position[1] = bbmin[1];
-        vert[2].position[2] = bbmin[2];
 
-        vert[3].position[0] = bbmax[0];
-        vert[3].position[1] = bbmin[1];
-        vert[3].position[2] = bbmin[2];
+static void Frustum_CullBoxesScalar(cull_boxes_p boxes, struct frustum_s *frustum, uint8_t *visible, uint32_t first)
+{
+    for(uint32_t i = first; i < boxes->count; i++)
+    {
+        const float *n = frustum->planes;
+        float centre[3] = {boxes->centre[0][i], boxes->centre[1][i], boxes->centre[2][i]};
+        uint8_t in = 1;
+        for(uint16_t j = 0; in && (j < frustum->vertex_count); j++, n += 4)
+        {
+            float r = boxes->extent[0][i] * ABS(n[0]) + boxes->extent[1][i] * ABS(n[1]) + boxes->extent[2][i] * ABS(n[2]);
+            in = !Frustum_IsBoxOutOfPlane(n, centre, r);
+        }
+        visible[i] |= in;
+    }
+}
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+/*
+ * Tests boxes by 4, returns the first box left for the scalar test.
+ */
+static uint32_t Frustum_CullBoxesSIMD(cull_boxes_p boxes, struct frustum_s *frustum, uint8_t *visible)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for(; i + 4 <= boxes->count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(boxes->centre[0] + i);
+        __m128 cy = _mm_loadu_ps(boxes->centre[1] + i);
+        __m128 cz = _mm_loadu_ps(boxes->centre[2] + i);
+        __m128 ex = _mm_loadu_ps(boxes->extent[0] + i);
+        __m128 ey = _mm_loadu_ps(boxes->extent[1] + i);
+        __m128 ez = _mm_loadu_ps(boxes->extent[2] + i);
+        __m128 out = zero;
+        const float *n = frustum->planes;
+        for(uint16_t j = 0; j < frustum->vertex_count; j++, n += 4)
         {
-            return true;
+            __m128 nx = _mm_set1_ps(n[0]);
+            __m128 ny = _mm_set1_ps(n[1]);
+            __m128 nz = _mm_set1_ps(n[2]);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(n[3])));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, abs_mask), ex), _mm_mul_ps(_mm_and_ps(ny, abs_mask), ey)), _mm_mul_ps(_mm_and_ps(nz, abs_mask), ez));
+            out = _mm_or_ps(out, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
         }
-        inside = false;
+        int mask = _mm_movemask_ps(out);
+        visible[i + 0] |= !(mask & 1);
+        visible[i + 1] |= !(mask & 2);
+        visible[i + 2] |= !(mask & 4);
+        visible[i + 3] |= !(mask & 8);
     }
-    else if(frustum->cam_pos[1] > bbmax[1])
+#elif defined(__ARM_NEON)
+    for(; i + 4 <= boxes->count; i += 4)
     {
-        poly.plane[1] = 1.0;
-        poly.plane[3] = -bbmax[1];
-        vert[0].position[0] = bbmax[0];
-        vert[0].position[1] = bbmax[1];
-        vert[0].position[2] = bbmax[2];
-
-        vert[1].position[0] = bbmin[0];
-        vert[1].position[1] = bbmax[1];
-        vert[1].position[2] = bbmax[2];
-
-        vert[2].position[0] = bbmin[0];
-        vert[2].position[1] = bbmax[1];
-        vert[2].position[2] = bbmin[2];
-
-        vert[3].position[0] = bbmax[0];
-        vert[3].position[1] = bbmax[1];
-        vert[3].position[2] = bbmin[2];
-
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        float32x4_t cx = vld1q_f32(boxes->centre[0] + i);
+        float32x4_t cy = vld1q_f32(boxes->centre[1] + i);
+        float32x4_t cz = vld1q_f32(boxes->centre[2] + i);
+        float32x4_t ex = vld1q_f32(boxes->extent[0] + i);
+        float32x4_t ey = vld1q_f32(boxes->extent[1] + i);
+        float32x4_t ez = vld1q_f32(boxes->extent[2] + i);
+        uint32x4_t out = vdupq_n_u32(0);
+        const float *n = frustum->planes;
+        for(uint16_t j = 0; j < frustum->vertex_count; j++, n += 4)
         {
-            return true;
+            float32x4_t d = vdupq_n_f32(n[3]);
+            d = vmlaq_n_f32(d, cx, n[0]);
+            d = vmlaq_n_f32(d, cy, n[1]);
+            d = vmlaq_n_f32(d, cz, n[2]);
+            d = vmlaq_n_f32(d, ex, ABS(n[0]));
+            d = vmlaq_n_f32(d, ey, ABS(n[1]));
+            d = vmlaq_n_f32(d, ez, ABS(n[2]));
+            out = vorrq_u32(out, vcltq_f32(d, vdupq_n_f32(0.0f)));
         }
-        inside = false;
+        visible[i + 0] |= !vgetq_lane_u32(out, 0);
+        visible[i + 1] |= !vgetq_lane_u32(out, 1);
+        visible[i + 2] |= !vgetq_lane_u32(out, 2);
+        visible[i + 3] |= !vgetq_lane_u32(out, 3);
     }
+#endif
+    return i;
+}
+
+/**
+ * Culls all boxes against the frustum list at once (4 boxes per SIMD step).
+ * @param visible - out array of boxes->count flags, 1 if box is in any frustum
+ * @return number of visible boxes
+ */
+uint32_t Frustum_CullBoxes(cull_boxes_p boxes, struct frustum_s *frustum, uint8_t *visible)
+{
+    uint32_t ret = 0;
 
-    /* Z AXIS */
+    memset(visible, 0, boxes->count);
+    for(; frustum; frustum = frustum->next)
+    {
+        Frustum_CullBoxesScalar(boxes, frustum, visible, Frustum_CullBoxesSIMD(boxes, frustum, visible));
+    }
 
-    poly.plane[0] = 0.0;
-    poly.plane[1] = 0.0;
-    if(frustum->cam_pos[2] < bbmin[2])
+    for(uint32_t i = 0; i < boxes->count; i++)
     {
-        poly.plane[2] = -1.0;
-        poly.plane[3] = bbmin[2];
-        vert[0].position[0] = bbmax[0];
-        vert[0].position[1] = bbmax[1];
-        vert[0].position[2] = bbmin[2];
+        ret += visible[i];
+    }
+
+    return ret;
+}
+
+/*
+ * CULLING BENCH
+ */
+static uint32_t Frustum_BenchRand(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
 
-        vert[1].position[0] = bbmin[0];
-        vert[1].position[1] = bbmax[1];
-        vert[1].position[2] = bbmin[2];
+static float Frustum_BenchRandf(uint32_t *seed, float min, float max)
+{
+    return min + (max - min) * (float)Frustum_BenchRand(seed) / (float)(1 << 24);
+}
 
-        vert[2].position[0] = bbmin[0];
-        vert[2].position[1] = bbmin[1];
-        vert[2].position[2] = bbmin[2];
+/*
+ * The box test as it was before plane tests: visible faces of the box are
+ * tested as polygons; kept as reference for the bench.
+ */
+static bool Frustum_IsAABBVisibleByFaces(const float bbmin[3], const float bbmax[3], struct frustum_s *frustum)
+{
+    bool inside = true;
+    polygon_t poly;
+    vertex_t vert[4];
 
-        vert[3].position[0] = bbmax[0];
-        vert[3].position[1] = bbmin[1];
-        vert[3].position[2] = bbmin[2];
+    poly.vertices = vert;
+    poly.vertex_count = 4;
+    for(int k = 0; k < 3; k++)
+    {
+        int k1 = (k == 0) ? (1) : (0);
+        int k2 = (k == 2) ? (1) : (2);
+        float side;
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(frustum->cam_pos[k] < bbmin[k])
         {
-            return true;
+            side = bbmin[k];
+            poly.plane[k] = -1.0f;
+            poly.plane[3] = bbmin[k];
         }
-        inside = false;
-    }
-    else if(frustum->cam_pos[2] > bbmax[2])
-    {
-        poly.plane[2] = 1.0;
-        poly.plane[3] = -bbmax[2];
-        vert[0].position[0] = bbmax[0];
-        vert[0].position[1] = bbmax[1];
-        vert[0].position[2] = bbmax[2];
-
-        vert[1].position[0] = bbmin[0];
-        vert[1].position[1] = bbmax[1];
-        vert[1].position[2] = bbmax[2];
-
-        vert[2].position[0] = bbmin[0];
-        vert[2].position[1] = bbmin[1];
-        vert[2].position[2] = bbmax[2];
+        else if(frustum->cam_pos[k] > bbmax[k])
+        {
+            side = bbmax[k];
+            poly.plane[k] = 1.0f;
+            poly.plane[3] = -bbmax[k];
+        }
+        else
+        {
+            continue;
+        }
+        poly.plane[k1] = 0.0f;
+        poly.plane[k2] = 0.0f;
 
-        vert[3].position[0] = bbmax[0];
-        vert[3].position[1] = bbmin[1];
-        vert[3].position[2] = bbmax[2];
+        for(int j = 0; j < 4; j++)
+        {
+            vert[j].position[k] = side;
+            vert[j].position[k1] = ((j == 0) || (j == 3)) ? (bbmax[k1]) : (bbmin[k1]);
+            vert[j].position[k2] = (j < 2) ? (bbmax[k2]) : (bbmin[k2]);
+        }
 
         if(Frustum_IsPolyVisible(&poly, frustum, true))
         {
@@ -652,40 +778,180 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
     return inside;
 }
 
-
-bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
+/*
+ * Max over frustums of the min (box to plane distance + box radius), in
+ * double: box is visible if it is not negative.
+ */
+static double Frustum_BenchBoxMargin(struct frustum_s *frustum, const float centre[3], const float extent[3])
 {
-    bool inside = true;
-    float t;
-    polygon_p p = obb->polygons;
-
-    for(int i = 0; i < 6; i++, p++)
+    double ret = -1.0e30;
+    for(; frustum; frustum = frustum->next)
     {
-        t = vec3_plane_dist(p->plane, frustum->cam_pos);
-        if((t >= 0.0f) && Frustum_IsPolyVisible(p, frustum, true))
+        const float *n = frustum->planes;
+        double m = 1.0e30;
+        for(uint16_t j = 0; j < frustum->vertex_count; j++, n += 4)
         {
-            return true;
+            double d = (double)n[3] + (double)n[0] * centre[0] + (double)n[1] * centre[1] + (double)n[2] * centre[2];
+            double r = extent[0] * ABS((double)n[0]) + extent[1] * ABS((double)n[1]) + extent[2] * ABS((double)n[2]);
+            m = (d + r < m) ? (d + r) : (m);
         }
-        if(inside && (t > 0.0f))
+        ret = (m > ret) ? (m) : (ret);
+    }
+    return ret;
+}
+
+/*
+ * Checks 3x3x3 points of the box, 1 if any is inside any frustum.
+ */
+static int Frustum_BenchBoxHasVisiblePoint(struct frustum_s *frustum, const float centre[3], const float extent[3])
+{
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
         {
-            inside = false;
+            for(int z = -1; z <= 1; z++)
+            {
+                float pos[3] = {centre[0] + x * extent[0], centre[1] + y * extent[1], centre[2] + z * extent[2]};
+                for(struct frustum_s *f = frustum; f; f = f->next)
+                {
+                    const float *n = f->planes;
+                    uint16_t j = 0;
+                    for(; (j < f->vertex_count) && (vec3_plane_dist(n, pos) > 0.05f); j++, n += 4);
+                    if(j == f->vertex_count)
+                    {
+                        return 1;
+                    }
+                }
+            }
         }
     }
-
-    return inside;
+    return 0;
 }
 
-bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum)
+/**
+ * Every round makes two random cameras (their frustums list) and random
+ * boxes around them, then runs the old faces test, the single box planes
+ * test, batch test with scalar code only and with SIMD. Batch and single
+ * tests must agree (except boxes within float precision of a plane), no
+ * rejected box may have a point inside the frustums.
+ */
+void Frustum_CullBench(cull_bench_p bench, uint32_t rounds, uint32_t boxes_count)
 {
-    for(; frustum; frustum = frustum->next)
+    camera_t cam[2];
+    cull_boxes_t boxes;
+    float *bb = (float*)malloc(6 * boxes_count * sizeof(float));
+    uint8_t *visible = (uint8_t*)malloc(4 * boxes_count);
+    uint8_t *visible_scalar = visible + boxes_count;
+    uint8_t *visible_single = visible_scalar + boxes_count;
+    uint8_t *visible_old = visible_single + boxes_count;
+    uint32_t seed = 12345;
+    float t;
+
+    memset(bench, 0, sizeof(cull_bench_t));
+#if defined(__SSE2__)
+    bench->simd = "SSE2";
+#elif defined(__ARM_NEON)
+    bench->simd = "NEON";
+#else
+    bench->simd = "none";
+#endif
+    Cam_Init(cam + 0);
+    Cam_Init(cam + 1);
+    cam[0].frustum->next = cam[1].frustum;
+    Frustum_BoxesInit(&boxes, boxes_count);
+
+    for(uint32_t round = 0; round < rounds; round++)
     {
-        if(Frustum_IsOBBVisible(obb, frustum))
+        for(int c = 0; c < 2; c++)
         {
-            return true;
+            float angles[3];
+            angles[0] = Frustum_BenchRandf(&seed, 0.0f, 2.0f * M_PI);
+            angles[1] = Frustum_BenchRandf(&seed, -1.2f, 1.2f);
+            angles[2] = Frustum_BenchRandf(&seed, -0.5f, 0.5f);
+            for(int k = 0; k < 3; k++)
+            {
+                cam[c].transform.M4x4[12 + k] = (c == 0) ? (Frustum_BenchRandf(&seed, -32768.0f, 32768.0f)) :
+                                                (cam[0].transform.M4x4[12 + k] + Frustum_BenchRandf(&seed, -2048.0f, 2048.0f));
+            }
+            Cam_SetRotation(cam + c, angles);
+            Cam_RecalcClipPlanes(cam + c);
+        }
+
+        for(uint32_t i = 0; i < boxes_count; i++)
+        {
+            float *bbmin = bb + 6 * i;
+            float *bbmax = bbmin + 3;
+            for(int k = 0; k < 3; k++)
+            {
+                boxes.centre[k][i] = cam[0].transform.M4x4[12 + k] + Frustum_BenchRandf(&seed, -8192.0f, 8192.0f);
+                boxes.extent[k][i] = Frustum_BenchRandf(&seed, 8.0f, 1024.0f);
+                bbmin[k] = boxes.centre[k][i] - boxes.extent[k][i];
+                bbmax[k] = boxes.centre[k][i] + boxes.extent[k][i];
+            }
+        }
+
+        t = Sys_FloatTime();
+        for(uint32_t i = 0; i < boxes_count; i++)
+        {
+            visible_old[i] = Frustum_IsAABBVisibleByFaces(bb + 6 * i, bb + 6 * i + 3, cam[0].frustum) ||
+                             Frustum_IsAABBVisibleByFaces(bb + 6 * i, bb + 6 * i + 3, cam[1].frustum);
+        }
+        bench->old_time += Sys_FloatTime() - t;
+
+        t = Sys_FloatTime();
+        for(uint32_t i = 0; i < boxes_count; i++)
+        {
+            visible_single[i] = Frustum_IsAABBVisible(bb + 6 * i, bb + 6 * i + 3, cam[0].frustum) ||
+                                Frustum_IsAABBVisible(bb + 6 * i, bb + 6 * i + 3, cam[1].frustum);
+        }
+        bench->single_time += Sys_FloatTime() - t;
+
+        t = Sys_FloatTime();
+        memset(visible_scalar, 0, boxes_count);
+        for(struct frustum_s *f = cam[0].frustum; f; f = f->next)
+        {
+            Frustum_CullBoxesScalar(&boxes, f, visible_scalar, 0);
+        }
+        bench->scalar_time += Sys_FloatTime() - t;
+
+        t = Sys_FloatTime();
+        bench->visible += Frustum_CullBoxes(&boxes, cam[0].frustum, visible);
+        bench->simd_time += Sys_FloatTime() - t;
+
+        for(uint32_t i = 0; i < boxes_count; i++)
+        {
+            float centre[3] = {boxes.centre[0][i], boxes.centre[1][i], boxes.centre[2][i]};
+            float extent[3] = {boxes.extent[0][i], boxes.extent[1][i], boxes.extent[2][i]};
+
+            if((visible[i] != visible_scalar[i]) || (visible[i] != visible_single[i]))
+            {
+                if(ABS(Frustum_BenchBoxMargin(cam[0].frustum, centre, extent)) < 0.1)
+                {
+                    bench->borderline++;
+                }
+                else
+                {
+                    bench->mismatches++;
+                }
+            }
+            if(!visible[i] && Frustum_BenchBoxHasVisiblePoint(cam[0].frustum, centre, extent))
+            {
+                bench->false_rejects++;
+            }
+            bench->old_passed += visible_old[i];
+            bench->old_passed_rejected += (visible_old[i] && !visible[i]);
         }
+        bench->boxes += boxes_count;
     }
 
-    return false;
+    Frustum_BoxesClear(&boxes);
+    for(int c = 0; c < 2; c++)
+    {
+        free(cam[c].frustum->vertex);
+        free(cam[c].frustum);
+    }
+    free(visible);
+    free(bb);
 }
 
 /*
@@ -35,6 +35,40 @@ typedef struct frustum_s
 }frustum_t, *frustum_p;
 
 
+/*
+ * World axis aligned boxes in SoA layout for batch culling:
+ * centre[0][i], centre[1][i], centre[2][i] - i-th box centre,
+ * extent - box half sizes.
+ */
+typedef struct cull_boxes_s
+{
+    uint32_t            count;
+    float              *centre[3];
+    float              *extent[3];
+    float              *data;
+}cull_boxes_t, *cull_boxes_p;
+
+/*
+ * Boxes culling self check and timings on random boxes around random
+ * cameras, CPU only (headless -cull_bench).
+ */
+typedef struct cull_bench_s
+{
+    const char         *simd;                                                   // batch test instruction set
+    uint32_t            boxes;                                                  // tested boxes, all rounds
+    uint32_t            visible;
+    uint32_t            mismatches;                                             // SIMD batch, scalar batch and single box tests disagree
+    uint32_t            borderline;                                             // disagree only within float precision of a plane
+    uint32_t            false_rejects;                                          // rejected, but have a sampled point in frustum
+    uint32_t            old_passed;                                             // passed by the old box faces polygons test
+    uint32_t            old_passed_rejected;                                    // ... but rejected by planes test
+    float               old_time;
+    float               single_time;
+    float               scalar_time;
+    float               simd_time;
+}cull_bench_t, *cull_bench_p;
+
+
 class CFrustumManager
 {
 public:
@@ -43,6 +77,10 @@ public:
     
     void Reset();
     frustum_p PortalFrustumIntersect(struct portal_s *portal, frustum_p emitter, struct camera_s *cam);
+    bool IsOverflowed() const
+    {
+        return m_need_realloc;
+    }
 
 private:
     float *Alloc(uint32_t size);
@@ -63,6 +101,12 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
 bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum);
 bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum);
 
+void     Frustum_BoxesInit(cull_boxes_p boxes, uint32_t count);
+void     Frustum_BoxesClear(cull_boxes_p boxes);
+void     Frustum_BoxesSetOBB(cull_boxes_p boxes, uint32_t index, struct obb_s *obb);
+uint32_t Frustum_CullBoxes(cull_boxes_p boxes, struct frustum_s *frustum, uint8_t *visible);
+void     Frustum_CullBench(cull_bench_p bench, uint32_t rounds, uint32_t boxes_count);
+
 
 portal_p Portal_Create(unsigned int vcount);
 void     Portal_Clear(portal_p p);
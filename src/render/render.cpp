@@ -27,12 +27,16 @@
 #include "../entity.h"
 #include "../character_controller.h"
 #include "../engine.h"
+#include "../core/jobs.h"
 
 CRender renderer;
 
 void CalculateWaterTint(GLfloat *tint, uint8_t fixed_colour);
 
 #define DEBUG_DRAWER_DEFAULT_BUFFER_SIZE        (128 * 1024)
+#define PVS_MAX_DEPTH                           (32)
+#define PVS_MAX_STEPS                           (16384)
+#define PVS_NO_ROOM                             (0xFFFFFFFF)
 
 /*
  * =============================================================================
@@ -49,14 +53,28 @@ m_active_texture(0),
 r_list_size(0),
 r_list_active_count(0),
 r_list(NULL),
+m_static_instances_size(0),
+m_static_instances_count(0),
+m_static_instances(NULL),
+m_rooms_transparency(NULL),
+m_transparent_batches(NULL),
+m_transparent_batches_count(0),
+m_rooms_pvs(NULL),
+m_pvs_row_size(0),
+m_pvs(NULL),
+m_rooms_lights(NULL),
 frustumManager(NULL),
+m_queue(NULL),
 shaderManager(NULL),
 debugDrawer(NULL),
 dynamicBSP(NULL),
 r_flags(0x00)
 {
     this->InitSettings();
+    memset(&m_queue_traversal_stats, 0, sizeof(m_queue_traversal_stats));
+    memset(&m_queue_stats, 0, sizeof(m_queue_stats));
     frustumManager = new CFrustumManager(32768);
+    m_queue        = new CRenderQueue();
     debugDrawer    = new CRenderDebugDrawer();
     dynamicBSP     = new CDynamicBSP(512 * 1024);
 }
@@ -73,12 +91,36 @@ CRender::~CRender()
         r_list = NULL;
     }
 
+    this->ClearRoomsTransparency();
+    this->ClearRoomsLights();
+
+    if(m_rooms_pvs)
+    {
+        free(m_rooms_pvs);
+        m_rooms_pvs = NULL;
+        m_pvs_row_size = 0;
+    }
+
+    if(m_static_instances)
+    {
+        m_static_instances_count = 0;
+        m_static_instances_size = 0;
+        free(m_static_instances);
+        m_static_instances = NULL;
+    }
+
     if(frustumManager)
     {
         delete frustumManager;
         frustumManager = NULL;
     }
 
+    if(m_queue)
+    {
+        delete m_queue;
+        m_queue = NULL;
+    }
+
     if(debugDrawer)
     {
         delete debugDrawer;
@@ -114,6 +156,7 @@ void CRender::InitSettings()
     settings.fog_color[2] = 0.0f;
     settings.fog_start_depth = 10000.0f;
     settings.fog_end_depth = 16000.0f;
+    settings.use_pvs = 1;
 }
 
 void CRender::DoShaders()
@@ -127,7 +170,16 @@ void CRender::DoShaders()
 void CRender::ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim_seq_s *anim_sequences, uint32_t anim_sequences_count)
 {
     this->CleanList();
+    this->ClearRoomsTransparency();
+    this->ClearRoomsLights();
     r_flags = 0x00;
+    m_pvs = NULL;
+    if(m_rooms_pvs)
+    {
+        free(m_rooms_pvs);
+        m_rooms_pvs = NULL;
+        m_pvs_row_size = 0;
+    }
 
     m_rooms = rooms;
     m_rooms_count = rooms_count;
@@ -156,7 +208,470 @@ void CRender::ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim
         {
             m_rooms[i].is_in_r_list = 0;
         }
+
+        m_transparent_batches = (struct transparent_batch_s*)malloc((list_size + 1) * sizeof(struct transparent_batch_s));
+        m_transparent_batches_count = 0;
+        this->GenRoomsTransparency();
+        this->GenRoomsPVS();
+        this->GenRoomsLights();
+    }
+}
+
+/**
+ * Room and static mesh transparency never moves, so every room content gets
+ * its own BSP tree (and VBO) built once here. Only animated texture coordinates
+ * of these trees are updated per frame. Flips swap rooms content, so the trees
+ * are bound to the content.
+ */
+void CRender::GenRoomsTransparency()
+{
+    m_rooms_transparency = (struct room_transparency_s*)malloc(m_rooms_count * sizeof(struct room_transparency_s));
+    for(uint32_t i = 0; i < m_rooms_count; i++)
+    {
+        room_p r = m_rooms + i;
+        room_content_p content = r->original_content;
+        struct room_transparency_s *rt = m_rooms_transparency + content->original_room_id;
+        bool has_transparency = (content->mesh != NULL) && (content->mesh->transparency_polygons != NULL);
+
+        rt->bsp = NULL;
+        rt->merged = 0;
+        for(uint32_t j = 0; !has_transparency && (j < content->static_mesh_count); j++)
+        {
+            has_transparency = (content->static_mesh[j].mesh->transparency_polygons != NULL);
+        }
+
+        if(has_transparency)
+        {
+            rt->bsp = new CDynamicBSP(16 * 1024);
+            do
+            {
+                rt->bsp->Reset(NULL);
+                if((content->mesh != NULL) && (content->mesh->transparency_polygons != NULL))
+                {
+                    rt->bsp->AddNewPolygonList(content->mesh->transparency_polygons, r->transform, NULL);
+                }
+                for(uint32_t j = 0; j < content->static_mesh_count; j++)
+                {
+                    if(content->static_mesh[j].mesh->transparency_polygons != NULL)
+                    {
+                        rt->bsp->AddNewPolygonList(content->static_mesh[j].mesh->transparency_polygons, content->static_mesh[j].transform, NULL);
+                    }
+                }
+            }
+            while(rt->bsp->NeedRealloc());
+
+            vertex_p v = rt->bsp->GetVertexArray();
+            vec3_copy(rt->bb_min, v->position);
+            vec3_copy(rt->bb_max, v->position);
+            for(uint32_t j = 1; j < rt->bsp->GetActiveVertexCount(); j++)
+            {
+                v++;
+                for(int k = 0; k < 3; k++)
+                {
+                    rt->bb_min[k] = (v->position[k] < rt->bb_min[k]) ? (v->position[k]) : (rt->bb_min[k]);
+                    rt->bb_max[k] = (v->position[k] > rt->bb_max[k]) ? (v->position[k]) : (rt->bb_max[k]);
+                }
+            }
+            rt->bsp->UploadVertices(GL_STATIC_DRAW);
+        }
+    }
+}
+
+void CRender::ClearRoomsTransparency()
+{
+    if(m_rooms_transparency)
+    {
+        for(uint32_t i = 0; i < m_rooms_count; i++)
+        {
+            if(m_rooms_transparency[i].bsp)
+            {
+                delete m_rooms_transparency[i].bsp;
+            }
+        }
+        free(m_rooms_transparency);
+        m_rooms_transparency = NULL;
+    }
+
+    if(m_transparent_batches)
+    {
+        free(m_transparent_batches);
+        m_transparent_batches = NULL;
+    }
+    m_transparent_batches_count = 0;
+}
+
+/*
+ * Potentially visible set generation. Room B is in the PVS of room A if some
+ * sight line that starts in A's box may go through a portals chain into B:
+ * every next portal of the chain must lie partly behind all previous ones and
+ * all previous ones partly in front of it (a line crosses a plane only once).
+ * Alternate rooms are merged with their real room (the one used by the portal
+ * walk), so the set is valid in every flip state.
+ */
+typedef struct pvs_build_s
+{
+    struct room_s      *rooms;
+    uint32_t            rooms_count;
+    uint32_t            row_size;
+    uint32_t           *pvs;
+    uint32_t           *group_first;                                        // first room with that real room id
+    uint32_t           *group_next;                                         // next room with the same real room
+}pvs_build_t, *pvs_build_p;
+
+typedef struct pvs_flow_s
+{
+    pvs_build_p         build;
+    uint32_t           *row;
+    uint32_t            steps;
+    uint16_t            depth;
+    uint16_t            overflow;
+    float               bb_min[3];                                          // the viewer's room box
+    float               bb_max[3];
+    struct portal_s    *chain[PVS_MAX_DEPTH];
+    uint32_t            path[PVS_MAX_DEPTH + 1];
+}pvs_flow_t, *pvs_flow_p;
+
+static bool PVS_IsPortalFaced(struct portal_s *p, pvs_flow_p flow)
+{
+    float v[3];
+    v[0] = (p->norm[0] > 0.0f) ? (flow->bb_max[0]) : (flow->bb_min[0]);
+    v[1] = (p->norm[1] > 0.0f) ? (flow->bb_max[1]) : (flow->bb_min[1]);
+    v[2] = (p->norm[2] > 0.0f) ? (flow->bb_max[2]) : (flow->bb_min[2]);
+    return vec3_plane_dist(p->norm, v) > -SPLIT_EPSILON;
+}
+
+static bool PVS_IsPortalsInLine(struct portal_s *near_p, struct portal_s *far_p)
+{
+    bool is_behind = false;
+    float *v = far_p->vertex;
+    for(uint16_t i = 0; i < far_p->vertex_count; i++, v += 3)
+    {
+        if(vec3_plane_dist(near_p->norm, v) < SPLIT_EPSILON)
+        {
+            is_behind = true;
+            break;
+        }
+    }
+
+    if(is_behind)
+    {
+        v = near_p->vertex;
+        for(uint16_t i = 0; i < near_p->vertex_count; i++, v += 3)
+        {
+            if(vec3_plane_dist(far_p->norm, v) > -SPLIT_EPSILON)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void PVS_Flow(pvs_flow_p flow, uint32_t room_id)
+{
+    pvs_build_p build = flow->build;
+    flow->path[flow->depth] = room_id;
+    for(uint32_t m = build->group_first[room_id]; m != PVS_NO_ROOM; m = build->group_next[m])
+    {
+        room_content_p content = build->rooms[m].original_content;
+        portal_p p = content->portals;
+        for(uint16_t i = 0; i < content->portals_count; i++, p++)
+        {
+            uint32_t dest_id = p->dest_room->real_room->id;
+            bool is_visible = PVS_IsPortalFaced(p, flow);
+            if(++flow->steps > PVS_MAX_STEPS)
+            {
+                flow->overflow = 1;
+                return;
+            }
+
+            for(uint16_t j = 0; is_visible && (j <= flow->depth); j++)
+            {
+                is_visible = (flow->path[j] != dest_id);
+            }
+            for(uint16_t j = 0; is_visible && (j < flow->depth); j++)
+            {
+                is_visible = PVS_IsPortalsInLine(flow->chain[j], p);
+            }
+
+            if(is_visible)
+            {
+                flow->row[dest_id >> 5] |= 1U << (dest_id & 31);
+                if(flow->depth >= PVS_MAX_DEPTH)
+                {
+                    flow->overflow = 1;
+                    return;
+                }
+                flow->chain[flow->depth++] = p;
+                PVS_Flow(flow, dest_id);
+                flow->depth--;
+                if(flow->overflow)
+                {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+static void PVS_GenRoomJob(void *data, uint32_t index)
+{
+    pvs_build_p build = (pvs_build_p)data;
+    room_p room = build->rooms + index;
+    pvs_flow_t flow;
+
+    if(room->real_room != room)
+    {
+        return;                                                                 // alternate rooms are never walked
+    }
+
+    flow.build = build;
+    flow.row = build->pvs + index * build->row_size;
+    flow.steps = 0;
+    flow.depth = 0;
+    flow.overflow = 0;
+    vec3_copy(flow.bb_min, room->bb_min);
+    vec3_copy(flow.bb_max, room->bb_max);
+    for(uint32_t m = build->group_first[index]; m != PVS_NO_ROOM; m = build->group_next[m])
+    {
+        for(int k = 0; k < 3; k++)
+        {
+            flow.bb_min[k] = (build->rooms[m].bb_min[k] < flow.bb_min[k]) ? (build->rooms[m].bb_min[k]) : (flow.bb_min[k]);
+            flow.bb_max[k] = (build->rooms[m].bb_max[k] > flow.bb_max[k]) ? (build->rooms[m].bb_max[k]) : (flow.bb_max[k]);
+        }
+    }
+    for(int k = 0; k < 3; k++)                                                  // room box excludes portal sectors, the camera may be there
+    {
+        flow.bb_min[k] -= TR_METERING_SECTORSIZE;
+        flow.bb_max[k] += TR_METERING_SECTORSIZE;
+    }
+
+    flow.row[index >> 5] |= 1U << (index & 31);
+    PVS_Flow(&flow, index);
+    if(flow.overflow)
+    {
+        memset(flow.row, 0xFF, build->row_size * sizeof(uint32_t));           // too complex: leave it to the frustum walk
+    }
+}
+
+void CRender::GenRoomsPVS()
+{
+    pvs_build_t build;
+
+    m_pvs_row_size = (m_rooms_count + 31) / 32;
+    m_rooms_pvs = (uint32_t*)calloc(m_rooms_count * m_pvs_row_size, sizeof(uint32_t));
+
+    build.rooms = m_rooms;
+    build.rooms_count = m_rooms_count;
+    build.row_size = m_pvs_row_size;
+    build.pvs = m_rooms_pvs;
+    build.group_first = (uint32_t*)Sys_GetTempMem(2 * m_rooms_count * sizeof(uint32_t));
+    build.group_next = build.group_first + m_rooms_count;
+    for(uint32_t i = 0; i < m_rooms_count; i++)
+    {
+        build.group_first[i] = PVS_NO_ROOM;
+    }
+    for(uint32_t i = m_rooms_count; i > 0; i--)
+    {
+        uint32_t real_id = m_rooms[i - 1].real_room->id;
+        build.group_next[i - 1] = build.group_first[real_id];
+        build.group_first[real_id] = i - 1;
+    }
+
+    Jobs_ParallelFor(PVS_GenRoomJob, &build, m_rooms_count, NULL);
+    Sys_ReturnTempMem(2 * m_rooms_count * sizeof(uint32_t));
+}
+
+bool CRender::IsInPVS(struct room_s *room) const
+{
+    return (m_pvs == NULL) || (m_pvs[room->id >> 5] & (1U << (room->id & 31)));
+}
+
+uint32_t CRender::GetPVSRoomsCount() const
+{
+    uint32_t ret = 0;
+    if(m_pvs)
+    {
+        for(uint32_t i = 0; i < m_pvs_row_size; i++)
+        {
+            for(uint32_t bits = m_pvs[i]; bits; bits &= bits - 1)
+            {
+                ret++;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Entity lights grid: every room sector gets the lights that may reach it,
+ * room's own ones first, then the lights of the near rooms (so the light
+ * behind the portal is already there when entity comes to it). When there
+ * are more than MAX_NUM_LIGHTS candidates the nearest ones are kept, so the
+ * chosen set does not depend on the lights order.
+ * Flips swap rooms content, so the grid is bound to the content; the near
+ * rooms contents it was built from are kept to rebuild it after their flip.
+ */
+void CRender::GenRoomsLights()
+{
+    m_rooms_lights = (struct room_lights_s*)calloc(m_rooms_count, sizeof(struct room_lights_s));
+    for(uint32_t i = 0; i < m_rooms_count; i++)
+    {
+        this->GenRoomLights(m_rooms + i);
+    }
+}
+
+void CRender::GenRoomLights(struct room_s *room)
+{
+    const uint32_t max_candidates = 256;
+    struct cell_light_s candidates[max_candidates];
+    float candidates_dist[max_candidates];
+    room_content_p content = room->original_content;
+    struct room_lights_s *rl = m_rooms_lights + content->original_room_id;
+    uint32_t lights_size = 0, lights_count = 0;
+
+    free(rl->cells);
+    free(rl->lights);
+    free(rl->near_contents);
+    rl->cells_x = room->sectors_x;
+    rl->cells_y = room->sectors_y;
+    rl->cells = (struct light_cell_s*)calloc(rl->cells_x * rl->cells_y + 1, sizeof(struct light_cell_s));
+    rl->lights = NULL;
+    rl->near_contents = (struct room_content_s**)malloc((content->near_room_list_size + 1) * sizeof(struct room_content_s*));
+    for(uint16_t i = 0; i < content->near_room_list_size; i++)
+    {
+        rl->near_contents[i] = content->near_room_list[i]->content;
+    }
+
+    for(uint16_t x = 0; x < rl->cells_x; x++)
+    {
+        for(uint16_t y = 0; y < rl->cells_y; y++)
+        {
+            struct light_cell_s *cell = rl->cells + x * rl->cells_y + y;
+            uint32_t candidates_count = 0;
+            float bb_min[3], bb_max[3];
+
+            bb_min[0] = room->transform[12 + 0] + x * TR_METERING_SECTORSIZE;
+            bb_min[1] = room->transform[12 + 1] + y * TR_METERING_SECTORSIZE;
+            bb_min[2] = room->bb_min[2];
+            bb_max[0] = bb_min[0] + TR_METERING_SECTORSIZE;
+            bb_max[1] = bb_min[1] + TR_METERING_SECTORSIZE;
+            bb_max[2] = room->bb_max[2];
+
+            for(int32_t room_index = -1; room_index < (int32_t)content->near_room_list_size; room_index++)
+            {
+                room_content_p src = (room_index < 0) ? (content) : (content->near_room_list[room_index]->content);
+                for(uint32_t j = 0; (j < src->lights_count) && (candidates_count < max_candidates); j++)
+                {
+                    light_p light = src->lights + j;
+                    struct cell_light_s *cl = candidates + candidates_count;
+                    float d, dist = 0.0f;
+
+                    for(int k = 0; k < 3; k++)                                  // light to cell box distance
+                    {
+                        d = (light->pos[k] < bb_min[k]) ? (bb_min[k] - light->pos[k]) : ((light->pos[k] > bb_max[k]) ? (light->pos[k] - bb_max[k]) : (0.0f));
+                        dist += d * d;
+                    }
+                    dist = sqrtf(dist);
+
+                    if((light->light_type == LT_SUN) && (room_index < 0))
+                    {
+                        cl->inner_radius = 1e20f;
+                        cl->outer_radius = 1e21f;
+                        dist = -1.0f;                                           // suns are always the first
+                    }
+                    else if((dist <= light->outer + 1024.0f) && (light->light_type == LT_POINT || light->light_type == LT_SHADOW))
+                    {
+                        cl->inner_radius = std::fabs(light->inner);
+                        cl->outer_radius = std::fabs(light->outer);
+                    }
+                    else
+                    {
+                        continue;
+                    }
+
+                    cl->light = light;
+                    cl->colour[0] = std::fmin(std::fmax(light->colour[0], 0.0), 1.0);
+                    cl->colour[1] = std::fmin(std::fmax(light->colour[1], 0.0), 1.0);
+                    cl->colour[2] = std::fmin(std::fmax(light->colour[2], 0.0), 1.0);
+                    cl->colour[3] = std::fmin(std::fmax(light->colour[3], 0.0), 1.0);
+                    if((room_index < 0) && (content->room_flags & TR_ROOM_FLAG_WATER))
+                    {
+                        CalculateWaterTint(cl->colour, 0);
+                    }
+                    candidates_dist[candidates_count++] = dist;
+                }
+            }
+
+            cell->first = lights_count;
+            cell->count = 0;
+            for(; (cell->count < MAX_NUM_LIGHTS) && (candidates_count > 0); cell->count++)
+            {
+                uint32_t nearest = 0;
+                for(uint32_t j = 1; j < candidates_count; j++)
+                {
+                    nearest = (candidates_dist[j] < candidates_dist[nearest]) ? (j) : (nearest);
+                }
+
+                if(lights_count >= lights_size)
+                {
+                    lights_size += 64;
+                    rl->lights = (struct cell_light_s*)realloc(rl->lights, lights_size * sizeof(struct cell_light_s));
+                }
+                rl->lights[lights_count++] = candidates[nearest];
+                candidates_count--;
+                candidates[nearest] = candidates[candidates_count];
+                candidates_dist[nearest] = candidates_dist[candidates_count];
+            }
+        }
+    }
+}
+
+void CRender::ClearRoomsLights()
+{
+    if(m_rooms_lights)
+    {
+        for(uint32_t i = 0; i < m_rooms_count; i++)
+        {
+            free(m_rooms_lights[i].cells);
+            free(m_rooms_lights[i].lights);
+            free(m_rooms_lights[i].near_contents);
+        }
+        free(m_rooms_lights);
+        m_rooms_lights = NULL;
+    }
+}
+
+/**
+ * Returns the lights cell of the room for the position, the positions out of
+ * the room are clamped to its border cells. The grid is rebuilt first if some
+ * near room was flipped since it was made.
+ */
+const struct CRender::light_cell_s *CRender::GetLightCell(struct room_s *room, const float pos[3])
+{
+    room_content_p content = room->content;
+    struct room_lights_s *rl = m_rooms_lights + content->original_room_id;
+    for(uint16_t i = 0; i < content->near_room_list_size; i++)
+    {
+        if(rl->near_contents[i] != content->near_room_list[i]->content)
+        {
+            this->GenRoomLights(m_rooms + content->original_room_id);
+            break;
+        }
+    }
+
+    int x = (int)((pos[0] - room->transform[12 + 0]) / TR_METERING_SECTORSIZE);
+    int y = (int)((pos[1] - room->transform[12 + 1]) / TR_METERING_SECTORSIZE);
+
+    if((rl->cells_x == 0) || (rl->cells_y == 0))
+    {
+        return rl->cells;                                                       // the only empty cell
     }
+    x = (x < 0) ? (0) : ((x >= rl->cells_x) ? (rl->cells_x - 1) : (x));
+    y = (y < 0) ? (0) : ((y >= rl->cells_y) ? (rl->cells_y - 1) : (y));
+
+    return rl->cells + x * rl->cells_y + y;
 }
 
 // This function is used for updating global animated texture frame
@@ -235,6 +750,7 @@ void CRender::GenWorldList(struct camera_s *cam)
     this->frustumManager->Reset();
     cam->frustum->next = NULL;
     m_camera = cam;
+    m_pvs = NULL;
 
     if(m_rooms == NULL)
     {
@@ -248,12 +764,14 @@ void CRender::GenWorldList(struct camera_s *cam)
     {
         const float eps = 10.0f;
         portal_p p = curr_room->content->portals;
+        const uint32_t *curr_pvs = (settings.use_pvs && m_rooms_pvs) ? (m_rooms_pvs + curr_room->real_room->id * m_pvs_row_size) : (NULL);
+        m_pvs = curr_pvs;
         curr_room->frustum = NULL;                                              // room with camera inside has no frustums!
         this->AddRoom(curr_room);                                               // room with camera inside adds to the render list immediately
         for(uint16_t i = 0; i < curr_room->content->portals_count; i++, p++)    // go through all start room portals
         {
             room_p dest_room = p->dest_room->real_room;
-            frustum_p last_frus = this->frustumManager->PortalFrustumIntersect(p, cam->frustum, cam);
+            frustum_p last_frus = (this->IsInPVS(dest_room)) ? (this->frustumManager->PortalFrustumIntersect(p, cam->frustum, cam)) : (NULL);
             if(last_frus)
             {
                 this->AddRoom(dest_room);                                       // portal destination room
@@ -269,10 +787,11 @@ void CRender::GenWorldList(struct camera_s *cam)
                 dest_room->frustum = NULL;                                      // room with camera inside has no frustums!
                 if(this->AddRoom(dest_room))                                    // room with camera inside adds to the render list immediately
                 {
+                    m_pvs = (curr_pvs) ? (m_rooms_pvs + dest_room->id * m_pvs_row_size) : (NULL);
                     for(uint16_t ii = 0; ii < dest_room->content->portals_count; ii++, np++)// go through all start room portals
                     {
                         room_p ndest_room = np->dest_room->real_room;
-                        frustum_p last_frus = this->frustumManager->PortalFrustumIntersect(np, cam->frustum, cam);
+                        frustum_p last_frus = (this->IsInPVS(ndest_room)) ? (this->frustumManager->PortalFrustumIntersect(np, cam->frustum, cam)) : (NULL);
                         if(last_frus)
                         {
                             this->AddRoom(ndest_room);                          // portal destination room
@@ -280,6 +799,21 @@ void CRender::GenWorldList(struct camera_s *cam)
                             this->ProcessRoom(np, last_frus);                   // next start reccursion algorithm
                         }
                     }
+                    m_pvs = curr_pvs;
+                }
+            }
+        }
+
+        if(m_pvs && this->frustumManager->IsOverflowed())                      // frustums buffer is over, portal walk has lost some rooms
+        {
+            room_p r = m_rooms;
+            for(uint32_t i = 0; i < m_rooms_count; i++, r++)
+            {
+                if((r->real_room == r) && this->IsInPVS(r) && !r->is_in_r_list &&
+                   Frustum_IsAABBVisible(r->bb_min, r->bb_max, cam->frustum))
+                {
+                    r->frustum = NULL;
+                    this->AddRoom(r);
                 }
             }
         }
@@ -329,9 +863,13 @@ void CRender::DrawList()
         /*
          * room rendering
          */
-        for(uint32_t i = 0; i < r_list_active_count; i++)
+        this->GenRenderQueue();
+        this->DrawRenderQueue();
+
+        if(shaderManager->getStaticMeshInstancedShader())
         {
-            this->DrawRoom(r_list[i].room, m_camera->gl_view_mat, m_camera->gl_view_proj_mat);
+            this->GenStaticInstanceList();
+            this->DrawStaticInstances();
         }
 
         qglDisable(GL_CULL_FACE);
@@ -343,53 +881,10 @@ void CRender::DrawList()
         /*
          * NOW render transparency polygons
          */
-        /*First generate BSP from base room mesh - it has good for start splitter polygons*/
-        for(uint32_t i = 0; i < r_list_active_count; i++)
-        {
-            room_p r = r_list[i].room;
-            if((r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
-            {
-                dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, m_camera->frustum);
-            }
-        }
-
-        for(uint32_t i = 0; i < r_list_active_count; i++)
-        {
-            room_p r = r_list[i].room;
-            // Add transparency polygons from static meshes (if they exists)
-            for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
-            {
-                if((r->content->static_mesh[j].mesh->transparency_polygons != NULL) && Frustum_IsOBBVisibleInFrustumList(r->content->static_mesh[j].obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
-                {
-                    dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, m_camera->frustum);
-                }
-            }
-
-            // Add transparency polygons from all entities (if they exists) // yes, entities may be animated and intersects with each others;
-            for(engine_container_p cont = r->containers; cont; cont = cont->next)
-            {
-                if(cont->object_type == OBJECT_ENTITY)
-                {
-                    entity_p ent = (entity_p)cont->object;
-                    if((ent->state_flags & ENTITY_STATE_VISIBLE) && ent->bf->animations.model && (ent->bf->animations.model->transparency_flags == MESH_HAS_TRANSPARENCY) && Frustum_IsOBBVisibleInFrustumList(ent->obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
-                    {
-                        float tr[16];
-                        for(uint16_t j = 0; j < ent->bf->bone_tag_count; j++)
-                        {
-                            if(ent->bf->bone_tags[j].mesh_base->transparency_polygons != NULL)
-                            {
-                                Mat4_Mat4_mul(tr, ent->transform.M4x4, ent->bf->bone_tags[j].full_transform);
-                                dynamicBSP->AddNewPolygonList(ent->bf->bone_tags[j].mesh_base->transparency_polygons, tr, m_camera->frustum);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        if(dynamicBSP->m_root->polygons_front && (dynamicBSP->m_vbo != 0))
+        this->GenTransparencyList();
+        if(m_transparent_batches_count > 0)
         {
-            const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
+            const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false, false);
             qglUseProgramObjectARB(shader->program);
             qglUniform1iARB(shader->sampler, 0);
             qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
@@ -398,14 +893,25 @@ void CRender::DrawList()
             qglDisable(GL_ALPHA_TEST);
             qglEnable(GL_BLEND);
             m_active_transparency = 0;
-            qglBindBufferARB(GL_ARRAY_BUFFER_ARB, dynamicBSP->m_vbo);
             qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-            qglBufferDataARB(GL_ARRAY_BUFFER_ARB, dynamicBSP->GetActiveVertexCount() * sizeof(vertex_t), dynamicBSP->GetVertexArray(), GL_DYNAMIC_DRAW);
-            qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
-            qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
-            qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
-            qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
-            this->DrawBSPBackToFront(dynamicBSP->m_root);
+            for(uint32_t i = 0; i < m_transparent_batches_count; i++)
+            {
+                CDynamicBSP *bsp = m_transparent_batches[i].bsp;
+                if(bsp == dynamicBSP)
+                {
+                    bsp->UploadVertices(GL_DYNAMIC_DRAW);
+                }
+                qglBindBufferARB(GL_ARRAY_BUFFER_ARB, bsp->m_vbo);
+                if(bsp != dynamicBSP)
+                {
+                    bsp->UpdateAnimTextures(m_anim_sequences);
+                }
+                qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+                qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+                qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+                qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+                this->DrawBSPBackToFront(bsp->m_root);
+            }
             qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
             qglDepthMask(GL_TRUE);
             qglDisable(GL_BLEND);
@@ -519,7 +1025,7 @@ void CRender::DrawListDebugLines()
 
     if(!debugDrawer->IsEmpty() && m_camera)
     {
-        const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
+        const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false, false);
         qglDisableClientState(GL_TEXTURE_COORD_ARRAY);
         qglUseProgramObjectARB(shader->program);
         qglUniform1iARB(shader->sampler, 0);
@@ -556,6 +1062,7 @@ void CRender::CleanList()
 
     r_flags &= ~R_DRAW_SKYBOX;
     r_list_active_count = 0;
+    m_static_instances_count = 0;
 }
 
 /*
@@ -602,7 +1109,7 @@ void CRender::DrawBSPPolygon(struct bsp_polygon_s *p)
         m_active_texture = p->texture_index;
         qglBindTexture(GL_TEXTURE_2D, m_active_texture);
     }
-    qglDrawElements(GL_TRIANGLE_FAN, p->vertex_count, GL_UNSIGNED_INT, p->indexes);
+    qglDrawArrays(GL_TRIANGLE_FAN, p->indexes[0], p->vertex_count);               // BSP polygon vertices are consecutive
 }
 
 void CRender::DrawBSPFrontToBack(struct bsp_node_s *root)
@@ -703,70 +1210,117 @@ void CRender::DrawBSPBackToFront(struct bsp_node_s *root)
 
 void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals)
 {
+    if(mesh->vbo_index_array)
+    {
+        qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_index_array);
+    }
+
     if(mesh->animated_vertex_count)
     {
-        // Respecify the tex coord buffer
-        qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_texcoord_array);
-        // Tell OpenGL to discard the old values
-        qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(GLfloat [2]), 0, GL_STREAM_DRAW);
-        // Get writable data (to avoid copy)
-        GLfloat *data = (GLfloat *) qglMapBufferARB(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+        this->DrawMeshAnimatedFaces(mesh);
+    }
 
-        for(polygon_p p = mesh->animated_polygons; p; p = p->next)
+    if(mesh->vertex_count == 0)
+    {
+        if(mesh->vbo_index_array)
         {
-            anim_seq_p seq = m_anim_sequences + p->anim_id - 1;
-            uint16_t frame = (seq->current_frame + p->frame_offset) % seq->frames_count;
-            tex_frame_p tf = seq->frames + frame;
-            for(uint16_t i = 0; i < p->vertex_count; i++, data += 2)
-            {
-                ApplyAnimTextureTransformation(data, p->vertices[i].tex_coord, tf);
-            }
+            qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
         }
-        qglUnmapBufferARB(GL_ARRAY_BUFFER);
+        return;
+    }
 
-        // Setup altered buffer
-        qglTexCoordPointer(2, GL_FLOAT, sizeof(GLfloat [2]), 0);
-        // Setup static data
-        qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_vertex_array);
-        qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
-        qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
-        qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+    if(mesh->vbo_vertex_array)
+    {
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
+        qglVertexPointer(3, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, position));
+        qglColorPointer(4, GL_UNSIGNED_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, color));
+        qglNormalPointer(GL_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, normal));
+        qglTexCoordPointer(2, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, tex_coord));
+    }
 
-        mesh_face_p face = mesh->animated_faces;
-        for(uint32_t face_index = 0; face_index < mesh->animated_faces_count; face_index++, face++)
-        {
-            if(m_active_texture != face->texture_index)
-            {
-                m_active_texture = face->texture_index;
-                qglBindTexture(GL_TEXTURE_2D, m_active_texture);
-            }
-            qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements);
+    // Bind overriden vertices if they exist
+    if (overrideVertices != NULL)
+    {
+        // Standard normals are always float. Overridden normals (from skinning)
+        // are float.
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+        qglVertexPointer(3, GL_FLOAT, 0, overrideVertices);
+        qglNormalPointer(GL_FLOAT, 0, overrideNormals);
+    }
+
+    mesh_face_p face = mesh->faces;
+    for(uint32_t face_index = 0; face_index < mesh->faces_count; face_index++, face++)
+    {
+        if(m_active_texture != face->texture_index)
+        {
+            m_active_texture = face->texture_index;
+            qglBindTexture(GL_TEXTURE_2D, m_active_texture);
         }
+        qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, (mesh->vbo_index_array) ? ((void*)(size_t)face->elements_offset) : (face->elements));
     }
 
-    if(mesh->vertex_count == 0)
+    if(mesh->vbo_index_array)
     {
-        return;
+        qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
     }
+}
 
-    if(mesh->vbo_vertex_array)
+/**
+ * Draws the faces with animated textures only, mesh's index buffer must be bound.
+ */
+void CRender::DrawMeshAnimatedFaces(struct base_mesh_s *mesh)
+{
+    // Respecify the tex coord buffer
+    qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_texcoord_array);
+    // Tell OpenGL to discard the old values
+    qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(GLfloat [2]), 0, GL_STREAM_DRAW);
+    // Get writable data (to avoid copy)
+    GLfloat *data = (GLfloat *) qglMapBufferARB(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+    for(polygon_p p = mesh->animated_polygons; p; p = p->next)
     {
-        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
-        qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
-        qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
-        qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
-        qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+        anim_seq_p seq = m_anim_sequences + p->anim_id - 1;
+        uint16_t frame = (seq->current_frame + p->frame_offset) % seq->frames_count;
+        tex_frame_p tf = seq->frames + frame;
+        for(uint16_t i = 0; i < p->vertex_count; i++, data += 2)
+        {
+            ApplyAnimTextureTransformation(data, p->vertices[i].tex_coord, tf);
+        }
     }
+    qglUnmapBufferARB(GL_ARRAY_BUFFER);
 
-    // Bind overriden vertices if they exist
-    if (overrideVertices != NULL)
+    // Setup altered buffer
+    qglTexCoordPointer(2, GL_FLOAT, sizeof(GLfloat [2]), 0);
+    // Setup static data
+    qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_vertex_array);
+    qglVertexPointer(3, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, position));
+    qglColorPointer(4, GL_UNSIGNED_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, color));
+    qglNormalPointer(GL_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, normal));
+
+    mesh_face_p face = mesh->animated_faces;
+    for(uint32_t face_index = 0; face_index < mesh->animated_faces_count; face_index++, face++)
     {
-        // Standard normals are always float. Overridden normals (from skinning)
-        // are float.
-        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-        qglVertexPointer(3, GL_FLOAT, 0, overrideVertices);
-        qglNormalPointer(GL_FLOAT, 0, overrideNormals);
+        if(m_active_texture != face->texture_index)
+        {
+            m_active_texture = face->texture_index;
+            qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+        }
+        qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, (mesh->vbo_index_array) ? ((void*)(size_t)face->elements_offset) : (face->elements));
     }
+}
+
+/**
+ * Draws instances_count copies of the mesh, per instance data must be set in the current shader.
+ * Mesh must have index buffer and no animated faces.
+ */
+void CRender::DrawMeshInstanced(struct base_mesh_s *mesh, uint32_t instances_count)
+{
+    qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_index_array);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
+    qglVertexPointer(3, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, position));
+    qglColorPointer(4, GL_UNSIGNED_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, color));
+    qglNormalPointer(GL_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, normal));
+    qglTexCoordPointer(2, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, tex_coord));
 
     mesh_face_p face = mesh->faces;
     for(uint32_t face_index = 0; face_index < mesh->faces_count; face_index++, face++)
@@ -776,8 +1330,10 @@ void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices,
             m_active_texture = face->texture_index;
             qglBindTexture(GL_TEXTURE_2D, m_active_texture);
         }
-        qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements);
+        qglDrawElementsInstancedARB(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, (void*)(size_t)face->elements_offset, instances_count);
     }
+
+    qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
 }
 
 void CRender::DrawSkinMesh(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16])
@@ -953,193 +1509,361 @@ void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16
     }
 }
 
-void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16])
-{
-    float transform[16];
-    engine_container_p cont;
-    entity_p ent;
-
-    const shader_description *lastShader = 0;
+#define RQ_SHADER_ROOM              (0)                                         // + 2 * water + flickering
+#define RQ_SHADER_STATIC            (4)
+#define RQ_SHADER_ENTITY            (8)                                         // + lights count
 
+/**
+ * Room mesh is clipped by its portals frustums in stencil buffer if some of
+ * overlapped rooms are visible too.
+ */
+bool CRender::NeedRoomStencil(struct room_s *room) const
+{
 #if STENCIL_FRUSTUM
-    ////start test stencil test code
-    bool need_stencil = false;
     if(room->frustum != NULL)
     {
         for(uint16_t i = 0; i < room->content->overlapped_room_list_size; i++)
         {
             if(room->content->overlapped_room_list[i]->real_room->is_in_r_list)
             {
-                need_stencil = true;
-                break;
+                return true;
             }
         }
+    }
+#endif
+    return false;
+}
 
-        if(need_stencil)
-        {
-            const int elem_size = (3 + 3 + 4 + 2) * sizeof(GLfloat);
-            const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
-            size_t buf_size;
+/**
+ * Fills stencil buffer by room's frustums and enables stencil test, changes
+ * current shader, texture and vertex buffer.
+ */
+void CRender::DrawRoomStencil(struct room_s *room)
+{
+    const int elem_size = (3 + 3 + 4 + 2) * sizeof(GLfloat);
+    const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false, false);
+    size_t buf_size;
+
+    qglUseProgramObjectARB(shader->program);
+    qglUniform1iARB(shader->sampler, 0);
+    qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, engine_camera.gl_view_proj_mat);
+    qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
+    qglEnable(GL_STENCIL_TEST);
+    qglClear(GL_STENCIL_BUFFER_BIT);
+    qglStencilFunc(GL_NEVER, 1, 0x00);
+    qglStencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);
+    for(frustum_p f = room->frustum; f; f = f->next)
+    {
+        buf_size = f->vertex_count * elem_size;
+        GLfloat *v, *buf = (GLfloat*)Sys_GetTempMem(buf_size);
+        v=buf;
+        for(int16_t i = f->vertex_count - 1; i >= 0; i--)
+        {
+            vec3_copy(v, f->vertex + 3 * i);                    v+=3;
+            vec3_copy_inv(v, engine_camera.transform.M4x4 + 8);   v+=3;
+            vec4_set_one(v);                                    v+=4;
+            v[0] = v[1] = 0.0;                                  v+=2;
+        }
 
-            qglUseProgramObjectARB(shader->program);
-            qglUniform1iARB(shader->sampler, 0);
-            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, engine_camera.gl_view_proj_mat);
-            qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
-            qglEnable(GL_STENCIL_TEST);
-            qglClear(GL_STENCIL_BUFFER_BIT);
-            qglStencilFunc(GL_NEVER, 1, 0x00);
-            qglStencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);
-            for(frustum_p f = room->frustum; f; f = f->next)
-            {
-                buf_size = f->vertex_count * elem_size;
-                GLfloat *v, *buf = (GLfloat*)Sys_GetTempMem(buf_size);
-                v=buf;
-                for(int16_t i = f->vertex_count - 1; i >= 0; i--)
-                {
-                    vec3_copy(v, f->vertex + 3 * i);                    v+=3;
-                    vec3_copy_inv(v, engine_camera.transform.M4x4 + 8);   v+=3;
-                    vec4_set_one(v);                                    v+=4;
-                    v[0] = v[1] = 0.0;                                  v+=2;
-                }
+        m_active_texture = 0;
+        BindWhiteTexture();
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+        qglVertexPointer(3, GL_FLOAT, elem_size, buf+0);
+        qglNormalPointer(GL_FLOAT, elem_size, buf+3);
+        qglColorPointer(4, GL_FLOAT, elem_size, buf+3+3);
+        qglTexCoordPointer(2, GL_FLOAT, elem_size, buf+3+3+4);
+        qglDrawArrays(GL_TRIANGLE_FAN, 0, f->vertex_count);
+
+        Sys_ReturnTempMem(buf_size);
+    }
+    qglStencilFunc(GL_EQUAL, 1, 0xFF);
+}
 
-                m_active_texture = 0;
-                BindWhiteTexture();
-                qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-                qglVertexPointer(3, GL_FLOAT, elem_size, buf+0);
-                qglNormalPointer(GL_FLOAT, elem_size, buf+3);
-                qglColorPointer(4, GL_FLOAT, elem_size, buf+3+3);
-                qglTexCoordPointer(2, GL_FLOAT, elem_size, buf+3+3+4);
-                qglDrawArrays(GL_TRIANGLE_FAN, 0, f->vertex_count);
+uint32_t CRender::GetQueueDepth(const float pos[3]) const
+{
+    float dist = vec3_dist(m_camera->transform.M4x4 + 12, pos) / m_camera->dist_far;
+    return (dist < 1.0f) ? ((uint32_t)(dist * 65535.0f)) : (0xFFFF);
+}
 
-                Sys_ReturnTempMem(buf_size);
-            }
-            qglStencilFunc(GL_EQUAL, 1, 0xFF);
-        }
+/**
+ * One item per mesh face (face is a texture page run), so the faces of all the
+ * meshes that use the same page may go together after sorting. Animated faces
+ * of the mesh are kept together in one item.
+ */
+void CRender::AddMeshToQueue(struct base_mesh_s *mesh, uint16_t type, uint32_t shader, uint32_t group, uint32_t depth,
+                             struct room_s *room, const float *transform, const GLfloat *tint)
+{
+    // without GL (headless) there are no buffers, mesh ID keeps the same order
+    uint32_t buffer = (mesh->vbo_vertex_array) ? (mesh->vbo_vertex_array) : (mesh->id + 1);
+    uint32_t anim_buffer = (mesh->vbo_animated_vertex_array) ? (mesh->vbo_animated_vertex_array) : (mesh->id + 1);
+    render_item_p item;
+
+    if(mesh->animated_vertex_count)
+    {
+        item = m_queue->Add(RQ_KEY(group, shader, mesh->animated_faces->texture_index, anim_buffer, depth));
+        item->type = type;
+        item->face = RQ_FACE_ANIMATED;
+        item->room = room;
+        item->object = mesh;
+        item->transform = transform;
+        item->tint = tint;
     }
-#endif
+
+    for(uint32_t i = 0; (mesh->vertex_count > 0) && (i < mesh->faces_count); i++)
+    {
+        item = m_queue->Add(RQ_KEY(group, shader, mesh->faces[i].texture_index, buffer, depth));
+        item->type = type;
+        item->face = i;
+        item->room = room;
+        item->object = mesh;
+        item->transform = transform;
+        item->tint = tint;
+    }
+}
+
+void CRender::AddEntityToQueue(struct entity_s *entity, struct room_s *room)
+{
+    uint32_t lights = 0;
+    if(entity->self->room && m_rooms_lights)
+    {
+        lights = this->GetLightCell(entity->self->room, entity->transform.M4x4 + 12)->count;
+    }
+
+    render_item_p item = m_queue->Add(RQ_KEY(0, RQ_SHADER_ENTITY + lights, 0, 0, this->GetQueueDepth(entity->transform.M4x4 + 12)));
+    item->type = RENDER_ITEM_ENTITY;
+    item->face = RQ_FACE_ALL;
+    item->room = room;
+    item->object = entity;
+    item->transform = entity->transform.M4x4;
+    item->tint = NULL;
+}
+
+/**
+ * Room's mesh, static batches and the visible entities of the room; statics
+ * and entities of the not visible near rooms that overlap this room too.
+ */
+void CRender::AddRoomToQueue(struct room_s *room, uint32_t group, uint32_t depth)
+{
+    frustum_p frus = (room->frustum) ? (room->frustum) : (m_camera->frustum);
+    bool use_instancing = shaderManager && shaderManager->getStaticMeshInstancedShader();
 
     if(!(r_flags & R_SKIP_ROOM) && room->content->mesh)
     {
-        float modelViewProjectionTransform[16];
-        Mat4_Mat4_mul(modelViewProjectionTransform, modelViewProjectionMatrix, room->transform);
+        uint32_t shader = RQ_SHADER_ROOM + ((room->content->room_flags & 1) ? (2) : (0)) + ((room->content->light_mode == 1) ? (1) : (0));
+        this->AddMeshToQueue(room->content->mesh, RENDER_ITEM_ROOM, shader, group, depth, room, room->transform, NULL);
+    }
 
-        const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(room->content->light_mode == 1, room->content->room_flags & 1);
+    for(uint32_t i = 0; i < room->content->static_batches_count; i++)
+    {
+        static_batch_p batch = room->content->static_batches + i;
+        this->AddMeshToQueue(batch->mesh, RENDER_ITEM_STATIC, RQ_SHADER_STATIC, 0, depth, room, NULL, batch->tint);
+    }
 
-        GLfloat tint[4];
-        CalculateWaterTint(tint, 1);
-        if (shader != lastShader)
+    for(uint32_t i = 0; !use_instancing && (i < room->content->static_mesh_count); i++)
+    {
+        static_mesh_p sm = room->content->static_mesh + i;
+        if(!sm->batched && Frustum_IsOBBVisibleInFrustumList(sm->obb, frus) && (!sm->hide || (r_flags & R_DRAW_DUMMY_STATICS)))
         {
-            qglUseProgramObjectARB(shader->program);
+            this->AddMeshToQueue(sm->mesh, RENDER_ITEM_STATIC, RQ_SHADER_STATIC, 0, this->GetQueueDepth(sm->pos), room, sm->transform, sm->tint);
         }
-
-        lastShader = shader;
-        qglUniform4fvARB(shader->tint_mult, 1, tint);
-        qglUniform1fARB(shader->current_tick, (GLfloat) SDL_GetTicks());
-        qglUniform1iARB(shader->sampler, 0);
-        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, modelViewProjectionTransform);
-        qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
-        this->DrawMesh(room->content->mesh, NULL, NULL);
     }
 
-#if STENCIL_FRUSTUM
-    if(need_stencil)
+    for(engine_container_p cont = room->containers; cont; cont = cont->next)
     {
-        qglDisable(GL_STENCIL_TEST);
+        if((cont->object_type == OBJECT_ENTITY) && Frustum_IsOBBVisibleInFrustumList(((entity_p)cont->object)->obb, frus))
+        {
+            this->AddEntityToQueue((entity_p)cont->object, room);
+        }
     }
-#endif
 
-    if (room->content->static_mesh_count > 0)
+    for(uint16_t ni = 0; ni < room->content->near_room_list_size; ni++)
     {
-        const unlit_tinted_shader_description *shader = shaderManager->getStaticMeshShader();
-        qglUseProgramObjectARB(shader->program);
-        for(uint32_t i = 0; i < room->content->static_mesh_count; i++)
+        room_p near_room = room->content->near_room_list[ni]->real_room;
+        if(!room->content->near_room_list[ni]->is_in_r_list)
         {
-            if(Frustum_IsOBBVisibleInFrustumList(room->content->static_mesh[i].obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
-               (!room->content->static_mesh[i].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
+            for(uint32_t si = 0; !use_instancing && (si < near_room->content->static_mesh_count); si++)
             {
-                Mat4_Mat4_mul(transform, modelViewProjectionMatrix, room->content->static_mesh[i].transform);
-                qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, transform);
-                qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
-                base_mesh_s *mesh = room->content->static_mesh[i].mesh;
-                GLfloat tint[4];
-
-                vec4_copy(tint, room->content->static_mesh[i].tint);
+                static_mesh_p sm = near_room->content->static_mesh + si;
+                if(OBB_OBB_Test(sm->obb, room->obb, 0.0f) && Frustum_IsOBBVisibleInFrustumList(sm->obb, frus) &&
+                   (!sm->hide || (r_flags & R_DRAW_DUMMY_STATICS)))
+                {
+                    this->AddMeshToQueue(sm->mesh, RENDER_ITEM_STATIC, RQ_SHADER_STATIC, 0, this->GetQueueDepth(sm->pos), near_room, sm->transform, sm->tint);
+                }
+            }
 
-                //If this static mesh is in a water room
-                if(room->content->room_flags & TR_ROOM_FLAG_WATER)
+            for(engine_container_p cont = near_room->containers; cont; cont = cont->next)
+            {
+                if(cont->object_type == OBJECT_ENTITY)
                 {
-                    CalculateWaterTint(tint, 0);
+                    entity_p ent = (entity_p)cont->object;
+                    if(OBB_OBB_Test(ent->obb, room->obb, 0.0f) && Frustum_IsOBBVisibleInFrustumList(ent->obb, frus))
+                    {
+                        this->AddEntityToQueue(ent, near_room);
+                    }
                 }
-                qglUniform4fvARB(shader->tint_mult, 1, tint);
-                this->DrawMesh(mesh, NULL, NULL);
             }
         }
     }
+}
 
-    for(cont = room->containers; cont; cont = cont->next)
+/**
+ * Collects the opaque draw records of the render list and sorts them by state
+ * key.
+ */
+void CRender::GenRenderQueue()
+{
+    uint32_t groups_count = 0;
+
+    m_queue->Reset();
+    for(uint32_t i = 0; i < r_list_active_count; i++)
     {
-        switch(cont->object_type)
+        room_p room = r_list[i].room;
+        uint32_t group = 0;
+        if(this->NeedRoomStencil(room) && (groups_count < RQ_MAX_GROUP))
         {
-        case OBJECT_ENTITY:
-            ent = (entity_p)cont->object;
-            if(Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)))
-            {
-                this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
-            }
-            break;
-        };
+            group = ++groups_count;
+        }
+        this->AddRoomToQueue(room, group, (r_list[i].dist < m_camera->dist_far) ? ((uint32_t)(r_list[i].dist / m_camera->dist_far * 65535.0f)) : (0xFFFF));
     }
 
-    for(uint16_t ni = 0; ni < room->content->near_room_list_size; ni++)
+    m_queue->CountStateChanges(&m_queue_traversal_stats);
+    m_queue->Sort();
+    m_queue->CountStateChanges(&m_queue_stats);
+}
+
+/**
+ * Issues the sorted queue, shader, uniforms, vertex buffer and texture are
+ * changed only when they differ from the previous item's ones.
+ */
+void CRender::DrawRenderQueue()
+{
+    const unlit_tinted_shader_description *shader = NULL;
+    const uint32_t no_shader = RQ_MAX_SHADER + 1;
+    uint32_t group = 0, shader_id = no_shader;
+    struct base_mesh_s *buffer_mesh = NULL;
+    const float *transform = NULL;
+    const GLfloat *tint = NULL;
+    bool transform_set = false;
+    float mvp[16];
+
+    memset(&m_queue_stats, 0, sizeof(m_queue_stats));
+    m_queue_stats.items = m_queue->GetCount();
+    for(uint32_t i = 0; i < m_queue->GetCount(); i++)
     {
-        room_p near_room = room->content->near_room_list[ni]->real_room;
-        if(!room->content->near_room_list[ni]->is_in_r_list)
+        render_item_p item = m_queue->GetItem(i);
+        uint32_t item_group = RQ_KEY_GROUP(item->key);
+
+        if(item_group != group)
         {
-            if (near_room->content->static_mesh_count > 0)
+            if(group)
             {
-                const unlit_tinted_shader_description *shader = shaderManager->getStaticMeshShader();
-                for(uint32_t si = 0; si < near_room->content->static_mesh_count; si++)
-                {
-                    if(OBB_OBB_Test(near_room->content->static_mesh[si].obb, room->obb, 0.0f) &&
-                       Frustum_IsOBBVisibleInFrustumList(near_room->content->static_mesh[si].obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
-                       (!near_room->content->static_mesh[si].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
-                    {
-                        qglUseProgramObjectARB(shader->program);
-                        Mat4_Mat4_mul(transform, modelViewProjectionMatrix, near_room->content->static_mesh[si].transform);
-                        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, transform);
-                        qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
-                        base_mesh_s *mesh = near_room->content->static_mesh[si].mesh;
-                        GLfloat tint[4];
+                qglDisable(GL_STENCIL_TEST);
+            }
+            if(item_group)
+            {
+                this->DrawRoomStencil(item->room);
+                shader_id = no_shader;
+                buffer_mesh = NULL;
+            }
+            group = item_group;
+        }
 
-                        vec4_copy(tint, near_room->content->static_mesh[si].tint);
+        if(item->type == RENDER_ITEM_ENTITY)
+        {
+            this->DrawEntity((entity_p)item->object, m_camera->gl_view_mat, m_camera->gl_view_proj_mat);
+            m_queue_stats.draws++;
+            m_queue_stats.shader_switches++;
+            shader_id = no_shader;
+            buffer_mesh = NULL;
+            continue;
+        }
 
-                        //If this static mesh is in a water near_room
-                        if(near_room->content->room_flags & TR_ROOM_FLAG_WATER)
-                        {
-                            CalculateWaterTint(tint, 0);
-                        }
-                        qglUniform4fvARB(shader->tint_mult, 1, tint);
-                        this->DrawMesh(mesh, NULL, NULL);
-                    }
-                }
+        if(RQ_KEY_SHADER(item->key) != shader_id)
+        {
+            shader_id = RQ_KEY_SHADER(item->key);
+            if(item->type == RENDER_ITEM_ROOM)
+            {
+                GLfloat water_tint[4];
+                CalculateWaterTint(water_tint, 1);
+                shader = shaderManager->getRoomShader(shader_id & 1, shader_id & 2, true);
+                qglUseProgramObjectARB(shader->program);
+                qglUniform4fvARB(shader->tint_mult, 1, water_tint);
+                qglUniform1fARB(shader->current_tick, (GLfloat) SDL_GetTicks());
+                qglUniform1iARB(shader->sampler, 0);
+            }
+            else
+            {
+                shader = shaderManager->getStaticMeshShader();
+                qglUseProgramObjectARB(shader->program);
             }
+            qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
+            transform_set = false;
+            tint = NULL;
+            m_queue_stats.shader_switches++;
+        }
 
-            for(cont = near_room->containers; cont; cont=cont->next)
+        if(!transform_set || (item->transform != transform))
+        {
+            if(item->transform)
             {
-                switch(cont->object_type)
-                {
-                case OBJECT_ENTITY:
-                    ent = (entity_p)cont->object;
-                    if(OBB_OBB_Test(ent->obb, room->obb, 0.0f) &&
-                       Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)))
-                    {
-                        this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
-                    }
-                    break;
-                };
+                Mat4_Mat4_mul(mvp, m_camera->gl_view_proj_mat, item->transform);
+            }
+            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, (item->transform) ? (mvp) : (m_camera->gl_view_proj_mat));
+            transform = item->transform;
+            transform_set = true;
+        }
+
+        if(item->tint && (item->tint != tint))
+        {
+            GLfloat item_tint[4];
+            vec4_copy(item_tint, item->tint);
+            if(item->room->content->room_flags & TR_ROOM_FLAG_WATER)
+            {
+                CalculateWaterTint(item_tint, 0);
+            }
+            qglUniform4fvARB(shader->tint_mult, 1, item_tint);
+            tint = item->tint;
+        }
+
+        struct base_mesh_s *mesh = (struct base_mesh_s*)item->object;
+        if(item->face == RQ_FACE_ANIMATED)
+        {
+            qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_index_array);
+            this->DrawMeshAnimatedFaces(mesh);
+            buffer_mesh = NULL;
+            m_queue_stats.buffer_binds++;
+        }
+        else
+        {
+            mesh_face_p face = mesh->faces + item->face;
+            if(buffer_mesh != mesh)
+            {
+                qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_index_array);
+                qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
+                qglVertexPointer(3, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, position));
+                qglColorPointer(4, GL_UNSIGNED_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, color));
+                qglNormalPointer(GL_BYTE, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, normal));
+                qglTexCoordPointer(2, GL_FLOAT, sizeof(gpu_vertex_t), (void*)offsetof(gpu_vertex_t, tex_coord));
+                buffer_mesh = mesh;
+                m_queue_stats.buffer_binds++;
             }
+            if(m_active_texture != face->texture_index)
+            {
+                m_active_texture = face->texture_index;
+                qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+                m_queue_stats.texture_binds++;
+            }
+            qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, (mesh->vbo_index_array) ? ((void*)(size_t)face->elements_offset) : (face->elements));
         }
+        m_queue_stats.draws++;
     }
+
+    if(group)
+    {
+        qglDisable(GL_STENCIL_TEST);
+    }
+    qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 }
 
 
@@ -1147,7 +1871,7 @@ void CRender::DrawRoomSprites(struct room_s *room)
 {
     if (room->content->sprites_count > 0)
     {
-        const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
+        const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false, false);
         GLfloat *view = m_camera->transform.M4x4 + 8;
         GLfloat *up = m_camera->transform.M4x4 + 4;
         GLfloat *right = m_camera->transform.M4x4 + 0;
@@ -1194,6 +1918,344 @@ void CRender::DrawRoomSprites(struct room_s *room)
 }
 
 
+int CRender::StaticInstanceCompare(const void *p1, const void *p2)
+{
+    const struct base_mesh_s *m1 = ((const struct static_instance_s*)p1)->mesh;
+    const struct base_mesh_s *m2 = ((const struct static_instance_s*)p2)->mesh;
+    return (m1 < m2) ? (-1) : ((m1 > m2) ? (1) : (0));
+}
+
+/**
+ * Collects visible not batched static meshes of the render list rooms and
+ * sorts them by mesh, so every MAX_STATIC_INSTANCES run of the same mesh is
+ * drawn by one instanced call.
+ * @return number of instanced draw calls
+ */
+uint32_t CRender::GenStaticInstanceList()
+{
+    uint32_t calls_count = 0;
+
+    m_static_instances_count = 0;
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p room = r_list[i].room;
+        frustum_p frus = (room->frustum) ? (room->frustum) : (m_camera->frustum);
+        if(room->content->static_boxes)
+        {
+            // coarse SoA pass for all room statics, OBB test for survivors only
+            uint8_t *visible = (uint8_t*)Sys_GetTempMem(room->content->static_mesh_count);
+            Frustum_CullBoxes(room->content->static_boxes, frus, visible);
+            for(uint32_t j = 0; j < room->content->static_mesh_count; j++)
+            {
+                static_mesh_p sm = room->content->static_mesh + j;
+                if(visible[j] && !sm->batched && (!sm->hide || (r_flags & R_DRAW_DUMMY_STATICS)) &&
+                   Frustum_IsOBBVisibleInFrustumList(sm->obb, frus))
+                {
+                    this->AddStaticInstance(sm, room);
+                }
+            }
+            Sys_ReturnTempMem(room->content->static_mesh_count);
+        }
+
+        for(uint16_t ni = 0; ni < room->content->near_room_list_size; ni++)
+        {
+            room_p near_room = room->content->near_room_list[ni]->real_room;
+            if(!room->content->near_room_list[ni]->is_in_r_list)
+            {
+                for(uint32_t j = 0; j < near_room->content->static_mesh_count; j++)
+                {
+                    static_mesh_p sm = near_room->content->static_mesh + j;
+                    if((!sm->hide || (r_flags & R_DRAW_DUMMY_STATICS)) &&
+                       OBB_OBB_Test(sm->obb, room->obb, 0.0f) &&
+                       Frustum_IsOBBVisibleInFrustumList(sm->obb, frus))
+                    {
+                        this->AddStaticInstance(sm, near_room);
+                    }
+                }
+            }
+        }
+    }
+
+    if(m_static_instances_count > 1)
+    {
+        qsort(m_static_instances, m_static_instances_count, sizeof(struct static_instance_s), StaticInstanceCompare);
+    }
+
+    for(uint32_t i = 0, run = 0; i < m_static_instances_count; i++)
+    {
+        if((i == 0) || (m_static_instances[i].mesh != m_static_instances[i - 1].mesh) || (run == MAX_STATIC_INSTANCES))
+        {
+            calls_count++;
+            run = 0;
+        }
+        run++;
+    }
+
+    return calls_count;
+}
+
+void CRender::AddStaticInstance(struct static_mesh_s *static_mesh, struct room_s *room)
+{
+    if(m_static_instances_count >= m_static_instances_size)
+    {
+        m_static_instances_size += 256;
+        m_static_instances = (struct static_instance_s*)realloc(m_static_instances, m_static_instances_size * sizeof(struct static_instance_s));
+    }
+
+    struct static_instance_s *inst = m_static_instances + m_static_instances_count++;
+    inst->mesh = static_mesh->mesh;
+    inst->transform = static_mesh->transform;
+    vec4_copy(inst->tint, static_mesh->tint);
+    if(room->content->room_flags & TR_ROOM_FLAG_WATER)
+    {
+        CalculateWaterTint(inst->tint, 0);
+    }
+}
+
+/**
+ * Draws the list made by GenStaticInstanceList(); meshes that can not be
+ * instanced (no index buffer or animated faces) go through DrawMesh.
+ */
+void CRender::DrawStaticInstances()
+{
+    const instanced_tinted_shader_description *shader = shaderManager->getStaticMeshInstancedShader();
+    const unlit_tinted_shader_description *single_shader = shaderManager->getStaticMeshShader();
+    GLfloat mvp[16 * MAX_STATIC_INSTANCES];
+    GLfloat tint[4 * MAX_STATIC_INSTANCES];
+    struct static_instance_s *inst = m_static_instances;
+    struct static_instance_s *end = m_static_instances + m_static_instances_count;
+
+    while(inst < end)
+    {
+        base_mesh_s *mesh = inst->mesh;
+        uint32_t count = 1;
+        while((inst + count < end) && (inst[count].mesh == mesh) && (count < MAX_STATIC_INSTANCES))
+        {
+            count++;
+        }
+
+        if(mesh->vbo_index_array && mesh->vbo_vertex_array && (mesh->animated_faces_count == 0))
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                Mat4_Mat4_mul(mvp + 16 * i, m_camera->gl_view_proj_mat, inst[i].transform);
+                vec4_copy(tint + 4 * i, inst[i].tint);
+            }
+            qglUseProgramObjectARB(shader->program);
+            qglUniform1iARB(shader->sampler, 0);
+            qglUniform1fARB(shader->dist_fog, m_camera->dist_far);
+            qglUniformMatrix4fvARB(shader->instance_mvp, count, false, mvp);
+            qglUniform4fvARB(shader->instance_tint, count, tint);
+            this->DrawMeshInstanced(mesh, count);
+        }
+        else
+        {
+            qglUseProgramObjectARB(single_shader->program);
+            qglUniform1fARB(single_shader->dist_fog, m_camera->dist_far);
+            for(uint32_t i = 0; i < count; i++)
+            {
+                Mat4_Mat4_mul(mvp, m_camera->gl_view_proj_mat, inst[i].transform);
+                qglUniformMatrix4fvARB(single_shader->model_view_projection, 1, false, mvp);
+                qglUniform4fvARB(single_shader->tint_mult, 1, inst[i].tint);
+                this->DrawMesh(mesh, NULL, NULL);
+            }
+        }
+        inst += count;
+    }
+}
+
+static bool IsEntityTransparencyVisible(entity_p ent, frustum_p frus)
+{
+    return (ent->state_flags & ENTITY_STATE_VISIBLE) && ent->bf->animations.model &&
+           (ent->bf->animations.model->transparency_flags == MESH_HAS_TRANSPARENCY) &&
+           Frustum_IsOBBVisibleInFrustumList(ent->obb, frus);
+}
+
+static bool IsBBOverlapped(const float min1[3], const float max1[3], const float min2[3], const float max2[3])
+{
+    const float eps = 1.0f;                                                     // touching rooms are still separated
+    return (min1[0] < max2[0] - eps) && (min2[0] < max1[0] - eps) &&
+           (min1[1] < max2[1] - eps) && (min2[1] < max1[1] - eps) &&
+           (min1[2] < max2[2] - eps) && (min2[2] < max1[2] - eps);
+}
+
+static void ExtendBB(float bb_min[3], float bb_max[3], const float min[3], const float max[3])
+{
+    for(int k = 0; k < 3; k++)
+    {
+        bb_min[k] = (min[k] < bb_min[k]) ? (min[k]) : (bb_min[k]);
+        bb_max[k] = (max[k] > bb_max[k]) ? (max[k]) : (bb_max[k]);
+    }
+}
+
+int CRender::TransparentBatchCompare(const void *p1, const void *p2)
+{
+    float d1 = ((const struct transparent_batch_s*)p1)->dist;
+    float d2 = ((const struct transparent_batch_s*)p2)->dist;
+    return (d1 > d2) ? (-1) : ((d1 < d2) ? (1) : (0));
+}
+
+/**
+ * Makes the back to front list of transparent BSP trees. Cached room trees
+ * are drawn as whole batches; rooms which bounds overlap other transparent
+ * rooms or transparent entities are inserted in the per frame dynamic tree
+ * together with entities, as all the transparency was before.
+ * @return number of transparent batches
+ */
+uint32_t CRender::GenTransparencyList()
+{
+    float dyn_min[3], dyn_max[3];
+    bool dyn = false;
+
+    m_transparent_batches_count = 0;
+    if(m_rooms_transparency == NULL)
+    {
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        frustum_p frus = (r->frustum) ? (r->frustum) : (m_camera->frustum);
+        m_rooms_transparency[r->content->original_room_id].merged = 0;
+        for(engine_container_p cont = r->containers; cont; cont = cont->next)
+        {
+            if((cont->object_type == OBJECT_ENTITY) && IsEntityTransparencyVisible((entity_p)cont->object, frus))
+            {
+                entity_p ent = (entity_p)cont->object;
+                float min[3], max[3];
+                for(int k = 0; k < 3; k++)
+                {
+                    min[k] = ent->obb->centre[k] - ent->obb->radius;
+                    max[k] = ent->obb->centre[k] + ent->obb->radius;
+                }
+                if(!dyn)
+                {
+                    vec3_copy(dyn_min, min);
+                    vec3_copy(dyn_max, max);
+                    dyn = true;
+                }
+                ExtendBB(dyn_min, dyn_max, min, max);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        struct room_transparency_s *rt = m_rooms_transparency + r_list[i].room->content->original_room_id;
+        for(uint32_t j = i + 1; rt->bsp && (j < r_list_active_count); j++)
+        {
+            struct room_transparency_s *rt2 = m_rooms_transparency + r_list[j].room->content->original_room_id;
+            if(rt2->bsp && IsBBOverlapped(rt->bb_min, rt->bb_max, rt2->bb_min, rt2->bb_max))
+            {
+                rt->merged = 1;
+                rt2->merged = 1;
+            }
+        }
+    }
+
+    for(bool changed = true; changed; )
+    {
+        changed = false;
+        for(uint32_t i = 0; i < r_list_active_count; i++)
+        {
+            struct room_transparency_s *rt = m_rooms_transparency + r_list[i].room->content->original_room_id;
+            if(rt->bsp && (rt->merged == 1))
+            {
+                if(!dyn)
+                {
+                    vec3_copy(dyn_min, rt->bb_min);
+                    vec3_copy(dyn_max, rt->bb_max);
+                    dyn = true;
+                }
+                ExtendBB(dyn_min, dyn_max, rt->bb_min, rt->bb_max);
+                rt->merged = 2;                                                 // bounds are in dynamic tree bounds
+                changed = true;
+            }
+            else if(rt->bsp && !rt->merged && dyn && IsBBOverlapped(rt->bb_min, rt->bb_max, dyn_min, dyn_max))
+            {
+                rt->merged = 1;
+                changed = true;
+            }
+        }
+    }
+
+    /*First generate BSP from base room mesh - it has good for start splitter polygons*/
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        if(m_rooms_transparency[r->content->original_room_id].merged && (r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
+        {
+            dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, m_camera->frustum);
+        }
+    }
+
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        frustum_p frus = (r->frustum) ? (r->frustum) : (m_camera->frustum);
+        struct room_transparency_s *rt = m_rooms_transparency + r->content->original_room_id;
+
+        if(rt->merged)
+        {
+            // Add transparency polygons from static meshes (if they exists)
+            for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
+            {
+                if((r->content->static_mesh[j].mesh->transparency_polygons != NULL) && Frustum_IsOBBVisibleInFrustumList(r->content->static_mesh[j].obb, frus))
+                {
+                    dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, m_camera->frustum);
+                }
+            }
+        }
+        else if(rt->bsp)
+        {
+            float centre[3];
+            centre[0] = (rt->bb_min[0] + rt->bb_max[0]) / 2;
+            centre[1] = (rt->bb_min[1] + rt->bb_max[1]) / 2;
+            centre[2] = (rt->bb_min[2] + rt->bb_max[2]) / 2;
+            m_transparent_batches[m_transparent_batches_count].bsp = rt->bsp;
+            m_transparent_batches[m_transparent_batches_count].dist = vec3_dist(m_camera->transform.M4x4 + 12, centre);
+            m_transparent_batches_count++;
+        }
+
+        // Add transparency polygons from all entities (if they exists) // yes, entities may be animated and intersects with each others;
+        for(engine_container_p cont = r->containers; cont; cont = cont->next)
+        {
+            if((cont->object_type == OBJECT_ENTITY) && IsEntityTransparencyVisible((entity_p)cont->object, frus))
+            {
+                entity_p ent = (entity_p)cont->object;
+                float tr[16];
+                for(uint16_t j = 0; j < ent->bf->bone_tag_count; j++)
+                {
+                    if(ent->bf->bone_tags[j].mesh_base->transparency_polygons != NULL)
+                    {
+                        Mat4_Mat4_mul(tr, ent->transform.M4x4, ent->bf->bone_tags[j].full_transform);
+                        dynamicBSP->AddNewPolygonList(ent->bf->bone_tags[j].mesh_base->transparency_polygons, tr, m_camera->frustum);
+                    }
+                }
+            }
+        }
+    }
+
+    if(dynamicBSP->m_root->polygons_front)
+    {
+        float centre[3];
+        centre[0] = (dyn_min[0] + dyn_max[0]) / 2;
+        centre[1] = (dyn_min[1] + dyn_max[1]) / 2;
+        centre[2] = (dyn_min[2] + dyn_max[2]) / 2;
+        m_transparent_batches[m_transparent_batches_count].bsp = dynamicBSP;
+        m_transparent_batches[m_transparent_batches_count].dist = vec3_dist(m_camera->transform.M4x4 + 12, centre);
+        m_transparent_batches_count++;
+    }
+
+    if(m_transparent_batches_count > 1)
+    {
+        qsort(m_transparent_batches, m_transparent_batches_count, sizeof(struct transparent_batch_s), TransparentBatchCompare);
+    }
+
+    return m_transparent_batches_count;
+}
+
 struct gl_text_line_s *CRender::OutTextXYZ(GLfloat x, GLfloat y, GLfloat z, const char *fmt, ...)
 {
     gl_text_line_p ret = NULL;
@@ -1271,7 +2333,7 @@ int CRender::ProcessRoom(struct portal_s *portal, struct frustum_s *frus)
     {
         portal_p p = room->content->portals + i;
         room_p dest_room = p->dest_room->real_room;
-        frustum_p gen_frus = frustumManager->PortalFrustumIntersect(p, frus, m_camera);  // backface portals are filtered here
+        frustum_p gen_frus = (this->IsInPVS(dest_room)) ? (frustumManager->PortalFrustumIntersect(p, frus, m_camera)) : (NULL);  // backface portals are filtered here
         if(gen_frus)
         {
             ret++;
@@ -1307,89 +2369,21 @@ const lit_shader_description *CRender::SetupEntityLight(struct entity_s *entity,
             CalculateWaterTint(ambient_component, 0);
         }
 
-        GLenum current_light_number = 0;
-        light_s *current_light = NULL;
+        const struct light_cell_s *cell = this->GetLightCell(room, entity->transform.M4x4 + 12);
+        const struct cell_light_s *cl = m_rooms_lights[room->content->original_room_id].lights + cell->first;
+        GLenum current_light_number = cell->count;
 
         GLfloat positions[3*MAX_NUM_LIGHTS];
         GLfloat colors[4*MAX_NUM_LIGHTS];
         GLfloat innerRadiuses[1*MAX_NUM_LIGHTS];
         GLfloat outerRadiuses[1*MAX_NUM_LIGHTS];
-        memset(positions, 0, sizeof(positions));
-        memset(colors, 0, sizeof(colors));
-        memset(innerRadiuses, 0, sizeof(innerRadiuses));
-        memset(outerRadiuses, 0, sizeof(outerRadiuses));
-
-        float *entity_pos = entity->transform.M4x4 + 12;
 
-        for(uint32_t i = 0; (i < room->content->lights_count) && (current_light_number < MAX_NUM_LIGHTS); i++)
+        for(uint32_t i = 0; i < current_light_number; i++, cl++)
         {
-            current_light = &room->content->lights[i];
-
-            float x = entity_pos[0] - current_light->pos[0];
-            float y = entity_pos[1] - current_light->pos[1];
-            float z = entity_pos[2] - current_light->pos[2];
-
-            float distance = sqrtf(x * x + y * y + z * z);
-
-            // Find color
-            colors[current_light_number*4 + 0] = std::fmin(std::fmax(current_light->colour[0], 0.0), 1.0);
-            colors[current_light_number*4 + 1] = std::fmin(std::fmax(current_light->colour[1], 0.0), 1.0);
-            colors[current_light_number*4 + 2] = std::fmin(std::fmax(current_light->colour[2], 0.0), 1.0);
-            colors[current_light_number*4 + 3] = std::fmin(std::fmax(current_light->colour[3], 0.0), 1.0);
-
-            if(room->content->room_flags & TR_ROOM_FLAG_WATER)
-            {
-                CalculateWaterTint(colors + current_light_number * 4, 0);
-            }
-
-            // Find position
-            Mat4_vec3_mul(&positions[3*current_light_number], modelViewMatrix, current_light->pos);
-
-            // Find fall-off
-            if(current_light->light_type == LT_SUN)
-            {
-                innerRadiuses[current_light_number] = 1e20f;
-                outerRadiuses[current_light_number] = 1e21f;
-                current_light_number++;
-            }
-            else if(distance <= current_light->outer + 1024.0f && (current_light->light_type == LT_POINT || current_light->light_type == LT_SHADOW))
-            {
-                innerRadiuses[current_light_number] = std::fabs(current_light->inner);
-                outerRadiuses[current_light_number] = std::fabs(current_light->outer);
-                current_light_number++;
-            }
-        }
-
-        for(uint32_t room_index = 0; (current_light_number < MAX_NUM_LIGHTS) && (room_index < room->content->near_room_list_size); room_index++)
-        {
-            room_p near_room = room->content->near_room_list[room_index];
-            for(uint32_t i = 0; (i < near_room->content->lights_count) && (current_light_number < MAX_NUM_LIGHTS); i++)
-            {
-                current_light = &near_room->content->lights[i];
-
-                float x = entity_pos[0] - current_light->pos[0];
-                float y = entity_pos[1] - current_light->pos[1];
-                float z = entity_pos[2] - current_light->pos[2];
-
-                float distance = sqrtf(x * x + y * y + z * z);
-
-                // Find color
-                colors[current_light_number*4 + 0] = std::fmin(std::fmax(current_light->colour[0], 0.0), 1.0);
-                colors[current_light_number*4 + 1] = std::fmin(std::fmax(current_light->colour[1], 0.0), 1.0);
-                colors[current_light_number*4 + 2] = std::fmin(std::fmax(current_light->colour[2], 0.0), 1.0);
-                colors[current_light_number*4 + 3] = std::fmin(std::fmax(current_light->colour[3], 0.0), 1.0);
-
-                // Find position
-                Mat4_vec3_mul(&positions[3*current_light_number], modelViewMatrix, current_light->pos);
-
-                // Find fall-off
-                if(distance <= current_light->outer + 1024.0f && (current_light->light_type == LT_POINT || current_light->light_type == LT_SHADOW))
-                {
-                    innerRadiuses[current_light_number] = std::fabs(current_light->inner);
-                    outerRadiuses[current_light_number] = std::fabs(current_light->outer);
-                    current_light_number++;
-                }
-            }
+            vec4_copy(colors + 4 * i, cl->colour);
+            Mat4_vec3_mul(&positions[3 * i], modelViewMatrix, cl->light->pos);  // only view space position changes every frame
+            innerRadiuses[i] = cl->inner_radius;
+            outerRadiuses[i] = cl->outer_radius;
         }
 
         shader = shaderManager->getEntityShader(current_light_number);
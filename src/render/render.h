@@ -7,6 +7,7 @@
 #include <SDL2/SDL_opengl.h>
 
 #include "../core/vmath.h"
+#include "render_queue.h"
 
 #define R_DRAW_WIRE             0x00000001      // Wireframe rendering
 #define R_DRAW_ROOMBOXES        0x00000002      // Show room bounds
@@ -41,6 +42,7 @@ struct camera_s;
 struct entity_s;
 struct sprite_s;
 struct base_mesh_s;
+struct static_mesh_s;
 struct obb_s;
 struct lit_shader_description;
 
@@ -83,6 +85,7 @@ typedef struct render_settings_s
     GLfloat   fog_color[4];
     float     fog_start_depth;
     float     fog_end_depth;
+    int8_t    use_pvs;                                                      // cull portal walk by precomputed rooms visibility
 }render_settings_t, *render_settings_p;
 
 
@@ -144,6 +147,11 @@ class CRender
         void ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim_seq_s *anim_sequences, uint32_t anim_sequences_count);
         void UpdateAnimTextures();
 
+        /*
+         * Gen* functions only fill the CPU side lists of the frame, GL state is
+         * touched by Draw* ones, so the lists may be built without GL context
+         * (headless -render_stats).
+         */
         void GenWorldList(struct camera_s *cam);
         void DrawList();
         void DrawListDebugLines();
@@ -154,15 +162,37 @@ class CRender
         void DrawBSPBackToFront(struct bsp_node_s *root);
 
         void DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals);
+        void DrawMeshAnimatedFaces(struct base_mesh_s *mesh);
+        void DrawMeshInstanced(struct base_mesh_s *mesh, uint32_t instances_count);
         void DrawSkinMesh(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16]);
         void DrawSkyBox(const float matrix[16]);
 
         void DrawSkeletalModel(const struct lit_shader_description *shader, struct ss_bone_frame_s *bframe, const float mvMatrix[16], const float mvpMatrix[16]);
         void DrawEntity(struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16]);
 
-        void DrawRoom(struct room_s *room, const float matrix[16], const float modelViewProjectionMatrix[16]);
+        void GenRenderQueue();                                                  // rooms, statics and entities draw records, sorted by state
+        void DrawRenderQueue();
+        void GetRenderQueueStats(struct render_queue_stats_s *traversal, struct render_queue_stats_s *sorted) const
+        {
+            *traversal = m_queue_traversal_stats;
+            *sorted = m_queue_stats;
+        }
         void DrawRoomSprites(struct room_s *room);
 
+        uint32_t GenStaticInstanceList();                                       // returns the number of instanced draw calls
+        void DrawStaticInstances();
+        uint32_t GetStaticInstancesCount() const
+        {
+            return m_static_instances_count;
+        }
+        uint32_t GetRenderListCount() const
+        {
+            return r_list_active_count;
+        }
+        uint32_t GetPVSRoomsCount() const;                                      // rooms in the camera room's PVS, 0 if not used
+
+        uint32_t GenTransparencyList();                                         // returns the number of sorted transparent batches
+
         struct gl_text_line_s *OutTextXYZ(GLfloat x, GLfloat y, GLfloat z, const char *fmt, ...);
 
     private:
@@ -173,10 +203,72 @@ class CRender
             float              dist;
         };
 
+        struct room_transparency_s
+        {
+            class CDynamicBSP  *bsp;                                            // room and its statics, built once; NULL if no transparency
+            float               bb_min[3];
+            float               bb_max[3];
+            char                merged;                                         // rebuilt in dynamic tree this frame
+        };
+
+        struct transparent_batch_s
+        {
+            class CDynamicBSP  *bsp;
+            float               dist;
+        };
+
+        struct cell_light_s
+        {
+            struct light_s     *light;
+            GLfloat             colour[4];                                      // clamped and water tinted
+            GLfloat             inner_radius;
+            GLfloat             outer_radius;
+        };
+
+        struct light_cell_s
+        {
+            uint32_t            first;                                          // in room_lights_s::lights
+            uint16_t            count;                                          // up to MAX_NUM_LIGHTS
+        };
+
+        struct room_lights_s
+        {
+            uint16_t            cells_x;                                        // one cell per room sector
+            uint16_t            cells_y;
+            struct light_cell_s *cells;
+            struct cell_light_s *lights;
+            struct room_content_s **near_contents;                              // near rooms contents the grid is built for
+        };
+
+        struct static_instance_s
+        {
+            struct base_mesh_s *mesh;
+            float              *transform;
+            GLfloat             tint[4];
+        };
+
         void InitSettings();
         int  AddRoom(struct room_s *room);
         int  ProcessRoom(struct portal_s *portal, struct frustum_s *frus);
         const lit_shader_description *SetupEntityLight(struct entity_s *entity, const float modelViewMatrix[16]);
+        void AddStaticInstance(struct static_mesh_s *static_mesh, struct room_s *room);
+        static int StaticInstanceCompare(const void *p1, const void *p2);
+        static int TransparentBatchCompare(const void *p1, const void *p2);
+        void GenRoomsTransparency();
+        void ClearRoomsTransparency();
+        void GenRoomsPVS();
+        void GenRoomsLights();
+        void GenRoomLights(struct room_s *room);
+        void ClearRoomsLights();
+        const struct light_cell_s *GetLightCell(struct room_s *room, const float pos[3]);
+        bool NeedRoomStencil(struct room_s *room) const;
+        void DrawRoomStencil(struct room_s *room);
+        void AddRoomToQueue(struct room_s *room, uint32_t group, uint32_t depth);
+        void AddMeshToQueue(struct base_mesh_s *mesh, uint16_t type, uint32_t shader, uint32_t group, uint32_t depth,
+                            struct room_s *room, const float *transform, const GLfloat *tint);
+        void AddEntityToQueue(struct entity_s *entity, struct room_s *room);
+        uint32_t GetQueueDepth(const float pos[3]) const;
+        bool IsInPVS(struct room_s *room) const;
 
         struct camera_s            *m_camera;
 
@@ -191,7 +283,22 @@ class CRender
         uint32_t                    r_list_size;
         uint32_t                    r_list_active_count;
         struct render_list_s       *r_list;
+
+        uint32_t                    m_static_instances_size;
+        uint32_t                    m_static_instances_count;
+        struct static_instance_s   *m_static_instances;
+
+        struct room_transparency_s *m_rooms_transparency;
+        struct transparent_batch_s *m_transparent_batches;
+        uint32_t                    m_transparent_batches_count;
+        uint32_t                   *m_rooms_pvs;                                // rooms_count rows of pvs_row_size words
+        uint32_t                    m_pvs_row_size;
+        const uint32_t             *m_pvs;                                      // camera room's row while list is generated
+        struct room_lights_s       *m_rooms_lights;                             // indexed by content's original room id
         class CFrustumManager      *frustumManager;
+        class CRenderQueue         *m_queue;
+        struct render_queue_stats_s m_queue_traversal_stats;                    // estimated for the traversal order
+        struct render_queue_stats_s m_queue_stats;                              // estimated by GenRenderQueue, real after DrawRenderQueue
 
     public:
         struct render_settings_s    settings;
@@ -0,0 +1,197 @@
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "render_queue.h"
+
+
+CRenderQueue::CRenderQueue():
+m_count(0),
+m_size(0),
+m_sorted(false),
+m_items(NULL),
+m_order(NULL),
+m_temp(NULL)
+{
+}
+
+CRenderQueue::~CRenderQueue()
+{
+    m_count = 0;
+    m_size = 0;
+    free(m_items);
+    free(m_order);
+    free(m_temp);
+    m_items = NULL;
+    m_order = NULL;
+    m_temp = NULL;
+}
+
+render_item_p CRenderQueue::Add(uint64_t key)
+{
+    if(m_count >= m_size)
+    {
+        m_size += 1024;
+        m_items = (struct render_item_s*)realloc(m_items, m_size * sizeof(struct render_item_s));
+        m_order = (struct sort_entry_s*)realloc(m_order, m_size * sizeof(struct sort_entry_s));
+        m_temp = (struct sort_entry_s*)realloc(m_temp, m_size * sizeof(struct sort_entry_s));
+    }
+
+    render_item_p ret = m_items + m_count;
+    ret->key = key;
+    m_order[m_count].key = key;
+    m_order[m_count].index = m_count;
+    m_count++;
+    return ret;
+}
+
+/*
+ * LSD radix sort by 8 bit digits, stable, so equal keys keep the traversal
+ * order. Digits that are the same for all the items (unused groups, no
+ * textures for entities...) are skipped.
+ */
+void CRenderQueue::Sort()
+{
+    if(m_count > 1)
+    {
+        for(uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            uint32_t hist[256];
+            memset(hist, 0, sizeof(hist));
+            for(uint32_t i = 0; i < m_count; i++)
+            {
+                hist[(m_order[i].key >> shift) & 0xFF]++;
+            }
+
+            if(hist[(m_order[0].key >> shift) & 0xFF] == m_count)
+            {
+                continue;
+            }
+
+            for(uint32_t i = 0, sum = 0; i < 256; i++)
+            {
+                uint32_t t = hist[i];
+                hist[i] = sum;
+                sum += t;
+            }
+
+            for(uint32_t i = 0; i < m_count; i++)
+            {
+                m_temp[hist[(m_order[i].key >> shift) & 0xFF]++] = m_order[i];
+            }
+
+            struct sort_entry_s *t = m_order;
+            m_order = m_temp;
+            m_temp = t;
+        }
+    }
+    m_sorted = true;
+}
+
+/*
+ * Estimates the state changes of the current items order by their keys, GL
+ * is not touched, so it works in headless mode too.
+ */
+void CRenderQueue::CountStateChanges(struct render_queue_stats_s *stats) const
+{
+    uint64_t prev_key = 0;
+
+    stats->items = m_count;
+    stats->draws = m_count;
+    stats->shader_switches = 0;
+    stats->texture_binds = 0;
+    stats->buffer_binds = 0;
+    for(uint32_t i = 0; i < m_count; i++)
+    {
+        uint64_t key = this->GetItem(i)->key;
+        if((i == 0) || (RQ_KEY_SHADER(key) != RQ_KEY_SHADER(prev_key)))
+        {
+            stats->shader_switches++;
+        }
+        if(RQ_KEY_TEXTURE(key) && ((i == 0) || (RQ_KEY_TEXTURE(key) != RQ_KEY_TEXTURE(prev_key))))
+        {
+            stats->texture_binds++;
+        }
+        if(RQ_KEY_BUFFER(key) && ((i == 0) || (RQ_KEY_BUFFER(key) != RQ_KEY_BUFFER(prev_key))))
+        {
+            stats->buffer_binds++;
+        }
+        prev_key = key;
+    }
+}
+
+struct check_entry_s
+{
+    uint64_t                key;
+    uintptr_t               index;
+};
+
+static bool RenderQueue_CheckLess(const struct check_entry_s &a, const struct check_entry_s &b)
+{
+    return a.key < b.key;
+}
+
+/*
+ * Sorts random queues and compares them with std::stable_sort, returns the
+ * number of misplaced items. Key sets are made to hit the skipped digits,
+ * equal keys order and the buffers growth; one queue is reused for all.
+ */
+uint32_t RenderQueue_CheckSort(uint32_t rounds)
+{
+    CRenderQueue queue;
+    std::vector<struct check_entry_s> expected;
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    uint32_t ret = 0;
+
+    for(uint32_t round = 0; round < rounds; round++)
+    {
+        uint32_t count = (round * 397) % 5000;
+        queue.Reset();
+        expected.resize(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            uint64_t key;
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            switch(round % 4)
+            {
+                case 0:                                                         // all digits
+                    key = seed;
+                    break;
+
+                case 1:                                                         // depth only
+                    key = RQ_KEY(3, 5, 7, 11, seed);
+                    break;
+
+                case 2:                                                         // a few equal keys
+                    key = RQ_KEY(seed & 1, 0, (seed >> 8) & 3, 0, 0);
+                    break;
+
+                default:                                                        // texture and depth
+                    key = RQ_KEY(0, 1, seed >> 32, 0, seed);
+                    break;
+            }
+            render_item_p item = queue.Add(key);
+            item->object = (void*)(uintptr_t)i;
+            expected[i].key = key;
+            expected[i].index = i;
+        }
+
+        queue.Sort();
+        std::stable_sort(expected.begin(), expected.end(), RenderQueue_CheckLess);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            render_item_p item = queue.GetItem(i);
+            if((item->key != expected[i].key) || ((uintptr_t)item->object != expected[i].index))
+            {
+                ret++;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,104 @@
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdint.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+/*
+ * Item state key, sorted as unsigned integer, high bits are the most
+ * expensive state: stencil group (rooms clipped by their portals stencil
+ * have their own groups, 0 - no stencil) | shader | texture | vertex buffer | depth
+ */
+#define RQ_KEY_GROUP_SHIFT          (54)
+#define RQ_KEY_SHADER_SHIFT         (48)
+#define RQ_KEY_TEXTURE_SHIFT        (32)
+#define RQ_KEY_BUFFER_SHIFT         (16)
+
+#define RQ_MAX_GROUP                (0x3FF)
+#define RQ_MAX_SHADER               (0x3F)
+
+#define RQ_KEY(group, shader, texture, buffer, depth) ((((uint64_t)(group)) << RQ_KEY_GROUP_SHIFT) | \
+                                                       (((uint64_t)(shader)) << RQ_KEY_SHADER_SHIFT) | \
+                                                       (((uint64_t)((texture) & 0xFFFF)) << RQ_KEY_TEXTURE_SHIFT) | \
+                                                       (((uint64_t)((buffer) & 0xFFFF)) << RQ_KEY_BUFFER_SHIFT) | \
+                                                       ((uint64_t)((depth) & 0xFFFF)))
+
+#define RQ_KEY_GROUP(key)           ((uint32_t)((key) >> RQ_KEY_GROUP_SHIFT))
+#define RQ_KEY_SHADER(key)          ((uint32_t)((key) >> RQ_KEY_SHADER_SHIFT) & RQ_MAX_SHADER)
+#define RQ_KEY_TEXTURE(key)         ((uint32_t)((key) >> RQ_KEY_TEXTURE_SHIFT) & 0xFFFF)
+#define RQ_KEY_BUFFER(key)          ((uint32_t)((key) >> RQ_KEY_BUFFER_SHIFT) & 0xFFFF)
+
+#define RQ_FACE_ALL                 (0xFFFF)                                    // whole object (entities)
+#define RQ_FACE_ANIMATED            (0xFFFE)                                    // all animated faces of the mesh
+
+enum render_item_type
+{
+    RENDER_ITEM_ROOM = 0,
+    RENDER_ITEM_STATIC,
+    RENDER_ITEM_ENTITY
+};
+
+typedef struct render_item_s
+{
+    uint64_t                key;
+    uint16_t                type;
+    uint16_t                face;                                               // face index or RQ_FACE_xxx
+    struct room_s          *room;
+    void                   *object;                                             // base_mesh_s or entity_s
+    const float            *transform;                                          // model matrix, NULL - world space
+    const GLfloat          *tint;
+}render_item_t, *render_item_p;
+
+typedef struct render_queue_stats_s
+{
+    uint32_t                items;
+    uint32_t                draws;
+    uint32_t                shader_switches;
+    uint32_t                texture_binds;
+    uint32_t                buffer_binds;
+}render_queue_stats_t, *render_queue_stats_p;
+
+
+class CRenderQueue
+{
+public:
+    CRenderQueue();
+   ~CRenderQueue();
+
+    void Reset()
+    {
+        m_count = 0;
+        m_sorted = false;
+    }
+    render_item_p Add(uint64_t key);
+    void Sort();
+    uint32_t GetCount() const
+    {
+        return m_count;
+    }
+    render_item_p GetItem(uint32_t i) const                                     // in sorted order after Sort()
+    {
+        return m_items + ((m_sorted) ? (m_order[i].index) : (i));
+    }
+    void CountStateChanges(struct render_queue_stats_s *stats) const;
+
+private:
+    struct sort_entry_s
+    {
+        uint64_t            key;
+        uint32_t            index;
+    };
+
+    uint32_t                m_count;
+    uint32_t                m_size;
+    bool                    m_sorted;
+    struct render_item_s   *m_items;
+    struct sort_entry_s    *m_order;
+    struct sort_entry_s    *m_temp;
+};
+
+uint32_t RenderQueue_CheckSort(uint32_t rounds);
+
+#endif
@@ -76,3 +76,10 @@ unlit_tinted_shader_description::unlit_tinted_shader_description(const shader_st
     current_tick = qglGetUniformLocationARB(program, "fCurrentTick");
     tint_mult = qglGetUniformLocationARB(program, "tintMult");
 }
+
+instanced_tinted_shader_description::instanced_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment)
+: unlit_shader_description(vertex, fragment)
+{
+    instance_mvp = qglGetUniformLocationARB(program, "instanceMVP");
+    instance_tint = qglGetUniformLocationARB(program, "instanceTint");
+}
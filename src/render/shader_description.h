@@ -77,4 +77,16 @@ struct unlit_tinted_shader_description : public unlit_shader_description
     unlit_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment);
 };
 
+/*!
+ * A shader description for instanced draws: transforms and tints of all
+ * instances are uploaded as uniform arrays and indexed by instance ID.
+ */
+struct instanced_tinted_shader_description : public unlit_shader_description
+{
+    GLint instance_mvp;
+    GLint instance_tint;
+
+    instanced_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment);
+};
+
 #endif /* defined(__OpenTomb__shader_description__) */
@@ -2,11 +2,22 @@
 #include <sstream>
 
 #include "shader_manager.h"
+#include "../mesh.h"
 
 shader_manager::shader_manager()
 {
     //Color mult prog
-    static_mesh_shader = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh"), shader_stage(GL_FRAGMENT_SHADER_ARB, "shaders/static_mesh.fsh"));
+    shader_stage staticMeshFragmentShader(GL_FRAGMENT_SHADER_ARB, "shaders/static_mesh.fsh");
+    static_mesh_shader = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh", "#define INSTANCED 0\n"), staticMeshFragmentShader);
+    static_mesh_instanced_shader = NULL;
+    if(qglDrawElementsInstancedARB)
+    {
+        std::ostringstream stream;
+        stream << "#define INSTANCED 1" << std::endl;
+        stream << "#define MAX_INSTANCES " << MAX_STATIC_INSTANCES << std::endl;
+
+        static_mesh_instanced_shader = new instanced_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh", stream.str().c_str()), staticMeshFragmentShader);
+    }
 
     //Room prog
     shader_stage roomFragmentShader(GL_FRAGMENT_SHADER_ARB, "shaders/room.fsh");
@@ -14,11 +25,15 @@ shader_manager::shader_manager()
     {
         for (int isFlicker = 0; isFlicker < 2; isFlicker++)
         {
-            std::ostringstream stream;
-            stream << "#define IS_WATER " << isWater << std::endl;
-            stream << "#define IS_FLICKER " << isFlicker << std::endl;
+            for (int isPacked = 0; isPacked < 2; isPacked++)
+            {
+                std::ostringstream stream;
+                stream << "#define IS_WATER " << isWater << std::endl;
+                stream << "#define IS_FLICKER " << isFlicker << std::endl;
+                stream << "#define COLOR_SCALE " << std::fixed << (isPacked ? MESH_COLOR_SCALE_ROOM : MESH_COLOR_SCALE_DEFAULT) << std::endl;
 
-            room_shaders[isWater][isFlicker] = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/room.vsh", stream.str().c_str()), roomFragmentShader);
+                room_shaders[isWater][isFlicker][isPacked] = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/room.vsh", stream.str().c_str()), roomFragmentShader);
+            }
         }
     }
 
@@ -45,7 +60,7 @@ const lit_shader_description *shader_manager::getEntityShader(unsigned numberOfL
     return entity_shader[numberOfLights];
 }
 
-const unlit_tinted_shader_description *shader_manager::getRoomShader(bool isFlickering, bool isWater) const
+const unlit_tinted_shader_description *shader_manager::getRoomShader(bool isFlickering, bool isWater, bool isPacked) const
 {
-    return room_shaders[isWater ? 1 : 0][isFlickering ? 1 : 0];
+    return room_shaders[isWater ? 1 : 0][isFlickering ? 1 : 0][isPacked ? 1 : 0];
 }
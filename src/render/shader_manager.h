@@ -5,10 +5,13 @@
 
 // Highest number of lights that will show up in the entity shader.
 #define MAX_NUM_LIGHTS 8
+// Instances per instanced static mesh draw call, limited by vertex uniforms budget.
+#define MAX_STATIC_INSTANCES 16
 
 class shader_manager {
-    unlit_tinted_shader_description *room_shaders[2][2];
+    unlit_tinted_shader_description *room_shaders[2][2][2];
     unlit_tinted_shader_description *static_mesh_shader;
+    instanced_tinted_shader_description *static_mesh_instanced_shader;
     lit_shader_description *entity_shader[MAX_NUM_LIGHTS+1];
     text_shader_description *text;
 
@@ -20,7 +23,11 @@ public:
     
     const unlit_tinted_shader_description *getStaticMeshShader() const { return static_mesh_shader; }
     
-    const unlit_tinted_shader_description *getRoomShader(bool isFlickering, bool isWater) const;
+    // NULL if GL_ARB_draw_instanced is not supported
+    const instanced_tinted_shader_description *getStaticMeshInstancedShader() const { return static_mesh_instanced_shader; }
+    
+    // isPacked - for room meshes VBO, colors are scaled by MESH_COLOR_SCALE_ROOM
+    const unlit_tinted_shader_description *getRoomShader(bool isFlickering, bool isWater, bool isPacked) const;
     
     const text_shader_description *getTextShader() const { return text; }
 };
@@ -1439,91 +1439,21 @@ void TR_GenRoomMesh(struct room_s *room, size_t room_index, struct anim_seq_s *a
 
 void TR_SkeletalModelInterpolateFrames(skeletal_model_p model, tr_animation_t *tr_animations)
 {
-    uint16_t new_frames_count;
     animation_frame_p anim = model->animations;
-    bone_frame_p bf, new_bone_frames;
-    float lerp, t;
 
     for(uint16_t i = 0; i < model->animation_count; i++, anim++)
     {
         tr_animation_t *tr_anim = tr_animations + i;
-        if(anim->frames_count > 1 && tr_anim->frame_rate > 1)                   // we can't interpolate one frame or rate < 2!
+        anim->frame_rate = 1;
+        anim->frames_count = anim->keyframes_count;
+        if(anim->keyframes_count > 1 && tr_anim->frame_rate > 1)                // we can't interpolate one frame or rate < 2!
         {
-            new_frames_count = (uint16_t)tr_anim->frame_rate * (anim->frames_count - 1) + 1;
-            bf = new_bone_frames = (bone_frame_p)malloc(new_frames_count * sizeof(bone_frame_t));
-
-            /*
-             * the first frame does not changes
-             */
-            bf->bone_tags = (bone_tag_p)malloc(model->mesh_count * sizeof(bone_tag_t));
-            bf->bone_tag_count = model->mesh_count;
-            vec3_set_zero(bf->pos);
-            vec3_copy(bf->centre, anim->frames[0].centre);
-            vec3_copy(bf->pos, anim->frames[0].pos);
-            vec3_copy(bf->bb_max, anim->frames[0].bb_max);
-            vec3_copy(bf->bb_min, anim->frames[0].bb_min);
-            for(uint16_t k = 0; k < model->mesh_count; k++)
-            {
-                vec3_copy(bf->bone_tags[k].offset, anim->frames[0].bone_tags[k].offset);
-                vec4_copy(bf->bone_tags[k].qrotate, anim->frames[0].bone_tags[k].qrotate);
-            }
-            bf++;
-
-            for(uint16_t j = 1; j < anim->frames_count; j++)
-            {
-                for(uint16_t lerp_index = 1; lerp_index <= tr_anim->frame_rate; lerp_index++)
-                {
-                    vec3_set_zero(bf->pos);
-                    lerp = ((float)lerp_index) / (float)tr_anim->frame_rate;
-                    t = 1.0f - lerp;
-
-                    bf->bone_tags = (bone_tag_p)malloc(model->mesh_count * sizeof(bone_tag_t));
-                    bf->bone_tag_count = model->mesh_count;
-
-                    bf->centre[0] = t * anim->frames[j-1].centre[0] + lerp * anim->frames[j].centre[0];
-                    bf->centre[1] = t * anim->frames[j-1].centre[1] + lerp * anim->frames[j].centre[1];
-                    bf->centre[2] = t * anim->frames[j-1].centre[2] + lerp * anim->frames[j].centre[2];
-
-                    bf->pos[0] = t * anim->frames[j-1].pos[0] + lerp * anim->frames[j].pos[0];
-                    bf->pos[1] = t * anim->frames[j-1].pos[1] + lerp * anim->frames[j].pos[1];
-                    bf->pos[2] = t * anim->frames[j-1].pos[2] + lerp * anim->frames[j].pos[2];
-
-                    bf->bb_max[0] = t * anim->frames[j-1].bb_max[0] + lerp * anim->frames[j].bb_max[0];
-                    bf->bb_max[1] = t * anim->frames[j-1].bb_max[1] + lerp * anim->frames[j].bb_max[1];
-                    bf->bb_max[2] = t * anim->frames[j-1].bb_max[2] + lerp * anim->frames[j].bb_max[2];
-
-                    bf->bb_min[0] = t * anim->frames[j-1].bb_min[0] + lerp * anim->frames[j].bb_min[0];
-                    bf->bb_min[1] = t * anim->frames[j-1].bb_min[1] + lerp * anim->frames[j].bb_min[1];
-                    bf->bb_min[2] = t * anim->frames[j-1].bb_min[2] + lerp * anim->frames[j].bb_min[2];
-
-                    for(uint16_t k = 0; k < model->mesh_count; k++)
-                    {
-                        bf->bone_tags[k].offset[0] = t * anim->frames[j-1].bone_tags[k].offset[0] + lerp * anim->frames[j].bone_tags[k].offset[0];
-                        bf->bone_tags[k].offset[1] = t * anim->frames[j-1].bone_tags[k].offset[1] + lerp * anim->frames[j].bone_tags[k].offset[1];
-                        bf->bone_tags[k].offset[2] = t * anim->frames[j-1].bone_tags[k].offset[2] + lerp * anim->frames[j].bone_tags[k].offset[2];
-
-                        vec4_slerp(bf->bone_tags[k].qrotate, anim->frames[j-1].bone_tags[k].qrotate, anim->frames[j].bone_tags[k].qrotate, lerp);
-                    }
-                    bf++;
-                }
-            }
-
             /*
-             * swap old and new animation bone frames
-             * free old bone frames;
+             * only key frames are stored, intermediate ones are
+             * interpolated on the fly in SSBoneFrame_Update
              */
-            for(uint16_t j = 0; j < anim->frames_count; j++)
-            {
-                if(anim->frames[j].bone_tag_count)
-                {
-                    anim->frames[j].bone_tag_count = 0;
-                    free(anim->frames[j].bone_tags);
-                    anim->frames[j].bone_tags = NULL;
-                }
-            }
-            free(anim->frames);
-            anim->frames = new_bone_frames;
-            anim->frames_count = new_frames_count;
+            anim->frame_rate = tr_anim->frame_rate;
+            anim->frames_count = (uint16_t)tr_anim->frame_rate * (anim->keyframes_count - 1) + 1;
         }
         if(anim->max_frame > anim->frames_count || anim->max_frame == 0)
         {
@@ -1579,8 +1509,9 @@ void TR_GenSkeletalModel(struct skeletal_model_s *model, size_t model_id, struct
         model->animation_count = 1;
         model->animations = (animation_frame_p)malloc(sizeof(animation_frame_t));
         model->animations->frames_count = 1;
+        model->animations->frame_rate = 1;
         model->animations->max_frame = 1;
-        model->animations->frames = (bone_frame_p)calloc(model->animations->frames_count , sizeof(bone_frame_t));
+        Anim_AllocFrames(model->animations, 1, model->mesh_count);
         bone_frame = model->animations->frames;
 
         model->animations->id = 0;
@@ -1590,8 +1521,6 @@ void TR_GenSkeletalModel(struct skeletal_model_s *model, size_t model_id, struct
         model->animations->state_change_count = 0;
         model->animations->commands = NULL;
         model->animations->effects = NULL;
-        bone_frame->bone_tag_count = model->mesh_count;
-        bone_frame->bone_tags = (bone_tag_p)malloc(bone_frame->bone_tag_count * sizeof(bone_tag_t));
         vec3_set_zero(bone_frame->pos);
 
         rot[0] = 0.0f;
@@ -1691,17 +1620,15 @@ void TR_GenSkeletalModel(struct skeletal_model_s *model, size_t model_id, struct
              */
             anim->frames_count = 1;
         }
-        anim->frames = (bone_frame_p)calloc(anim->frames_count, sizeof(bone_frame_t));
+        Anim_AllocFrames(anim, anim->frames_count, model->mesh_count);
 
         /*
          * let us begin to load animations
          */
         bone_frame = anim->frames;
         rotations = (tr5_vertex_t*)Sys_GetTempMem(model->mesh_count * sizeof(tr5_vertex_t));
-        for(uint16_t frame_index = 0; frame_index < anim->frames_count; frame_index++, bone_frame++)
+        for(uint16_t frame_index = 0; frame_index < anim->keyframes_count; frame_index++, bone_frame++)
         {
-            bone_frame->bone_tag_count = model->mesh_count;
-            bone_frame->bone_tags = (bone_tag_p)malloc(model->mesh_count * sizeof(bone_tag_t));
             tr->get_anim_frame_data(min_max_pos, rotations, bone_frame->bone_tag_count, tr_animation, frame_index);
 
             bone_frame->bb_min[0] = min_max_pos[0].x;
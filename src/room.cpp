@@ -55,6 +55,25 @@ void Room_Clear(struct room_s *room)
             content->mesh = NULL;
         }
 
+        if(content->static_batches_count)
+        {
+            for(uint32_t i = 0; i < content->static_batches_count; i++)
+            {
+                BaseMesh_Clear(content->static_batches[i].mesh);
+                free(content->static_batches[i].mesh);
+            }
+            free(content->static_batches);
+            content->static_batches = NULL;
+            content->static_batches_count = 0;
+        }
+
+        if(content->static_boxes)
+        {
+            Frustum_BoxesClear(content->static_boxes);
+            free(content->static_boxes);
+            content->static_boxes = NULL;
+        }
+
         if(content->static_mesh_count)
         {
             for(uint32_t i = 0; i < content->static_mesh_count; i++)
@@ -643,6 +662,174 @@ void Room_GenSpritesBuffer(struct room_s *room)
 }
 
 
+/*
+ * Static meshes never move, so shown ones with equal tint are merged in one
+ * world space mesh with one vertex and one index buffer: room draws a face
+ * per texture page for all of them instead of a draw per instance and page.
+ * Meshes with animated textures keep instance drawing.
+ */
+void Room_GenStaticBatches(struct room_s *room)
+{
+    room_content_p content = room->content;
+    uint32_t batched_count = 0;
+    uint32_t *batch_index;
+
+    content->static_batches_count = 0;
+    content->static_batches = NULL;
+    for(uint32_t i = 0; i < content->static_mesh_count; i++)
+    {
+        static_mesh_p sm = content->static_mesh + i;
+        base_mesh_p mesh = sm->mesh;
+        sm->batched = !sm->hide && mesh && (mesh->vertex_count > 0) && (mesh->faces_count > 0) && (mesh->animated_faces_count == 0);
+        batched_count += sm->batched;
+    }
+
+    if(batched_count < 2)
+    {
+        for(uint32_t i = 0; i < content->static_mesh_count; i++)
+        {
+            content->static_mesh[i].batched = 0;
+        }
+        return;
+    }
+
+    batch_index = (uint32_t*)malloc(content->static_mesh_count * sizeof(uint32_t));
+    content->static_batches = (static_batch_p)calloc(batched_count, sizeof(static_batch_t));
+    for(uint32_t i = 0; i < content->static_mesh_count; i++)
+    {
+        static_mesh_p sm = content->static_mesh + i;
+        if(sm->batched)
+        {
+            uint32_t b = 0;
+            for(; b < content->static_batches_count; b++)
+            {
+                GLfloat *tint = content->static_batches[b].tint;
+                if((tint[0] == sm->tint[0]) && (tint[1] == sm->tint[1]) && (tint[2] == sm->tint[2]) && (tint[3] == sm->tint[3]))
+                {
+                    break;
+                }
+            }
+            if(b == content->static_batches_count)
+            {
+                vec4_copy(content->static_batches[b].tint, sm->tint);
+                content->static_batches[b].mesh = (base_mesh_p)calloc(1, sizeof(base_mesh_t));
+                content->static_batches_count++;
+            }
+            batch_index[i] = b;
+            content->static_batches[b].mesh->vertex_count += sm->mesh->vertex_count;
+            content->static_batches[b].mesh->faces_count += sm->mesh->faces_count; // upper bound for now
+        }
+    }
+
+    for(uint32_t b = 0; b < content->static_batches_count; b++)
+    {
+        base_mesh_p batch = content->static_batches[b].mesh;
+        batch->vertices = (vertex_p)malloc(batch->vertex_count * sizeof(vertex_t));
+        batch->faces = (mesh_face_p)calloc(batch->faces_count, sizeof(mesh_face_t));
+        batch->vertex_count = 0;
+        batch->faces_count = 0;
+    }
+
+    // count elements per texture page
+    for(uint32_t i = 0; i < content->static_mesh_count; i++)
+    {
+        if(content->static_mesh[i].batched)
+        {
+            base_mesh_p batch = content->static_batches[batch_index[i]].mesh;
+            base_mesh_p mesh = content->static_mesh[i].mesh;
+            for(uint32_t f = 0; f < mesh->faces_count; f++)
+            {
+                uint32_t bf = 0;
+                while((bf < batch->faces_count) && (batch->faces[bf].texture_index != mesh->faces[f].texture_index))
+                {
+                    bf++;
+                }
+                if(bf == batch->faces_count)
+                {
+                    batch->faces[bf].texture_index = mesh->faces[f].texture_index;
+                    batch->faces_count++;
+                }
+                batch->faces[bf].elements_count += mesh->faces[f].elements_count;
+            }
+        }
+    }
+
+    for(uint32_t b = 0; b < content->static_batches_count; b++)
+    {
+        base_mesh_p batch = content->static_batches[b].mesh;
+        for(uint32_t bf = 0; bf < batch->faces_count; bf++)
+        {
+            batch->faces[bf].elements = (GLuint*)malloc(batch->faces[bf].elements_count * sizeof(GLuint));
+            batch->faces[bf].elements_count = 0;                                // used as fill position
+        }
+    }
+
+    // move vertices to world space and append rebased elements
+    for(uint32_t i = 0; i < content->static_mesh_count; i++)
+    {
+        static_mesh_p sm = content->static_mesh + i;
+        if(sm->batched)
+        {
+            base_mesh_p batch = content->static_batches[batch_index[i]].mesh;
+            base_mesh_p mesh = sm->mesh;
+            vertex_p dst = batch->vertices + batch->vertex_count;
+            vertex_p src = mesh->vertices;
+            for(uint32_t v = 0; v < mesh->vertex_count; v++, dst++, src++)
+            {
+                Mat4_vec3_mul_macro(dst->position, sm->transform, src->position);
+                Mat4_vec3_rot_macro(dst->normal, sm->transform, src->normal);
+                vec4_copy(dst->color, src->color);
+                dst->tex_coord[0] = src->tex_coord[0];
+                dst->tex_coord[1] = src->tex_coord[1];
+            }
+
+            for(uint32_t f = 0; f < mesh->faces_count; f++)
+            {
+                mesh_face_p face = batch->faces;
+                while(face->texture_index != mesh->faces[f].texture_index)
+                {
+                    face++;
+                }
+                for(uint32_t e = 0; e < mesh->faces[f].elements_count; e++)
+                {
+                    face->elements[face->elements_count++] = mesh->faces[f].elements[e] + batch->vertex_count;
+                }
+            }
+            batch->vertex_count += mesh->vertex_count;
+        }
+    }
+    free(batch_index);
+
+    for(uint32_t b = 0; b < content->static_batches_count; b++)
+    {
+        base_mesh_p batch = content->static_batches[b].mesh;
+        BaseMesh_FindBB(batch);
+        batch->radius = vec3_dist(batch->bb_min, batch->bb_max) * 0.5f;
+        BaseMesh_GenVBO(batch, MESH_COLOR_SCALE_DEFAULT);
+    }
+}
+
+/*
+ * Static meshes never move, so their visibility boxes are stored once in
+ * SoA layout: the renderer culls all room statics in one Frustum_CullBoxes call.
+ */
+void Room_GenStaticBoxes(struct room_s *room)
+{
+    room_content_p content = room->content;
+
+    content->static_boxes = NULL;
+    if(content->static_mesh_count > 0)
+    {
+        content->static_boxes = (cull_boxes_p)malloc(sizeof(cull_boxes_t));
+        Frustum_BoxesInit(content->static_boxes, content->static_mesh_count);
+        for(uint32_t i = 0; i < content->static_mesh_count; i++)
+        {
+            Frustum_BoxesSetOBB(content->static_boxes, i, content->static_mesh[i].obb);
+        }
+    }
+}
+
+
 /*
  *   Sectors functionality
  */
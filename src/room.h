@@ -214,6 +214,7 @@ typedef struct static_mesh_s
 {
     uint32_t                    object_id;                                      //
     uint8_t                     hide;                                           // disable static mesh rendering
+    uint8_t                     batched;                                        // drawn by room's static batch
     float                       pos[3];                                         // model position
     float                       rot[3];                                         // model angles
     GLfloat                     tint[4];                                        // model tint
@@ -232,6 +233,16 @@ typedef struct static_mesh_s
 }static_mesh_t, *static_mesh_p;
 
 
+/*
+ * Static meshes of the room with the same tint, merged in one world space mesh
+ */
+typedef struct static_batch_s
+{
+    GLfloat                     tint[4];
+    struct base_mesh_s         *mesh;
+}static_batch_t, *static_batch_p;
+
+
 typedef struct room_content_s
 {
     uint32_t                    original_room_id;
@@ -247,6 +258,9 @@ typedef struct room_content_s
 
     uint32_t                    static_mesh_count;
     struct static_mesh_s       *static_mesh;
+    uint32_t                    static_batches_count;
+    struct static_batch_s      *static_batches;
+    struct cull_boxes_s        *static_boxes;                                   // statics visibility boxes for batch culling
     uint32_t                    sprites_count;
     struct room_sprite_s       *sprites;
     struct vertex_s            *sprites_vertices;
@@ -311,6 +325,8 @@ int  Room_IsInOverlappedRoomsList(struct room_s *r0, struct room_s *r1);
 void Room_MoveActiveItems(struct room_s *room_to, struct room_s *room_from);
 
 void Room_GenSpritesBuffer(struct room_s *room);
+void Room_GenStaticBatches(struct room_s *room);
+void Room_GenStaticBoxes(struct room_s *room);
 
 struct room_sector_s *Sector_GetNextSector(struct room_sector_s *rs, float dir[3]);
 struct room_sector_s *Sector_GetPortalSectorTargetRaw(struct room_sector_s *rs);
@@ -0,0 +1,1358 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+
+extern "C" {
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+#include "core/system.h"
+#include "core/console.h"
+#include "core/vmath.h"
+#include "physics/physics.h"
+#include "script/script.h"
+#include "vt/tr_versions.h"
+#include "engine.h"
+#include "room.h"
+#include "world.h"
+#include "skeletal_model.h"
+#include "entity.h"
+#include "character_controller.h"
+#include "gameflow.h"
+#include "inventory.h"
+#include "save_game.h"
+
+extern lua_State *engine_lua;
+
+#define SAVE_HEADER_SIZE            (20)
+
+#define SAVE_BONE_HIDDEN            (0x01)
+#define SAVE_BONE_TARGETED          (0x02)
+#define SAVE_BONE_AXIS_MODDED       (0x04)
+
+#define SAVE_ENTITY_SPAWNED         (0x0001)
+#define SAVE_ENTITY_IN_ROOM         (0x0002)
+#define SAVE_ENTITY_BASE_MODEL      (0x0004)
+#define SAVE_ENTITY_ACTIVATION      (0x0008)
+#define SAVE_ENTITY_CHARACTER       (0x0010)
+#define SAVE_ENTITY_WEAPON_READY    (0x0020)
+#define SAVE_ENTITY_NO_FIX_ALL      (0x0040)
+#define SAVE_ENTITY_NO_MOVE         (0x0080)
+
+#define SAVE_NO_MODEL               (0xFFFFFFFF)
+
+typedef struct save_bone_s
+{
+    uint8_t                     flags;
+    float                       target[3];
+    float                       direction[3];
+    float                       axis_mod[3];
+    float                       limit[4];
+    float                       current[4];
+}save_bone_t, *save_bone_p;
+
+typedef struct save_anim_s
+{
+    uint16_t                    type;
+    uint16_t                    enabled;
+    uint16_t                    anim_ext_flags;
+    uint32_t                    model_id;                                       // SAVE_NO_MODEL for empty override slot
+    int16_t                     current_animation;
+    int16_t                     current_frame;
+    int16_t                     prev_animation;
+    int16_t                     prev_frame;
+    int16_t                     next_state;
+    int16_t                     next_state_heavy;
+}save_anim_t, *save_anim_p;
+
+typedef struct save_item_s
+{
+    uint32_t                    id;
+    int32_t                     count;
+}save_item_t, *save_item_p;
+
+typedef struct save_entity_s
+{
+    uint32_t                    id;
+    uint32_t                    flags;
+    uint32_t                    model_id;
+    uint32_t                    room_id;
+    float                       pos[3];
+    float                       angles[3];
+    uint8_t                     move_type;
+    uint8_t                     dir_flag;
+    uint8_t                     trigger_layout;
+    uint8_t                     collision_shape;
+    int16_t                     collision_group;
+    int16_t                     collision_mask;
+    uint16_t                    state_flags;
+    uint16_t                    type_flags;
+    uint32_t                    callback_flags;
+    float                       timer;
+    float                       linear_speed;
+    float                       speed[3];
+    float                       activation_offset[4];
+    float                       activation_direction[4];
+
+    float                       climb_point[3];                                 // character part
+    uint32_t                    target_id;
+    int16_t                     weapon_id;
+    int16_t                     weapon_id_req;
+    uint16_t                    params_count;
+    float                      *params;                                         // values, then maximums
+
+    uint16_t                    bones_count;
+    uint16_t                    anims_count;
+    uint32_t                    items_count;
+    uint32_t                    script_size;
+    struct save_bone_s         *bones;
+    struct save_anim_s         *anims;                                          // base animation first
+    struct save_item_s         *items;
+    char                       *script;
+}save_entity_t, *save_entity_p;
+
+typedef struct save_snapshot_s
+{
+    char                        level_path[MAX_ENGINE_PATH];
+    int32_t                     game_id;
+    int32_t                     level_id;
+    int32_t                     global_flip_state;                              // -1 for TR4+
+    uint32_t                    flip_count;
+    uint32_t                    rooms_count;
+    uint32_t                    flipeffects_script_size;
+    uint32_t                    entities_count;
+    uint32_t                    entities_size;
+    uint8_t                    *flip_map;
+    uint8_t                    *flip_state;
+    uint32_t                   *rooms;                                          // room id and active content room id pairs
+    char                       *flipeffects_script;
+    struct save_entity_s       *entities;
+}save_snapshot_t, *save_snapshot_p;
+
+typedef struct save_stream_s
+{
+    uint8_t                    *data;
+    size_t                      size;
+    size_t                      pos;                                            // write end or read position
+    int                         error;
+}save_stream_t, *save_stream_p;
+
+static struct
+{
+    pthread_t                   thread;
+    int                         is_thread_run;
+    volatile int                is_done;
+    int                         result;
+    int                         format;
+    struct save_snapshot_s     *snapshot;
+    char                        path[MAX_ENGINE_PATH];
+} save_writer = {0};
+
+
+/*
+ * Byte stream, little endian regardless of the host
+ */
+static void Save_Write(save_stream_p s, const void *data, size_t size)
+{
+    if(size == 0)
+    {
+        return;
+    }
+    if(s->pos + size > s->size)
+    {
+        size_t new_size = (s->size) ? (s->size) : (65536);
+        while(new_size < s->pos + size)
+        {
+            new_size *= 2;
+        }
+        uint8_t *new_data = (uint8_t*)realloc(s->data, new_size);
+        if(!new_data)
+        {
+            s->error = 1;
+            return;
+        }
+        s->data = new_data;
+        s->size = new_size;
+    }
+    memcpy(s->data + s->pos, data, size);
+    s->pos += size;
+}
+
+
+static void Save_WriteU8(save_stream_p s, uint8_t value)
+{
+    Save_Write(s, &value, 1);
+}
+
+
+static void Save_WriteU16(save_stream_p s, uint16_t value)
+{
+    uint8_t b[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+    Save_Write(s, b, 2);
+}
+
+
+static void Save_WriteU32(save_stream_p s, uint32_t value)
+{
+    uint8_t b[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    Save_Write(s, b, 4);
+}
+
+
+static void Save_WriteFloats(save_stream_p s, const float *v, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t u;
+        memcpy(&u, v + i, 4);
+        Save_WriteU32(s, u);
+    }
+}
+
+
+static const uint8_t *Save_Read(save_stream_p s, size_t size)
+{
+    if(s->error || (s->pos + size > s->size))
+    {
+        s->error = 1;
+        return NULL;
+    }
+    s->pos += size;
+    return s->data + s->pos - size;
+}
+
+
+static uint8_t Save_ReadU8(save_stream_p s)
+{
+    const uint8_t *b = Save_Read(s, 1);
+    return (b) ? (b[0]) : (0);
+}
+
+
+static uint16_t Save_ReadU16(save_stream_p s)
+{
+    const uint8_t *b = Save_Read(s, 2);
+    return (b) ? ((uint16_t)b[0] | ((uint16_t)b[1] << 8)) : (0);
+}
+
+
+static uint32_t Save_ReadU32(save_stream_p s)
+{
+    const uint8_t *b = Save_Read(s, 4);
+    return (b) ? ((uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24)) : (0);
+}
+
+
+static void Save_ReadFloats(save_stream_p s, float *v, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t u = Save_ReadU32(s);
+        memcpy(v + i, &u, 4);
+    }
+}
+
+
+/*
+ * Arrays of count elements; count comes from file, so it is checked against
+ * the rest of stream before allocation.
+ */
+static void *Save_ReadAlloc(save_stream_p s, uint32_t count, size_t min_elem_size, size_t elem_size)
+{
+    if(count == 0)
+    {
+        return NULL;
+    }
+    if(s->error || ((s->size - s->pos) / min_elem_size < count))
+    {
+        s->error = 1;
+        return NULL;
+    }
+
+    void *ret = calloc(count, elem_size);
+    s->error |= (ret == NULL);
+    return ret;
+}
+
+
+static char *Save_ReadString(save_stream_p s, uint32_t size)
+{
+    const uint8_t *str = Save_Read(s, size);
+    char *ret = NULL;
+    if(str && (size > 0))
+    {
+        ret = (char*)malloc(size + 1);
+        memcpy(ret, str, size);
+        ret[size] = 0;
+    }
+
+    return ret;
+}
+
+
+/*
+ * Capture
+ */
+static void Save_CopyScriptData(void *data, const char *str, size_t size)
+{
+    char **dst = (char**)data;
+    *dst = (char*)malloc(size + 1);
+    memcpy(*dst, str, size);
+    (*dst)[size] = 0;
+}
+
+
+static int Save_CaptureEntity(entity_p ent, void *data)
+{
+    save_snapshot_p ss = (save_snapshot_p)data;
+    if(ent)
+    {
+        if(ss->entities_count >= ss->entities_size)
+        {
+            ss->entities_size = (ss->entities_size) ? (ss->entities_size * 2) : (256);
+            ss->entities = (save_entity_p)realloc(ss->entities, ss->entities_size * sizeof(save_entity_t));
+        }
+
+        save_entity_p se = ss->entities + ss->entities_count++;
+        memset(se, 0x00, sizeof(save_entity_t));
+        se->id = ent->id;
+        se->model_id = (ent->bf->animations.model) ? (ent->bf->animations.model->id) : (SAVE_NO_MODEL);
+        se->room_id = (ent->self->room) ? (ent->self->room->id) : (0xFFFFFFFF);
+        vec3_copy(se->pos, ent->transform.M4x4 + 12);
+        vec3_copy(se->angles, ent->transform.angles);
+        se->move_type = ent->move_type;
+        se->dir_flag = ent->dir_flag;
+        se->trigger_layout = ent->trigger_layout;
+        se->collision_shape = ent->self->collision_shape;
+        se->collision_group = ent->self->collision_group;
+        se->collision_mask = ent->self->collision_mask;
+        se->state_flags = ent->state_flags;
+        se->type_flags = ent->type_flags;
+        se->callback_flags = ent->callback_flags;
+        se->timer = ent->timer;
+        se->linear_speed = ent->linear_speed;
+        vec3_copy(se->speed, ent->speed);
+
+        se->flags |= (ent->type_flags & ENTITY_TYPE_SPAWNED) ? (SAVE_ENTITY_SPAWNED) : (0);
+        se->flags |= (ent->self->room) ? (SAVE_ENTITY_IN_ROOM) : (0);
+        se->flags |= (ent->no_fix_all) ? (SAVE_ENTITY_NO_FIX_ALL) : (0);
+        se->flags |= (ent->no_move) ? (SAVE_ENTITY_NO_MOVE) : (0);
+        if(ent->bf->animations.model && ent->character)
+        {
+            se->flags |= SAVE_ENTITY_BASE_MODEL;
+        }
+
+        if(ent->activation_point)
+        {
+            se->flags |= SAVE_ENTITY_ACTIVATION;
+            vec4_copy(se->activation_offset, ent->activation_point->offset);
+            vec4_copy(se->activation_direction, ent->activation_point->direction);
+        }
+
+        se->bones_count = ent->bf->bone_tag_count;
+        se->bones = (save_bone_p)calloc(se->bones_count, sizeof(save_bone_t));
+        for(uint16_t i = 0; i < se->bones_count; ++i)
+        {
+            ss_bone_tag_p b_tag = ent->bf->bone_tags + i;
+            save_bone_p sb = se->bones + i;
+            sb->flags |= (b_tag->is_hidden) ? (SAVE_BONE_HIDDEN) : (0);
+            sb->flags |= (b_tag->is_targeted) ? (SAVE_BONE_TARGETED) : (0);
+            sb->flags |= (b_tag->is_axis_modded) ? (SAVE_BONE_AXIS_MODDED) : (0);
+            vec3_copy(sb->target, b_tag->mod.target);
+            vec3_copy(sb->direction, b_tag->mod.direction);
+            vec3_copy(sb->axis_mod, b_tag->mod.axis_mod);
+            vec4_copy(sb->limit, b_tag->mod.limit);
+            vec4_copy(sb->current, b_tag->mod.current);
+        }
+
+        se->script_size = Script_GetEntitySaveData(engine_lua, ent->id, Save_CopyScriptData, &se->script);
+
+        for(ss_animation_p ss_anim = &ent->bf->animations; ss_anim; ss_anim = ss_anim->next)
+        {
+            se->anims_count++;
+        }
+        se->anims = (save_anim_p)calloc(se->anims_count, sizeof(save_anim_t));
+        save_anim_p sa = se->anims;
+        for(ss_animation_p ss_anim = &ent->bf->animations; ss_anim; ss_anim = ss_anim->next, ++sa)
+        {
+            sa->type = ss_anim->type;
+            sa->enabled = ss_anim->enabled;
+            sa->anim_ext_flags = ss_anim->anim_ext_flags;
+            sa->model_id = (ss_anim->model) ? (ss_anim->model->id) : (SAVE_NO_MODEL);
+            sa->current_animation = ss_anim->current_animation;
+            sa->current_frame = ss_anim->current_frame;
+            sa->prev_animation = ss_anim->prev_animation;
+            sa->prev_frame = ss_anim->prev_frame;
+            sa->next_state = ss_anim->next_state;
+            sa->next_state_heavy = ss_anim->next_state_heavy;
+        }
+
+        for(inventory_node_p i = ent->inventory; i; i = i->next)
+        {
+            se->items_count++;
+        }
+        se->items = (save_item_p)calloc(se->items_count, sizeof(save_item_t));
+        save_item_p si = se->items;
+        for(inventory_node_p i = ent->inventory; i; i = i->next, ++si)
+        {
+            si->id = i->id;
+            si->count = i->count;
+        }
+
+        if(ent->character)
+        {
+            se->flags |= SAVE_ENTITY_CHARACTER;
+            se->flags |= (ent->character->state.weapon_ready) ? (SAVE_ENTITY_WEAPON_READY) : (0);
+            vec3_copy(se->climb_point, ent->character->climb.point);
+            se->target_id = ent->character->target_id;
+            se->weapon_id = ent->character->weapon_id;
+            se->weapon_id_req = ent->character->weapon_id_req;
+            se->params_count = PARAM_LASTINDEX;
+            se->params = (float*)malloc(2 * PARAM_LASTINDEX * sizeof(float));
+            memcpy(se->params, ent->character->parameters.param, PARAM_LASTINDEX * sizeof(float));
+            memcpy(se->params + PARAM_LASTINDEX, ent->character->parameters.maximum, PARAM_LASTINDEX * sizeof(float));
+        }
+    }
+
+    return 0;
+}
+
+
+save_snapshot_p Save_CaptureSnapshot()
+{
+    save_snapshot_p ss = (save_snapshot_p)calloc(1, sizeof(save_snapshot_t));
+    uint8_t *flip_map;
+    uint8_t *flip_state;
+
+    strncpy(ss->level_path, Gameflow_GetCurrentLevelPathLocal(), sizeof(ss->level_path) - 1);
+    ss->game_id = Gameflow_GetCurrentGameID();
+    ss->level_id = Gameflow_GetCurrentLevelID();
+    ss->global_flip_state = (World_GetVersion() < TR_IV) ? ((int32_t)World_GetGlobalFlipState()) : (-1);
+
+    World_GetFlipInfo(&flip_map, &flip_state, &ss->flip_count);
+    if(ss->flip_count)
+    {
+        ss->flip_map = (uint8_t*)malloc(2 * ss->flip_count);
+        ss->flip_state = ss->flip_map + ss->flip_count;
+        memcpy(ss->flip_map, flip_map, ss->flip_count);
+        memcpy(ss->flip_state, flip_state, ss->flip_count);
+    }
+
+    for(room_p r = World_GetRoomByID(ss->rooms_count); r; r = World_GetRoomByID(++ss->rooms_count));
+    ss->rooms = (uint32_t*)malloc(2 * ss->rooms_count * sizeof(uint32_t) + 1);
+    uint32_t alt_rooms_count = 0;
+    for(uint32_t id = 0; id < ss->rooms_count; ++id)
+    {
+        room_p r = World_GetRoomByID(id);
+        if(r->alternate_room_next || r->alternate_room_prev)
+        {
+            ss->rooms[2 * alt_rooms_count + 0] = id;
+            ss->rooms[2 * alt_rooms_count + 1] = r->content->original_room_id;
+            ++alt_rooms_count;
+        }
+    }
+    ss->rooms_count = alt_rooms_count;
+
+    ss->flipeffects_script_size = Script_GetFlipEffectsSaveData(engine_lua, Save_CopyScriptData, &ss->flipeffects_script);
+    World_IterateAllEntities(Save_CaptureEntity, ss);
+
+    return ss;
+}
+
+
+void Save_FreeSnapshot(save_snapshot_p ss)
+{
+    if(ss)
+    {
+        for(uint32_t i = 0; i < ss->entities_count; ++i)
+        {
+            save_entity_p se = ss->entities + i;
+            free(se->params);
+            free(se->bones);
+            free(se->anims);
+            free(se->items);
+            free(se->script);
+        }
+        free(ss->entities);
+        free(ss->flipeffects_script);
+        free(ss->rooms);
+        free(ss->flip_map);
+        free(ss);
+    }
+}
+
+
+/*
+ * Binary format
+ */
+static void Save_SerializeEntity(save_stream_p s, save_entity_p se)
+{
+    Save_WriteU32(s, se->id);
+    Save_WriteU32(s, se->flags);
+    Save_WriteU32(s, se->model_id);
+    Save_WriteU32(s, se->room_id);
+    Save_WriteFloats(s, se->pos, 3);
+    Save_WriteFloats(s, se->angles, 3);
+    Save_WriteU8(s, se->move_type);
+    Save_WriteU8(s, se->dir_flag);
+    Save_WriteU8(s, se->trigger_layout);
+    Save_WriteU8(s, se->collision_shape);
+    Save_WriteU16(s, se->collision_group);
+    Save_WriteU16(s, se->collision_mask);
+    Save_WriteU16(s, se->state_flags);
+    Save_WriteU16(s, se->type_flags);
+    Save_WriteU32(s, se->callback_flags);
+    Save_WriteFloats(s, &se->timer, 1);
+    Save_WriteFloats(s, &se->linear_speed, 1);
+    Save_WriteFloats(s, se->speed, 3);
+    if(se->flags & SAVE_ENTITY_ACTIVATION)
+    {
+        Save_WriteFloats(s, se->activation_offset, 4);
+        Save_WriteFloats(s, se->activation_direction, 4);
+    }
+    if(se->flags & SAVE_ENTITY_CHARACTER)
+    {
+        Save_WriteFloats(s, se->climb_point, 3);
+        Save_WriteU32(s, se->target_id);
+        Save_WriteU16(s, se->weapon_id);
+        Save_WriteU16(s, se->weapon_id_req);
+        Save_WriteU16(s, se->params_count);
+        Save_WriteFloats(s, se->params, 2 * se->params_count);
+    }
+
+    Save_WriteU16(s, se->bones_count);
+    for(uint16_t i = 0; i < se->bones_count; ++i)
+    {
+        save_bone_p sb = se->bones + i;
+        Save_WriteU8(s, sb->flags);
+        Save_WriteFloats(s, sb->target, 3);
+        Save_WriteFloats(s, sb->direction, 3);
+        Save_WriteFloats(s, sb->axis_mod, 3);
+        Save_WriteFloats(s, sb->limit, 4);
+        Save_WriteFloats(s, sb->current, 4);
+    }
+
+    Save_WriteU16(s, se->anims_count);
+    for(uint16_t i = 0; i < se->anims_count; ++i)
+    {
+        save_anim_p sa = se->anims + i;
+        Save_WriteU16(s, sa->type);
+        Save_WriteU16(s, sa->enabled);
+        Save_WriteU16(s, sa->anim_ext_flags);
+        Save_WriteU32(s, sa->model_id);
+        Save_WriteU16(s, sa->current_animation);
+        Save_WriteU16(s, sa->current_frame);
+        Save_WriteU16(s, sa->prev_animation);
+        Save_WriteU16(s, sa->prev_frame);
+        Save_WriteU16(s, sa->next_state);
+        Save_WriteU16(s, sa->next_state_heavy);
+    }
+
+    Save_WriteU32(s, se->items_count);
+    for(uint32_t i = 0; i < se->items_count; ++i)
+    {
+        Save_WriteU32(s, se->items[i].id);
+        Save_WriteU32(s, se->items[i].count);
+    }
+
+    Save_WriteU32(s, se->script_size);
+    Save_Write(s, se->script, se->script_size);
+}
+
+
+static void Save_SerializeSnapshot(save_stream_p s, save_snapshot_p ss)
+{
+    uint16_t path_len = strlen(ss->level_path);
+    Save_WriteU16(s, path_len);
+    Save_Write(s, ss->level_path, path_len);
+    Save_WriteU32(s, ss->game_id);
+    Save_WriteU32(s, ss->level_id);
+    Save_WriteU32(s, ss->global_flip_state);
+
+    Save_WriteU32(s, ss->flip_count);
+    Save_Write(s, ss->flip_map, ss->flip_count);
+    Save_Write(s, ss->flip_state, ss->flip_count);
+
+    Save_WriteU32(s, ss->rooms_count);
+    for(uint32_t i = 0; i < 2 * ss->rooms_count; ++i)
+    {
+        Save_WriteU32(s, ss->rooms[i]);
+    }
+
+    Save_WriteU32(s, ss->flipeffects_script_size);
+    Save_Write(s, ss->flipeffects_script, ss->flipeffects_script_size);
+
+    Save_WriteU32(s, ss->entities_count);
+    for(uint32_t i = 0; i < ss->entities_count; ++i)
+    {
+        Save_SerializeEntity(s, ss->entities + i);
+    }
+}
+
+
+static int Save_DeserializeEntity(save_stream_p s, save_entity_p se)
+{
+    se->id = Save_ReadU32(s);
+    se->flags = Save_ReadU32(s);
+    se->model_id = Save_ReadU32(s);
+    se->room_id = Save_ReadU32(s);
+    Save_ReadFloats(s, se->pos, 3);
+    Save_ReadFloats(s, se->angles, 3);
+    se->move_type = Save_ReadU8(s);
+    se->dir_flag = Save_ReadU8(s);
+    se->trigger_layout = Save_ReadU8(s);
+    se->collision_shape = Save_ReadU8(s);
+    se->collision_group = Save_ReadU16(s);
+    se->collision_mask = Save_ReadU16(s);
+    se->state_flags = Save_ReadU16(s);
+    se->type_flags = Save_ReadU16(s);
+    se->callback_flags = Save_ReadU32(s);
+    Save_ReadFloats(s, &se->timer, 1);
+    Save_ReadFloats(s, &se->linear_speed, 1);
+    Save_ReadFloats(s, se->speed, 3);
+    if(se->flags & SAVE_ENTITY_ACTIVATION)
+    {
+        Save_ReadFloats(s, se->activation_offset, 4);
+        Save_ReadFloats(s, se->activation_direction, 4);
+    }
+    if(se->flags & SAVE_ENTITY_CHARACTER)
+    {
+        Save_ReadFloats(s, se->climb_point, 3);
+        se->target_id = Save_ReadU32(s);
+        se->weapon_id = Save_ReadU16(s);
+        se->weapon_id_req = Save_ReadU16(s);
+        se->params_count = Save_ReadU16(s);
+        se->params = (float*)Save_ReadAlloc(s, 2 * se->params_count, 4, sizeof(float));
+        if(se->params)
+        {
+            Save_ReadFloats(s, se->params, 2 * se->params_count);
+        }
+    }
+
+    se->bones_count = Save_ReadU16(s);
+    se->bones = (save_bone_p)Save_ReadAlloc(s, se->bones_count, 69, sizeof(save_bone_t));
+    for(uint16_t i = 0; se->bones && (i < se->bones_count); ++i)
+    {
+        save_bone_p sb = se->bones + i;
+        sb->flags = Save_ReadU8(s);
+        Save_ReadFloats(s, sb->target, 3);
+        Save_ReadFloats(s, sb->direction, 3);
+        Save_ReadFloats(s, sb->axis_mod, 3);
+        Save_ReadFloats(s, sb->limit, 4);
+        Save_ReadFloats(s, sb->current, 4);
+    }
+
+    se->anims_count = Save_ReadU16(s);
+    se->anims = (save_anim_p)Save_ReadAlloc(s, se->anims_count, 22, sizeof(save_anim_t));
+    for(uint16_t i = 0; se->anims && (i < se->anims_count); ++i)
+    {
+        save_anim_p sa = se->anims + i;
+        sa->type = Save_ReadU16(s);
+        sa->enabled = Save_ReadU16(s);
+        sa->anim_ext_flags = Save_ReadU16(s);
+        sa->model_id = Save_ReadU32(s);
+        sa->current_animation = Save_ReadU16(s);
+        sa->current_frame = Save_ReadU16(s);
+        sa->prev_animation = Save_ReadU16(s);
+        sa->prev_frame = Save_ReadU16(s);
+        sa->next_state = Save_ReadU16(s);
+        sa->next_state_heavy = Save_ReadU16(s);
+    }
+
+    se->items_count = Save_ReadU32(s);
+    se->items = (save_item_p)Save_ReadAlloc(s, se->items_count, 8, sizeof(save_item_t));
+    for(uint32_t i = 0; se->items && (i < se->items_count); ++i)
+    {
+        se->items[i].id = Save_ReadU32(s);
+        se->items[i].count = Save_ReadU32(s);
+    }
+
+    se->script_size = Save_ReadU32(s);
+    se->script = Save_ReadString(s, se->script_size);
+
+    return !s->error;
+}
+
+
+static save_snapshot_p Save_DeserializeSnapshot(save_stream_p s)
+{
+    save_snapshot_p ss = (save_snapshot_p)calloc(1, sizeof(save_snapshot_t));
+    uint16_t path_len = Save_ReadU16(s);
+    const uint8_t *path = Save_Read(s, path_len);
+    if(path && (path_len < sizeof(ss->level_path)))
+    {
+        memcpy(ss->level_path, path, path_len);
+    }
+    else
+    {
+        s->error = 1;
+    }
+    ss->game_id = Save_ReadU32(s);
+    ss->level_id = Save_ReadU32(s);
+    ss->global_flip_state = Save_ReadU32(s);
+
+    ss->flip_count = Save_ReadU32(s);
+    s->error |= (ss->flip_count > s->size);
+    ss->flip_map = (uint8_t*)Save_ReadAlloc(s, 2 * ss->flip_count, 1, 1);
+    const uint8_t *flips = Save_Read(s, 2 * ss->flip_count);
+    if(ss->flip_map && flips)
+    {
+        ss->flip_state = ss->flip_map + ss->flip_count;
+        memcpy(ss->flip_map, flips, 2 * ss->flip_count);
+    }
+
+    ss->rooms_count = Save_ReadU32(s);
+    s->error |= (ss->rooms_count > s->size);
+    ss->rooms = (uint32_t*)Save_ReadAlloc(s, 2 * ss->rooms_count, 4, sizeof(uint32_t));
+    for(uint32_t i = 0; ss->rooms && (i < 2 * ss->rooms_count); ++i)
+    {
+        ss->rooms[i] = Save_ReadU32(s);
+    }
+
+    ss->flipeffects_script_size = Save_ReadU32(s);
+    ss->flipeffects_script = Save_ReadString(s, ss->flipeffects_script_size);
+
+    uint32_t entities_count = Save_ReadU32(s);
+    ss->entities = (save_entity_p)Save_ReadAlloc(s, entities_count, 60, sizeof(save_entity_t));
+    for(uint32_t i = 0; ss->entities && (i < entities_count) && !s->error; ++i)
+    {
+        ss->entities_count++;
+        Save_DeserializeEntity(s, ss->entities + i);
+    }
+
+    if(s->error)
+    {
+        Save_FreeSnapshot(ss);
+        ss = NULL;
+    }
+
+    return ss;
+}
+
+
+/*
+ * Lua script export, same commands as old saves had
+ */
+static void Save_ExportEntity(FILE *f, save_entity_p se)
+{
+    int is_character = (se->flags & SAVE_ENTITY_CHARACTER) != 0;
+    if(se->flags & SAVE_ENTITY_SPAWNED)
+    {
+        fprintf(f, "\nspawnEntity(%d, 0x%X, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %d);", se->model_id, se->room_id,
+                se->pos[0], se->pos[1], se->pos[2], se->angles[0], se->angles[1], se->angles[2], se->id);
+    }
+    else
+    {
+        fprintf(f, "\nsetEntityPos(%d, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f);", se->id,
+                se->pos[0], se->pos[1], se->pos[2], se->angles[0], se->angles[1], se->angles[2]);
+    }
+
+    if(se->flags & SAVE_ENTITY_IN_ROOM)
+    {
+        fprintf(f, "\nsetEntityRoomMove(%d, %d, %d, %d);", se->id, se->room_id, se->move_type, se->dir_flag);
+    }
+    else
+    {
+        fprintf(f, "\nsetEntityRoomMove(%d, nil, %d, %d);", se->id, se->move_type, se->dir_flag);
+    }
+
+    if(se->flags & SAVE_ENTITY_BASE_MODEL)
+    {
+        fprintf(f, "\nsetEntityBaseAnimModel(%d, %d);", se->id, se->model_id);
+    }
+
+    if(se->flags & SAVE_ENTITY_ACTIVATION)
+    {
+        float *v = se->activation_offset;
+        fprintf(f, "\nsetEntityActivationOffset(%d, %.4f, %.4f, %.4f, %.4f);", se->id, v[0], v[1], v[2], v[3]);
+        v = se->activation_direction;
+        fprintf(f, "\nsetEntityActivationDirection(%d, %.4f, %.4f, %.4f, %.4f);", se->id, v[0], v[1], v[2], v[3]);
+    }
+
+    for(uint16_t i = 0; i < se->bones_count; ++i)
+    {
+        save_bone_p sb = se->bones + i;
+        if(sb->flags & SAVE_BONE_HIDDEN)
+        {
+            fprintf(f, "\nsetEntityBoneVisibility(%d, %d, false);", se->id, i);
+        }
+        if(is_character)
+        {
+            if(sb->flags & SAVE_BONE_TARGETED)
+            {
+                fprintf(f, "\nentitySSAnimSetTarget(%d, %d, %.2f, %.2f, %.2f, %.6f, %.6f, %.6f);", se->id, i,
+                    sb->target[0], sb->target[1], sb->target[2],
+                    sb->direction[0], sb->direction[1], sb->direction[2]);
+            }
+            if(sb->flags & SAVE_BONE_AXIS_MODDED)
+            {
+                fprintf(f, "\nentitySSAnimSetAxisMod(%d, %d, %.6f, %.6f, %.6f);", se->id, i,
+                    sb->axis_mod[0], sb->axis_mod[1], sb->axis_mod[2]);
+            }
+            fprintf(f, "\nentitySSAnimSetTargetingLimit(%d, %d, %.6f, %.6f, %.6f, %.6f);", se->id, i,
+                sb->limit[0], sb->limit[1], sb->limit[2], sb->limit[3]);
+            fprintf(f, "\nentitySSAnimSetCurrentRotation(%d, %d, %.6f, %.6f, %.6f, %.6f);", se->id, i,
+                sb->current[0], sb->current[1], sb->current[2], sb->current[3]);
+        }
+    }
+
+    if(se->script_size > 0)
+    {
+        fprintf(f, "\n%s", se->script);
+    }
+
+    for(int i = (int)se->anims_count - 1; i >= 0; --i)
+    {
+        save_anim_p sa = se->anims + i;
+        if(sa->type != ANIM_TYPE_BASE)
+        {
+            if(sa->model_id != SAVE_NO_MODEL)
+            {
+                fprintf(f, "\nentitySSAnimEnsureExists(%d, %d, %d);", se->id, sa->type, sa->model_id);
+            }
+            else
+            {
+                fprintf(f, "\nentitySSAnimEnsureExists(%d, %d, nil);", se->id, sa->type);
+            }
+        }
+    }
+
+    fprintf(f, "\nremoveAllItems(%d);", se->id);
+    for(uint32_t i = 0; i < se->items_count; ++i)
+    {
+        fprintf(f, "\naddItem(%d, %d, %d);", se->id, se->items[i].id, se->items[i].count);
+    }
+
+    if(is_character)
+    {
+        fprintf(f, "\nsetCharacterClimbPoint(%d, %.2f, %.2f, %.2f);", se->id,
+                se->climb_point[0], se->climb_point[1], se->climb_point[2]);
+        if(se->target_id != ENTITY_ID_NONE)
+        {
+            fprintf(f, "\nsetCharacterTarget(%d, %d);", se->id, se->target_id);
+        }
+        else
+        {
+            fprintf(f, "\nsetCharacterTarget(%d);", se->id);
+        }
+
+        fprintf(f, "\nsetCharacterWeaponModel(%d, %d, %d, %d);", se->id, se->weapon_id, (se->flags & SAVE_ENTITY_WEAPON_READY) ? 2 : 0, se->weapon_id_req);
+        for(int i = 0; i < se->params_count; i++)
+        {
+            fprintf(f, "\nsetCharacterParam(%d, %d, %.2f, %.2f);", se->id, i, se->params[i], se->params[se->params_count + i]);
+        }
+    }
+
+    fprintf(f, "\nsetEntityLinearSpeed(%d, %.2f);", se->id, se->linear_speed);
+    fprintf(f, "\nsetEntitySpeed(%d, %.2f, %.2f, %.2f);", se->id, se->speed[0], se->speed[1], se->speed[2]);
+
+    fprintf(f, "\nsetEntityFlags(%d, 0x%.4X, 0x%.4X, 0x%.8X);", se->id, se->state_flags, se->type_flags, se->callback_flags);
+    fprintf(f, "\nsetEntityCollisionFlags(%d, %d, %d, %d);", se->id, se->collision_group, se->collision_shape, se->collision_mask);
+    fprintf(f, "\nsetEntityTriggerLayout(%d, 0x%.2X);", se->id, se->trigger_layout);
+    fprintf(f, "\nsetEntityTimer(%d, %.3f);", se->id, se->timer);
+
+    for(uint16_t i = 0; i < se->anims_count; ++i)
+    {
+        save_anim_p sa = se->anims + i;
+        if(sa->model_id != SAVE_NO_MODEL)
+        {
+            fprintf(f, "\nsetEntityAnim(%d, %d, %d, %d, %d, %d);", se->id, sa->type, sa->current_animation, sa->current_frame, sa->prev_animation, sa->prev_frame);
+            fprintf(f, "\nsetEntityAnimStateHeavy(%d, %d, %d);", se->id, sa->type, sa->next_state_heavy);
+            fprintf(f, "\nsetEntityAnimState(%d, %d, %d);", se->id, sa->type, sa->next_state);
+            fprintf(f, "\nentitySSAnimSetExtFlags(%d, %d, %d, %d);", se->id, sa->type, sa->enabled, sa->anim_ext_flags);
+            fprintf(f, "\nentitySSAnimSetEnable(%d, %d, %d);", se->id, sa->type, sa->enabled);
+        }
+    }
+
+    if(se->flags & SAVE_ENTITY_NO_FIX_ALL)
+    {
+        fprintf(f, "\nnoFixEntityCollision(%d, true);", se->id);
+    }
+    if(se->flags & SAVE_ENTITY_NO_MOVE)
+    {
+        fprintf(f, "\nnoEntityMove(%d, true);", se->id);
+    }
+}
+
+
+static void Save_ExportSnapshot(FILE *f, save_snapshot_p ss)
+{
+    fprintf(f, "loadMap(\"%s\", %d, %d);\n", ss->level_path, ss->game_id, ss->level_id);
+
+    for(uint32_t i = 0; i < ss->flip_count; i++)
+    {
+        fprintf(f, "setFlipMap(%d, 0x%02X, 0);\n", i, ss->flip_map[i]);
+        fprintf(f, "setFlipState(%d, %d);\n", i, ss->flip_state[i]);
+    }
+    if(ss->global_flip_state >= 0)
+    {
+        fprintf(f, "setGlobalFlipState(%d);\n", ss->global_flip_state);
+    }
+
+    for(uint32_t i = 0; i < ss->rooms_count; i++)
+    {
+        fprintf(f, "setRoomActiveContent(%d, %d);\n", ss->rooms[2 * i + 0], ss->rooms[2 * i + 1]);
+    }
+
+    if(ss->flipeffects_script_size > 0)
+    {
+        fprintf(f, "\n%s\n", ss->flipeffects_script);
+    }
+
+    for(uint32_t i = 0; i < ss->entities_count; ++i)
+    {
+        Save_ExportEntity(f, ss->entities + i);
+    }
+}
+
+
+/*
+ * Background writer
+ */
+static int Save_WriteBinary(FILE *f, save_snapshot_p ss)
+{
+    save_stream_t s = {NULL, 0, SAVE_HEADER_SIZE, 0};
+    save_stream_t header = {NULL, 0, 0, 0};
+    uint8_t *payload = NULL;
+    uLongf payload_size = 0;
+    uint32_t flags = 0;
+    int ret = 0;
+
+    Save_SerializeSnapshot(&s, ss);
+    if(!s.error)
+    {
+        uLong raw_size = s.pos - SAVE_HEADER_SIZE;
+        payload = s.data + SAVE_HEADER_SIZE;
+        payload_size = raw_size;
+
+        uLongf packed_size = compressBound(raw_size);
+        uint8_t *packed = (uint8_t*)malloc(packed_size);
+        if(packed && (Z_OK == compress2(packed, &packed_size, payload, raw_size, Z_BEST_SPEED)) && (packed_size < raw_size))
+        {
+            memcpy(payload, packed, packed_size);                               // packed is shorter, so it fits
+            payload_size = packed_size;
+            flags |= SAVE_FILE_COMPRESSED;
+        }
+        free(packed);
+
+        Save_Write(&header, SAVE_MAGIC, 4);
+        Save_WriteU32(&header, SAVE_VERSION);
+        Save_WriteU32(&header, flags);
+        Save_WriteU32(&header, raw_size);
+        Save_WriteU32(&header, payload_size);
+        memcpy(s.data, header.data, SAVE_HEADER_SIZE);
+        ret = (1 == fwrite(s.data, SAVE_HEADER_SIZE + payload_size, 1, f)) && !header.error;
+    }
+
+    free(header.data);
+    free(s.data);
+
+    return ret;
+}
+
+
+static void *Save_WriterThread(void *data)
+{
+    char tmp_path[MAX_ENGINE_PATH + 8];
+    int ret = 0;
+    (void)data;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", save_writer.path);
+    FILE *f = fopen(tmp_path, "wb");
+    if(f)
+    {
+        if(save_writer.format == SAVE_FORMAT_LUA)
+        {
+            Save_ExportSnapshot(f, save_writer.snapshot);
+            ret = !ferror(f);
+        }
+        else
+        {
+            ret = Save_WriteBinary(f, save_writer.snapshot);
+        }
+        ret = (0 == fclose(f)) && ret;
+
+        // old save stays untouched if write failed
+        if(ret)
+        {
+            remove(save_writer.path);
+            ret = (0 == rename(tmp_path, save_writer.path));
+        }
+        else
+        {
+            remove(tmp_path);
+        }
+    }
+
+    Save_FreeSnapshot(save_writer.snapshot);
+    save_writer.snapshot = NULL;
+    save_writer.result = ret;
+    save_writer.is_done = 1;
+
+    return NULL;
+}
+
+
+static void Save_JoinWriter()
+{
+    if(save_writer.is_thread_run)
+    {
+        pthread_join(save_writer.thread, NULL);
+        save_writer.is_thread_run = 0;
+        if(!save_writer.result)
+        {
+            Sys_extWarn("Can not create file \"%s\"", save_writer.path);
+        }
+    }
+}
+
+
+int Save_WriteSnapshotAsync(save_snapshot_p ss, const char *path, int format)
+{
+    Save_JoinWriter();
+
+    strncpy(save_writer.path, path, sizeof(save_writer.path) - 1);
+    save_writer.path[sizeof(save_writer.path) - 1] = 0;
+    save_writer.format = format;
+    save_writer.snapshot = ss;
+    save_writer.result = 0;
+    save_writer.is_done = 0;
+    save_writer.is_thread_run = (0 == pthread_create(&save_writer.thread, NULL, Save_WriterThread, NULL));
+    if(!save_writer.is_thread_run)
+    {
+        Save_WriterThread(NULL);                                                // no threads - write it here
+        if(!save_writer.result)
+        {
+            Sys_extWarn("Can not create file \"%s\"", path);
+        }
+        return save_writer.result;
+    }
+
+    return 1;
+}
+
+
+void Save_WaitWrite()
+{
+    Save_JoinWriter();
+}
+
+
+void Save_CheckWrite()
+{
+    if(save_writer.is_thread_run && save_writer.is_done)
+    {
+        Save_JoinWriter();
+    }
+}
+
+
+/*
+ * Load
+ */
+static void Save_DoScript(const char *script, size_t size)
+{
+    if(script && (size > 0))
+    {
+        if(LUA_OK == luaL_loadbuffer(engine_lua, script, size, "save"))
+        {
+            lua_CallAndLog(engine_lua, 0, 0, 0);
+        }
+        else
+        {
+            Con_Warning("%s", lua_tostring(engine_lua, -1));
+            lua_pop(engine_lua, 1);
+        }
+    }
+}
+
+
+static void Save_ApplyEntity(save_entity_p se)
+{
+    entity_p ent;
+
+    if(se->flags & SAVE_ENTITY_SPAWNED)
+    {
+        World_SpawnEntity(se->model_id, se->room_id, se->pos, se->angles, se->id);
+        ent = World_GetEntityByID(se->id);
+    }
+    else if((ent = World_GetEntityByID(se->id)))
+    {
+        vec3_copy(ent->transform.M4x4 + 12, se->pos);
+        vec3_copy(ent->transform.angles, se->angles);
+        Entity_UpdateTransform(ent);
+        Entity_UpdateRigidBody(ent, 1);
+    }
+
+    if(!ent)
+    {
+        Con_Warning("no entity with id = %d", se->id);
+        return;
+    }
+
+    room_p room = (se->flags & SAVE_ENTITY_IN_ROOM) ? (World_GetRoomByID(se->room_id)) : (NULL);
+    Entity_SetRoomMove(ent, room, se->move_type, se->dir_flag);
+
+    if(se->flags & SAVE_ENTITY_BASE_MODEL)
+    {
+        Entity_SetBaseAnimModel(ent, World_GetModelByID(se->model_id));
+    }
+
+    if(se->flags & SAVE_ENTITY_ACTIVATION)
+    {
+        Entity_SetActivationOffset(ent, se->activation_offset, 4);
+        vec4_copy(ent->activation_point->direction, se->activation_direction);
+    }
+
+    for(uint16_t i = 0; (i < se->bones_count) && (i < ent->bf->bone_tag_count); ++i)
+    {
+        ss_bone_tag_p b_tag = ent->bf->bone_tags + i;
+        save_bone_p sb = se->bones + i;
+        if(sb->flags & SAVE_BONE_HIDDEN)
+        {
+            b_tag->is_hidden = 0x01;
+        }
+        if(se->flags & SAVE_ENTITY_CHARACTER)
+        {
+            if(sb->flags & SAVE_BONE_TARGETED)
+            {
+                SSBoneFrame_SetTarget(b_tag, sb->target, sb->direction);
+            }
+            if(sb->flags & SAVE_BONE_AXIS_MODDED)
+            {
+                SSBoneFrame_SetTargetingAxisMod(b_tag, sb->axis_mod);
+            }
+            SSBoneFrame_SetTargetingLimit(b_tag, sb->limit);
+            vec4_copy(b_tag->mod.current, sb->current);
+        }
+    }
+
+    Save_DoScript(se->script, se->script_size);
+
+    for(int i = (int)se->anims_count - 1; i >= 0; --i)
+    {
+        save_anim_p sa = se->anims + i;
+        if((sa->type != ANIM_TYPE_BASE) && !SSBoneFrame_GetOverrideAnim(ent->bf, sa->type))
+        {
+            skeletal_model_p model = (sa->model_id != SAVE_NO_MODEL) ? (World_GetModelByID(sa->model_id)) : (NULL);
+            SSBoneFrame_AddOverrideAnim(ent->bf, model, sa->type);
+        }
+    }
+
+    Inventory_RemoveAllItems(&ent->inventory);
+    for(uint32_t i = 0; i < se->items_count; ++i)
+    {
+        Inventory_AddItem(&ent->inventory, se->items[i].id, se->items[i].count);
+    }
+
+    if((se->flags & SAVE_ENTITY_CHARACTER) && ent->character)
+    {
+        vec3_copy(ent->character->climb.point, se->climb_point);
+        ent->character->target_id = se->target_id;
+        if(ent->character->set_weapon_model_func)
+        {
+            ent->character->set_weapon_model_func(ent, se->weapon_id, (se->flags & SAVE_ENTITY_WEAPON_READY) ? 2 : 0);
+            ent->character->weapon_id_req = se->weapon_id_req;
+        }
+        for(int i = 0; (i < se->params_count) && (i < PARAM_LASTINDEX); i++)
+        {
+            ent->character->parameters.param[i] = se->params[i];
+            ent->character->parameters.maximum[i] = se->params[se->params_count + i];
+        }
+    }
+
+    ent->linear_speed = se->linear_speed;
+    vec3_copy(ent->speed, se->speed);
+
+    Entity_SetStateFlags(ent, se->state_flags);
+    ent->type_flags = se->type_flags;
+    ent->callback_flags = se->callback_flags;
+
+    ent->self->collision_group = se->collision_group;
+    ent->self->collision_shape = se->collision_shape;
+    ent->self->collision_mask = se->collision_mask;
+    if(Physics_GetBodiesCount(ent->physics) != ent->bf->bone_tag_count)
+    {
+        ent->self->collision_shape = COLLISION_SHAPE_SINGLE_BOX;
+    }
+    ent->trigger_layout = se->trigger_layout;
+    ent->timer = se->timer;
+
+    for(uint16_t i = 0; i < se->anims_count; ++i)
+    {
+        save_anim_p sa = se->anims + i;
+        ss_animation_p ss_anim = SSBoneFrame_GetOverrideAnim(ent->bf, sa->type);
+        if((sa->model_id == SAVE_NO_MODEL) || !ss_anim)
+        {
+            continue;
+        }
+
+        if(ss_anim->model)
+        {
+            Anim_SetAnimation(ss_anim, sa->current_animation, sa->current_frame);
+            Anim_SetPrevAnimation(ss_anim, sa->prev_animation, sa->prev_frame);
+        }
+        SSBoneFrame_Update(ent->bf, 0.0f);
+
+        ss_anim->next_state_heavy = sa->next_state_heavy;
+        ss_anim->next_state = sa->next_state;
+        ss_anim->anim_ext_flags = sa->anim_ext_flags;
+        if(sa->enabled)
+        {
+            SSBoneFrame_EnableOverrideAnimByType(ent->bf, sa->type);
+        }
+        else
+        {
+            SSBoneFrame_DisableOverrideAnimByType(ent->bf, sa->type);
+        }
+    }
+
+    if(se->flags & SAVE_ENTITY_NO_FIX_ALL)
+    {
+        ent->no_fix_all = 0x01;
+    }
+    if(se->flags & SAVE_ENTITY_NO_MOVE)
+    {
+        ent->no_move = 0x01;
+    }
+}
+
+
+static int Save_ApplySnapshot(save_snapshot_p ss)
+{
+    if(!Gameflow_SetMap(ss->level_path, ss->game_id, ss->level_id))
+    {
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < ss->flip_count; i++)
+    {
+        World_SetFlipMap(i, ss->flip_map[i], 0);
+        World_SetFlipState(i, ss->flip_state[i]);
+    }
+    if(ss->global_flip_state >= 0)
+    {
+        World_SetGlobalFlipState(ss->global_flip_state);
+    }
+
+    for(uint32_t i = 0; i < ss->rooms_count; i++)
+    {
+        room_p r1 = World_GetRoomByID(ss->rooms[2 * i + 0]);
+        room_p r2 = World_GetRoomByID(ss->rooms[2 * i + 1]);
+        if(r1 && r2 && (r1->content->original_room_id != r2->id))
+        {
+            Room_SetActiveContent(r1, r2);
+        }
+    }
+
+    Save_DoScript(ss->flipeffects_script, ss->flipeffects_script_size);
+
+    for(uint32_t i = 0; i < ss->entities_count; ++i)
+    {
+        Save_ApplyEntity(ss->entities + i);
+    }
+
+    return 1;
+}
+
+
+static uint8_t *Save_ReadFile(const char *path, size_t *size)
+{
+    uint8_t *ret = NULL;
+    FILE *f = fopen(path, "rb");
+    if(f)
+    {
+        fseek(f, 0, SEEK_END);
+        long file_size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if(file_size > 0)
+        {
+            ret = (uint8_t*)malloc(file_size);
+            if(ret && (1 != fread(ret, file_size, 1, f)))
+            {
+                free(ret);
+                ret = NULL;
+            }
+            *size = file_size;
+        }
+        fclose(f);
+    }
+
+    return ret;
+}
+
+
+int Save_IsSnapshotFile(const char *path)
+{
+    char magic[4];
+    int ret = 0;
+    FILE *f = fopen(path, "rb");
+    if(f)
+    {
+        ret = (1 == fread(magic, 4, 1, f)) && !strncmp(magic, SAVE_MAGIC, 4);
+        fclose(f);
+    }
+
+    return ret;
+}
+
+
+int Save_LoadSnapshot(const char *path)
+{
+    save_stream_t s = {NULL, 0, 0, 0};
+    save_snapshot_p ss = NULL;
+    int ret = 0;
+
+    s.data = Save_ReadFile(path, &s.size);
+    if(s.data && (s.size >= SAVE_HEADER_SIZE) && !strncmp((const char*)s.data, SAVE_MAGIC, 4))
+    {
+        s.pos = 4;
+        uint32_t version = Save_ReadU32(&s);
+        uint32_t flags = Save_ReadU32(&s);
+        uLongf raw_size = Save_ReadU32(&s);
+        uint32_t stored_size = Save_ReadU32(&s);
+
+        if((version == SAVE_VERSION) && (stored_size == s.size - SAVE_HEADER_SIZE))
+        {
+            if(flags & SAVE_FILE_COMPRESSED)
+            {
+                uint8_t *raw = (uint8_t*)malloc(raw_size);
+                if(raw && (Z_OK == uncompress(raw, &raw_size, s.data + SAVE_HEADER_SIZE, stored_size)))
+                {
+                    free(s.data);
+                    s.data = raw;
+                    s.size = raw_size;
+                    s.pos = 0;
+                    ss = Save_DeserializeSnapshot(&s);
+                }
+                else
+                {
+                    free(raw);
+                }
+            }
+            else
+            {
+                ss = Save_DeserializeSnapshot(&s);
+            }
+        }
+    }
+    free(s.data);
+
+    if(ss)
+    {
+        Script_LuaClearTasks();
+        ret = Save_ApplySnapshot(ss);
+        Save_FreeSnapshot(ss);
+    }
+    else
+    {
+        Sys_extWarn("Broken save file \"%s\"", path);
+    }
+
+    return ret;
+}
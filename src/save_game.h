@@ -0,0 +1,35 @@
+
+#ifndef SAVE_GAME_H
+#define SAVE_GAME_H
+
+#include <stdint.h>
+
+/*
+ * Game state snapshots: captured on the main thread into plain memory, then
+ * written on a background thread as versioned binary (zlib compressed if it
+ * is shorter) or exported as old lua script text. Binary files start with
+ * SAVE_MAGIC, anything else is treated as lua script by loader.
+ */
+
+#define SAVE_MAGIC                  "OTSV"
+#define SAVE_VERSION                (1)
+
+#define SAVE_FORMAT_BINARY          (0)
+#define SAVE_FORMAT_LUA             (1)
+
+#define SAVE_FILE_COMPRESSED        (0x00000001)
+
+struct save_snapshot_s;
+
+struct save_snapshot_s *Save_CaptureSnapshot();
+void Save_FreeSnapshot(struct save_snapshot_s *ss);
+
+/* Owns ss after call; waits for the previous write to finish first. */
+int  Save_WriteSnapshotAsync(struct save_snapshot_s *ss, const char *path, int format);
+void Save_WaitWrite();
+void Save_CheckWrite();                                                         // reports finished write, never blocks
+
+int  Save_IsSnapshotFile(const char *path);
+int  Save_LoadSnapshot(const char *path);
+
+#endif
@@ -16,6 +16,7 @@ extern "C" {
 #include "../core/vmath.h"
 #include "../render/camera.h"
 #include "../render/render.h"
+#include "../physics/physics.h"
 #include "../state_control/state_control.h"
 #include "../vt/tr_versions.h"
 #include "../skeletal_model.h"
@@ -206,13 +207,47 @@ int Script_UseItem(lua_State *lua, int item_id, int activator_id)
 }
 
 
+/*
+ * Calls task function with the rest arguments and returns its results;
+ * every task is profiled in its own entry.
+ */
+static int lua_CallTask(lua_State *lua)
+{
+    script_profile_sample_t sample;
+    char name[SCRIPT_PROFILE_NAME_SIZE];
+    int top = lua_gettop(lua);
+    int ret;
+
+    if((top < 1) || !lua_isfunction(lua, 1))
+    {
+        return 0;
+    }
+
+    Script_ProfileFuncName(lua, 1, "task ", name);
+    Script_ProfileBegin(&sample);
+    ret = lua_pcall(lua, top - 1, LUA_MULTRET, 0);
+    Script_ProfileEnd(&sample, name);
+    if(ret != LUA_OK)
+    {
+        return lua_error(lua);                                                  // keeps the task error for doTasks caller
+    }
+
+    return lua_gettop(lua);
+}
+
+
 int Script_DoTasks(lua_State *lua, float time)
 {
+    script_profile_sample_t sample;
+
+    Script_ProfileBegin(&sample);
     lua_pushnumber(lua, time);
     lua_setglobal(lua, "frame_time");
+    Script_SyncEntityFuncs(lua);
 
     Script_CallVoidFunc(lua, "doTasks");
     Script_CallVoidFunc(lua, "clearKeys");
+    Script_ProfileEnd(&sample, "doTasks");
 
     return 0;
 }
@@ -445,6 +480,13 @@ int Script_ParseRender(lua_State *lua, struct render_settings_s *rs)
         rs->fog_end_depth = lua_tonumber(lua, -1);
         lua_pop(lua, 1);
 
+        lua_getfield(lua, -1, "use_pvs");                                      // optional, enabled by default
+        if(lua_isnumber(lua, -1))
+        {
+            rs->use_pvs = lua_tonumber(lua, -1);
+        }
+        lua_pop(lua, 1);
+
 
         lua_getfield(lua, -1, "fog_color");
         if(lua_istable(lua, -1))
@@ -477,6 +519,69 @@ int Script_ParseRender(lua_State *lua, struct render_settings_s *rs)
 }
 
 
+int Script_ParsePhysics(lua_State *lua, struct physics_settings_s *ps)
+{
+    if(lua)
+    {
+        int top = lua_gettop(lua);
+
+        lua_getglobal(lua, "physics");
+        if(lua_istable(lua, -1))                                                // old configs have no physics section
+        {
+            lua_getfield(lua, -1, "step_rate");
+            if(lua_isnumber(lua, -1))
+            {
+                ps->step_rate = lua_tonumber(lua, -1);
+            }
+            lua_pop(lua, 1);
+
+            lua_getfield(lua, -1, "max_substeps");
+            if(lua_isnumber(lua, -1))
+            {
+                ps->max_substeps = lua_tointeger(lua, -1);
+            }
+            lua_pop(lua, 1);
+        }
+
+        lua_settop(lua, top);
+        return 1;
+    }
+
+    return -1;
+}
+
+int Script_ParseScript(lua_State *lua, struct script_settings_s *ss)
+{
+    if(lua)
+    {
+        int top = lua_gettop(lua);
+
+        lua_getglobal(lua, "script");
+        if(lua_istable(lua, -1))                                                // old configs have no script section
+        {
+            lua_getfield(lua, -1, "gc_step_budget");
+            if(lua_isnumber(lua, -1))
+            {
+                lua_Integer budget = lua_tointeger(lua, -1);
+                ss->gc_step_budget = (budget > 0) ? (budget) : (0);
+            }
+            lua_pop(lua, 1);
+
+            lua_getfield(lua, -1, "profile");
+            if(lua_isnumber(lua, -1))
+            {
+                ss->profile = lua_tointeger(lua, -1);
+            }
+            lua_pop(lua, 1);
+        }
+
+        lua_settop(lua, top);
+        return 1;
+    }
+
+    return -1;
+}
+
 int Script_ParseConsole(lua_State *lua)
 {
     if(lua)
@@ -1033,7 +1138,7 @@ void Script_LoadConstants(lua_State *lua)
 bool Script_LuaInit()
 {
     bool ret = false;
-    engine_lua = luaL_newstate();
+    engine_lua = lua_newstate(Script_LuaAlloc, NULL);                          // counts allocations for profiler
 
     if(engine_lua)
     {
@@ -1099,6 +1204,7 @@ void Script_LuaRegisterFuncs(lua_State *lua)
     luaL_dostring(lua, CVAR_LUA_TABLE_NAME " = {};");
 
     lua_register(lua, "print", lua_print);
+    lua_register(lua, "callTask", lua_CallTask);
 
     lua_register(lua, "getActionState", lua_GetActionState);
     lua_register(lua, "getActionChange", lua_GetActionChange);
@@ -2,6 +2,9 @@
 #ifndef ENGINE_SCRIPT_H
 #define ENGINE_SCRIPT_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 struct screen_info_s;
 struct entity_s;
 struct lua_State;
@@ -16,7 +19,22 @@ struct lua_State;
 #define TICK_STOPPED        (1)
 #define TICK_ACTIVE         (2)
 
+typedef struct script_settings_s
+{
+    uint32_t    gc_step_budget;                                                 // us of incremental GC per frame, 0 - Lua's automatic GC
+    uint16_t    profile;                                                        // collect callbacks timings
+}script_settings_t, *script_settings_p;
+
+#define SCRIPT_PROFILE_NAME_SIZE        (32)
+
+typedef struct script_profile_sample_s
+{
+    uint64_t    ticks;
+    uint64_t    alloc;
+}script_profile_sample_t, *script_profile_sample_p;
+
 extern lua_State *engine_lua;
+extern struct script_settings_s script_settings;
 
 void Script_LoadConstants(lua_State *lua);
 bool Script_LuaInit();
@@ -38,8 +56,10 @@ bool  lua_CallWithError(lua_State *lua, int nargs, int nresults, int errfunc, co
 int Script_ParseScreen(lua_State *lua, struct screen_info_s *sc);
 int Script_ParseRender(lua_State *lua, struct render_settings_s *rs);
 int Script_ParseAudio(lua_State *lua, struct audio_settings_s *as);
+int Script_ParsePhysics(lua_State *lua, struct physics_settings_s *ps);
 int Script_ParseConsole(lua_State *lua);
 int Script_ParseControls(lua_State *lua, struct control_settings_s *cs);
+int Script_ParseScript(lua_State *lua, struct script_settings_s *ss);
 
 bool Script_GetOverridedSamplesInfo(lua_State *lua, int *num_samples, int *num_sounds, char *sample_name_mask);
 bool Script_GetOverridedSample(lua_State *lua, int sound_id, int *first_sample_number, int *samples_count);
@@ -50,16 +70,28 @@ int  Script_GetNumTracks(lua_State *lua);
 bool Script_GetSoundtrack(lua_State *lua, int track_index, char *track_path, int file_path_len, int *load_method, int *stream_type);
 bool Script_GetString(lua_State *lua, int string_index, size_t string_size, char *buffer);
 
+void Script_SyncEntityFuncs(lua_State *lua);
 void Script_LoopEntity(lua_State *lua, struct entity_s *ent);
 int Script_UseItem(lua_State *lua, int item_id, int activator_id);
 int  Script_ExecEntity(lua_State *lua, int id_callback, int id_object, int id_activator = -1);
 int  Script_EntityUpdateCollisionInfo(lua_State *lua, int id, struct collision_node_s *cn);
-size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, char *buf, size_t buf_size);
+typedef void (*script_save_data_func_t)(void *data, const char *str, size_t size);
+size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, script_save_data_func_t out, void *data);
 void Script_DoFlipEffect(lua_State *lua, int id_effect, int id_object, int param);
-size_t Script_GetFlipEffectsSaveData(lua_State *lua, char *buf, size_t buf_size);
+size_t Script_GetFlipEffectsSaveData(lua_State *lua, script_save_data_func_t out, void *data);
 int  Script_DoTasks(lua_State *lua, float time);
 bool Script_CallVoidFunc(lua_State *lua, const char* func_name, bool destroy_after_call = false);
 
 void Script_AddKey(lua_State *lua, int keycode, int state);
 
+/* Callbacks profiler and GC control */
+void *Script_LuaAlloc(void *ud, void *ptr, size_t osize, size_t nsize);
+void Script_ProfileBegin(struct script_profile_sample_s *sample);
+void Script_ProfileEnd(struct script_profile_sample_s *sample, const char *name);
+void Script_ProfileFuncName(lua_State *lua, int index, const char *prefix, char name[SCRIPT_PROFILE_NAME_SIZE]);
+void Script_ProfileReset();
+void Script_ProfilePrint();
+int  Script_ProfileDump(const char *file_name);
+void Script_GCStep(lua_State *lua);
+
 #endif
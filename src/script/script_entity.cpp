@@ -27,64 +27,300 @@ extern "C" {
 #include "../engine.h"
 
 
-int Script_ExecEntity(lua_State *lua, int id_callback, int id_object, int id_activator)
+/*
+ * C side cache of entity_funcs: the global table is replaced by a proxy, so
+ * every entity_funcs[id] assignment updates the entity slot. Entity tables
+ * track first assignment of callbacks, so entities without needed callback
+ * are skipped without any Lua access.
+ */
+#define SCRIPT_ENTITY_CALLBACK_LOOP                 (0x00000080)
+
+typedef struct script_entity_slot_s
+{
+    int                         table_ref;                                      // entity_funcs[id] or LUA_NOREF
+    const void                 *table;
+    uint32_t                    callbacks;                                      // callbacks that may be set
+    uint32_t                    tracked;                                        // callbacks assignment is tracked by metatable
+}script_entity_slot_t, *script_entity_slot_p;
+
+static struct
+{
+    lua_State                  *lua;
+    const void                 *proxy;                                          // installed entity_funcs
+    int                         storage_ref;                                    // real entity_funcs contents
+    uint32_t                    slots_count;
+    struct script_entity_slot_s *slots;
+} script_entity_funcs = {NULL, NULL, LUA_NOREF, 0, NULL};
+
+static const struct
+{
+    uint32_t                    flag;
+    const char                 *name;
+} script_entity_callbacks[] =
+{
+    {ENTITY_CALLBACK_ACTIVATE,      "onActivate"},
+    {ENTITY_CALLBACK_DEACTIVATE,    "onDeactivate"},
+    {ENTITY_CALLBACK_COLLISION,     "onCollide"},
+    {ENTITY_CALLBACK_STAND,         "onStand"},
+    {ENTITY_CALLBACK_HIT,           "onHit"},
+    {ENTITY_CALLBACK_ATTACK,        "onAttack"},
+    {ENTITY_CALLBACK_SHOOT,         "onShoot"},
+    {SCRIPT_ENTITY_CALLBACK_LOOP,   "onLoop"},
+    {ENTITY_CALLBACK_NONE,          NULL}
+};
+
+
+static const char *Script_GetEntityCallbackName(uint32_t flag)
+{
+    for(int i = 0; script_entity_callbacks[i].name; i++)
+    {
+        if(script_entity_callbacks[i].flag == flag)
+        {
+            return script_entity_callbacks[i].name;
+        }
+    }
+    return NULL;
+}
+
+
+static int lua_EntityFuncsTableNewIndex(lua_State *lua)
+{
+    uint32_t id = lua_tointeger(lua, lua_upvalueindex(1));
+    const char *key = (lua_type(lua, 2) == LUA_TSTRING) ? (lua_tostring(lua, 2)) : (NULL);
+
+    if(key && !lua_isnil(lua, 3) && (id < script_entity_funcs.slots_count) &&
+       (script_entity_funcs.slots[id].table == lua_topointer(lua, 1)))
+    {
+        for(int i = 0; script_entity_callbacks[i].name; i++)
+        {
+            if(!strcmp(key, script_entity_callbacks[i].name))
+            {
+                script_entity_funcs.slots[id].callbacks |= script_entity_callbacks[i].flag;
+                break;
+            }
+        }
+    }
+    lua_rawset(lua, 1);
+
+    return 0;
+}
+
+
+static void Script_SetEntityFuncsSlot(lua_State *lua, uint32_t id, int value)
+{
+    script_entity_slot_p slot;
+
+    if(id >= script_entity_funcs.slots_count)
+    {
+        if(!lua_istable(lua, value))
+        {
+            return;
+        }
+        uint32_t new_count = id + 64;
+        script_entity_funcs.slots = (script_entity_slot_p)realloc(script_entity_funcs.slots, new_count * sizeof(script_entity_slot_t));
+        for(uint32_t i = script_entity_funcs.slots_count; i < new_count; i++)
+        {
+            script_entity_funcs.slots[i].table_ref = LUA_NOREF;
+            script_entity_funcs.slots[i].table = NULL;
+            script_entity_funcs.slots[i].callbacks = ENTITY_CALLBACK_NONE;
+            script_entity_funcs.slots[i].tracked = 0;
+        }
+        script_entity_funcs.slots_count = new_count;
+    }
+
+    slot = script_entity_funcs.slots + id;
+    luaL_unref(lua, LUA_REGISTRYINDEX, slot->table_ref);
+    slot->table_ref = LUA_NOREF;
+    slot->table = NULL;
+    slot->callbacks = ENTITY_CALLBACK_NONE;
+    slot->tracked = 0;
+
+    if(lua_istable(lua, value))
+    {
+        value = lua_absindex(lua, value);
+        slot->table = lua_topointer(lua, value);
+        lua_pushvalue(lua, value);
+        slot->table_ref = luaL_ref(lua, LUA_REGISTRYINDEX);
+
+        if(lua_getmetatable(lua, value))
+        {
+            // foreign metatable, callbacks can not be tracked
+            lua_pop(lua, 1);
+            slot->callbacks = 0xFFFFFFFF;
+            return;
+        }
+
+        for(int i = 0; script_entity_callbacks[i].name; i++)
+        {
+            lua_pushstring(lua, script_entity_callbacks[i].name);
+            if(lua_rawget(lua, value) != LUA_TNIL)
+            {
+                slot->callbacks |= script_entity_callbacks[i].flag;
+            }
+            lua_pop(lua, 1);
+        }
+
+        lua_createtable(lua, 0, 1);
+        lua_pushinteger(lua, id);
+        lua_pushcclosure(lua, lua_EntityFuncsTableNewIndex, 1);
+        lua_setfield(lua, -2, "__newindex");
+        lua_setmetatable(lua, value);
+        slot->tracked = 1;
+    }
+}
+
+
+static int lua_EntityFuncsNewIndex(lua_State *lua)
+{
+    int is_num = 0;
+    lua_Integer id = lua_tointegerx(lua, 2, &is_num);
+
+    lua_pushvalue(lua, 2);
+    lua_pushvalue(lua, 3);
+    lua_rawset(lua, lua_upvalueindex(1));
+    if(is_num && (id >= 0) && (id <= 0xFFFFFFFF))
+    {
+        Script_SetEntityFuncsSlot(lua, id, 3);
+    }
+
+    return 0;
+}
+
+
+static int lua_EntityFuncsPairs(lua_State *lua)
+{
+    lua_getglobal(lua, "next");
+    lua_pushvalue(lua, lua_upvalueindex(1));
+    lua_pushnil(lua);
+
+    return 3;
+}
+
+
+/*
+ * Installs entity_funcs proxy, if the global table was (re)created by scripts.
+ */
+void Script_SyncEntityFuncs(lua_State *lua)
 {
     int top = lua_gettop(lua);
-    int ret = -1;
 
     lua_getglobal(lua, "entity_funcs");
-    if(!lua_istable(lua, -1))
+    if((script_entity_funcs.lua == lua) && script_entity_funcs.proxy && (lua_topointer(lua, -1) == script_entity_funcs.proxy))
     {
         lua_settop(lua, top);
-        return -1;
+        return;
     }
 
-    lua_rawgeti(lua, -1, id_object);
-    if(!lua_istable(lua, -1))
+    if(script_entity_funcs.lua == lua)
     {
-        lua_settop(lua, top);
-        return -1;
+        for(uint32_t i = 0; i < script_entity_funcs.slots_count; i++)
+        {
+            luaL_unref(lua, LUA_REGISTRYINDEX, script_entity_funcs.slots[i].table_ref);
+        }
+        luaL_unref(lua, LUA_REGISTRYINDEX, script_entity_funcs.storage_ref);
     }
+    free(script_entity_funcs.slots);
+    script_entity_funcs.slots = NULL;
+    script_entity_funcs.slots_count = 0;
+    script_entity_funcs.storage_ref = LUA_NOREF;
+    script_entity_funcs.proxy = NULL;
+    script_entity_funcs.lua = lua;
 
-    switch(id_callback)
+    if(lua_istable(lua, -1))
     {
-        case ENTITY_CALLBACK_ACTIVATE:
-            lua_pushstring(lua, "onActivate");
-            break;
+        int storage = lua_gettop(lua);
+        lua_pushvalue(lua, storage);
+        script_entity_funcs.storage_ref = luaL_ref(lua, LUA_REGISTRYINDEX);
 
-        case ENTITY_CALLBACK_DEACTIVATE:
-            lua_pushstring(lua, "onDeactivate");
-            break;
+        lua_newtable(lua);
+        script_entity_funcs.proxy = lua_topointer(lua, -1);
+        lua_createtable(lua, 0, 3);
+        lua_pushvalue(lua, storage);
+        lua_setfield(lua, -2, "__index");
+        lua_pushvalue(lua, storage);
+        lua_pushcclosure(lua, lua_EntityFuncsNewIndex, 1);
+        lua_setfield(lua, -2, "__newindex");
+        lua_pushvalue(lua, storage);
+        lua_pushcclosure(lua, lua_EntityFuncsPairs, 1);
+        lua_setfield(lua, -2, "__pairs");
+        lua_setmetatable(lua, -2);
+        lua_setglobal(lua, "entity_funcs");
 
-        case ENTITY_CALLBACK_COLLISION:
-            lua_pushstring(lua, "onCollide");
-            break;
+        lua_pushnil(lua);
+        while(lua_next(lua, storage))
+        {
+            if(lua_isinteger(lua, -2) && (lua_tointeger(lua, -2) >= 0))
+            {
+                Script_SetEntityFuncsSlot(lua, lua_tointeger(lua, -2), -1);
+            }
+            lua_pop(lua, 1);
+        }
+    }
 
-        case ENTITY_CALLBACK_STAND:
-            lua_pushstring(lua, "onStand");
-            break;
+    lua_settop(lua, top);
+}
 
-        case ENTITY_CALLBACK_HIT:
-            lua_pushstring(lua, "onHit");
-            break;
 
-        case ENTITY_CALLBACK_ATTACK:
-            lua_pushstring(lua, "onAttack");
-            break;
+/*
+ * Pushes entity_funcs[id] and returns 1 if it exists and may have the callback
+ * (ENTITY_CALLBACK_NONE - any table); nothing is pushed otherwise.
+ */
+static int Script_PushEntityFuncs(lua_State *lua, uint32_t id, uint32_t callback)
+{
+    if((script_entity_funcs.lua != lua) || !script_entity_funcs.proxy)
+    {
+        Script_SyncEntityFuncs(lua);
+    }
 
-        case ENTITY_CALLBACK_SHOOT:
-            lua_pushstring(lua, "onShoot");
-            break;
+    if(id < script_entity_funcs.slots_count)
+    {
+        script_entity_slot_p slot = script_entity_funcs.slots + id;
+        if((slot->table_ref != LUA_NOREF) && ((callback == ENTITY_CALLBACK_NONE) || (slot->callbacks & callback)))
+        {
+            lua_rawgeti(lua, LUA_REGISTRYINDEX, slot->table_ref);
+            return 1;
+        }
+    }
 
-        default:
-            lua_settop(lua, top);
-            return -1;
+    return 0;
+}
+
+
+/*
+ * Pushes callback function of entity, or returns 0 with unchanged stack.
+ */
+static int Script_PushEntityCallback(lua_State *lua, uint32_t id, uint32_t callback)
+{
+    const char *name = Script_GetEntityCallbackName(callback);
+    if(name && Script_PushEntityFuncs(lua, id, callback))
+    {
+        lua_pushstring(lua, name);
+        int type = lua_rawget(lua, -2);
+        if(type == LUA_TFUNCTION)
+        {
+            lua_remove(lua, -2);
+            return 1;
+        }
+        lua_pop(lua, 2);
+        if((type == LUA_TNIL) && script_entity_funcs.slots[id].tracked)
+        {
+            // only a removed key makes next assignment call __newindex again
+            script_entity_funcs.slots[id].callbacks &= ~callback;
+        }
     }
 
-    lua_rawget(lua, -2);
-    if(!lua_isfunction(lua, -1))
+    return 0;
+}
+
+
+int Script_ExecEntity(lua_State *lua, int id_callback, int id_object, int id_activator)
+{
+    int top = lua_gettop(lua);
+    int ret = -1;
+    script_profile_sample_t sample;
+
+    if((id_object < 0) || !Script_PushEntityCallback(lua, id_object, id_callback))
     {
-        lua_settop(lua, top);
         return -1;
     }
 
@@ -98,10 +334,12 @@ int Script_ExecEntity(lua_State *lua, int id_callback, int id_object, int id_act
         lua_pushnil(lua);
     }
 
+    Script_ProfileBegin(&sample);
     if(lua_pcall(lua, 2, 1, 0) == LUA_OK)
     {
         ret = lua_tointeger(lua, -1);
     }
+    Script_ProfileEnd(&sample, Script_GetEntityCallbackName(id_callback));
 
     lua_settop(lua, top);
 
@@ -113,17 +351,8 @@ int Script_EntityUpdateCollisionInfo(lua_State *lua, int id, struct collision_no
 {
     int top = lua_gettop(lua);
 
-    lua_getglobal(lua, "entity_funcs");
-    if(!lua_istable(lua, -1))
-    {
-        lua_settop(lua, top);
-        return 0;
-    }
-
-    lua_rawgeti(lua, -1, id);
-    if(!lua_istable(lua, -1))
+    if((id < 0) || !Script_PushEntityFuncs(lua, id, ENTITY_CALLBACK_NONE))
     {
-        lua_settop(lua, top);
         return 0;
     }
 
@@ -153,7 +382,7 @@ int Script_EntityUpdateCollisionInfo(lua_State *lua, int id, struct collision_no
 }
 
 
-size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, char *buf, size_t buf_size)
+size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, script_save_data_func_t out, void *data)
 {
     int top = lua_gettop(lua);
     size_t ret = 0;
@@ -164,7 +393,11 @@ size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, char *buf, size_t
         lua_pushinteger(lua, id_entity);
         if((lua_pcall(lua, 1, 1, 0) == LUA_OK) && lua_isstring(lua, -1))
         {
-            strncpy(buf, lua_tolstring(lua, -1, &ret), buf_size);
+            const char *str = lua_tolstring(lua, -1, &ret);
+            if(ret > 0)
+            {
+                out(data, str, ret);
+            }
         }
     }
     lua_settop(lua, top);
@@ -179,6 +412,8 @@ void Script_LoopEntity(lua_State *lua, struct entity_s *ent)
     {
         int top = lua_gettop(lua);
         int tick_state = TICK_ACTIVE;
+        script_profile_sample_t sample;
+        char name[SCRIPT_PROFILE_NAME_SIZE];
 
         if(ent->timer > 0.0f)
         {
@@ -194,31 +429,17 @@ void Script_LoopEntity(lua_State *lua, struct entity_s *ent)
             tick_state = TICK_IDLE;
         }
 
-        lua_getglobal(lua, "entity_funcs");
-        if(!lua_istable(lua, -1))
+        if(!Script_PushEntityCallback(lua, ent->id, SCRIPT_ENTITY_CALLBACK_LOOP))
         {
-            lua_settop(lua, top);
-            return;
-        }
-
-        lua_rawgeti(lua, -1, ent->id);
-        if(!lua_istable(lua, -1))
-        {
-            lua_settop(lua, top);
-            return;
-        }
-
-        lua_pushstring(lua, "onLoop");
-        lua_rawget(lua, -2);
-        if(!lua_isfunction(lua, -1))
-        {
-            lua_settop(lua, top);
             return;
         }
 
+        Script_ProfileFuncName(lua, -1, "onLoop ", name);
         lua_pushinteger(lua, ent->id);
         lua_pushinteger(lua, tick_state);
+        Script_ProfileBegin(&sample);
         lua_CallAndLog(lua, 2, 0, 0);
+        Script_ProfileEnd(&sample, name);
 
         lua_settop(lua, top);
     }
@@ -455,21 +676,13 @@ int lua_SetEntityActivationOffset(lua_State * lua)
         entity_p ent = World_GetEntityByID(lua_tointeger(lua, 1));
         if(ent)
         {
-            if(!ent->activation_point)
+            float offset[4];
+            int size = (top >= 5) ? (4) : ((top >= 4) ? (3) : (0));
+            for(int i = 0; i < size; i++)
             {
-                Entity_InitActivationPoint(ent);
-            }
-
-            if(top >= 4)
-            {
-                ent->activation_point->offset[0] = lua_tonumber(lua, 2);
-                ent->activation_point->offset[1] = lua_tonumber(lua, 3);
-                ent->activation_point->offset[2] = lua_tonumber(lua, 4);
-            }
-            if(top >= 5)
-            {
-                ent->activation_point->offset[3] = lua_tonumber(lua, 5);
+                offset[i] = lua_tonumber(lua, 2 + i);
             }
+            Entity_SetActivationOffset(ent, offset, size);
         }
         else
         {
@@ -1688,15 +1901,7 @@ int lua_SetEntityFlags(lua_State * lua)
         {
             if(!lua_isnil(lua, 2))
             {
-                ent->state_flags = lua_tointeger(lua, 2);
-                if(ent->state_flags & ENTITY_STATE_COLLIDABLE)
-                {
-                    Entity_EnableCollision(ent);
-                }
-                else
-                {
-                    Entity_DisableCollision(ent);
-                }
+                Entity_SetStateFlags(ent, lua_tointeger(lua, 2));
             }
             if(!lua_isnil(lua, 3))
             {
@@ -2018,28 +2223,10 @@ int lua_SetEntityRoomMove(lua_State * lua)
         entity_p ent = World_GetEntityByID(lua_tointeger(lua, 1));
         if(ent)
         {
-            room_p room = NULL;
-            if(!lua_isnil(lua, 2) && (room = World_GetRoomByID(lua_tointeger(lua, 2))))
-            {
-                if(ent->self->room != room)
-                {
-                    if(ent->self->room != NULL)
-                    {
-                        Room_RemoveObject(ent->self->room, ent->self);
-                    }
-                    Room_AddObject(room, ent->self);
-                }
-            }
-            Entity_UpdateRoomPos(ent);
-
-            if(!lua_isnil(lua, 3))
-            {
-                ent->move_type = lua_tointeger(lua, 3);
-            }
-            if(!lua_isnil(lua, 4))
-            {
-                ent->dir_flag = lua_tointeger(lua, 4);
-            }
+            room_p room = (!lua_isnil(lua, 2)) ? (World_GetRoomByID(lua_tointeger(lua, 2))) : (NULL);
+            uint16_t move_type = (!lua_isnil(lua, 3)) ? (lua_tointeger(lua, 3)) : (ent->move_type);
+            uint16_t dir_flag = (!lua_isnil(lua, 4)) ? (lua_tointeger(lua, 4)) : (ent->dir_flag);
+            Entity_SetRoomMove(ent, room, move_type, dir_flag);
         }
         else
         {
@@ -0,0 +1,325 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <SDL2/SDL_timer.h>
+
+extern "C" {
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+#include "script.h"
+#include "../core/gl_text.h"
+#include "../core/console.h"
+
+
+#define SCRIPT_PROFILE_MAX_ENTRIES      (128)
+
+typedef struct script_profile_entry_s
+{
+    char        name[SCRIPT_PROFILE_NAME_SIZE];
+    uint32_t    calls;
+    uint64_t    total_ticks;
+    uint64_t    max_ticks;
+    uint64_t    alloc_bytes;
+}script_profile_entry_t, *script_profile_entry_p;
+
+static struct
+{
+    uint64_t                    alloc_bytes;                                    // monotonic, grows in Script_LuaAlloc
+    uint16_t                    depth;                                          // nested callbacks are inclusive, count outer ones only for frame
+    uint16_t                    entries_count;
+    uint32_t                    frames;
+    uint64_t                    frame_ticks;
+    uint64_t                    frame_max_ticks;
+    uint64_t                    total_ticks;
+    script_profile_entry_t      entries[SCRIPT_PROFILE_MAX_ENTRIES];
+} script_profile = {0};
+
+static struct
+{
+    int         cycle_active;
+    int         idle_kb;                                                        // heap size after last finished cycle
+} script_gc = {0};
+
+script_settings_t script_settings = {0, 0};
+
+
+void *Script_LuaAlloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    (void)ud;
+    if(nsize == 0)
+    {
+        free(ptr);
+        return NULL;
+    }
+
+    if(ptr == NULL)
+    {
+        script_profile.alloc_bytes += nsize;                                    // osize holds the object type here
+    }
+    else if(nsize > osize)
+    {
+        script_profile.alloc_bytes += nsize - osize;
+    }
+
+    return realloc(ptr, nsize);
+}
+
+
+static script_profile_entry_p Script_ProfileGetEntry(const char *name)
+{
+    for(uint16_t i = 0; i < script_profile.entries_count; ++i)
+    {
+        if(!strncmp(script_profile.entries[i].name, name, SCRIPT_PROFILE_NAME_SIZE - 1))
+        {
+            return script_profile.entries + i;
+        }
+    }
+
+    if(script_profile.entries_count < SCRIPT_PROFILE_MAX_ENTRIES)
+    {
+        script_profile_entry_p ret = script_profile.entries + script_profile.entries_count++;
+        memset(ret, 0x00, sizeof(script_profile_entry_t));
+        strncpy(ret->name, name, SCRIPT_PROFILE_NAME_SIZE - 1);
+        return ret;
+    }
+
+    return NULL;
+}
+
+
+void Script_ProfileBegin(struct script_profile_sample_s *sample)
+{
+    if(script_settings.profile)
+    {
+        sample->ticks = SDL_GetPerformanceCounter();
+        sample->alloc = script_profile.alloc_bytes;
+        script_profile.depth++;
+    }
+    else
+    {
+        sample->ticks = 0;
+        sample->alloc = 0;
+    }
+}
+
+
+void Script_ProfileEnd(struct script_profile_sample_s *sample, const char *name)
+{
+    if(sample->ticks && script_profile.depth)
+    {
+        uint64_t ticks = SDL_GetPerformanceCounter() - sample->ticks;
+        script_profile_entry_p entry = Script_ProfileGetEntry(name);
+        if(entry)
+        {
+            entry->calls++;
+            entry->total_ticks += ticks;
+            entry->max_ticks = (ticks > entry->max_ticks) ? (ticks) : (entry->max_ticks);
+            entry->alloc_bytes += script_profile.alloc_bytes - sample->alloc;
+        }
+
+        if(--script_profile.depth == 0)
+        {
+            script_profile.frame_ticks += ticks;
+        }
+    }
+}
+
+
+/*
+ * Entry name of the Lua function at index: prefix, source file name and the
+ * line function is defined at, so every callback gets its own entry. File
+ * name is cut from the start to fit SCRIPT_PROFILE_NAME_SIZE.
+ */
+void Script_ProfileFuncName(lua_State *lua, int index, const char *prefix, char name[SCRIPT_PROFILE_NAME_SIZE])
+{
+    lua_Debug ar;
+
+    strncpy(name, prefix, SCRIPT_PROFILE_NAME_SIZE - 1);
+    name[SCRIPT_PROFILE_NAME_SIZE - 1] = 0;
+    if(!script_settings.profile)
+    {
+        return;                                                                 // name is not used
+    }
+
+    lua_pushvalue(lua, index);
+    if(lua_getinfo(lua, ">S", &ar))
+    {
+        char line[16];
+        const char *src = strrchr(ar.short_src, '/');
+        int line_len = snprintf(line, sizeof(line), ":%d", ar.linedefined);
+        int src_size = SCRIPT_PROFILE_NAME_SIZE - 1 - (int)strlen(name) - line_len;
+        int src_len;
+
+        src = (src) ? (src + 1) : (ar.short_src);
+        src_len = strlen(src);
+        if(src_size > 0)
+        {
+            src += (src_len > src_size) ? (src_len - src_size) : (0);
+            strncat(name, src, SCRIPT_PROFILE_NAME_SIZE - 1 - strlen(name));
+            strncat(name, line, SCRIPT_PROFILE_NAME_SIZE - 1 - strlen(name));
+        }
+    }
+}
+
+
+void Script_ProfileReset()
+{
+    uint64_t alloc_bytes = script_profile.alloc_bytes;
+    memset(&script_profile, 0x00, sizeof(script_profile));
+    script_profile.alloc_bytes = alloc_bytes;
+}
+
+
+static int Script_ProfileCompareEntries(const void *a, const void *b)
+{
+    const script_profile_entry_t *ea = (const script_profile_entry_t*)a;
+    const script_profile_entry_t *eb = (const script_profile_entry_t*)b;
+    if(ea->total_ticks != eb->total_ticks)
+    {
+        return (ea->total_ticks < eb->total_ticks) ? (1) : (-1);
+    }
+    return strcmp(ea->name, eb->name);
+}
+
+
+static double Script_ProfileTicksToUs(uint64_t ticks)
+{
+    return 1000000.0 * (double)ticks / (double)SDL_GetPerformanceFrequency();
+}
+
+
+/*
+ * Calls out(line) for the header and each entry, the most expensive ones first.
+ */
+static void Script_ProfileFormat(void (*out)(void *data, const char *line), void *data)
+{
+    char line[256];
+    uint32_t frames = (script_profile.frames) ? (script_profile.frames) : (1);
+
+    qsort(script_profile.entries, script_profile.entries_count, sizeof(script_profile_entry_t), Script_ProfileCompareEntries);
+    snprintf(line, sizeof(line), "script profile: %u frames, %.1f us/frame avg, %.1f us/frame max",
+             script_profile.frames, Script_ProfileTicksToUs(script_profile.total_ticks) / frames,
+             Script_ProfileTicksToUs(script_profile.frame_max_ticks));
+    out(data, line);
+    snprintf(line, sizeof(line), "%-31s %8s %12s %10s %10s %12s", "name", "calls", "total us", "avg us", "max us", "alloc bytes");
+    out(data, line);
+
+    for(uint16_t i = 0; i < script_profile.entries_count; ++i)
+    {
+        script_profile_entry_p e = script_profile.entries + i;
+        double total_us = Script_ProfileTicksToUs(e->total_ticks);
+        snprintf(line, sizeof(line), "%-31s %8u %12.1f %10.2f %10.1f %12llu", e->name, e->calls, total_us,
+                 (e->calls) ? (total_us / e->calls) : (0.0), Script_ProfileTicksToUs(e->max_ticks),
+                 (unsigned long long)e->alloc_bytes);
+        out(data, line);
+    }
+}
+
+
+static void Script_ProfileOutConsole(void *data, const char *line)
+{
+    (void)data;
+    Con_AddLine(line, FONTSTYLE_CONSOLE_INFO);
+}
+
+
+static void Script_ProfileOutFile(void *data, const char *line)
+{
+    fprintf((FILE*)data, "%s\n", line);
+}
+
+
+void Script_ProfilePrint()
+{
+    Script_ProfileFormat(Script_ProfileOutConsole, NULL);
+}
+
+
+int Script_ProfileDump(const char *file_name)
+{
+    FILE *f = fopen(file_name, "w");
+    if(f)
+    {
+        Script_ProfileFormat(Script_ProfileOutFile, f);
+        fclose(f);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Fixed point of the frame: closes profiler frame and runs the collector.
+ * With zero budget Lua's own incremental GC works inside allocations,
+ * else it is stopped and stepped here for no more than gc_step_budget us.
+ */
+void Script_GCStep(lua_State *lua)
+{
+    if(lua)
+    {
+        if(script_settings.gc_step_budget == 0)
+        {
+            if(!lua_gc(lua, LUA_GCISRUNNING, 0))
+            {
+                lua_gc(lua, LUA_GCRESTART, 0);
+                script_gc.cycle_active = 0;
+                script_gc.idle_kb = 0;
+            }
+        }
+        else
+        {
+            struct script_profile_sample_s sample;
+            int kb = lua_gc(lua, LUA_GCCOUNT, 0);
+
+            if(lua_gc(lua, LUA_GCISRUNNING, 0))
+            {
+                lua_gc(lua, LUA_GCSTOP, 0);
+            }
+
+            // like default 200% pause: a new cycle starts after heap doubles
+            if(!script_gc.cycle_active && (kb >= 2 * script_gc.idle_kb))
+            {
+                script_gc.cycle_active = 1;
+            }
+
+            if(script_gc.cycle_active)
+            {
+                // scripts allocate faster than budget allows: finish cycle now to keep heap bounded
+                int overdue = (script_gc.idle_kb > 0) && (kb >= 4 * script_gc.idle_kb);
+                uint64_t budget = SDL_GetPerformanceFrequency() * script_settings.gc_step_budget / 1000000;
+                uint64_t start = SDL_GetPerformanceCounter();
+
+                Script_ProfileBegin(&sample);
+                do
+                {
+                    if(lua_gc(lua, LUA_GCSTEP, 0))
+                    {
+                        script_gc.cycle_active = 0;
+                        script_gc.idle_kb = lua_gc(lua, LUA_GCCOUNT, 0);
+                        break;
+                    }
+                }
+                while(overdue || (SDL_GetPerformanceCounter() - start < budget));
+                Script_ProfileEnd(&sample, "(gc step)");
+            }
+        }
+    }
+
+    if(script_settings.profile)
+    {
+        script_profile.frames++;
+        script_profile.total_ticks += script_profile.frame_ticks;
+        if(script_profile.frame_ticks > script_profile.frame_max_ticks)
+        {
+            script_profile.frame_max_ticks = script_profile.frame_ticks;
+        }
+        script_profile.frame_ticks = 0;
+    }
+}
@@ -138,15 +138,7 @@ int lua_SetEntityBaseAnimModel(lua_State * lua)
         entity_p ent = World_GetEntityByID(lua_tointeger(lua, 1));
         if(ent)
         {
-            skeletal_model_p model = World_GetModelByID(lua_tointeger(lua, 2));
-            if(model && ent->bf->animations.model && (ent->bf->animations.model->mesh_count == model->mesh_count))
-            {
-                ent->bf->animations.model = model;
-                ent->bf->animations.prev_animation = 0;
-                ent->bf->animations.prev_frame = 0;
-                ent->bf->animations.current_animation = 0;
-                ent->bf->animations.current_frame = 0;
-            }
+            Entity_SetBaseAnimModel(ent, World_GetModelByID(lua_tointeger(lua, 2)));
         }
         else
         {
@@ -575,13 +567,7 @@ int lua_SetEntityAnim(lua_State * lua)
                 Anim_SetAnimation(ss_anim, lua_tointeger(lua, 3), lua_tointeger(lua, 4));
                 if(top >= 6)
                 {
-                    int16_t anim = lua_tointeger(lua, 5);
-                    int16_t frame = lua_tointeger(lua, 6);
-                    if((anim < ss_anim->model->animation_count) && (frame < ss_anim->model->animations[anim].frames_count))
-                    {
-                        ss_anim->prev_animation = anim;
-                        ss_anim->prev_frame = frame;
-                    }
+                    Anim_SetPrevAnimation(ss_anim, lua_tointeger(lua, 5), lua_tointeger(lua, 6));
                 }
             }
             SSBoneFrame_Update(ent->bf, 0.0f);
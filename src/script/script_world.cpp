@@ -43,19 +43,22 @@ void Script_DoFlipEffect(lua_State *lua, int id_effect, int id_object, int param
     lua_getglobal(lua, "doFlipEffect");
     if(lua_isfunction(lua, -1))
     {
+        script_profile_sample_t sample;
         lua_pushinteger(lua, id_effect);
         lua_pushinteger(lua, id_object);
         lua_pushinteger(lua, param);
+        Script_ProfileBegin(&sample);
         if(lua_pcall(lua, 3, 0, 0) == LUA_OK)
         {
            //
         }
+        Script_ProfileEnd(&sample, "doFlipEffect");
     }
     lua_settop(lua, top);
 }
 
 
-size_t Script_GetFlipEffectsSaveData(lua_State *lua, char *buf, size_t buf_size)
+size_t Script_GetFlipEffectsSaveData(lua_State *lua, script_save_data_func_t out, void *data)
 {
     int top = lua_gettop(lua);
     size_t ret = 0;
@@ -65,7 +68,11 @@ size_t Script_GetFlipEffectsSaveData(lua_State *lua, char *buf, size_t buf_size)
     {
         if((lua_pcall(lua, 0, 1, 0) == LUA_OK) && lua_isstring(lua, -1))
         {
-            strncpy(buf, lua_tolstring(lua, -1, &ret), buf_size);
+            const char *str = lua_tolstring(lua, -1, &ret);
+            if(ret > 0)
+            {
+                out(data, str, ret);
+            }
         }
     }
     lua_settop(lua, top);
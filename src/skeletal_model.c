@@ -1,6 +1,10 @@
 
 #include <stdlib.h>
 #include <memory.h>
+#include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 #include "core/system.h"
 #include "core/gl_util.h"
@@ -15,6 +19,29 @@ void SSBoneFrame_InitSSAnim(struct ss_animation_s *ss_anim, uint32_t anim_type_i
 void Anim_Clear(struct animation_frame_s *anim);
 
 
+#define SS_POSE_BATCH_SIZE          (128)                                       // bones per staging pass, must be a multiple of 4
+
+/*
+ * Bones rotations staging area for batched pose evaluation: quaternions are
+ * stored as structure of arrays, so slerp goes through 4 bones at once.
+ */
+typedef struct ss_pose_batch_s
+{
+    float                       curr_a[4][SS_POSE_BATCH_SIZE];                  // key frames around previous frame
+    float                       curr_b[4][SS_POSE_BATCH_SIZE];
+    float                       next_a[4][SS_POSE_BATCH_SIZE];                  // key frames around current frame
+    float                       next_b[4][SS_POSE_BATCH_SIZE];
+    float                       curr_lerp[SS_POSE_BATCH_SIZE];
+    float                       next_lerp[SS_POSE_BATCH_SIZE];
+    float                       lerp[SS_POSE_BATCH_SIZE];
+    struct ss_bone_tag_s       *bone_tags[SS_POSE_BATCH_SIZE];
+    uint32_t                    count;
+}__attribute__((aligned(16))) ss_pose_batch_t, *ss_pose_batch_p;
+
+
+static bone_frame_p Anim_GetKeyFrames(struct animation_frame_s *anim, int frame, bone_frame_p *next_key, float *lerp);
+
+
 void SkeletalModel_Clear(skeletal_model_p model)
 {
     if(model != NULL)
@@ -142,13 +169,14 @@ void SkeletalModel_CopyAnims(skeletal_model_p dst, skeletal_model_p src)
         }
 
         dst_a->frames_count = src_a->frames_count;
-        dst_a->frames = (bone_frame_p)calloc(src_a->frames_count, sizeof(bone_frame_t));
-        for(uint16_t i = 0; i < src_a->frames_count; ++i)
+        dst_a->frame_rate = src_a->frame_rate;
+        Anim_AllocFrames(dst_a, src_a->keyframes_count, src_a->frames->bone_tag_count);
+        for(uint16_t i = 0; i < src_a->keyframes_count; ++i)
         {
-            size_t sz = src_a->frames[i].bone_tag_count * sizeof(bone_tag_t);
+            bone_tag_p bone_tags = dst_a->frames[i].bone_tags;
             dst_a->frames[i] = src_a->frames[i];
-            dst_a->frames[i].bone_tags = (bone_tag_p)malloc(sz);
-            memcpy(dst_a->frames[i].bone_tags, src_a->frames[i].bone_tags, sz);
+            dst_a->frames[i].bone_tags = bone_tags;
+            memcpy(bone_tags, src_a->frames[i].bone_tags, src_a->frames[i].bone_tag_count * sizeof(bone_tag_t));
         }
         
         dst_a->state_change_count = src_a->state_change_count;
@@ -358,64 +386,240 @@ void SSBoneFrame_Copy(struct ss_bone_frame_s *dst, struct ss_bone_frame_s *src)
 
 void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time)
 {
-    float t = 1.0f - bf->animations.lerp;
-    ss_bone_tag_p btag = bf->bone_tags;
-    bone_tag_p src_btag, next_btag;
-    skeletal_model_p model = bf->animations.model;
-    animation_frame_p curr_anim = model->animations + bf->animations.prev_animation;
-    animation_frame_p next_anim = model->animations + bf->animations.current_animation;
-    bone_frame_p curr_bf = curr_anim->frames + bf->animations.prev_frame;
-    bone_frame_p next_bf = next_anim->frames + bf->animations.current_frame;
-    
-    vec3_interpolate_macro(bf->bb_max, curr_bf->bb_max, next_bf->bb_max, bf->animations.lerp, t);
-    vec3_interpolate_macro(bf->bb_min, curr_bf->bb_min, next_bf->bb_min, bf->animations.lerp, t);
-    vec3_interpolate_macro(bf->centre, curr_bf->centre, next_bf->centre, bf->animations.lerp, t);
-    vec3_interpolate_macro(bf->pos, curr_bf->pos, next_bf->pos, bf->animations.lerp, t);
-    
-    next_btag = next_bf->bone_tags;
-    src_btag = curr_bf->bone_tags;
-    for(uint16_t k = 0; k < curr_bf->bone_tag_count; k++, btag++, src_btag++, next_btag++)
+    SSBoneFrame_UpdateBatch(&bf, 1, time);
+}
+
+
+/*
+ * Stages bone rotations: key frames pairs around previous and current frames
+ * of one bone; orientation is slerped through all stages at flush.
+ */
+static void SSBoneFrame_AddToPoseBatch(ss_pose_batch_p batch, ss_bone_tag_p btag, bone_tag_p curr_a, bone_tag_p curr_b, float curr_lerp, bone_tag_p next_a, bone_tag_p next_b, float next_lerp, float lerp)
+{
+    uint32_t i = batch->count++;
+    batch->bone_tags[i] = btag;
+    batch->curr_lerp[i] = curr_lerp;
+    batch->next_lerp[i] = next_lerp;
+    batch->lerp[i] = lerp;
+    for(int j = 0; j < 4; j++)
+    {
+        batch->curr_a[j][i] = curr_a->qrotate[j];
+        batch->curr_b[j][i] = curr_b->qrotate[j];
+        batch->next_a[j][i] = next_a->qrotate[j];
+        batch->next_b[j][i] = next_b->qrotate[j];
+    }
+}
+
+
+/*
+ * The same as vec4_slerp, but for SS_POSE_BATCH_SIZE quaternions in SoA layout;
+ * count must be a multiple of 4, ret may alias q1.
+ */
+static void SSBoneFrame_SlerpBatch(float ret[4][SS_POSE_BATCH_SIZE], float q1[4][SS_POSE_BATCH_SIZE], float q2[4][SS_POSE_BATCH_SIZE], const float *t, uint32_t count)
+{
+    float k1[SS_POSE_BATCH_SIZE] __attribute__((aligned(16)));
+    float k2[SS_POSE_BATCH_SIZE] __attribute__((aligned(16)));
+
+#if defined(__SSE__)
+    for(uint32_t i = 0; i < count; i += 4)
     {
-        vec3_interpolate_macro(btag->offset, src_btag->offset, next_btag->offset, bf->animations.lerp, t);
-        vec3_copy(btag->transform + 12, btag->offset);
-        btag->transform[15] = 1.0f;
-        if(k == 0)
+        __m128 cos_fi = _mm_mul_ps(_mm_load_ps(q1[3] + i), _mm_load_ps(q2[3] + i));
+        cos_fi = _mm_add_ps(cos_fi, _mm_mul_ps(_mm_load_ps(q1[0] + i), _mm_load_ps(q2[0] + i)));
+        cos_fi = _mm_add_ps(cos_fi, _mm_mul_ps(_mm_load_ps(q1[1] + i), _mm_load_ps(q2[1] + i)));
+        cos_fi = _mm_add_ps(cos_fi, _mm_mul_ps(_mm_load_ps(q1[2] + i), _mm_load_ps(q2[2] + i)));
+        _mm_store_ps(k1 + i, cos_fi);
+    }
+#else
+    for(uint32_t i = 0; i < count; i++)
+    {
+        k1[i] = q1[3][i] * q2[3][i] + q1[0][i] * q2[0][i] + q1[1][i] * q2[1][i] + q1[2][i] * q2[2][i];
+    }
+#endif
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        float cos_fi = k1[i];
+        float sign = (cos_fi < 0.0f) ? (-1.0f) : (1.0f);
+        float fi = acosf(sign * cos_fi);
+        float sin_fi = sinf(fi);
+
+        if((fabs(sin_fi) > 0.00001f) && (t[i] > 0.0001f) && (t[i] < 1.0f))
         {
-            vec3_add(btag->transform + 12, btag->transform + 12, bf->pos);
-            vec4_slerp(btag->qrotate, src_btag->qrotate, next_btag->qrotate, bf->animations.lerp);
+            k1[i] = sinf(fi * (1.0f - t[i])) / sin_fi;
+            k2[i] = sinf(fi * t[i] * sign) / sin_fi;
         }
         else
         {
-            bone_tag_p ov_src_btag = src_btag;
-            bone_tag_p ov_next_btag = next_btag;
-            float ov_lerp = bf->animations.lerp;
-            if(btag->alt_anim && btag->alt_anim->model && btag->alt_anim->enabled && (btag->alt_anim->model->mesh_tree[k].replace_anim != 0))
+            k1[i] = 1.0f - t[i];
+            k2[i] = t[i];
+        }
+    }
+
+#if defined(__SSE__)
+    for(uint32_t i = 0; i < count; i += 4)
+    {
+        __m128 a = _mm_load_ps(k1 + i);
+        __m128 b = _mm_load_ps(k2 + i);
+        __m128 x = _mm_add_ps(_mm_mul_ps(a, _mm_load_ps(q1[0] + i)), _mm_mul_ps(b, _mm_load_ps(q2[0] + i)));
+        __m128 y = _mm_add_ps(_mm_mul_ps(a, _mm_load_ps(q1[1] + i)), _mm_mul_ps(b, _mm_load_ps(q2[1] + i)));
+        __m128 z = _mm_add_ps(_mm_mul_ps(a, _mm_load_ps(q1[2] + i)), _mm_mul_ps(b, _mm_load_ps(q2[2] + i)));
+        __m128 w = _mm_add_ps(_mm_mul_ps(a, _mm_load_ps(q1[3] + i)), _mm_mul_ps(b, _mm_load_ps(q2[3] + i)));
+        __m128 len = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w));
+        __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len));
+        _mm_store_ps(ret[0] + i, _mm_mul_ps(x, inv));
+        _mm_store_ps(ret[1] + i, _mm_mul_ps(y, inv));
+        _mm_store_ps(ret[2] + i, _mm_mul_ps(z, inv));
+        _mm_store_ps(ret[3] + i, _mm_mul_ps(w, inv));
+    }
+#else
+    for(uint32_t i = 0; i < count; i++)
+    {
+        float q[4], inv;
+        q[0] = k1[i] * q1[0][i] + k2[i] * q2[0][i];
+        q[1] = k1[i] * q1[1][i] + k2[i] * q2[1][i];
+        q[2] = k1[i] * q1[2][i] + k2[i] * q2[2][i];
+        q[3] = k1[i] * q1[3][i] + k2[i] * q2[3][i];
+        inv = 1.0f / vec4_abs(q);
+        ret[0][i] = q[0] * inv;
+        ret[1][i] = q[1] * inv;
+        ret[2][i] = q[2] * inv;
+        ret[3][i] = q[3] * inv;
+    }
+#endif
+}
+
+
+static void SSBoneFrame_FlushPoseBatch(ss_pose_batch_p batch)
+{
+    uint32_t count = (batch->count + 3) & ~3;
+
+    /*
+     * pad tail lanes with identity rotations
+     */
+    for(uint32_t i = batch->count; i < count; i++)
+    {
+        batch->curr_lerp[i] = batch->next_lerp[i] = batch->lerp[i] = 0.0f;
+        for(int j = 0; j < 4; j++)
+        {
+            batch->curr_a[j][i] = batch->curr_b[j][i] = batch->next_a[j][i] = batch->next_b[j][i] = (j == 3) ? (1.0f) : (0.0f);
+        }
+    }
+
+    SSBoneFrame_SlerpBatch(batch->curr_a, batch->curr_a, batch->curr_b, batch->curr_lerp, count);
+    SSBoneFrame_SlerpBatch(batch->next_a, batch->next_a, batch->next_b, batch->next_lerp, count);
+    SSBoneFrame_SlerpBatch(batch->curr_a, batch->curr_a, batch->next_a, batch->lerp, count);
+
+    for(uint32_t i = 0; i < batch->count; i++)
+    {
+        ss_bone_tag_p btag = batch->bone_tags[i];
+        btag->qrotate[0] = batch->curr_a[0][i];
+        btag->qrotate[1] = batch->curr_a[1][i];
+        btag->qrotate[2] = batch->curr_a[2][i];
+        btag->qrotate[3] = batch->curr_a[3][i];
+        Mat4_set_qrotation(btag->transform, btag->qrotate);
+    }
+    batch->count = 0;
+}
+
+
+void SSBoneFrame_UpdateBatch(struct ss_bone_frame_s **bfs, uint32_t count, float time)
+{
+    ss_pose_batch_t batch;
+    batch.count = 0;
+
+    /*
+     * first pass: interpolate offsets and bounds, stage bones rotations
+     */
+    for(uint32_t i = 0; i < count; i++)
+    {
+        ss_bone_frame_p bf = bfs[i];
+        float t = 1.0f - bf->animations.lerp;
+        float curr_lerp, next_lerp, ct, nt;
+        float curr_v[3], next_v[3];
+        ss_bone_tag_p btag = bf->bone_tags;
+        skeletal_model_p model = bf->animations.model;
+        animation_frame_p curr_anim = model->animations + bf->animations.prev_animation;
+        animation_frame_p next_anim = model->animations + bf->animations.current_animation;
+        bone_frame_p curr_key_next, next_key_next;
+        bone_frame_p curr_bf = Anim_GetKeyFrames(curr_anim, bf->animations.prev_frame, &curr_key_next, &curr_lerp);
+        bone_frame_p next_bf = Anim_GetKeyFrames(next_anim, bf->animations.current_frame, &next_key_next, &next_lerp);
+
+        /*
+         * only key frames are stored: sample both game frames between their
+         * neighbour key frames, then blend them as before.
+         */
+        ct = 1.0f - curr_lerp;
+        nt = 1.0f - next_lerp;
+        vec3_interpolate_macro(curr_v, curr_bf->bb_max, curr_key_next->bb_max, curr_lerp, ct);
+        vec3_interpolate_macro(next_v, next_bf->bb_max, next_key_next->bb_max, next_lerp, nt);
+        vec3_interpolate_macro(bf->bb_max, curr_v, next_v, bf->animations.lerp, t);
+        vec3_interpolate_macro(curr_v, curr_bf->bb_min, curr_key_next->bb_min, curr_lerp, ct);
+        vec3_interpolate_macro(next_v, next_bf->bb_min, next_key_next->bb_min, next_lerp, nt);
+        vec3_interpolate_macro(bf->bb_min, curr_v, next_v, bf->animations.lerp, t);
+        vec3_interpolate_macro(curr_v, curr_bf->centre, curr_key_next->centre, curr_lerp, ct);
+        vec3_interpolate_macro(next_v, next_bf->centre, next_key_next->centre, next_lerp, nt);
+        vec3_interpolate_macro(bf->centre, curr_v, next_v, bf->animations.lerp, t);
+        vec3_interpolate_macro(curr_v, curr_bf->pos, curr_key_next->pos, curr_lerp, ct);
+        vec3_interpolate_macro(next_v, next_bf->pos, next_key_next->pos, next_lerp, nt);
+        vec3_interpolate_macro(bf->pos, curr_v, next_v, bf->animations.lerp, t);
+
+        for(uint16_t k = 0; k < curr_bf->bone_tag_count; k++, btag++)
+        {
+            bone_tag_p curr_a = curr_bf->bone_tags + k;
+            bone_tag_p curr_b = curr_key_next->bone_tags + k;
+            bone_tag_p next_a = next_bf->bone_tags + k;
+            bone_tag_p next_b = next_key_next->bone_tags + k;
+
+            vec3_interpolate_macro(curr_v, curr_a->offset, curr_b->offset, curr_lerp, ct);
+            vec3_interpolate_macro(next_v, next_a->offset, next_b->offset, next_lerp, nt);
+            vec3_interpolate_macro(btag->offset, curr_v, next_v, bf->animations.lerp, t);
+            vec3_copy(btag->transform + 12, btag->offset);
+            btag->transform[15] = 1.0f;
+            if(k == 0)
+            {
+                vec3_add(btag->transform + 12, btag->transform + 12, bf->pos);
+                SSBoneFrame_AddToPoseBatch(&batch, btag, curr_a, curr_b, curr_lerp, next_a, next_b, next_lerp, bf->animations.lerp);
+            }
+            else if(btag->alt_anim && btag->alt_anim->model && btag->alt_anim->enabled && (btag->alt_anim->model->mesh_tree[k].replace_anim != 0))
             {
-                curr_anim = btag->alt_anim->model->animations + btag->alt_anim->prev_animation;
-                next_anim = btag->alt_anim->model->animations + btag->alt_anim->current_animation;
-                bone_frame_p ov_curr_bf = curr_anim->frames + btag->alt_anim->prev_frame;
-                bone_frame_p ov_next_bf = next_anim->frames + btag->alt_anim->current_frame;
-                ov_lerp = btag->alt_anim->lerp;
-                ov_src_btag = ov_curr_bf->bone_tags + k;
-                ov_next_btag = ov_next_bf->bone_tags + k;
+                bone_frame_p ov_curr_bf, ov_next_bf, ov_curr_key_next, ov_next_key_next;
+                float ov_curr_lerp, ov_next_lerp;
+                animation_frame_p ov_curr_anim = btag->alt_anim->model->animations + btag->alt_anim->prev_animation;
+                animation_frame_p ov_next_anim = btag->alt_anim->model->animations + btag->alt_anim->current_animation;
+                ov_curr_bf = Anim_GetKeyFrames(ov_curr_anim, btag->alt_anim->prev_frame, &ov_curr_key_next, &ov_curr_lerp);
+                ov_next_bf = Anim_GetKeyFrames(ov_next_anim, btag->alt_anim->current_frame, &ov_next_key_next, &ov_next_lerp);
+                SSBoneFrame_AddToPoseBatch(&batch, btag, ov_curr_bf->bone_tags + k, ov_curr_key_next->bone_tags + k, ov_curr_lerp,
+                                           ov_next_bf->bone_tags + k, ov_next_key_next->bone_tags + k, ov_next_lerp, btag->alt_anim->lerp);
+            }
+            else
+            {
+                SSBoneFrame_AddToPoseBatch(&batch, btag, curr_a, curr_b, curr_lerp, next_a, next_b, next_lerp, bf->animations.lerp);
+            }
+
+            if(batch.count >= SS_POSE_BATCH_SIZE)
+            {
+                SSBoneFrame_FlushPoseBatch(&batch);
             }
-            vec4_slerp(btag->qrotate, ov_src_btag->qrotate, ov_next_btag->qrotate, ov_lerp);
         }
-        Mat4_set_qrotation(btag->transform, btag->qrotate);
     }
+    SSBoneFrame_FlushPoseBatch(&batch);
 
     /*
      * build absolute coordinate matrix system
      */
-    btag = bf->bone_tags;
-    Mat4_Copy(btag->full_transform, btag->transform);
-    Mat4_Copy(btag->orig_transform, btag->transform);
-    btag++;
-    for(uint16_t k = 1; k < curr_bf->bone_tag_count; k++, btag++)
+    for(uint32_t i = 0; i < count; i++)
     {
-        Mat4_Mat4_mul(btag->full_transform, btag->parent->full_transform, btag->transform);
-        Mat4_Copy(btag->orig_transform, btag->full_transform);
-        SSBoneFrame_TargetBoneToSlerp(bf, btag, time);
+        ss_bone_frame_p bf = bfs[i];
+        ss_bone_tag_p btag = bf->bone_tags;
+        Mat4_Copy(btag->full_transform, btag->transform);
+        Mat4_Copy(btag->orig_transform, btag->transform);
+        btag++;
+        for(uint16_t k = 1; k < bf->bone_tag_count; k++, btag++)
+        {
+            Mat4_Mat4_mul(btag->full_transform, btag->parent->full_transform, btag->transform);
+            Mat4_Copy(btag->orig_transform, btag->full_transform);
+            SSBoneFrame_TargetBoneToSlerp(bf, btag, time);
+        }
     }
 }
 
@@ -680,20 +884,12 @@ void Anim_Clear(struct animation_frame_s *anim)
         anim->state_change = NULL;
     }
 
-    if(anim->frames_count)
+    if(anim->frames)
     {
-        for(uint16_t j = 0; j < anim->frames_count; j++)
-        {
-            if(anim->frames[j].bone_tag_count)
-            {
-                anim->frames[j].bone_tag_count = 0;
-                free(anim->frames[j].bone_tags);
-                anim->frames[j].bone_tags = NULL;
-            }
-        }
         anim->frames_count = 0;
+        anim->keyframes_count = 0;
         anim->max_frame = 0;
-        free(anim->frames);
+        free(anim->frames);                                                     // bone tags share one allocation with the frames
         anim->frames = NULL;
     }
 
@@ -713,6 +909,50 @@ void Anim_Clear(struct animation_frame_s *anim)
 }
 
 
+/*
+ * Allocates key frames and their bone tags with a single block.
+ */
+void Anim_AllocFrames(struct animation_frame_s *anim, uint16_t keyframes_count, uint16_t bone_tag_count)
+{
+    size_t frames_size = keyframes_count * sizeof(bone_frame_t);
+    bone_tag_p bone_tags;
+
+    anim->keyframes_count = keyframes_count;
+    anim->frames = (bone_frame_p)calloc(1, frames_size + keyframes_count * bone_tag_count * sizeof(bone_tag_t));
+    bone_tags = (bone_tag_p)((uint8_t*)anim->frames + frames_size);
+    for(uint16_t i = 0; i < keyframes_count; i++, bone_tags += bone_tag_count)
+    {
+        anim->frames[i].bone_tag_count = bone_tag_count;
+        anim->frames[i].bone_tags = bone_tags;
+    }
+}
+
+
+/*
+ * Maps game frame to the pair of key frames around it;
+ * lerp == 0 means that frame is exactly the returned key frame.
+ */
+static bone_frame_p Anim_GetKeyFrames(struct animation_frame_s *anim, int frame, bone_frame_p *next_key, float *lerp)
+{
+    int key = (frame > 0) ? (frame / anim->frame_rate) : (0);
+    int rem = (frame > 0) ? (frame % anim->frame_rate) : (0);
+
+    if(key + 1 < anim->keyframes_count)
+    {
+        *next_key = anim->frames + key + 1;
+        *lerp = (float)rem / (float)anim->frame_rate;
+    }
+    else
+    {
+        key = anim->keyframes_count - 1;
+        *next_key = anim->frames + key;
+        *lerp = 0.0f;
+    }
+
+    return anim->frames + key;
+}
+
+
 void Anim_AddCommand(struct animation_frame_s *anim, const animation_command_p command)
 {
     animation_command_p *ptr = &anim->commands;
@@ -795,7 +1035,7 @@ int Anim_GetAnimDispatchCase(struct ss_animation_s *ss_anim, uint32_t id)
 
 void Anim_SetAnimation(struct ss_animation_s *ss_anim, int animation, int frame)
 {
-    if(ss_anim && ss_anim->model && (animation < ss_anim->model->animation_count))
+    if(ss_anim && ss_anim->model && (animation >= 0) && (animation < ss_anim->model->animation_count))
     {
         animation_frame_p anim = &ss_anim->model->animations[animation];
         ss_anim->lerp = 0.0;
@@ -816,6 +1056,19 @@ void Anim_SetAnimation(struct ss_animation_s *ss_anim, int animation, int frame)
     }
 }
 
+/*
+ * Sets the frame interpolation starts from, out of range values are ignored.
+ */
+void Anim_SetPrevAnimation(struct ss_animation_s *ss_anim, int animation, int frame)
+{
+    if(ss_anim && ss_anim->model && (animation >= 0) && (animation < ss_anim->model->animation_count) &&
+       (frame >= 0) && (frame < ss_anim->model->animations[animation].frames_count))
+    {
+        ss_anim->prev_animation = animation;
+        ss_anim->prev_frame = frame;
+    }
+}
+
 /*
  * Next frame and next anim calculation function.
  */
@@ -206,9 +206,11 @@ typedef struct animation_frame_s
     uint32_t                    id;
     uint16_t                    state_id;
     uint16_t                    max_frame;
-    uint16_t                    frames_count;           // Number of frames
+    uint16_t                    frames_count;           // Number of frames (with interpolated ones)
+    uint16_t                    keyframes_count;        // Number of stored key frames
+    uint16_t                    frame_rate;             // Frames per key frame, interpolated ones are sampled on the fly
     uint16_t                    state_change_count;     // Number of animation statechanges
-    struct bone_frame_s        *frames;                 // Frame data
+    struct bone_frame_s        *frames;                 // Key frames data
     struct state_change_s      *state_change;           // Animation statechanges data
     
     struct animation_command_s *commands;
@@ -257,6 +259,7 @@ void SSBoneFrame_CreateFromModel(ss_bone_frame_p bf, skeletal_model_p model);
 void SSBoneFrame_Clear(ss_bone_frame_p bf);
 void SSBoneFrame_Copy(struct ss_bone_frame_s *dst, struct ss_bone_frame_s *src);
 void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time);
+void SSBoneFrame_UpdateBatch(struct ss_bone_frame_s **bfs, uint32_t count, float time);
 void SSBoneFrame_RotateBone(struct ss_bone_frame_s *bf, const float q_rotate[4], int bone);
 int  SSBoneFrame_CheckTargetBoneLimit(struct ss_bone_frame_s *bf, struct ss_bone_tag_s *b_tag, float target[3]);
 void SSBoneFrame_TargetBoneToSlerp(struct ss_bone_frame_s *bf, struct ss_bone_tag_s *b_tag, float time);
@@ -271,12 +274,14 @@ void SSBoneFrame_DisableOverrideAnimByType(struct ss_bone_frame_s *bf, uint16_t
 void SSBoneFrame_DisableOverrideAnim(struct ss_bone_frame_s *bf, struct ss_animation_s *ss_anim);
 void SSBoneFrame_FillSkinnedMeshMap(ss_bone_frame_p model);
 
+void Anim_AllocFrames(struct animation_frame_s *anim, uint16_t keyframes_count, uint16_t bone_tag_count);
 void Anim_AddCommand(struct animation_frame_s *anim, const animation_command_p command);
 void Anim_AddEffect(struct animation_frame_s *anim, const animation_effect_p effect);
 struct state_change_s *Anim_FindStateChangeByAnim(struct animation_frame_s *anim, int state_change_anim);
 struct state_change_s *Anim_FindStateChangeByID(struct animation_frame_s *anim, uint32_t id);
 int  Anim_GetAnimDispatchCase(struct ss_animation_s *ss_anim, uint32_t id);
 void Anim_SetAnimation(struct ss_animation_s *ss_anim, int animation, int frame);
+void Anim_SetPrevAnimation(struct ss_animation_s *ss_anim, int animation, int frame);
 int  Anim_SetNextFrame(struct ss_animation_s *ss_anim, float time);
 int  Anim_IncTime(struct ss_animation_s *ss_anim, float time);
 inline uint16_t Anim_GetCurrentState(struct ss_animation_s *ss_anim)
@@ -0,0 +1,451 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * This file is part of vt.
+ *
+ */
+
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tr_versions.h"
+#include "vt_level.h"
+
+/*
+ * Cooked level cache: TR_Level content after prepare_level(), stored as
+ * raw native structures. Every array is written as element count followed
+ * by packed elements; nested room and mesh arrays follow their parent
+ * array, pointers inside structures are written as NULL and restored on
+ * read. The file is read with a single SDL_RWread and split by memcpy.
+ */
+
+#define TR_CACHE_MAGIC          (0x434C544F)    // "OTLC"
+#define TR_CACHE_VERSION        (1)
+
+typedef struct tr_cache_header_s
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layout;
+    int32_t  game_version;
+    uint64_t level_hash;
+} tr_cache_header_t;
+
+typedef struct tr_cache_reader_s
+{
+    uint8_t *data;
+    size_t   size;
+    size_t   pos;
+    int      error;
+} tr_cache_reader_t;
+
+
+/// \brief hash of used structures sizes, invalidates caches written by builds with another layout.
+static uint32_t cache_layout()
+{
+    const uint32_t sizes[] = {
+        sizeof(tr5_room_t), sizeof(tr5_room_layer_t), sizeof(tr5_room_vertex_t), sizeof(tr4_face4_t),
+        sizeof(tr4_face3_t), sizeof(tr_room_sprite_t), sizeof(tr_room_portal_t), sizeof(tr_room_sector_t),
+        sizeof(tr5_room_light_t), sizeof(tr2_room_staticmesh_t), sizeof(tr4_mesh_t), sizeof(tr5_vertex_t),
+        sizeof(tr_animation_t), sizeof(tr_state_change_t), sizeof(tr_anim_dispatch_t), sizeof(tr_moveable_t),
+        sizeof(tr_staticmesh_t), sizeof(tr4_object_texture_t), sizeof(tr_sprite_texture_t), sizeof(tr_sprite_sequence_t),
+        sizeof(tr_camera_t), sizeof(tr4_flyby_camera_t), sizeof(tr_sound_source_t), sizeof(tr_box_t),
+        sizeof(tr2_zone_t), sizeof(tr2_item_t), sizeof(tr_lightmap_t), sizeof(tr2_palette_t),
+        sizeof(tr4_ai_object_t), sizeof(tr_cinematic_frame_t), sizeof(tr_sound_details_t), sizeof(tr4_textile32_t)
+    };
+    uint32_t ret = 2166136261u;
+
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        ret = (ret ^ sizes[i]) * 16777619u;
+    }
+
+    return ret;
+}
+
+static uint32_t cache_soundmap_size(int32_t game_version)
+{
+    switch(game_version)
+    {
+        case TR_I:
+        case TR_I_DEMO:
+        case TR_I_UB:
+            return TR_AUDIO_MAP_SIZE_TR1;
+
+        case TR_II:
+        case TR_II_DEMO:
+            return TR_AUDIO_MAP_SIZE_TR2;
+
+        case TR_III:
+            return TR_AUDIO_MAP_SIZE_TR3;
+
+        case TR_IV:
+        case TR_IV_DEMO:
+            return TR_AUDIO_MAP_SIZE_TR4;
+
+        case TR_V:
+            return TR_AUDIO_MAP_SIZE_TR5;
+    };
+
+    return 0;
+}
+
+static void cache_write(SDL_RWops *dst, const void *data, size_t size, int *error)
+{
+    if(size && (SDL_RWwrite(dst, data, size, 1) != 1))
+    {
+        *error = 1;
+    }
+}
+
+static void cache_write_array(SDL_RWops *dst, const void *data, size_t elem_size, uint32_t count, int *error)
+{
+    if(data == NULL)
+    {
+        count = 0;
+    }
+    cache_write(dst, &count, sizeof(count), error);
+    cache_write(dst, data, elem_size * count, error);
+}
+
+static void cache_read(tr_cache_reader_t *r, void *data, size_t size)
+{
+    if(r->error || (size > r->size - r->pos))
+    {
+        r->error = 1;
+        memset(data, 0, size);
+        return;
+    }
+    memcpy(data, r->data + r->pos, size);
+    r->pos += size;
+}
+
+/// \brief reads array written by cache_write_array; returns NULL for empty or broken arrays.
+static void *cache_read_array(tr_cache_reader_t *r, size_t elem_size, uint32_t *count)
+{
+    void *ret = NULL;
+
+    cache_read(r, count, sizeof(*count));
+    if(r->error || (*count == 0) || ((uint64_t)elem_size * (*count) > r->size - r->pos))
+    {
+        r->error |= (*count != 0);
+        *count = 0;
+        return NULL;
+    }
+
+    ret = malloc(elem_size * (*count));
+    cache_read(r, ret, elem_size * (*count));
+    return ret;
+}
+
+/// \brief reads nested array, which elements count is already known from the owner structure.
+static void *cache_read_nested_array(tr_cache_reader_t *r, size_t elem_size, uint32_t expected_count)
+{
+    uint32_t count = 0;
+    void *ret = cache_read_array(r, elem_size, &count);
+
+    if((count != 0) && (count != expected_count))
+    {
+        r->error = 1;
+    }
+
+    return ret;
+}
+
+
+/// \brief 64-bit FNV-1a hash of the whole level file, 0 if file can not be read.
+uint64_t VT_Level::get_level_hash(const char *name)
+{
+    uint64_t ret = 0;
+    SDL_RWops *src = SDL_RWFromFile(name, "rb");
+
+    if(src)
+    {
+        Sint64 size = SDL_RWsize(src);
+        uint8_t *buffer = (size > 0) ? ((uint8_t*)malloc(size)) : (NULL);
+        if(buffer && (SDL_RWread(src, buffer, size, 1) == 1))
+        {
+            const uint64_t prime = 1099511628211ull;
+            Sint64 i = 0;
+            uint64_t word;
+
+            ret = 14695981039346656037ull;
+            for(; i + 8 <= size; i += 8)
+            {
+                memcpy(&word, buffer + i, sizeof(word));
+                ret = (ret ^ word) * prime;
+            }
+            for(; i < size; i++)
+            {
+                ret = (ret ^ buffer[i]) * prime;
+            }
+            ret ^= (uint64_t)size;
+            ret = (ret) ? (ret) : (1);
+        }
+        free(buffer);
+        SDL_RWclose(src);
+    }
+
+    return ret;
+}
+
+/** \brief reads cooked level cache.
+  *
+  * Level must be fresh (not read yet). Returns false if cache is missing, outdated or broken;
+  * level may be partially filled in that case and should be recreated before read_level().
+  */
+bool VT_Level::read_cache(const char *name, uint64_t level_hash)
+{
+    tr_cache_reader_t reader;
+    tr_cache_header_t header;
+    tr_cache_reader_t *r = &reader;
+    SDL_RWops *src;
+    Sint64 size;
+    uint32_t i;
+
+    if(!level_hash || ((src = SDL_RWFromFile(name, "rb")) == NULL))
+    {
+        return false;
+    }
+
+    size = SDL_RWsize(src);
+    reader.data = (size > (Sint64)sizeof(header)) ? ((uint8_t*)malloc(size)) : (NULL);
+    reader.size = size;
+    reader.pos = 0;
+    reader.error = 0;
+    if(!reader.data || (SDL_RWread(src, reader.data, size, 1) != 1))
+    {
+        free(reader.data);
+        SDL_RWclose(src);
+        return false;
+    }
+    SDL_RWclose(src);
+
+    cache_read(r, &header, sizeof(header));
+    if((header.magic != TR_CACHE_MAGIC) || (header.version != TR_CACHE_VERSION) ||
+       (header.layout != cache_layout()) || (header.level_hash != level_hash))
+    {
+        free(reader.data);
+        return false;
+    }
+
+    this->game_version = header.game_version;
+    cache_read(r, &this->num_textiles, sizeof(this->num_textiles));
+    cache_read(r, &this->num_room_textiles, sizeof(this->num_room_textiles));
+    cache_read(r, &this->num_obj_textiles, sizeof(this->num_obj_textiles));
+    cache_read(r, &this->num_bump_textiles, sizeof(this->num_bump_textiles));
+    cache_read(r, &this->num_misc_textiles, sizeof(this->num_misc_textiles));
+    cache_read(r, &this->read_32bit_textiles, sizeof(this->read_32bit_textiles));
+    cache_read(r, &this->lightmap, sizeof(this->lightmap));
+    cache_read(r, &this->palette, sizeof(this->palette));
+    cache_read(r, &this->palette16, sizeof(this->palette16));
+    cache_read(r, &this->animated_textures_uv_count, sizeof(this->animated_textures_uv_count));
+    cache_read(r, &this->samples_count, sizeof(this->samples_count));
+
+#define CACHE_READ_ARRAY(ptr, count) \
+    (ptr) = (decltype(ptr))cache_read_array(r, sizeof(*(ptr)), &(count));
+
+    CACHE_READ_ARRAY(this->textile32, this->textile32_count);
+    CACHE_READ_ARRAY(this->floor_data, this->floor_data_size);
+    CACHE_READ_ARRAY(this->mesh_indices, this->mesh_indices_count);
+    CACHE_READ_ARRAY(this->animations, this->animations_count);
+    CACHE_READ_ARRAY(this->state_changes, this->state_changes_count);
+    CACHE_READ_ARRAY(this->anim_dispatches, this->anim_dispatches_count);
+    CACHE_READ_ARRAY(this->anim_commands, this->anim_commands_count);
+    CACHE_READ_ARRAY(this->moveables, this->moveables_count);
+    CACHE_READ_ARRAY(this->static_meshes, this->static_meshes_count);
+    CACHE_READ_ARRAY(this->object_textures, this->object_textures_count);
+    CACHE_READ_ARRAY(this->animated_textures, this->animated_textures_count);
+    CACHE_READ_ARRAY(this->sprite_textures, this->sprite_textures_count);
+    CACHE_READ_ARRAY(this->sprite_sequences, this->sprite_sequences_count);
+    CACHE_READ_ARRAY(this->cameras, this->cameras_count);
+    CACHE_READ_ARRAY(this->flyby_cameras, this->flyby_cameras_count);
+    CACHE_READ_ARRAY(this->sound_sources, this->sound_sources_count);
+    CACHE_READ_ARRAY(this->overlaps, this->overlaps_count);
+    CACHE_READ_ARRAY(this->items, this->items_count);
+    CACHE_READ_ARRAY(this->ai_objects, this->ai_objects_count);
+    CACHE_READ_ARRAY(this->cinematic_frames, this->cinematic_frames_count);
+    CACHE_READ_ARRAY(this->demo_data, this->demo_data_count);
+    CACHE_READ_ARRAY(this->sound_details, this->sound_details_count);
+    CACHE_READ_ARRAY(this->samples_data, this->samples_data_size);
+    CACHE_READ_ARRAY(this->sample_indices, this->sample_indices_count);
+    CACHE_READ_ARRAY(this->frame_data, this->frame_data_size);
+    CACHE_READ_ARRAY(this->mesh_tree_data, this->mesh_tree_data_size);
+    CACHE_READ_ARRAY(this->boxes, this->boxes_count);
+    this->zones = (tr2_zone_t*)cache_read_nested_array(r, sizeof(tr2_zone_t), this->boxes_count);
+    this->soundmap = (int16_t*)cache_read_nested_array(r, sizeof(int16_t), cache_soundmap_size(this->game_version));
+
+    CACHE_READ_ARRAY(this->meshes, this->meshes_count);
+    for(i = 0; i < this->meshes_count; i++)
+    {
+        tr4_mesh_t *mesh = this->meshes + i;
+        mesh->vertices = (tr5_vertex_t*)cache_read_nested_array(r, sizeof(tr5_vertex_t), mesh->num_vertices);
+        mesh->normals = (tr5_vertex_t*)cache_read_nested_array(r, sizeof(tr5_vertex_t), mesh->num_normals);
+        mesh->lights = (int16_t*)cache_read_nested_array(r, sizeof(int16_t), mesh->num_lights);
+        mesh->textured_rectangles = (tr4_face4_t*)cache_read_nested_array(r, sizeof(tr4_face4_t), mesh->num_textured_rectangles);
+        mesh->textured_triangles = (tr4_face3_t*)cache_read_nested_array(r, sizeof(tr4_face3_t), mesh->num_textured_triangles);
+        mesh->coloured_rectangles = (tr4_face4_t*)cache_read_nested_array(r, sizeof(tr4_face4_t), mesh->num_coloured_rectangles);
+        mesh->coloured_triangles = (tr4_face3_t*)cache_read_nested_array(r, sizeof(tr4_face3_t), mesh->num_coloured_triangles);
+    }
+
+    CACHE_READ_ARRAY(this->rooms, this->rooms_count);
+    for(i = 0; i < this->rooms_count; i++)
+    {
+        tr5_room_t *room = this->rooms + i;
+        room->layers = (tr5_room_layer_t*)cache_read_nested_array(r, sizeof(tr5_room_layer_t), room->num_layers);
+        room->vertices = (tr5_room_vertex_t*)cache_read_nested_array(r, sizeof(tr5_room_vertex_t), room->num_vertices);
+        room->rectangles = (tr4_face4_t*)cache_read_nested_array(r, sizeof(tr4_face4_t), room->num_rectangles);
+        room->triangles = (tr4_face3_t*)cache_read_nested_array(r, sizeof(tr4_face3_t), room->num_triangles);
+        room->sprites = (tr_room_sprite_t*)cache_read_nested_array(r, sizeof(tr_room_sprite_t), room->num_sprites);
+        room->portals = (tr_room_portal_t*)cache_read_nested_array(r, sizeof(tr_room_portal_t), room->num_portals);
+        room->sector_list = (tr_room_sector_t*)cache_read_nested_array(r, sizeof(tr_room_sector_t), room->num_xsectors * room->num_zsectors);
+        room->lights = (tr5_room_light_t*)cache_read_nested_array(r, sizeof(tr5_room_light_t), room->num_lights);
+        room->static_meshes = (tr2_room_staticmesh_t*)cache_read_nested_array(r, sizeof(tr2_room_staticmesh_t), room->num_static_meshes);
+    }
+#undef CACHE_READ_ARRAY
+
+    cache_read(r, &header.magic, sizeof(header.magic));
+    free(reader.data);
+
+    return !reader.error && (header.magic == TR_CACHE_MAGIC);
+}
+
+/** \brief writes cooked level cache.
+  *
+  * Must be called after prepare_level(), before any data is taken by the world generator.
+  */
+bool VT_Level::write_cache(const char *name, uint64_t level_hash)
+{
+    tr_cache_header_t header;
+    SDL_RWops *dst;
+    uint32_t i;
+    int error = 0;
+
+    if(!level_hash || ((dst = SDL_RWFromFile(name, "wb")) == NULL))
+    {
+        return false;
+    }
+
+    header.magic = TR_CACHE_MAGIC;
+    header.version = TR_CACHE_VERSION;
+    header.layout = cache_layout();
+    header.game_version = this->game_version;
+    header.level_hash = level_hash;
+    cache_write(dst, &header, sizeof(header), &error);
+
+    cache_write(dst, &this->num_textiles, sizeof(this->num_textiles), &error);
+    cache_write(dst, &this->num_room_textiles, sizeof(this->num_room_textiles), &error);
+    cache_write(dst, &this->num_obj_textiles, sizeof(this->num_obj_textiles), &error);
+    cache_write(dst, &this->num_bump_textiles, sizeof(this->num_bump_textiles), &error);
+    cache_write(dst, &this->num_misc_textiles, sizeof(this->num_misc_textiles), &error);
+    cache_write(dst, &this->read_32bit_textiles, sizeof(this->read_32bit_textiles), &error);
+    cache_write(dst, &this->lightmap, sizeof(this->lightmap), &error);
+    cache_write(dst, &this->palette, sizeof(this->palette), &error);
+    cache_write(dst, &this->palette16, sizeof(this->palette16), &error);
+    cache_write(dst, &this->animated_textures_uv_count, sizeof(this->animated_textures_uv_count), &error);
+    cache_write(dst, &this->samples_count, sizeof(this->samples_count), &error);
+
+#define CACHE_WRITE_ARRAY(ptr, count) \
+    cache_write_array(dst, (ptr), sizeof(*(ptr)), (count), &error);
+
+    CACHE_WRITE_ARRAY(this->textile32, this->textile32_count);
+    CACHE_WRITE_ARRAY(this->floor_data, this->floor_data_size);
+    CACHE_WRITE_ARRAY(this->mesh_indices, this->mesh_indices_count);
+    CACHE_WRITE_ARRAY(this->animations, this->animations_count);
+    CACHE_WRITE_ARRAY(this->state_changes, this->state_changes_count);
+    CACHE_WRITE_ARRAY(this->anim_dispatches, this->anim_dispatches_count);
+    CACHE_WRITE_ARRAY(this->anim_commands, this->anim_commands_count);
+    CACHE_WRITE_ARRAY(this->moveables, this->moveables_count);
+    CACHE_WRITE_ARRAY(this->static_meshes, this->static_meshes_count);
+    CACHE_WRITE_ARRAY(this->object_textures, this->object_textures_count);
+    CACHE_WRITE_ARRAY(this->animated_textures, this->animated_textures_count);
+    CACHE_WRITE_ARRAY(this->sprite_textures, this->sprite_textures_count);
+    CACHE_WRITE_ARRAY(this->sprite_sequences, this->sprite_sequences_count);
+    CACHE_WRITE_ARRAY(this->cameras, this->cameras_count);
+    CACHE_WRITE_ARRAY(this->flyby_cameras, this->flyby_cameras_count);
+    CACHE_WRITE_ARRAY(this->sound_sources, this->sound_sources_count);
+    CACHE_WRITE_ARRAY(this->overlaps, this->overlaps_count);
+    CACHE_WRITE_ARRAY(this->items, this->items_count);
+    CACHE_WRITE_ARRAY(this->ai_objects, this->ai_objects_count);
+    CACHE_WRITE_ARRAY(this->cinematic_frames, this->cinematic_frames_count);
+    CACHE_WRITE_ARRAY(this->demo_data, this->demo_data_count);
+    CACHE_WRITE_ARRAY(this->sound_details, this->sound_details_count);
+    CACHE_WRITE_ARRAY(this->samples_data, this->samples_data_size);
+    CACHE_WRITE_ARRAY(this->sample_indices, this->sample_indices_count);
+    CACHE_WRITE_ARRAY(this->frame_data, this->frame_data_size);
+    CACHE_WRITE_ARRAY(this->mesh_tree_data, this->mesh_tree_data_size);
+    CACHE_WRITE_ARRAY(this->boxes, this->boxes_count);
+    cache_write_array(dst, this->zones, sizeof(tr2_zone_t), this->boxes_count, &error);
+    cache_write_array(dst, this->soundmap, sizeof(int16_t), cache_soundmap_size(this->game_version), &error);
+
+    // Nested arrays are written after their owner, so owner pointers are stored as NULL.
+    cache_write(dst, &this->meshes_count, sizeof(this->meshes_count), &error);
+    for(i = 0; i < this->meshes_count; i++)
+    {
+        tr4_mesh_t mesh = this->meshes[i];
+        mesh.vertices = NULL;
+        mesh.normals = NULL;
+        mesh.lights = NULL;
+        mesh.textured_rectangles = NULL;
+        mesh.textured_triangles = NULL;
+        mesh.coloured_rectangles = NULL;
+        mesh.coloured_triangles = NULL;
+        cache_write(dst, &mesh, sizeof(mesh), &error);
+    }
+    for(i = 0; i < this->meshes_count; i++)
+    {
+        tr4_mesh_t *mesh = this->meshes + i;
+        cache_write_array(dst, mesh->vertices, sizeof(tr5_vertex_t), mesh->num_vertices, &error);
+        cache_write_array(dst, mesh->normals, sizeof(tr5_vertex_t), mesh->num_normals, &error);
+        cache_write_array(dst, mesh->lights, sizeof(int16_t), mesh->num_lights, &error);
+        cache_write_array(dst, mesh->textured_rectangles, sizeof(tr4_face4_t), mesh->num_textured_rectangles, &error);
+        cache_write_array(dst, mesh->textured_triangles, sizeof(tr4_face3_t), mesh->num_textured_triangles, &error);
+        cache_write_array(dst, mesh->coloured_rectangles, sizeof(tr4_face4_t), mesh->num_coloured_rectangles, &error);
+        cache_write_array(dst, mesh->coloured_triangles, sizeof(tr4_face3_t), mesh->num_coloured_triangles, &error);
+    }
+
+    cache_write(dst, &this->rooms_count, sizeof(this->rooms_count), &error);
+    for(i = 0; i < this->rooms_count; i++)
+    {
+        tr5_room_t room = this->rooms[i];
+        room.layers = NULL;
+        room.vertices = NULL;
+        room.rectangles = NULL;
+        room.triangles = NULL;
+        room.sprites = NULL;
+        room.portals = NULL;
+        room.sector_list = NULL;
+        room.lights = NULL;
+        room.static_meshes = NULL;
+        cache_write(dst, &room, sizeof(room), &error);
+    }
+    for(i = 0; i < this->rooms_count; i++)
+    {
+        tr5_room_t *room = this->rooms + i;
+        cache_write_array(dst, room->layers, sizeof(tr5_room_layer_t), room->num_layers, &error);
+        cache_write_array(dst, room->vertices, sizeof(tr5_room_vertex_t), room->num_vertices, &error);
+        cache_write_array(dst, room->rectangles, sizeof(tr4_face4_t), room->num_rectangles, &error);
+        cache_write_array(dst, room->triangles, sizeof(tr4_face3_t), room->num_triangles, &error);
+        cache_write_array(dst, room->sprites, sizeof(tr_room_sprite_t), room->num_sprites, &error);
+        cache_write_array(dst, room->portals, sizeof(tr_room_portal_t), room->num_portals, &error);
+        cache_write_array(dst, room->sector_list, sizeof(tr_room_sector_t), room->num_xsectors * room->num_zsectors, &error);
+        cache_write_array(dst, room->lights, sizeof(tr5_room_light_t), room->num_lights, &error);
+        cache_write_array(dst, room->static_meshes, sizeof(tr2_room_staticmesh_t), room->num_static_meshes, &error);
+    }
+#undef CACHE_WRITE_ARRAY
+
+    header.magic = TR_CACHE_MAGIC;
+    cache_write(dst, &header.magic, sizeof(header.magic), &error);
+    SDL_RWclose(dst);
+
+    return !error;
+}
@@ -177,3 +177,61 @@ float TR_Level::read_mixfloat(SDL_RWops * const src)
 
     return ((float)base_int + ((float)sign_int / 65535.0));
 }
+
+/** \brief reads array of unsigned 8-bit values.
+  *
+  * uses current position from src, reads whole array at once.
+  */
+void TR_Level::read_bitu8_array(SDL_RWops * const src, uint8_t *data, uint32_t count)
+{
+    if (src == NULL)
+        Sys_extError("read_bitu8_array: src == NULL");
+
+    if (count && (SDL_RWread(src, data, 1, count) < count))
+        Sys_extError("read_bitu8_array");
+}
+
+/** \brief reads array of signed 16-bit values.
+  *
+  * uses current position from src, reads whole array at once. does endian correction.
+  */
+void TR_Level::read_bit16_array(SDL_RWops * const src, int16_t *data, uint32_t count)
+{
+    read_bitu16_array(src, (uint16_t*)data, count);
+}
+
+/** \brief reads array of unsigned 16-bit values.
+  *
+  * uses current position from src, reads whole array at once. does endian correction.
+  */
+void TR_Level::read_bitu16_array(SDL_RWops * const src, uint16_t *data, uint32_t count)
+{
+    if (src == NULL)
+        Sys_extError("read_bitu16_array: src == NULL");
+
+    if (count && (SDL_RWread(src, data, 2, count) < count))
+        Sys_extError("read_bitu16_array");
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    for (uint32_t i = 0; i < count; i++)
+        data[i] = SDL_SwapLE16(data[i]);
+#endif
+}
+
+/** \brief reads array of unsigned 32-bit values.
+  *
+  * uses current position from src, reads whole array at once. does endian correction.
+  */
+void TR_Level::read_bitu32_array(SDL_RWops * const src, uint32_t *data, uint32_t count)
+{
+    if (src == NULL)
+        Sys_extError("read_bitu32_array: src == NULL");
+
+    if (count && (SDL_RWread(src, data, 4, count) < count))
+        Sys_extError("read_bitu32_array");
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    for (uint32_t i = 0; i < count; i++)
+        data[i] = SDL_SwapLE32(data[i]);
+#endif
+}
@@ -168,8 +168,22 @@ void TR_Level::read_level(const char *filename, int32_t game_version)
         strncat(this->sfx_path, "MAIN.SFX", 256);
     }
 
+    // Whole file is parsed from memory: scalar reads are much cheaper than file reads.
+    Sint64 size = SDL_RWsize(src);
+    uint8_t *buffer = (size > 0) ? ((uint8_t*)malloc(size)) : (NULL);
+    if(buffer && (SDL_RWread(src, buffer, size, 1) == 1))
+    {
+        SDL_RWclose(src);
+        src = SDL_RWFromConstMem(buffer, size);
+    }
+    else
+    {
+        SDL_RWseek(src, 0, RW_SEEK_SET);
+    }
+
     this->read_level(src, game_version);
     SDL_RWclose(src);
+    free(buffer);
 }
 
 /** \brief reads the level.
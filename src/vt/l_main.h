@@ -563,6 +563,10 @@ class TR_Level
     uint32_t read_bitu32(SDL_RWops * const src);
     float read_float(SDL_RWops * const src);
     float read_mixfloat(SDL_RWops * const src);
+    void read_bitu8_array(SDL_RWops * const src, uint8_t *data, uint32_t count);
+    void read_bit16_array(SDL_RWops * const src, int16_t *data, uint32_t count);
+    void read_bitu16_array(SDL_RWops * const src, uint16_t *data, uint32_t count);
+    void read_bitu32_array(SDL_RWops * const src, uint32_t *data, uint32_t count);
 
     void read_mesh_data(SDL_RWops * const src);
     void read_frame_moveable_data(SDL_RWops * const src);
@@ -572,6 +576,8 @@ class TR_Level
     void read_tr_vertex32(SDL_RWops * const src, tr5_vertex_t & vertex);
     void read_tr_face3(SDL_RWops * const src, tr4_face3_t & face);
     void read_tr_face4(SDL_RWops * const src, tr4_face4_t & face);
+    void read_tr_face3_array(SDL_RWops * const src, tr4_face3_t *faces, uint32_t count);
+    void read_tr_face4_array(SDL_RWops * const src, tr4_face4_t *faces, uint32_t count);
     void read_tr_textile8(SDL_RWops * const src, tr_textile8_t & textile);
     void read_tr_lightmap(SDL_RWops * const src, tr_lightmap_t & lightmap);
     void read_tr_palette(SDL_RWops * const src, tr2_palette_t & palette);
@@ -621,6 +627,8 @@ class TR_Level
     void read_tr4_textile32(SDL_RWops * const src, tr4_textile32_t & textile);
     void read_tr4_face3(SDL_RWops * const src, tr4_face3_t & meshface);
     void read_tr4_face4(SDL_RWops * const src, tr4_face4_t & meshface);
+    void read_tr4_face3_array(SDL_RWops * const src, tr4_face3_t *meshfaces, uint32_t count);
+    void read_tr4_face4_array(SDL_RWops * const src, tr4_face4_t *meshfaces, uint32_t count);
     void read_tr4_room_light(SDL_RWops * const src, tr5_room_light_t & light);
     void read_tr4_room_vertex(SDL_RWops * const src, tr5_room_vertex_t & room_vertex);
      void read_tr4_room_staticmesh(SDL_RWops * const src, tr2_room_staticmesh_t & room_static_mesh);
@@ -93,12 +93,47 @@ void TR_Level::read_tr_face4(SDL_RWops * const src, tr4_face4_t & meshface)
     meshface.lighting = 0;
 }
 
+/** \brief reads an array of triangle definitions.
+  *
+  * Raw values are read at once into the destination and unpacked in place, from the last face.
+  */
+void TR_Level::read_tr_face3_array(SDL_RWops * const src, tr4_face3_t *meshfaces, uint32_t count)
+{
+    uint16_t *raw = (uint16_t*)meshfaces;
+
+    read_bitu16_array(src, raw, count * 4);
+    for (uint32_t i = count; i-- > 0;)
+    {
+        tr4_face3_t meshface;
+        memcpy(&meshface, raw + i * 4, 4 * sizeof(uint16_t));
+        meshface.lighting = 0;
+        meshfaces[i] = meshface;
+    }
+}
+
+/** \brief reads an array of rectangle definitions.
+  *
+  * Raw values are read at once into the destination and unpacked in place, from the last face.
+  */
+void TR_Level::read_tr_face4_array(SDL_RWops * const src, tr4_face4_t *meshfaces, uint32_t count)
+{
+    uint16_t *raw = (uint16_t*)meshfaces;
+
+    read_bitu16_array(src, raw, count * 5);
+    for (uint32_t i = count; i-- > 0;)
+    {
+        tr4_face4_t meshface;
+        memcpy(&meshface, raw + i * 5, 5 * sizeof(uint16_t));
+        meshface.lighting = 0;
+        meshfaces[i] = meshface;
+    }
+}
+
 /// \brief reads a 8-bit 256x256 textile.
 void TR_Level::read_tr_textile8(SDL_RWops * const src, tr_textile8_t & textile)
 {
-    for (int i = 0; i < 256; i++)
-        if (SDL_RWread(src, textile.pixels[i], 1, 256) < 256)
-                        Sys_extError("read_tr_textile8");
+    if (SDL_RWread(src, textile.pixels, 256, 256) < 256)
+        Sys_extError("read_tr_textile8");
 }
 
 /// \brief reads the lightmap.
@@ -305,13 +340,11 @@ void TR_Level::read_tr_room(SDL_RWops * const src, tr5_room_t & room)
 
     room.num_rectangles = read_bitu16(src);
         room.rectangles = (tr4_face4_t*)malloc(room.num_rectangles * sizeof(tr4_face4_t));
-    for (i = 0; i < room.num_rectangles; i++)
-        read_tr_face4(src, room.rectangles[i]);
+    read_tr_face4_array(src, room.rectangles, room.num_rectangles);
 
     room.num_triangles = read_bitu16(src);
     room.triangles = (tr4_face3_t*)malloc(room.num_triangles * sizeof(tr4_face3_t));
-    for (i = 0; i < room.num_triangles; i++)
-        read_tr_face3(src, room.triangles[i]);
+    read_tr_face3_array(src, room.triangles, room.num_triangles);
 
     room.num_sprites = read_bitu16(src);
     room.sprites = (tr_room_sprite_t*)malloc(room.num_sprites * sizeof(tr_room_sprite_t));
@@ -479,29 +512,24 @@ void TR_Level::read_tr_mesh(SDL_RWops * const src, tr4_mesh_t & mesh)
         mesh.num_lights = -mesh.num_normals;
         mesh.num_normals = 0;
         mesh.lights = (int16_t*)malloc(mesh.num_lights * sizeof(int16_t));
-        for (i = 0; i < mesh.num_lights; i++)
-            mesh.lights[i] = read_bit16(src);
+        read_bit16_array(src, mesh.lights, mesh.num_lights);
     }
 
     mesh.num_textured_rectangles = read_bit16(src);
     mesh.textured_rectangles = (tr4_face4_t*)malloc(mesh.num_textured_rectangles * sizeof(tr4_face4_t));
-    for (i = 0; i < mesh.num_textured_rectangles; i++)
-        read_tr_face4(src, mesh.textured_rectangles[i]);
+    read_tr_face4_array(src, mesh.textured_rectangles, mesh.num_textured_rectangles);
 
     mesh.num_textured_triangles = read_bit16(src);
     mesh.textured_triangles = (tr4_face3_t*)malloc(mesh.num_textured_triangles * sizeof(tr4_face3_t));
-    for (i = 0; i < mesh.num_textured_triangles; i++)
-        read_tr_face3(src, mesh.textured_triangles[i]);
+    read_tr_face3_array(src, mesh.textured_triangles, mesh.num_textured_triangles);
 
     mesh.num_coloured_rectangles = read_bit16(src);
     mesh.coloured_rectangles = (tr4_face4_t*)malloc(mesh.num_coloured_rectangles * sizeof(tr4_face4_t));
-    for (i = 0; i < mesh.num_coloured_rectangles; i++)
-        read_tr_face4(src, mesh.coloured_rectangles[i]);
+    read_tr_face4_array(src, mesh.coloured_rectangles, mesh.num_coloured_rectangles);
 
     mesh.num_coloured_triangles = read_bit16(src);
     mesh.coloured_triangles = (tr4_face3_t*)malloc(mesh.num_coloured_triangles * sizeof(tr4_face3_t));
-    for (i = 0; i < mesh.num_coloured_triangles; i++)
-        read_tr_face3(src, mesh.coloured_triangles[i]);
+    read_tr_face3_array(src, mesh.coloured_triangles, mesh.num_coloured_triangles);
 }
 
 /// \brief reads an animation state change.
@@ -650,8 +678,7 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->floor_data_size = read_bitu32(src);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-        this->floor_data[i] = read_bitu16(src);
+    read_bitu16_array(src, this->floor_data, this->floor_data_size);
 
     read_mesh_data(src);
 
@@ -672,13 +699,11 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->anim_commands_count = read_bitu32(src);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(src);
+    read_bit16_array(src, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(src);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(src);
+    read_bitu32_array(src, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(src);
 
@@ -744,8 +769,7 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->overlaps_count = read_bitu32(src);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(src);
+    read_bitu16_array(src, this->overlaps, this->overlaps_count);
 
     // Zones
     for (i = 0; i < this->boxes_count; i++)
@@ -778,13 +802,11 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->demo_data_count = read_bitu16(src);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(src);
+    read_bitu8_array(src, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR1 * sizeof(int16_t));
-    for(i=0; i < TR_AUDIO_MAP_SIZE_TR1; i++)
-        this->soundmap[i] = read_bit16(src);
+    read_bit16_array(src, this->soundmap, TR_AUDIO_MAP_SIZE_TR1);
 
     this->sound_details_count = read_bitu32(src);
     this->sound_details = (tr_sound_details_t*)malloc(this->sound_details_count * sizeof(tr_sound_details_t));
@@ -808,10 +830,10 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
     this->samples_count = 0;
     this->samples_data_size = read_bitu32(src);
     this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-    for(i=0; i < this->samples_data_size; i++)
+    read_bitu8_array(src, this->samples_data, this->samples_data_size);
+    for(i = 4; i < this->samples_data_size; i++)
     {
-        this->samples_data[i] = read_bitu8(src);
-        if((i >= 4) && (*((uint32_t*)(this->samples_data+i-4)) == 0x46464952))   /// RIFF
+        if(*((uint32_t*)(this->samples_data+i-4)) == 0x46464952)   /// RIFF
         {
             this->samples_count++;
         }
@@ -819,6 +841,5 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->sample_indices_count = read_bitu32(src);
     this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-    for(i=0; i < this->sample_indices_count; i++)
-        this->sample_indices[i] = read_bitu32(src);
+    read_bitu32_array(src, this->sample_indices, this->sample_indices_count);
 }
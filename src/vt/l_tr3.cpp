@@ -109,13 +109,11 @@ void TR_Level::read_tr3_room(SDL_RWops * const src, tr5_room_t & room)
 
     room.num_rectangles = read_bitu16(src);
     room.rectangles = (tr4_face4_t*)malloc(room.num_rectangles * sizeof(tr4_face4_t));
-    for (i = 0; i < room.num_rectangles; i++)
-        read_tr_face4(src, room.rectangles[i]);
+    read_tr_face4_array(src, room.rectangles, room.num_rectangles);
 
     room.num_triangles = read_bitu16(src);
     room.triangles = (tr4_face3_t*)malloc(room.num_triangles * sizeof(tr4_face3_t));
-    for (i = 0; i < room.num_triangles; i++)
-        read_tr_face3(src, room.triangles[i]);
+    read_tr_face3_array(src, room.triangles, room.num_triangles);
 
     room.num_sprites = read_bitu16(src);
     room.sprites = (tr_room_sprite_t*)malloc(room.num_sprites * sizeof(tr_room_sprite_t));
@@ -233,8 +231,7 @@ void TR_Level::read_tr3_level(SDL_RWops *const src)
 
     this->floor_data_size = read_bitu32(src);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-            this->floor_data[i] = read_bitu16(src);
+    read_bitu16_array(src, this->floor_data, this->floor_data_size);
 
     read_mesh_data(src);
 
@@ -255,13 +252,11 @@ void TR_Level::read_tr3_level(SDL_RWops *const src)
 
     this->anim_commands_count = read_bitu32(src);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(src);
+    read_bit16_array(src, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(src);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(src);                     // 4 bytes
+    read_bitu32_array(src, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(src);
 
@@ -312,8 +307,7 @@ void TR_Level::read_tr3_level(SDL_RWops *const src)
 
     this->overlaps_count = read_bitu32(src);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(src);
+    read_bitu16_array(src, this->overlaps, this->overlaps_count);
 
     // Zones
     for (i = 0; i < this->boxes_count; i++)
@@ -348,13 +342,11 @@ void TR_Level::read_tr3_level(SDL_RWops *const src)
 
     this->demo_data_count = read_bitu16(src);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(src);
+    read_bitu8_array(src, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR3 * sizeof(int16_t));
-    for(i = 0; i < TR_AUDIO_MAP_SIZE_TR3; i++)
-        this->soundmap[i] = read_bit16(src);
+    read_bit16_array(src, this->soundmap, TR_AUDIO_MAP_SIZE_TR3);
 
     this->sound_details_count = read_bitu32(src);
     this->sound_details = (tr_sound_details_t*)malloc(this->sound_details_count * sizeof(tr_sound_details_t));
@@ -371,8 +363,7 @@ void TR_Level::read_tr3_level(SDL_RWops *const src)
 
     this->sample_indices_count = read_bitu32(src);
     this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-    for(i=0; i < this->sample_indices_count; i++)
-        this->sample_indices[i] = read_bitu32(src);
+    read_bitu32_array(src, this->sample_indices, this->sample_indices_count);
 
     // remap all sample indices here
     for(i = 0; i < this->sound_details_count; i++)
@@ -398,10 +389,10 @@ void TR_Level::read_tr3_level(SDL_RWops *const src)
         this->samples_data_size = SDL_RWsize(newsrc);
         this->samples_count = 0;
         this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-        for(i = 0; i < this->samples_data_size; i++)
+        read_bitu8_array(newsrc, this->samples_data, this->samples_data_size);
+        for(i = 4; i < this->samples_data_size; i++)
         {
-            this->samples_data[i] = read_bitu8(newsrc);
-            if((i >= 4) && (*((uint32_t*)(this->samples_data+i-4)) == 0x46464952))   /// RIFF
+            if(*((uint32_t*)(this->samples_data+i-4)) == 0x46464952)   /// RIFF
             {
                 this->samples_count++;
             }
@@ -37,10 +37,10 @@ void TR_Level::read_tr4_vertex_float(SDL_RWops * const src, tr5_vertex_t & verte
 
 void TR_Level::read_tr4_textile32(SDL_RWops * const src, tr4_textile32_t & textile)
 {
-    for (int i = 0; i < 256; i++) {
-        if (SDL_RWread(src, textile.pixels[i], 4, 256) < 256)
-            Sys_extError("read_tr4_textile32");
+    if (SDL_RWread(src, textile.pixels, 4 * 256, 256) < 256)
+        Sys_extError("read_tr4_textile32");
 
+    for (int i = 0; i < 256; i++) {
         for (int j = 0; j < 256; j++)
             textile.pixels[i][j] = SDL_SwapLE32((textile.pixels[i][j] & 0xff00ff00) | ((textile.pixels[i][j] & 0x00ff0000) >> 16) | ((textile.pixels[i][j] & 0x000000ff) << 16));
     }
@@ -65,6 +65,18 @@ void TR_Level::read_tr4_face4(SDL_RWops * const src, tr4_face4_t & meshface)
     meshface.lighting = read_bitu16(src);
 }
 
+/// \brief reads an array of triangle definitions, file layout matches tr4_face3_t.
+void TR_Level::read_tr4_face3_array(SDL_RWops * const src, tr4_face3_t *meshfaces, uint32_t count)
+{
+    read_bitu16_array(src, (uint16_t*)meshfaces, count * 5);
+}
+
+/// \brief reads an array of rectangle definitions, file layout matches tr4_face4_t.
+void TR_Level::read_tr4_face4_array(SDL_RWops * const src, tr4_face4_t *meshfaces, uint32_t count)
+{
+    read_bitu16_array(src, (uint16_t*)meshfaces, count * 6);
+}
+
 void TR_Level::read_tr4_room_light(SDL_RWops * const src, tr5_room_light_t & light)
 {
     read_tr_vertex32(src, light.pos);
@@ -141,13 +153,11 @@ void TR_Level::read_tr4_room(SDL_RWops * const src, tr5_room_t & room)
 
     room.num_rectangles = read_bitu16(src);
     room.rectangles = (tr4_face4_t*)malloc(room.num_rectangles * sizeof(tr4_face4_t));
-    for (i = 0; i < room.num_rectangles; i++)
-        read_tr_face4(src, room.rectangles[i]);
+    read_tr_face4_array(src, room.rectangles, room.num_rectangles);
 
     room.num_triangles = read_bitu16(src);
     room.triangles = (tr4_face3_t*)malloc(room.num_triangles * sizeof(tr4_face3_t));
-    for (i = 0; i < room.num_triangles; i++)
-        read_tr_face3(src, room.triangles[i]);
+    read_tr_face3_array(src, room.triangles, room.num_triangles);
 
     room.num_sprites = read_bitu16(src);
     room.sprites = (tr_room_sprite_t*)malloc(room.num_sprites * sizeof(tr_room_sprite_t));
@@ -299,19 +309,16 @@ void TR_Level::read_tr4_mesh(SDL_RWops * const src, tr4_mesh_t & mesh)
         mesh.num_lights = -mesh.num_normals;
         mesh.num_normals = 0;
         mesh.lights = (int16_t*)malloc(mesh.num_lights * sizeof(int16_t));
-        for (i = 0; i < mesh.num_lights; i++)
-            mesh.lights[i] = read_bit16(src);
+        read_bit16_array(src, mesh.lights, mesh.num_lights);
     }
 
     mesh.num_textured_rectangles = read_bit16(src);
     mesh.textured_rectangles = (tr4_face4_t*)malloc(mesh.num_textured_rectangles * sizeof(tr4_face4_t));
-    for (i = 0; i < mesh.num_textured_rectangles; i++)
-        read_tr4_face4(src, mesh.textured_rectangles[i]);
+    read_tr4_face4_array(src, mesh.textured_rectangles, mesh.num_textured_rectangles);
 
     mesh.num_textured_triangles = read_bit16(src);
     mesh.textured_triangles = (tr4_face3_t*)malloc(mesh.num_textured_triangles * sizeof(tr4_face3_t));
-    for (i = 0; i < mesh.num_textured_triangles; i++)
-        read_tr4_face3(src, mesh.textured_triangles[i]);
+    read_tr4_face3_array(src, mesh.textured_triangles, mesh.num_textured_triangles);
 
     mesh.num_coloured_rectangles = 0;
     mesh.num_coloured_triangles = 0;
@@ -580,8 +587,7 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->floor_data_size = read_bitu32(newsrc);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-        this->floor_data[i] = read_bitu16(newsrc);
+    read_bitu16_array(newsrc, this->floor_data, this->floor_data_size);
 
     read_mesh_data(newsrc);
 
@@ -602,13 +608,11 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->anim_commands_count = read_bitu32(newsrc);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(newsrc);
+    read_bit16_array(newsrc, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(newsrc);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(newsrc);                     // 4 bytes
+    read_bitu32_array(newsrc, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(newsrc);
 
@@ -692,8 +696,7 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->overlaps_count = read_bitu32(newsrc);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(newsrc);
+    read_bitu16_array(newsrc, this->overlaps, this->overlaps_count);
 
     // Zones
     for (i = 0; i < this->boxes_count; i++)
@@ -745,13 +748,11 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->demo_data_count = read_bitu16(newsrc);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(newsrc);
+    read_bitu8_array(newsrc, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR4 * sizeof(int16_t));
-    for(i=0; i < TR_AUDIO_MAP_SIZE_TR4; i++)
-        this->soundmap[i] = read_bit16(newsrc);
+    read_bit16_array(newsrc, this->soundmap, TR_AUDIO_MAP_SIZE_TR4);
 
     this->sound_details_count = 0;
     i = read_bitu32(newsrc);
@@ -779,8 +780,7 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
         this->sample_indices_count = i;
 
         this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-        for(i=0; i < this->sample_indices_count; i++)
-            this->sample_indices[i] = read_bitu32(newsrc);
+        read_bitu32_array(newsrc, this->sample_indices, this->sample_indices_count);
     }
     else
     {
@@ -802,7 +802,6 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
         // block of file as single array.
         this->samples_data_size = (uint32_t) (SDL_RWsize(src) - SDL_RWtell(src));
         this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-        for(i = 0; i < this->samples_data_size; i++)
-            this->samples_data[i] = read_bitu8(src);
+        read_bitu8_array(src, this->samples_data, this->samples_data_size);
     }
 }
@@ -361,16 +361,16 @@ void TR_Level::read_tr5_room(SDL_RWops * const src, tr5_room_t & room)
         for (i = 0; i < room.num_layers; i++) {
             uint32_t j;
 
+            read_tr4_face4_array(newsrc, room.rectangles + rectangle_index, room.layers[i].num_rectangles);
             for (j = 0; j < room.layers[i].num_rectangles; j++) {
-                read_tr4_face4(newsrc, room.rectangles[rectangle_index]);
                 room.rectangles[rectangle_index].vertices[0] += vertex_index;
                 room.rectangles[rectangle_index].vertices[1] += vertex_index;
                 room.rectangles[rectangle_index].vertices[2] += vertex_index;
                 room.rectangles[rectangle_index].vertices[3] += vertex_index;
                 rectangle_index++;
             }
+            read_tr4_face3_array(newsrc, room.triangles + triangle_index, room.layers[i].num_triangles);
             for (j = 0; j < room.layers[i].num_triangles; j++) {
-                read_tr4_face3(newsrc, room.triangles[triangle_index]);
                 room.triangles[triangle_index].vertices[0] += vertex_index;
                 room.triangles[triangle_index].vertices[1] += vertex_index;
                 room.triangles[triangle_index].vertices[2] += vertex_index;
@@ -653,8 +653,7 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->floor_data_size = read_bitu32(src);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-        this->floor_data[i] = read_bitu16(src);
+    read_bitu16_array(src, this->floor_data, this->floor_data_size);
 
     read_mesh_data(src);
 
@@ -677,13 +676,11 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->anim_commands_count = read_bitu32(src);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(src);
+    read_bit16_array(src, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(src);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(src);                     // 4 bytes
+    read_bitu32_array(src, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(src);
 
@@ -769,8 +766,7 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->overlaps_count = read_bitu32(src);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(src);
+    read_bitu16_array(src, this->overlaps, this->overlaps_count);
 
     // Zones
     for (i = 0; i < this->boxes_count; i++)
@@ -829,13 +825,11 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->demo_data_count = read_bitu16(src);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(src);
+    read_bitu8_array(src, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR5 * sizeof(int16_t));
-    for(i=0; i < TR_AUDIO_MAP_SIZE_TR5; i++)
-        this->soundmap[i] = read_bit16(src);
+    read_bit16_array(src, this->soundmap, TR_AUDIO_MAP_SIZE_TR5);
 
     this->sound_details_count = read_bitu32(src);
     this->sound_details = (tr_sound_details_t*)malloc(this->sound_details_count * sizeof(tr_sound_details_t));
@@ -853,8 +847,7 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->sample_indices_count = read_bitu32(src);
     this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-    for(i=0; i < this->sample_indices_count; i++)
-        this->sample_indices[i] = read_bitu32(src);
+    read_bitu32_array(src, this->sample_indices, this->sample_indices_count);
 
     SDL_RWseek(src, 6, SEEK_CUR);   // In TR5, sample indices are followed by 6 0xCD bytes. - correct - really 0xCDCDCDCDCDCD
 
@@ -866,7 +859,6 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
         // block of file as single array.
         this->samples_data_size = SDL_RWsize(src) - SDL_RWtell(src);
         this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-        for(i = 0; i < this->samples_data_size; i++)
-            this->samples_data[i] = read_bitu8(src);
+        read_bitu8_array(src, this->samples_data, this->samples_data_size);
     }
 }
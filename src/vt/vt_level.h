@@ -16,7 +16,10 @@ class VT_Level : public TR_Level
     public:
     static int get_level_format(const char *name);
     static int get_PC_level_version(const char *name);
+    static uint64_t get_level_hash(const char *name);
     void prepare_level();
+    bool read_cache(const char *name, uint64_t level_hash);
+    bool write_cache(const char *name, uint64_t level_hash);
     void dump_textures();
     tr_staticmesh_t *find_staticmesh_id(uint32_t object_id);
     tr2_item_t *find_item_id(int32_t object_id);
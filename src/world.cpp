@@ -1,6 +1,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_rwops.h>
 
@@ -17,6 +18,7 @@ extern "C" {
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/obb.h"
+#include "core/jobs.h"
 #include "render/camera.h"
 #include "render/frustum.h"
 #include "render/render.h"
@@ -50,6 +52,12 @@ extern "C" {
     uint32_t                        rooms_count;
     struct room_s                  *rooms;
 
+    uint32_t                        room_grid_x;            // Rooms spatial index: XY grid with sector sized cells
+    uint32_t                        room_grid_y;
+    float                           room_grid_min[2];       // Grid origin
+    uint32_t                       *room_grid_offsets;      // Start of every cell in room_grid_list, (x * y + 1) items
+    uint32_t                       *room_grid_list;         // Room indexes, in rooms order inside of each cell
+
     uint32_t                        room_boxes_count;
     struct room_box_s              *room_boxes;
 
@@ -115,6 +123,7 @@ void World_GenCinematicCameras(class VT_Level *tr);
 void World_GenFlyByCameras(class VT_Level *tr);
 void World_GenRoom(struct room_s *room, class VT_Level *tr);
 void World_GenRooms(class VT_Level *tr);
+void World_GenRoomGrid();
 void World_GenRoomFlipMap();
 void World_GenSkeletalModels(class VT_Level *tr);
 void World_GenEntities(class VT_Level *tr);
@@ -140,6 +149,12 @@ void World_Prepare()
     global_world.sprites_count = 0;
     global_world.rooms_count = 0;
     global_world.rooms = 0;
+    global_world.room_grid_x = 0;
+    global_world.room_grid_y = 0;
+    global_world.room_grid_min[0] = 0.0f;
+    global_world.room_grid_min[1] = 0.0f;
+    global_world.room_grid_offsets = NULL;
+    global_world.room_grid_list = NULL;
     global_world.flip_map = NULL;
     global_world.flip_state = NULL;
     global_world.flip_count = 0;
@@ -174,11 +189,42 @@ void World_Prepare()
 }
 
 
+/*
+ * Cooked level caches are stored in "cache/" folder of base path, if it exists.
+ * File name contains level hash, so different levels with the same name do not collide.
+ */
+static bool World_IsLevelCacheEnabled()
+{
+    char cache_dir[1024];
+    struct stat st;
+    snprintf(cache_dir, sizeof(cache_dir), "%scache", Engine_GetBasePath());
+    return (stat(cache_dir, &st) == 0) && (st.st_mode & S_IFDIR);
+}
+
+static void World_GetLevelCachePath(char *buf, size_t buf_size, const char *path, uint64_t level_hash)
+{
+    char level_name[LEVEL_NAME_MAX_LEN];
+    Engine_GetLevelName(level_name, path);
+    snprintf(buf, buf_size, "%scache/%s_%08X%08X.cache", Engine_GetBasePath(), level_name,
+             (uint32_t)(level_hash >> 32), (uint32_t)level_hash);
+}
+
+
 void World_Open(const char *path, int trv)
 {
+    char cache_path[1024];
+    uint64_t level_hash = (World_IsLevelCacheEnabled()) ? (VT_Level::get_level_hash(path)) : (0);   // no cache folder - no need to hash the file
     VT_Level *tr = new VT_Level();
-    tr->read_level(path, trv);
-    tr->prepare_level();
+
+    World_GetLevelCachePath(cache_path, sizeof(cache_path), path, level_hash);
+    if(!tr->read_cache(cache_path, level_hash))
+    {
+        delete tr;
+        tr = new VT_Level();
+        tr->read_level(path, trv);
+        tr->prepare_level();
+        tr->write_cache(cache_path, level_hash);
+    }
     //tr_level->dump_textures();
     World_Clear();
 
@@ -203,6 +249,7 @@ void World_Open(const char *path, int trv)
     Gui_DrawLoadScreen(440);
 
     World_GenRooms(tr);                 // Build all rooms
+    World_GenRoomGrid();                // Build rooms spatial index
     Gui_DrawLoadScreen(480);
 
     World_GenCameras(tr);               // Generate cameras & sinks.
@@ -302,6 +349,13 @@ void World_Clear()
     free(global_world.rooms);
     global_world.rooms = NULL;
 
+    global_world.room_grid_x = 0;
+    global_world.room_grid_y = 0;
+    free(global_world.room_grid_offsets);
+    global_world.room_grid_offsets = NULL;
+    free(global_world.room_grid_list);
+    global_world.room_grid_list = NULL;
+
     if(global_world.flip_count)
     {
         global_world.flip_count = 0;
@@ -392,7 +446,10 @@ void World_Clear()
 
     if(global_world.tex_count)
     {
-        qglDeleteTextures(global_world.tex_count, global_world.textures);
+        if(!screen_info.headless)
+        {
+            qglDeleteTextures(global_world.tex_count, global_world.textures);
+        }
         global_world.tex_count = 0;
         free(global_world.textures);
         global_world.textures = NULL;
@@ -824,9 +881,20 @@ struct room_s *World_GetRoomByID(uint32_t id)
 struct room_s *World_FindRoomByPos(float pos[3])
 {
     const float z_margin = TR_METERING_SECTORSIZE / 2.0f;
-    room_p r = global_world.rooms;
-    for(uint32_t i = 0; i < global_world.rooms_count; i++, r++)
+    int32_t x = (pos[0] - global_world.room_grid_min[0]) / TR_METERING_SECTORSIZE;
+    int32_t y = (pos[1] - global_world.room_grid_min[1]) / TR_METERING_SECTORSIZE;
+    if((pos[0] < global_world.room_grid_min[0]) || (pos[1] < global_world.room_grid_min[1]) ||
+       (x >= (int32_t)global_world.room_grid_x) || (y >= (int32_t)global_world.room_grid_y))
+    {
+        return NULL;
+    }
+
+    uint32_t cell = x * global_world.room_grid_y + y;
+    uint32_t *index = global_world.room_grid_list + global_world.room_grid_offsets[cell];
+    uint32_t *index_end = global_world.room_grid_list + global_world.room_grid_offsets[cell + 1];
+    for(; index < index_end; index++)
     {
+        room_p r = global_world.rooms + *index;
         if((r == r->real_room) &&
            (pos[0] >= r->bb_min[0]) && (pos[0] < r->bb_max[0]) &&
            (pos[1] >= r->bb_min[1]) && (pos[1] < r->bb_max[1]) &&
@@ -1320,6 +1388,17 @@ void World_GenTextures(class VT_Level *tr)
     global_world.tex_count = (uint32_t) global_world.tex_atlas->getNumAtlasPages();
     global_world.textures = (GLuint*)malloc(global_world.tex_count * sizeof(GLuint));
 
+    if(screen_info.headless)
+    {
+        // Page numbers stand in for texture names, so faces are still split by page.
+        for(uint32_t i = 0; i < global_world.tex_count; i++)
+        {
+            global_world.textures[i] = i + 1;
+        }
+        global_world.tex_atlas->assignTextureNames(global_world.textures);
+        return;
+    }
+
     qglPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     qglPixelZoom(1, 1);
     global_world.tex_atlas->createTextures(global_world.textures);
@@ -1469,16 +1548,51 @@ void World_GenAnimTextures(class VT_Level *tr)
 }
 
 
-void World_GenMeshes(class VT_Level *tr)
+/*
+ * Load screen update from parallel jobs; drawing is limited to
+ * some steps, as every draw waits for buffers swap.
+ */
+static int  world_load_screen_from = 0;
+static int  world_load_screen_to = 0;
+static int  world_load_screen_last = 0;
+
+static void World_SetLoadScreenRange(int from, int to)
+{
+    world_load_screen_from = from;
+    world_load_screen_to = to;
+    world_load_screen_last = from;
+}
+
+static void World_JobsProgress(uint32_t done, uint32_t count)
 {
-    base_mesh_p base_mesh;
+    int value = world_load_screen_from + (world_load_screen_to - world_load_screen_from) * done / count;
+    if((value - world_load_screen_last >= 10) || (done == count))
+    {
+        world_load_screen_last = value;
+        Gui_DrawLoadScreen(value);
+    }
+}
+
+
+static void World_GenMeshJob(void *data, uint32_t index)
+{
+    base_mesh_p base_mesh = global_world.meshes + index;
+    TR_GenMesh(base_mesh, index, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, (VT_Level*)data);
+    BaseMesh_GenFaces(base_mesh);
+}
 
+
+void World_GenMeshes(class VT_Level *tr)
+{
     global_world.meshes_count = tr->meshes_count;
-    base_mesh = global_world.meshes = (base_mesh_p)calloc(global_world.meshes_count, sizeof(base_mesh_t));
-    for(uint32_t i = 0; i < global_world.meshes_count; i++, base_mesh++)
+    global_world.meshes = (base_mesh_p)calloc(global_world.meshes_count, sizeof(base_mesh_t));
+
+    World_SetLoadScreenRange(320, 400);
+    Jobs_ParallelFor(World_GenMeshJob, tr, global_world.meshes_count, World_JobsProgress);
+
+    for(uint32_t i = 0; i < global_world.meshes_count; i++)
     {
-        TR_GenMesh(base_mesh, i, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, tr);
-        BaseMesh_GenFaces(base_mesh);
+        BaseMesh_GenVBO(global_world.meshes + i, MESH_COLOR_SCALE_DEFAULT);
     }
 }
 
@@ -1724,6 +1838,9 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->content->physics_alt_tween = NULL;
     room->content->mesh = NULL;
     room->content->static_mesh = NULL;
+    room->content->static_batches_count = 0;
+    room->content->static_batches = NULL;
+    room->content->static_boxes = NULL;
     room->content->sprites = NULL;
     room->content->sprites_vertices = NULL;
     room->content->lights_count = 0;
@@ -1736,11 +1853,6 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->content->ambient_lighting[1] = tr->rooms[room->id].light_colour.g * 2;
     room->content->ambient_lighting[2] = tr->rooms[room->id].light_colour.b * 2;
 
-    TR_GenRoomMesh(room, room->id, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, tr);
-    if(room->content->mesh)
-    {
-        BaseMesh_GenFaces(room->content->mesh);
-    }
     /*
      * let us load sectors
      */
@@ -2091,6 +2203,17 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
 }
 
 
+static void World_GenRoomMeshJob(void *data, uint32_t index)
+{
+    room_p room = global_world.rooms + index;
+    TR_GenRoomMesh(room, room->id, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, (VT_Level*)data);
+    if(room->content->mesh)
+    {
+        BaseMesh_GenFaces(room->content->mesh);
+    }
+}
+
+
 void World_GenRooms(class VT_Level *tr)
 {
     global_world.rooms_count = tr->rooms_count;
@@ -2100,6 +2223,114 @@ void World_GenRooms(class VT_Level *tr)
         r->id = i;
         World_GenRoom(r, tr);
     }
+
+    // Room geometry does not depend on the other rooms data.
+    World_SetLoadScreenRange(440, 480);
+    Jobs_ParallelFor(World_GenRoomMeshJob, tr, global_world.rooms_count, World_JobsProgress);
+
+    r = global_world.rooms;
+    for(uint32_t i = 0; i < global_world.rooms_count; i++, r++)
+    {
+        if(r->content->mesh)
+        {
+            BaseMesh_GenVBO(r->content->mesh, MESH_COLOR_SCALE_ROOM);
+        }
+        Room_GenStaticBatches(r);
+        Room_GenStaticBoxes(r);
+    }
+}
+
+
+/**
+ * Rooms spatial index for World_FindRoomByPos: every grid cell keeps the list
+ * of rooms, which XY bounding boxes touch it. Both flip states are indexed,
+ * active room check (real_room) is done on search, as rooms are flipped in game.
+ */
+void World_GenRoomGrid()
+{
+    const float cell_size = TR_METERING_SECTORSIZE;
+    float grid_max[2];
+    uint32_t cells_count;
+    room_p r;
+
+    global_world.room_grid_min[0] = global_world.room_grid_min[1] = 0.0f;
+    grid_max[0] = grid_max[1] = 0.0f;
+    r = global_world.rooms;
+    for(uint32_t i = 0; i < global_world.rooms_count; i++, r++)
+    {
+        if((i == 0) || (r->bb_min[0] < global_world.room_grid_min[0]))
+        {
+            global_world.room_grid_min[0] = r->bb_min[0];
+        }
+        if((i == 0) || (r->bb_min[1] < global_world.room_grid_min[1]))
+        {
+            global_world.room_grid_min[1] = r->bb_min[1];
+        }
+        if((i == 0) || (r->bb_max[0] > grid_max[0]))
+        {
+            grid_max[0] = r->bb_max[0];
+        }
+        if((i == 0) || (r->bb_max[1] > grid_max[1]))
+        {
+            grid_max[1] = r->bb_max[1];
+        }
+    }
+
+    global_world.room_grid_x = (grid_max[0] > global_world.room_grid_min[0]) ? ((grid_max[0] - global_world.room_grid_min[0]) / cell_size + 1) : (1);
+    global_world.room_grid_y = (grid_max[1] > global_world.room_grid_min[1]) ? ((grid_max[1] - global_world.room_grid_min[1]) / cell_size + 1) : (1);
+    cells_count = global_world.room_grid_x * global_world.room_grid_y;
+    global_world.room_grid_offsets = (uint32_t*)calloc(cells_count + 1, sizeof(uint32_t));
+
+    // First pass counts rooms in each cell, second one fills the lists.
+    for(int pass = 0; pass < 2; pass++)
+    {
+        r = global_world.rooms;
+        for(uint32_t i = 0; i < global_world.rooms_count; i++, r++)
+        {
+            if((r->bb_min[0] >= r->bb_max[0]) || (r->bb_min[1] >= r->bb_max[1]))
+            {
+                continue;                                                       // can not contain any point
+            }
+
+            uint32_t x0 = (r->bb_min[0] - global_world.room_grid_min[0]) / cell_size;
+            uint32_t y0 = (r->bb_min[1] - global_world.room_grid_min[1]) / cell_size;
+            uint32_t x1 = (r->bb_max[0] - global_world.room_grid_min[0]) / cell_size;
+            uint32_t y1 = (r->bb_max[1] - global_world.room_grid_min[1]) / cell_size;
+            x1 = (x1 < global_world.room_grid_x) ? (x1) : (global_world.room_grid_x - 1);
+            y1 = (y1 < global_world.room_grid_y) ? (y1) : (global_world.room_grid_y - 1);
+            for(uint32_t x = x0; x <= x1; x++)
+            {
+                for(uint32_t y = y0; y <= y1; y++)
+                {
+                    uint32_t cell = x * global_world.room_grid_y + y;
+                    if(pass == 0)
+                    {
+                        global_world.room_grid_offsets[cell + 1]++;
+                    }
+                    else
+                    {
+                        global_world.room_grid_list[global_world.room_grid_offsets[cell]++] = i;
+                    }
+                }
+            }
+        }
+
+        if(pass == 0)
+        {
+            for(uint32_t i = 0; i < cells_count; i++)
+            {
+                global_world.room_grid_offsets[i + 1] += global_world.room_grid_offsets[i];
+            }
+            global_world.room_grid_list = (uint32_t*)malloc((global_world.room_grid_offsets[cells_count] + 1) * sizeof(uint32_t));
+        }
+    }
+
+    // Filling has moved every offset to the start of the next cell.
+    for(uint32_t i = cells_count; i > 0; i--)
+    {
+        global_world.room_grid_offsets[i] = global_world.room_grid_offsets[i - 1];
+    }
+    global_world.room_grid_offsets[0] = 0;
 }
 
 